@@ -22,16 +22,9 @@ HRESULT ApplicationLoopbackCapture::InitializeLoopbackCapture()
     // Create events for sample ready or user stop
     RETURN_IF_FAILED(m_SampleReadyEvent.create(wil::EventOptions::None));
 
-    // Initialize MF
+    // Initialize MF, used for the start and stop work items
     RETURN_IF_FAILED(MFStartup(MF_VERSION, MFSTARTUP_LITE));
 
-    // Register MMCSS work queue
-    DWORD dwTaskID = 0;
-    RETURN_IF_FAILED(MFLockSharedWorkQueue(L"Capture", 0, &dwTaskID, &m_dwQueueID));
-
-    // Set the capture event work queue to use the MMCSS queue
-    m_xSampleReady.SetQueueID(m_dwQueueID);
-
     // Create the completion event as auto-reset
     RETURN_IF_FAILED(m_hActivateCompleted.create(wil::EventOptions::None));
 
@@ -43,10 +36,7 @@ HRESULT ApplicationLoopbackCapture::InitializeLoopbackCapture()
 
 ApplicationLoopbackCapture::~ApplicationLoopbackCapture()
 {
-    if (m_dwQueueID != 0)
-    {
-        MFUnlockWorkQueue(m_dwQueueID);
-    }
+    CaptureScheduler::GetInstance().Unregister(m_SampleReadyRegistration);
 }
 
 HRESULT ApplicationLoopbackCapture::ActivateAudioInterface(DWORD processId, bool includeProcessTree)
@@ -97,7 +87,7 @@ HRESULT ApplicationLoopbackCapture::ActivateCompleted(IActivateAudioInterfaceAsy
             // 16 - bit PCM format.
             m_CaptureFormat.wFormatTag = WAVE_FORMAT_PCM;
             m_CaptureFormat.nChannels = 2;
-            m_CaptureFormat.nSamplesPerSec = 44100;
+            m_CaptureFormat.nSamplesPerSec = m_SampleRate;
             m_CaptureFormat.wBitsPerSample = 16;
             m_CaptureFormat.nBlockAlign = m_CaptureFormat.nChannels * m_CaptureFormat.wBitsPerSample / BITS_PER_BYTE;
             m_CaptureFormat.nAvgBytesPerSec = m_CaptureFormat.nSamplesPerSec * m_CaptureFormat.nBlockAlign;
@@ -110,15 +100,14 @@ HRESULT ApplicationLoopbackCapture::ActivateCompleted(IActivateAudioInterfaceAsy
                 &m_CaptureFormat,
                 nullptr));
 
+            RETURN_IF_FAILED(m_Sink.SetFormat(SampleFormat::Int16, SampleFormat::Int16, m_CaptureFormat.nChannels, m_CaptureFormat.nSamplesPerSec));
+
             // Get the maximum size of the AudioClient Buffer
             RETURN_IF_FAILED(m_AudioClient->GetBufferSize(&m_BufferFrames));
 
             // Get the capture client
             RETURN_IF_FAILED(m_AudioClient->GetService(IID_PPV_ARGS(&m_AudioCaptureClient)));
 
-            // Create Async callback for sample events
-            RETURN_IF_FAILED(MFCreateAsyncResult(nullptr, &m_xSampleReady, nullptr, &m_SampleReadyAsyncResult));
-
             // Tell the system which event handle it should signal when an audio buffer is ready to be processed by the client
             RETURN_IF_FAILED(m_AudioClient->SetEventHandle(m_SampleReadyEvent.get()));
 
@@ -133,11 +122,11 @@ HRESULT ApplicationLoopbackCapture::ActivateCompleted(IActivateAudioInterfaceAsy
     return S_OK;
 }
 
-HRESULT ApplicationLoopbackCapture::StartCaptureAsync(DWORD processId, bool includeProcessTree)
+HRESULT ApplicationLoopbackCapture::StartCaptureAsync()
 {
-    RETURN_IF_WIN32_BOOL_FALSE(CreateServerPipe(processId));
+    RETURN_IF_FAILED(m_Sink.Open(m_PipeId));
     RETURN_IF_FAILED(InitializeLoopbackCapture());
-    RETURN_IF_FAILED(ActivateAudioInterface(processId, includeProcessTree));
+    RETURN_IF_FAILED(ActivateAudioInterface(m_PipeId, m_IncludeProcessTree));
 
     // We should be in the initialzied state if this is the first time through getting ready to capture.
     if (m_DeviceState == DeviceState::Initialized)
@@ -162,9 +151,10 @@ HRESULT ApplicationLoopbackCapture::OnStartCapture(IMFAsyncResult* pResult)
             RETURN_IF_FAILED(m_AudioClient->Start());
 
             m_DeviceState = DeviceState::Capturing;
-            MFPutWaitingWorkItem(m_SampleReadyEvent.get(), 0, m_SampleReadyAsyncResult.get(), &m_SampleReadyKey);
 
-            return S_OK;
+            // Packets are read on the shared capture threads
+            return CaptureScheduler::GetInstance().Register(m_SampleReadyEvent.get(),
+                [this]() { OnSampleReady(); }, m_SampleReadyRegistration);
         }());
 }
 
@@ -176,10 +166,12 @@ HRESULT ApplicationLoopbackCapture::OnStartCapture(IMFAsyncResult* pResult)
 //
 HRESULT ApplicationLoopbackCapture::StopCaptureAsync()
 {
-    ClosePipe();
-
-    RETURN_HR_IF(E_NOT_VALID_STATE, (m_DeviceState != DeviceState::Capturing) &&
-        (m_DeviceState != DeviceState::Error));
+    // Nothing is delivering unless capture got going, the sink may still be open from StartCaptureAsync
+    if ((m_DeviceState != DeviceState::Capturing) && (m_DeviceState != DeviceState::Error))
+    {
+        m_Sink.Close();
+        return E_NOT_VALID_STATE;
+    }
 
     m_DeviceState = DeviceState::Stopping;
 
@@ -198,16 +190,15 @@ HRESULT ApplicationLoopbackCapture::StopCaptureAsync()
 //
 HRESULT ApplicationLoopbackCapture::OnStopCapture(IMFAsyncResult* pResult)
 {
-    // Stop capture by cancelling Work Item
-    // Cancel the queued work item (if any)
-    if (0 != m_SampleReadyKey)
-    {
-        MFCancelWorkItem(m_SampleReadyKey);
-        m_SampleReadyKey = 0;
-    }
+    // Stop capture by removing the sample event from the scheduler, no packet
+    // callback is running once this returns
+    CaptureScheduler::GetInstance().Unregister(m_SampleReadyRegistration);
+    m_SampleReadyRegistration = 0;
 
     m_AudioClient->Stop();
-    m_SampleReadyAsyncResult.reset();
+
+    // Closed only now so that the packet that was being delivered still gets through
+    m_Sink.Close();
 
     return FinishCaptureAsync();
 }
@@ -241,25 +232,14 @@ HRESULT ApplicationLoopbackCapture::OnFinishCapture(IMFAsyncResult* pResult)
 //
 //  OnSampleReady()
 //
-//  Callback method when ready to fill sample buffer
+//  Called by the capture scheduler every time the audio engine signals m_SampleReadyEvent
 //
-HRESULT ApplicationLoopbackCapture::OnSampleReady(IMFAsyncResult* pResult)
+void ApplicationLoopbackCapture::OnSampleReady()
 {
-    if (SUCCEEDED(OnAudioSampleRequested()))
-    {
-        // Re-queue work item for next sample
-        if (m_DeviceState == DeviceState::Capturing)
-        {
-            // Re-queue work item for next sample
-            return MFPutWaitingWorkItem(m_SampleReadyEvent.get(), 0, m_SampleReadyAsyncResult.get(), &m_SampleReadyKey);
-        }
-    }
-    else
+    if (FAILED(OnAudioSampleRequested()))
     {
         m_DeviceState = DeviceState::Error;
     }
-
-    return S_OK;
 }
 
 //
@@ -274,7 +254,6 @@ HRESULT ApplicationLoopbackCapture::OnAudioSampleRequested()
     DWORD dwCaptureFlags;
     UINT64 u64DevicePosition = 0;
     UINT64 u64QPCPosition = 0;
-    DWORD cbBytesToCapture = 0;
 
     auto lock = m_CritSec.lock();
 
@@ -307,13 +286,11 @@ HRESULT ApplicationLoopbackCapture::OnAudioSampleRequested()
     // over and over again until it indicates there are no more packets remaining.
     while (SUCCEEDED(m_AudioCaptureClient->GetNextPacketSize(&FramesAvailable)) && FramesAvailable > 0)
     {
-        cbBytesToCapture = FramesAvailable * m_CaptureFormat.nBlockAlign;
-
         // Get sample buffer
         RETURN_IF_FAILED(m_AudioCaptureClient->GetBuffer(&Data, &FramesAvailable, &dwCaptureFlags, &u64DevicePosition, &u64QPCPosition));
 
-        // Write to Pipe
-        WriteToPipe(Data, cbBytesToCapture);
+        // Hand the packet over to the transport and the mixdown, this never blocks
+        m_Sink.Deliver(Data, FramesAvailable, dwCaptureFlags);
 
         // Release buffer back
         m_AudioCaptureClient->ReleaseBuffer(FramesAvailable);
@@ -321,31 +298,3 @@ HRESULT ApplicationLoopbackCapture::OnAudioSampleRequested()
 
     return S_OK;
 }
-
-BOOL ApplicationLoopbackCapture::CreateServerPipe(DWORD pid) {
-    TCHAR pipeName[256];
-    swprintf_s(pipeName, _countof(pipeName), L"\\\\.\\pipe\\AudioDataPipe_%lu_%lld", pid, m_CaptureId);
-    m_hPipe = CreateNamedPipe(
-        pipeName,
-        PIPE_ACCESS_OUTBOUND,
-        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
-        1,
-        1024 * 16,
-        0,
-        0,
-        NULL
-    );
-
-    return m_hPipe != INVALID_HANDLE_VALUE;
-}
-
-void ApplicationLoopbackCapture::WriteToPipe(const PBYTE data, DWORD dataSize) {
-    if (m_hPipe != INVALID_HANDLE_VALUE) {
-        DWORD written = 0;
-        WriteFile(m_hPipe, data, dataSize, &written, NULL);
-    }
-}
-
-void ApplicationLoopbackCapture::ClosePipe() {
-    CloseHandle(m_hPipe);
-}
@@ -10,23 +10,31 @@
 #include <wil\com.h>
 #include <wil\result.h>
 
+#include "AudioCaptureSource.h"
+#include "CaptureScheduler.h"
 #include "Common.h"
 
 using namespace Microsoft::WRL;
 
 class ApplicationLoopbackCapture :
-    public RuntimeClass< RuntimeClassFlags< ClassicCom >, FtmBase, IActivateAudioInterfaceCompletionHandler >
+    public RuntimeClass< RuntimeClassFlags< ClassicCom >, FtmBase, IActivateAudioInterfaceCompletionHandler >,
+    public AudioCaptureSource
 {
 public:
-    ApplicationLoopbackCapture(long long captureId) : m_CaptureId(captureId) {}
-    ~ApplicationLoopbackCapture();
+    // The stream's pipe id is the captured process id.
+    ApplicationLoopbackCapture(long long captureId, DWORD processId, bool includeProcessTree, TransportType transport = TransportType::NamedPipe) :
+        AudioCaptureSource(captureId, processId, transport), m_IncludeProcessTree(includeProcessTree) {}
+    ~ApplicationLoopbackCapture() override;
 
-    HRESULT StartCaptureAsync(DWORD processId, bool includeProcessTree);
-    HRESULT StopCaptureAsync();
+    HRESULT StartCaptureAsync() override;
+    HRESULT StopCaptureAsync() override;
+
+    // The stream is requested at this rate. The audio engine converts from its mix rate anyway,
+    // so no resampler of our own is involved.
+    void SetTargetSampleRate(uint32_t sampleRate, ResamplerQuality) override { m_SampleRate = sampleRate; }
 
     METHODASYNCCALLBACK(ApplicationLoopbackCapture, StartCapture, OnStartCapture);
     METHODASYNCCALLBACK(ApplicationLoopbackCapture, StopCapture, OnStopCapture);
-    METHODASYNCCALLBACK(ApplicationLoopbackCapture, SampleReady, OnSampleReady);
     METHODASYNCCALLBACK(ApplicationLoopbackCapture, FinishCapture, OnFinishCapture);
 
     // IActivateAudioInterfaceCompletionHandler
@@ -49,13 +57,10 @@ private:
     HRESULT OnStartCapture(IMFAsyncResult* pResult);
     HRESULT OnStopCapture(IMFAsyncResult* pResult);
     HRESULT OnFinishCapture(IMFAsyncResult* pResult);
-    HRESULT OnSampleReady(IMFAsyncResult* pResult);
+    void OnSampleReady();
 
     HRESULT InitializeLoopbackCapture();
     HRESULT OnAudioSampleRequested();
-    BOOL CreateServerPipe(DWORD pid);
-    void WriteToPipe(const PBYTE data, DWORD dataSize);
-    void ClosePipe();
 
     HRESULT ActivateAudioInterface(DWORD processId, bool includeProcessTree);
     HRESULT FinishCaptureAsync();
@@ -64,14 +69,13 @@ private:
 
     wil::com_ptr_nothrow<IAudioClient> m_AudioClient;
     WAVEFORMATEX m_CaptureFormat{};
+    DWORD m_SampleRate = 44100;
     UINT32 m_BufferFrames = 0;
     wil::com_ptr_nothrow<IAudioCaptureClient> m_AudioCaptureClient;
-    wil::com_ptr_nothrow<IMFAsyncResult> m_SampleReadyAsyncResult;
 
     wil::unique_event_nothrow m_SampleReadyEvent;
-    MFWORKITEM_KEY m_SampleReadyKey = 0;
+    CaptureScheduler::RegistrationId m_SampleReadyRegistration = 0;
     wil::critical_section m_CritSec;
-    DWORD m_dwQueueID = 0;
     DWORD m_cbHeaderSize = 0;
     DWORD m_cbDataSize = 0;
 
@@ -83,7 +87,5 @@ private:
     wil::unique_event_nothrow m_hActivateCompleted;
     wil::unique_event_nothrow m_hCaptureStopped;
 
-    HANDLE m_hPipe = NULL;
-
-    long long m_CaptureId = 0;
+    bool m_IncludeProcessTree;
 };
@@ -0,0 +1,312 @@
+#include "AsyncFileWriter.h"
+
+#include <winioctl.h>
+#include <wil/result.h>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+AsyncFileWriter::~AsyncFileWriter() {
+    Close();
+}
+
+HRESULT AsyncFileWriter::Open(const std::wstring& filePath, const AsyncWriteSettings& settings) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, m_File.is_valid());
+    RETURN_HR_IF(E_INVALIDARG, settings.BufferSize == 0 || settings.BufferSize % WriteAlignment != 0 || settings.BufferCount < 2);
+
+    if (!m_SyncEvent) {
+        RETURN_IF_FAILED(m_SyncEvent.create(wil::EventOptions::ManualReset));
+    }
+
+    // Buffers are reused across files of the same layout.
+    if (!m_Memory || m_Settings.BufferSize != settings.BufferSize || m_Settings.BufferCount != settings.BufferCount) {
+        m_Memory.reset(static_cast<uint8_t*>(VirtualAlloc(nullptr, static_cast<size_t>(settings.BufferSize) * settings.BufferCount,
+            MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)));
+        RETURN_LAST_ERROR_IF(!m_Memory);
+    }
+
+    m_File.reset(CreateFileW(filePath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, nullptr));
+    RETURN_LAST_ERROR_IF(!m_File.is_valid());
+
+    if (const HRESULT hr = AsyncIoBackend::GetDefault().Attach(m_File.get()); FAILED(hr)) {
+        m_File.reset();
+        return hr;
+    }
+
+    m_Settings = settings;
+    m_Buffers.assign(settings.BufferCount, {});
+    m_FreeBuffers.clear();
+    for (uint32_t i = 0; i < settings.BufferCount; ++i) {
+        m_Buffers[i].Owner = this;
+        m_Buffers[i].File = m_File.get();
+        m_Buffers[i].Data = m_Memory.get() + static_cast<size_t>(i) * settings.BufferSize;
+        m_FreeBuffers.push_back(&m_Buffers[i]);
+    }
+
+    m_Current = nullptr;
+    m_Size = 0;
+    m_IsSparse = false;
+    m_SparseChecked = false;
+    m_InFlight = 0;
+    m_Error = S_OK;
+    m_Allocated = 0;
+    m_LastFlush = std::chrono::steady_clock::now();
+    m_Stats = {};
+    m_WriteLatency.Reset();
+    return S_OK;
+}
+
+HRESULT AsyncFileWriter::Append(const void* data, size_t size) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_File.is_valid());
+
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        if (!m_Current) {
+            RETURN_IF_FAILED(AcquireBuffer());
+        }
+
+        const size_t count = (std::min)(size, m_Current->Capacity - m_Current->Size);
+        memcpy(m_Current->Data + m_Current->Size, bytes, count);
+        m_Current->Size += count;
+        m_Size += count;
+        bytes += count;
+        size -= count;
+
+        if (m_Current->Size == m_Current->Capacity) {
+            RETURN_IF_FAILED(Submit());
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT AsyncFileWriter::AppendZeros(uint64_t size) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_File.is_valid());
+
+    if (size >= MinSparseRun && !m_SparseChecked) {
+        m_SparseChecked = true;
+        m_IsSparse = SUCCEEDED(MakeSparse());
+    }
+
+    // Skipped bytes read as zeros, Close() sets the file size in case the file ends in a hole.
+    if (m_IsSparse && size >= MinSparseRun) {
+        RETURN_IF_FAILED(Submit());
+        m_Size += size;
+        return S_OK;
+    }
+
+    while (size > 0) {
+        if (!m_Current) {
+            RETURN_IF_FAILED(AcquireBuffer());
+        }
+
+        const size_t count = static_cast<size_t>((std::min)(size, static_cast<uint64_t>(m_Current->Capacity - m_Current->Size)));
+        memset(m_Current->Data + m_Current->Size, 0, count);
+        m_Current->Size += count;
+        m_Size += count;
+        size -= count;
+
+        if (m_Current->Size == m_Current->Capacity) {
+            RETURN_IF_FAILED(Submit());
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT AsyncFileWriter::WriteAt(uint64_t offset, const void* data, size_t size) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_File.is_valid());
+
+    RETURN_IF_FAILED(Submit());
+    RETURN_IF_FAILED(WaitForWrites());
+    return WriteSync(offset, data, size);
+}
+
+HRESULT AsyncFileWriter::Submit() {
+    if (!m_Current) {
+        return S_OK;
+    }
+
+    Buffer& buffer = *std::exchange(m_Current, nullptr);
+
+    std::lock_guard lock(m_Lock);
+    if (buffer.Size == 0 || FAILED(m_Error)) {
+        m_FreeBuffers.push_back(&buffer);
+        return m_Error;
+    }
+
+    buffer.Submitted = std::chrono::steady_clock::now();
+    ++m_InFlight;
+    if (!AsyncIoBackend::GetDefault().Submit(buffer)) {
+        --m_InFlight;
+        m_FreeBuffers.push_back(&buffer);
+        m_Error = HRESULT_FROM_WIN32(GetLastError());
+    }
+    return m_Error;
+}
+
+HRESULT AsyncFileWriter::Flush() {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_File.is_valid());
+
+    RETURN_IF_FAILED(Submit());
+    RETURN_IF_FAILED(WaitForWrites());
+    RETURN_IF_WIN32_BOOL_FALSE(FlushFileBuffers(m_File.get()));
+
+    std::lock_guard lock(m_Lock);
+    ++m_Stats.Flushes;
+    return S_OK;
+}
+
+HRESULT AsyncFileWriter::Close() {
+    if (!m_File.is_valid()) {
+        return S_OK;
+    }
+
+    auto closeFile = wil::scope_exit([&] {
+        m_File.reset();
+        AsyncIoBackend::GetDefault().Detach();
+    });
+
+    // Nothing may be in flight once the file is closed, even after an error.
+    const HRESULT submitted = Submit();
+    const HRESULT written = WaitForWrites();
+    RETURN_IF_FAILED(submitted);
+    RETURN_IF_FAILED(written);
+
+    // Gives the preallocation beyond the data back and extends the file over a trailing hole.
+    FILE_END_OF_FILE_INFO endOfFile = {};
+    endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(m_Size);
+    RETURN_IF_WIN32_BOOL_FALSE(SetFileInformationByHandle(m_File.get(), FileEndOfFileInfo, &endOfFile, sizeof(endOfFile)));
+
+    if (m_Settings.FlushIntervalMs != 0) {
+        RETURN_IF_WIN32_BOOL_FALSE(FlushFileBuffers(m_File.get()));
+    }
+    return S_OK;
+}
+
+AsyncWriteStats AsyncFileWriter::GetStats() const {
+    std::lock_guard lock(m_Lock);
+    return m_Stats;
+}
+
+HRESULT AsyncFileWriter::AcquireBuffer() {
+    std::unique_lock lock(m_Lock);
+
+    if (m_FreeBuffers.empty() && SUCCEEDED(m_Error)) {
+        const auto start = std::chrono::steady_clock::now();
+        m_Completed.wait(lock, [&] { return !m_FreeBuffers.empty() || FAILED(m_Error); });
+        ++m_Stats.Stalls;
+        m_Stats.StallNanoseconds += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    RETURN_IF_FAILED(m_Error);
+
+    m_Current = m_FreeBuffers.back();
+    m_FreeBuffers.pop_back();
+
+    // A shorter first buffer after an unaligned position keeps all further writes aligned.
+    m_Current->Offset = m_Size;
+    m_Current->Size = 0;
+    m_Current->Capacity = m_Settings.BufferSize - static_cast<size_t>(m_Size % WriteAlignment);
+    return S_OK;
+}
+
+HRESULT AsyncFileWriter::WaitForWrites() {
+    std::unique_lock lock(m_Lock);
+    m_Completed.wait(lock, [&] { return m_InFlight == 0; });
+    return m_Error;
+}
+
+HRESULT AsyncFileWriter::MakeSparse() {
+    RETURN_IF_FAILED(Submit());
+    RETURN_IF_FAILED(WaitForWrites());
+
+    // The low bit of the event keeps the completion away from the I/O thread's port.
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<ULONG_PTR>(m_SyncEvent.get()) | 1);
+    m_SyncEvent.ResetEvent();
+
+    DWORD returned = 0;
+    if (!DeviceIoControl(m_File.get(), FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, &overlapped)) {
+        RETURN_LAST_ERROR_IF(GetLastError() != ERROR_IO_PENDING);
+    }
+    RETURN_IF_WIN32_BOOL_FALSE(GetOverlappedResult(m_File.get(), &overlapped, &returned, TRUE));
+    return S_OK;
+}
+
+HRESULT AsyncFileWriter::WriteSync(uint64_t offset, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<ULONG_PTR>(m_SyncEvent.get()) | 1);
+        m_SyncEvent.ResetEvent();
+
+        const DWORD chunkSize = static_cast<DWORD>((std::min)(size, static_cast<size_t>(MAXDWORD)));
+        DWORD written = 0;
+        if (!WriteFile(m_File.get(), bytes, chunkSize, nullptr, &overlapped)) {
+            RETURN_LAST_ERROR_IF(GetLastError() != ERROR_IO_PENDING);
+        }
+        RETURN_IF_WIN32_BOOL_FALSE(GetOverlappedResult(m_File.get(), &overlapped, &written, TRUE));
+
+        bytes += written;
+        offset += written;
+        size -= written;
+    }
+
+    return S_OK;
+}
+
+void AsyncFileWriter::PrepareWrite(AsyncIoRequest& request) {
+    // Extending the allocation ahead of the writes lets the file system place the file in a few
+    // large extents. Sparse files keep their holes instead.
+    const uint64_t end = request.Offset + request.Size;
+    const uint64_t step = m_Settings.PreallocationStep;
+    if (step != 0 && !m_IsSparse && end > m_Allocated) {
+        FILE_ALLOCATION_INFO allocation = {};
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>((end + step - 1) / step * step);
+        if (SetFileInformationByHandle(m_File.get(), FileAllocationInfo, &allocation, sizeof(allocation))) {
+            m_Allocated = static_cast<uint64_t>(allocation.AllocationSize.QuadPart);
+        }
+        else {
+            // Not worth retrying on every write, the data is written either way.
+            m_Allocated = UINT64_MAX;
+        }
+    }
+}
+
+void AsyncFileWriter::CompleteWrite(AsyncIoRequest& request, DWORD error) {
+    auto& buffer = static_cast<Buffer&>(request);
+    const auto now = std::chrono::steady_clock::now();
+    m_WriteLatency.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - buffer.Submitted).count()));
+
+    bool flushed = false;
+    DWORD flushError = ERROR_SUCCESS;
+    if (error == ERROR_SUCCESS && m_Settings.FlushIntervalMs != 0 &&
+        now - m_LastFlush >= std::chrono::milliseconds(m_Settings.FlushIntervalMs)) {
+        flushed = true;
+        flushError = FlushFileBuffers(m_File.get()) ? ERROR_SUCCESS : GetLastError();
+        m_LastFlush = now;
+    }
+
+    // Notified under the lock: the writer may be gone as soon as it sees no write in flight.
+    std::lock_guard lock(m_Lock);
+    if (error != ERROR_SUCCESS || flushError != ERROR_SUCCESS) {
+        if (SUCCEEDED(m_Error)) {
+            m_Error = HRESULT_FROM_WIN32(error != ERROR_SUCCESS ? error : flushError);
+        }
+    }
+    else {
+        m_Stats.BytesWritten += buffer.Size;
+        ++m_Stats.Writes;
+    }
+    if (flushed) {
+        ++m_Stats.Flushes;
+    }
+
+    m_FreeBuffers.push_back(&buffer);
+    --m_InFlight;
+    m_Completed.notify_all();
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AsyncIoBackend.h"
+#include "LatencyHistogram.h"
+
+struct AsyncWriteSettings {
+    // Size of every buffer and of every write but the last, a multiple of AsyncFileWriter::WriteAlignment.
+    uint32_t BufferSize = 1024 * 1024;
+    // 2 for double, 3 for triple buffering. Appending only waits when all of them are being written.
+    uint32_t BufferCount = 3;
+    // The file's allocation is extended in steps of this size ahead of the writes so the file
+    // system can hand out contiguous extents. 0 lets the file grow write by write.
+    uint64_t PreallocationStep = 64ull * 1024 * 1024;
+    // Completed writes are flushed to the disk at most this often, and once more on Close().
+    // 0 leaves flushing to the system.
+    uint32_t FlushIntervalMs = 0;
+};
+
+struct AsyncWriteStats {
+    uint64_t BytesWritten;
+    uint64_t Writes;
+    uint64_t Flushes;
+    // Appends that found every buffer in flight and had to wait for the disk.
+    uint64_t Stalls;
+    uint64_t StallNanoseconds;
+};
+
+// Sequential file writer that keeps the disk off the caller's thread. Appends are copied into one
+// of BufferCount aligned buffers; a full buffer is handed to the shared I/O thread, which issues it
+// as one overlapped write at its file offset, so a slow disk costs the caller nothing as long as a
+// buffer is free. The file is preallocated ahead of the writes and trimmed to its real size on
+// Close(). Errors of a queued write are returned by the next call.
+//
+// The I/O thread is AsyncIoBackend::GetDefault(), which only has an I/O completion port
+// implementation so far. There is no io_uring backend yet, and opening, preallocation, sparse
+// files, WriteAt and Flush still call Win32 directly, so the writer only builds on Windows.
+//
+// One thread at a time per writer.
+class AsyncFileWriter : private AsyncIoTarget {
+public:
+    static constexpr size_t WriteAlignment = 4096;
+    // Runs of zeros from this size on become holes once the file is sparse.
+    static constexpr uint64_t MinSparseRun = 64 * 1024;
+
+    AsyncFileWriter() = default;
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    HRESULT Open(const std::wstring& filePath, const AsyncWriteSettings& settings = {});
+    bool IsOpen() const { return m_File.is_valid(); }
+
+    HRESULT Append(const void* data, size_t size);
+
+    // Appends `size` zero bytes. Long runs are left as holes if the file system supports sparse
+    // files; the first one switches the file to sparse, which also ends its preallocation.
+    HRESULT AppendZeros(uint64_t size);
+
+    // Waits for everything appended so far and writes `size` bytes at `offset`, for headers that are
+    // only known at the end.
+    HRESULT WriteAt(uint64_t offset, const void* data, size_t size);
+
+    // Hands the partly filled buffer to the I/O thread without waiting for it.
+    HRESULT Submit();
+
+    // Waits for everything appended so far and flushes it to the disk.
+    HRESULT Flush();
+
+    HRESULT Close();
+
+    // Bytes appended, the file size after Close().
+    uint64_t GetSize() const { return m_Size; }
+    AsyncWriteStats GetStats() const;
+    // Time from handing a buffer to the I/O thread until its write completed.
+    const LatencyHistogram& GetWriteLatency() const { return m_WriteLatency; }
+
+private:
+    struct Buffer : AsyncIoRequest {
+        size_t Capacity;
+        std::chrono::steady_clock::time_point Submitted;
+    };
+
+    // Caller thread.
+    HRESULT AcquireBuffer();
+    HRESULT WaitForWrites();
+    HRESULT MakeSparse();
+    HRESULT WriteSync(uint64_t offset, const void* data, size_t size);
+
+    // I/O thread.
+    void PrepareWrite(AsyncIoRequest& request) override;
+    void CompleteWrite(AsyncIoRequest& request, DWORD error) override;
+
+    wil::unique_hfile m_File;
+    wil::unique_event_nothrow m_SyncEvent;
+    AsyncWriteSettings m_Settings;
+    wil::unique_virtualalloc_ptr<uint8_t> m_Memory;
+    std::vector<Buffer> m_Buffers;
+    Buffer* m_Current = nullptr;
+    uint64_t m_Size = 0;
+    bool m_IsSparse = false;
+    bool m_SparseChecked = false;
+
+    mutable std::mutex m_Lock;
+    std::condition_variable m_Completed;
+    std::vector<Buffer*> m_FreeBuffers;
+    size_t m_InFlight = 0;
+    HRESULT m_Error = S_OK;
+
+    // Touched by the I/O thread only.
+    uint64_t m_Allocated = 0;
+    std::chrono::steady_clock::time_point m_LastFlush;
+
+    AsyncWriteStats m_Stats = {};
+    LatencyHistogram m_WriteLatency;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstddef>
+#include <cstdint>
+
+class AsyncIoTarget;
+
+// One positioned write of `Size` bytes from `Data` at `Offset` of `File`. Owned by the target and
+// left alone until the backend handed it back through AsyncIoTarget::CompleteWrite.
+struct AsyncIoRequest {
+    // First member, the completion port backend gets it back from the port. Other backends may
+    // ignore it.
+    OVERLAPPED Overlapped;
+    AsyncIoTarget* Owner;
+    HANDLE File;
+    uint8_t* Data;
+    size_t Size;
+    uint64_t Offset;
+};
+
+// Receives the requests it submitted back on the backend's I/O thread.
+class AsyncIoTarget {
+public:
+    // Right before the write is issued, for work that belongs on the I/O thread, like extending
+    // the file's allocation.
+    virtual void PrepareWrite(AsyncIoRequest& request) = 0;
+
+    // The write finished, failed or could not be issued. `error` is a Win32 error code; a short
+    // write is reported as ERROR_WRITE_FAULT.
+    virtual void CompleteWrite(AsyncIoRequest& request, DWORD error) = 0;
+
+protected:
+    ~AsyncIoTarget() = default;
+};
+
+// Issues the writes of every AsyncFileWriter and hands back their completions, on one thread that
+// runs while at least one file is attached. AsyncFileWriter only sees this interface; the backend
+// is chosen by GetDefault.
+//
+// The only implementation is IocpIoBackend, an I/O completion port. An io_uring backend would be a
+// second implementation with its own GetDefault in a Linux build; none exists yet, and the file
+// handling around it (CreateFileW, preallocation, sparse files) in AsyncFileWriter is Win32 still.
+class AsyncIoBackend {
+public:
+    // The backend of this platform. Never destroyed.
+    static AsyncIoBackend& GetDefault();
+
+    virtual ~AsyncIoBackend() = default;
+
+    // `file` must be opened for overlapped I/O. Starts the I/O thread for the first file.
+    virtual HRESULT Attach(HANDLE file) = 0;
+
+    // The file has no request in flight anymore. Stops the I/O thread after the last file.
+    virtual void Detach() = 0;
+
+    // Queues `request` for the I/O thread, which calls PrepareWrite, writes and later calls
+    // CompleteWrite. False with the thread's last error set if it could not be queued, in which
+    // case CompleteWrite is not called.
+    virtual bool Submit(AsyncIoRequest& request) = 0;
+};
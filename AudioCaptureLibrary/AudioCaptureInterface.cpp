@@ -9,6 +9,7 @@
 #include <sstream>
 #include <iomanip>
 #include <memory>
+#include <mutex>
 #include <comutil.h>
 #include <vector>
 #include <propkey.h>
@@ -17,11 +18,36 @@
 #include <functiondiscoverykeys_devpkey.h>
 #include <string>
 #include <functional>
+#include <algorithm>
+#include <cmath>
 
 #include "pch.h"
 #include "ApplicationLoopbackCapture.h"
+#include "AudioMixer.h"
 #include "AudioDeviceCapture.h"
 #include "AudioSessionNotification.h"
+#include "CaptureOptions.h"
+#include "CaptureStats.h"
+#include "CompressedReplayBuffer.h"
+#include "DeviceCacheBenchmark.h"
+#include "DeviceChangeLog.h"
+#include "DeviceSnapshot.h"
+#include "DiskWriterBenchmark.h"
+#include "FlacBenchmark.h"
+#include "FlacFileWriter.h"
+#include "InstantReplayBuffer.h"
+#include "MixdownBenchmark.h"
+#include "MultitrackReader.h"
+#include "MultitrackWriter.h"
+#include "PipelineBenchmark.h"
+#include "RecordingJournal.h"
+#include "ReplayBufferBenchmark.h"
+#include "SampleConverterBenchmark.h"
+#include "SharedMemoryReader.h"
+#include "SimulatedCaptureSource.h"
+#include "WavFileReader.h"
+#include "WavFileWriter.h"
+#include "WaveformPyramid.h"
 #include "Logger.h"
 #include "OutputAudioDeviceManager.h"
 #include "InputAudioDeviceManager.h"
@@ -31,7 +57,7 @@ static OutputAudioDeviceManager* outputDeviceManager = new OutputAudioDeviceMana
 
 extern "C" __declspec(dllexport) void __stdcall RegisterInputNotificationCallback(DeviceStateChangedCallback callback) {
     Logger::GetInstance().Log("RegisterInputNotificationCallback", LogLevel::Info);
-    inputDeviceManager->RegisterNotificationCallback(callback, eCapture);
+    inputDeviceManager->RegisterNotificationCallback(callback);
 }
 
 extern "C" __declspec(dllexport) void __stdcall UnregisterInputNotificationCallback() {
@@ -102,7 +128,7 @@ extern "C" __declspec(dllexport) void __stdcall FreeInputAudioDevice(InputAudioD
 
 extern "C" __declspec(dllexport) void __stdcall RegisterOutputNotificationCallback(DeviceStateChangedCallback callback) {
     Logger::GetInstance().Log("RegisterOutputNotificationCallback", LogLevel::Info);
-    outputDeviceManager->RegisterNotificationCallback(callback, eRender);
+    outputDeviceManager->RegisterNotificationCallback(callback);
 }
 
 extern "C" __declspec(dllexport) void __stdcall UnregisterOutputNotificationCallback() {
@@ -217,8 +243,94 @@ extern "C" __declspec(dllexport) void __stdcall FreeOutputAudioDevicesArray(Outp
     }
 }
 
+// One writer for both flows, its buffers are kept between calls.
+static DeviceSnapshotWriter snapshotWriter;
+static std::mutex snapshotLock;
+
+static int CopyDeviceSnapshot(AudioDeviceManagerBase& manager, const wchar_t* deviceId, BYTE* buffer, int capacity) {
+    std::lock_guard lock(snapshotLock);
+    snapshotWriter.Reset();
+    manager.WriteSnapshot(snapshotWriter, deviceId);
+
+    const auto& snapshot = snapshotWriter.Finish();
+    if (snapshot.size() > static_cast<size_t>(INT_MAX))
+        return -1;
+
+    const int size = static_cast<int>(snapshot.size());
+    if (buffer && capacity >= size) {
+        memcpy(buffer, snapshot.data(), snapshot.size());
+    }
+    return size;
+}
+
+// Devices and sessions as one block laid out as in DeviceSnapshot.h, all active devices when deviceId
+// is null. Returns the size of the snapshot, which is only copied if it fits into capacity, or -1.
+extern "C" __declspec(dllexport) int __stdcall GetOutputDeviceSnapshot(const wchar_t* deviceId, BYTE* buffer, int capacity) {
+    if (capacity < 0)
+        return -1;
+
+    return CopyDeviceSnapshot(*outputDeviceManager, deviceId, buffer, capacity);
+}
+
+extern "C" __declspec(dllexport) int __stdcall GetInputDeviceSnapshot(const wchar_t* deviceId, BYTE* buffer, int capacity) {
+    if (capacity < 0)
+        return -1;
+
+    return CopyDeviceSnapshot(*inputDeviceManager, deviceId, buffer, capacity);
+}
+
+static std::vector<DeviceChange> changeList;
+static std::vector<BYTE> changeBlock;
+
+static int CopyDeviceChanges(AudioDeviceManagerBase& manager, ULONGLONG generation, BYTE* buffer, int capacity) {
+    std::lock_guard lock(snapshotLock);
+    changeList.clear();
+
+    uint64_t current = 0;
+    const std::vector<BYTE>* snapshot = nullptr;
+    if (!manager.GetChangeLog().GetChangesSince(generation, changeList, current)) {
+        // Taken after the generation was read, so nothing between the two is lost.
+        snapshotWriter.Reset();
+        manager.WriteSnapshot(snapshotWriter);
+        snapshot = &snapshotWriter.Finish();
+    }
+
+    WriteDeviceChanges(current, changeList, snapshot, changeBlock);
+    if (changeBlock.size() > static_cast<size_t>(INT_MAX))
+        return -1;
+
+    const int size = static_cast<int>(changeBlock.size());
+    if (buffer && capacity >= size) {
+        memcpy(buffer, changeBlock.data(), changeBlock.size());
+    }
+    return size;
+}
+
+// Device and session state changes after `generation` laid out as in DeviceChangeLog.h, or a full
+// snapshot when they are not all kept anymore; pass 0 for the first call. Returns the size of the
+// block, which is only copied if it fits into capacity, or -1. A call that did not fit has to be
+// repeated with the same generation.
+extern "C" __declspec(dllexport) int __stdcall GetOutputDeviceChanges(ULONGLONG generation, BYTE* buffer, int capacity) {
+    if (capacity < 0)
+        return -1;
+
+    return CopyDeviceChanges(*outputDeviceManager, generation, buffer, capacity);
+}
+
+extern "C" __declspec(dllexport) int __stdcall GetInputDeviceChanges(ULONGLONG generation, BYTE* buffer, int capacity) {
+    if (capacity < 0)
+        return -1;
+
+    return CopyDeviceChanges(*inputDeviceManager, generation, buffer, capacity);
+}
+
 std::map<long long, std::vector<ComPtr<ApplicationLoopbackCapture>>> activeAppCaptures;
-std::map<long long, std::vector<std::unique_ptr<AudioDeviceCapture>>> activeDeviceCaptures;
+std::map<long long, std::vector<std::unique_ptr<AudioCaptureSource>>> activeSources;
+std::map<long long, std::unique_ptr<AudioMixer>> activeMixers;
+// Guards the three maps above, GetCaptureStats may be polled from another thread than the one
+// starting and stopping captures. Sources are started and stopped outside of it, stopping one
+// waits for its transport to drain.
+static std::mutex activeCapturesLock;
 
 long long GenerateUniqueId() {
     auto now = std::chrono::system_clock::now();
@@ -229,7 +341,64 @@ long long GenerateUniqueId() {
     return millis;
 }
 
-extern "C" __declspec(dllexport) long long __stdcall StartCapture(AudioDeviceInfo* inputDevices, int inputDeviceCount, AudioDeviceInfo* outputDevices, int outputDeviceCount, AudioSessionInfo* sessions, int sessionCount) {
+static std::unique_ptr<AudioMixer> CreateMixer(long long captureId, const CaptureOptions& options) {
+    if (!options.MixdownEnabled) {
+        return nullptr;
+    }
+
+    const uint32_t mixRate = options.TargetSampleRate != 0 ? options.TargetSampleRate : AudioMixer::DefaultSampleRate;
+    auto mixer = std::make_unique<AudioMixer>(captureId, mixRate, static_cast<TransportType>(options.Transport),
+        static_cast<ResamplerQuality>(options.ResamplerQuality));
+    mixer->SetCoalescing(options.GetCoalescing());
+    mixer->SetSilenceHandling(options.GetSilenceHandling());
+    return mixer;
+}
+
+// Applies the per-capture options to one source and starts it.
+static HRESULT StartSource(AudioCaptureSource& source, const CaptureOptions& options, AudioMixer* mixer) {
+    if (options.TargetSampleRate != 0) {
+        source.SetTargetSampleRate(options.TargetSampleRate, static_cast<ResamplerQuality>(options.ResamplerQuality));
+    }
+    source.SetCoalescing(options.GetCoalescing());
+    source.SetSilenceHandling(options.GetSilenceHandling());
+    if (mixer) {
+        source.SetMixerInput(mixer->AddInput(source.GetPipeId()));
+    }
+
+    return source.StartCaptureAsync();
+}
+
+// Returns the mixer if it started, it is dropped otherwise.
+static std::unique_ptr<AudioMixer> StartMixer(std::unique_ptr<AudioMixer> mixer) {
+    if (!mixer) {
+        return nullptr;
+    }
+
+    if (const auto hr = mixer->Start(); FAILED(hr)) {
+        Logger::GetInstance().Log("Failed to start mixdown, HRESULT = " + std::to_string(hr), LogLevel::Error);
+        return nullptr;
+    }
+
+    Logger::GetInstance().Log("Started mixdown at " + std::to_string(mixer->GetSampleRate()) + " Hz");
+    return mixer;
+}
+
+// Publishes a capture once all of its sources are running.
+static void AddActiveCapture(long long captureId, std::vector<ComPtr<ApplicationLoopbackCapture>> appCaptures,
+    std::vector<std::unique_ptr<AudioCaptureSource>> sources, std::unique_ptr<AudioMixer> mixer) {
+    std::lock_guard lock(activeCapturesLock);
+    if (!appCaptures.empty()) {
+        activeAppCaptures[captureId] = std::move(appCaptures);
+    }
+    if (!sources.empty()) {
+        activeSources[captureId] = std::move(sources);
+    }
+    if (mixer) {
+        activeMixers[captureId] = std::move(mixer);
+    }
+}
+
+extern "C" __declspec(dllexport) long long __stdcall StartCaptureEx(AudioDeviceInfo* inputDevices, int inputDeviceCount, AudioDeviceInfo* outputDevices, int outputDeviceCount, AudioSessionInfo* sessions, int sessionCount, const CaptureOptions* captureOptions) {
     Logger::GetInstance().Log("StartCapture called.");
     Logger::GetInstance().Log(
         "Parameters: inputDeviceCount = " + std::to_string(inputDeviceCount) +
@@ -237,20 +406,29 @@ extern "C" __declspec(dllexport) long long __stdcall StartCapture(AudioDeviceInf
         ", sessionCount = " + std::to_string(sessionCount)
     );
 
+    const CaptureOptions options = captureOptions ? *captureOptions : CaptureOptions{};
+    const auto transport = static_cast<TransportType>(options.Transport);
+    Logger::GetInstance().Log("Transport: " + std::to_string(options.Transport));
+    Logger::GetInstance().Log("Target sample rate: " + std::to_string(options.TargetSampleRate));
+
 	auto captureId = GenerateUniqueId();
     Logger::GetInstance().Log("Generated captureId: " + std::to_string(captureId));
 
+    auto mixer = CreateMixer(captureId, options);
+    std::vector<ComPtr<ApplicationLoopbackCapture>> appCaptures;
+    std::vector<std::unique_ptr<AudioCaptureSource>> sources;
+
     for (int s = 0; s < sessionCount; ++s) {
         Logger::GetInstance().Log("Starting capture for session index " + std::to_string(s));
         const auto& session = sessions[s];
 
-        ComPtr<ApplicationLoopbackCapture> capture = Make<ApplicationLoopbackCapture>(captureId);
-        if (const auto hr = capture->StartCaptureAsync(session.PipeId, true); SUCCEEDED(hr)) {
+        ComPtr<ApplicationLoopbackCapture> capture = Make<ApplicationLoopbackCapture>(captureId, session.PipeId, true, transport);
+        if (const auto hr = StartSource(*capture.Get(), options, mixer.get()); SUCCEEDED(hr)) {
             Logger::GetInstance().Log(
                 "Successfully started ApplicationLoopbackCapture for session index " +
                 std::to_string(s) + ", PipeId = " + std::to_string(session.PipeId)
             );
-            activeAppCaptures[captureId].push_back(capture);
+            appCaptures.push_back(capture);
         }
         else {
             Logger::GetInstance().Log(
@@ -265,12 +443,12 @@ extern "C" __declspec(dllexport) long long __stdcall StartCapture(AudioDeviceInf
         Logger::GetInstance().Log("Starting capture for input device index " + std::to_string(i));
         const auto& device = inputDevices[i];
 
-        auto capture = std::make_unique<AudioDeviceCapture>(captureId);
-        if (const auto hr = capture->StartCaptureAsync(device.Id, device.PipeId); SUCCEEDED(hr)) {
+        auto capture = std::make_unique<AudioDeviceCapture>(captureId, device.Id, device.PipeId, transport);
+        if (const auto hr = StartSource(*capture, options, mixer.get()); SUCCEEDED(hr)) {
             Logger::GetInstance().Log(
                 "Successfully started AudioDeviceCapture for device index " +
                 std::to_string(i));
-            activeDeviceCaptures[captureId].push_back(std::move(capture));
+            sources.push_back(std::move(capture));
         }
         else {
             Logger::GetInstance().Log(
@@ -280,23 +458,754 @@ extern "C" __declspec(dllexport) long long __stdcall StartCapture(AudioDeviceInf
         }
     }
 
+    AddActiveCapture(captureId, std::move(appCaptures), std::move(sources), StartMixer(std::move(mixer)));
+
     return captureId;
 }
 
+extern "C" __declspec(dllexport) long long __stdcall StartCapture(AudioDeviceInfo* inputDevices, int inputDeviceCount, AudioDeviceInfo* outputDevices, int outputDeviceCount, AudioSessionInfo* sessions, int sessionCount) {
+    return StartCaptureEx(inputDevices, inputDeviceCount, outputDevices, outputDeviceCount, sessions, sessionCount, nullptr);
+}
+
+// Same as StartCaptureEx with generated or file-fed sources instead of sessions and devices, for
+// exercising the pipeline without audio hardware. Stopped with StopCapture.
+extern "C" __declspec(dllexport) long long __stdcall StartSimulatedCapture(SimulatedSourceInfo* sources, int sourceCount, const CaptureOptions* captureOptions) {
+    Logger::GetInstance().Log("StartSimulatedCapture called, sourceCount = " + std::to_string(sourceCount));
+
+    const CaptureOptions options = captureOptions ? *captureOptions : CaptureOptions{};
+    const auto captureId = GenerateUniqueId();
+    auto mixer = CreateMixer(captureId, options);
+    std::vector<std::unique_ptr<AudioCaptureSource>> started;
+
+    for (int i = 0; i < sourceCount; ++i) {
+        auto source = CreateSimulatedSource(captureId, sources[i], static_cast<TransportType>(options.Transport));
+        if (const auto hr = StartSource(*source, options, mixer.get()); SUCCEEDED(hr)) {
+            started.push_back(std::move(source));
+        }
+        else {
+            Logger::GetInstance().Log(
+                "Failed to start simulated source " + std::to_string(sources[i].PipeId) +
+                ", HRESULT = " + std::to_string(hr), LogLevel::Error
+            );
+        }
+    }
+
+    AddActiveCapture(captureId, {}, std::move(started), StartMixer(std::move(mixer)));
+
+    return captureId;
+}
+
+// Blocks for the whole benchmark, see PipelineBenchmark.h. Results are appended to resultPath as JSON lines.
+extern "C" __declspec(dllexport) HRESULT __stdcall RunCaptureBenchmark(const PipelineBenchmarkOptions* options, LPCWSTR resultPath) {
+    if (!options || !resultPath)
+        return E_POINTER;
+
+    Logger::GetInstance().Log("RunCaptureBenchmark, maxSources = " + std::to_string(options->MaxSources), LogLevel::Info);
+    return RunPipelineBenchmark(*options, resultPath);
+}
+
+// Blocks until every level has been measured, see FlacBenchmark.h.
+extern "C" __declspec(dllexport) HRESULT __stdcall RunFlacEncoderBenchmark(const FlacBenchmarkOptions* options, LPCWSTR resultPath) {
+    if (!options || !resultPath)
+        return E_POINTER;
+
+    Logger::GetInstance().Log("RunFlacEncoderBenchmark", LogLevel::Info);
+    return RunFlacBenchmark(*options, resultPath);
+}
+
+// Blocks for DurationMs plus the time to close the files, see DiskWriterBenchmark.h.
+extern "C" __declspec(dllexport) HRESULT __stdcall RunFileWriterBenchmark(const DiskWriterBenchmarkOptions* options, LPCWSTR resultPath) {
+    if (!options || !resultPath)
+        return E_POINTER;
+
+    Logger::GetInstance().Log("RunFileWriterBenchmark, files = " + std::to_string(options->FileCount), LogLevel::Info);
+    return RunDiskWriterBenchmark(*options, resultPath);
+}
+
+// Blocks until the window has been filled and every save is written, see ReplayBufferBenchmark.h.
+extern "C" __declspec(dllexport) HRESULT __stdcall RunInstantReplayBenchmark(const ReplayBufferBenchmarkOptions* options, LPCWSTR resultPath) {
+    if (!options || !resultPath)
+        return E_POINTER;
+
+    Logger::GetInstance().Log("RunInstantReplayBenchmark, window = " + std::to_string(options->WindowSeconds) + " s", LogLevel::Info);
+    return RunReplayBufferBenchmark(*options, resultPath);
+}
+
+// Runs against a fake enumerator, no audio device is touched. See DeviceCacheBenchmark.h.
+extern "C" __declspec(dllexport) HRESULT __stdcall RunDeviceEnumerationBenchmark(const DeviceCacheBenchmarkOptions* options, LPCWSTR resultPath) {
+    if (!options || !resultPath)
+        return E_POINTER;
+
+    Logger::GetInstance().Log("RunDeviceEnumerationBenchmark, devices = " + std::to_string(options->DeviceCount), LogLevel::Info);
+    return RunDeviceCacheBenchmark(*options, resultPath);
+}
+
+// Blocks until every kernel has been timed, see SampleConverterBenchmark.h.
+extern "C" __declspec(dllexport) HRESULT __stdcall RunFormatConverterBenchmark(const SampleConverterBenchmarkOptions* options, LPCWSTR resultPath) {
+    if (!options || !resultPath)
+        return E_POINTER;
+
+    Logger::GetInstance().Log("RunFormatConverterBenchmark, block = " + std::to_string(options->BlockSamples) + " samples", LogLevel::Info);
+    return RunSampleConverterBenchmark(*options, resultPath);
+}
+
+// Blocks until every source count has been measured, see MixdownBenchmark.h.
+extern "C" __declspec(dllexport) HRESULT __stdcall RunMixerBenchmark(const MixdownBenchmarkOptions* options, LPCWSTR resultPath) {
+    if (!options || !resultPath)
+        return E_POINTER;
+
+    Logger::GetInstance().Log("RunMixerBenchmark, maxSources = " + std::to_string(options->MaxSources), LogLevel::Info);
+    return RunMixdownBenchmark(*options, resultPath);
+}
+
 extern "C" __declspec(dllexport) void __stdcall StopCapture(long long captureId) {
-    auto deviceIt = activeDeviceCaptures.find(captureId);
-    if (deviceIt != activeDeviceCaptures.end()) {
-        for (auto& capture : deviceIt->second) {
-            capture->StopCaptureAsync();
+    // Taken out of the maps first: closing a transport may wait for it to drain and the stats
+    // and mixdown calls of other captures must not queue up behind that.
+    std::vector<std::unique_ptr<AudioCaptureSource>> sources;
+    std::vector<ComPtr<ApplicationLoopbackCapture>> appCaptures;
+    std::unique_ptr<AudioMixer> mixer;
+    {
+        std::lock_guard lock(activeCapturesLock);
+        if (auto sourceIt = activeSources.find(captureId); sourceIt != activeSources.end()) {
+            sources = std::move(sourceIt->second);
+            activeSources.erase(sourceIt);
+        }
+        if (auto appIt = activeAppCaptures.find(captureId); appIt != activeAppCaptures.end()) {
+            appCaptures = std::move(appIt->second);
+            activeAppCaptures.erase(appIt);
+        }
+        if (auto mixerIt = activeMixers.find(captureId); mixerIt != activeMixers.end()) {
+            mixer = std::move(mixerIt->second);
+            activeMixers.erase(mixerIt);
+        }
+    }
+
+    for (auto& source : sources) {
+        source->StopCaptureAsync();
+    }
+    sources.clear();
+
+    for (auto& capture : appCaptures) {
+        capture->StopCaptureAsync();
+    }
+    appCaptures.clear();
+
+    // Sources first, so the mixer drains what they delivered last.
+    if (mixer) {
+        mixer->Stop();
+    }
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall SetMixdownSourceGain(long long captureId, DWORD pipeId, float gain) {
+    std::lock_guard lock(activeCapturesLock);
+    auto mixerIt = activeMixers.find(captureId);
+    if (mixerIt == activeMixers.end())
+        return FALSE;
+
+    return mixerIt->second->SetGain(pipeId, gain) ? TRUE : FALSE;
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall SetMixdownSourceMuted(long long captureId, DWORD pipeId, BOOL muted) {
+    std::lock_guard lock(activeCapturesLock);
+    auto mixerIt = activeMixers.find(captureId);
+    if (mixerIt == activeMixers.end())
+        return FALSE;
+
+    return mixerIt->second->SetMuted(pipeId, muted != FALSE) ? TRUE : FALSE;
+}
+
+// One entry per stream of the capture, the mixdown included. Fills at most `capacity` entries and
+// returns the number of streams, so a call with capacity 0 sizes the buffer; -1 for an unknown capture.
+// Only reads atomic counters, cheap enough to poll a few times per second.
+extern "C" __declspec(dllexport) int __stdcall GetCaptureStats(long long captureId, CaptureStats* stats, int capacity) {
+    if (!stats && capacity > 0)
+        return -1;
+
+    std::lock_guard lock(activeCapturesLock);
+    std::vector<CaptureStats> streams;
+
+    if (auto sourceIt = activeSources.find(captureId); sourceIt != activeSources.end()) {
+        for (const auto& source : sourceIt->second) {
+            source->GetStats(streams.emplace_back());
         }
-        activeDeviceCaptures.erase(deviceIt);
     }
-    
-    auto appIt = activeAppCaptures.find(captureId);
-    if (appIt != activeAppCaptures.end()) {
-        for (auto& capture : appIt->second) {
-            capture->StopCaptureAsync();
+
+    if (auto appIt = activeAppCaptures.find(captureId); appIt != activeAppCaptures.end()) {
+        for (const auto& capture : appIt->second) {
+            capture->GetStats(streams.emplace_back());
+        }
+    }
+
+    if (auto mixerIt = activeMixers.find(captureId); mixerIt != activeMixers.end()) {
+        mixerIt->second->GetStats(streams.emplace_back());
+    }
+
+    if (streams.empty())
+        return -1;
+
+    std::copy_n(streams.begin(), (std::min)(streams.size(), static_cast<size_t>((std::max)(capacity, 0))), stats);
+    return static_cast<int>(streams.size());
+}
+
+// Levels of every stream of the capture, in the same order as GetCaptureStats and with the same
+// sizing convention. Streams publish LevelMeter::DefaultRateHz periods per second, polling faster
+// only returns the same period again; -1 for an unknown capture.
+extern "C" __declspec(dllexport) int __stdcall GetCaptureLevels(long long captureId, StreamLevels* levels, int capacity) {
+    if (!levels && capacity > 0)
+        return -1;
+
+    std::lock_guard lock(activeCapturesLock);
+    std::vector<StreamLevels> streams;
+
+    if (auto sourceIt = activeSources.find(captureId); sourceIt != activeSources.end()) {
+        for (const auto& source : sourceIt->second) {
+            source->GetLevels(streams.emplace_back());
+        }
+    }
+
+    if (auto appIt = activeAppCaptures.find(captureId); appIt != activeAppCaptures.end()) {
+        for (const auto& capture : appIt->second) {
+            capture->GetLevels(streams.emplace_back());
+        }
+    }
+
+    if (auto mixerIt = activeMixers.find(captureId); mixerIt != activeMixers.end()) {
+        mixerIt->second->GetLevels(streams.emplace_back());
+    }
+
+    if (streams.empty())
+        return -1;
+
+    std::copy_n(streams.begin(), (std::min)(streams.size(), static_cast<size_t>((std::max)(capacity, 0))), levels);
+    return static_cast<int>(streams.size());
+}
+
+extern "C" __declspec(dllexport) SharedMemoryReader* __stdcall OpenSharedMemoryReader(DWORD pipeId, long long captureId) {
+    Logger::GetInstance().Log("OpenSharedMemoryReader", LogLevel::Info);
+
+    auto reader = std::make_unique<SharedMemoryReader>();
+    if (const auto hr = reader->Open(pipeId, captureId); FAILED(hr)) {
+        Logger::GetInstance().Log("Failed to open shared memory transport, HRESULT = " + std::to_string(hr), LogLevel::Error);
+        return nullptr;
+    }
+
+    return reader.release();
+}
+
+extern "C" __declspec(dllexport) int __stdcall ReadSharedMemory(SharedMemoryReader* reader, BYTE* buffer, int bufferSize, DWORD timeoutMs) {
+    if (!reader || !buffer || bufferSize <= 0)
+        return -1;
+
+    return reader->Read(buffer, bufferSize, timeoutMs);
+}
+
+extern "C" __declspec(dllexport) UINT64 __stdcall GetSharedMemoryLostRecords(SharedMemoryReader* reader) {
+    if (!reader)
+        return 0;
+
+    return reader->GetLostRecords();
+}
+
+extern "C" __declspec(dllexport) void __stdcall CloseSharedMemoryReader(SharedMemoryReader* reader) {
+    if (reader && reader->GetLostRecords() > 0) {
+        Logger::GetInstance().Log("Shared memory reader lost " + std::to_string(reader->GetLostRecords()) + " records", LogLevel::Warning);
+    }
+
+    delete reader;
+}
+
+extern "C" __declspec(dllexport) InstantReplayBuffer* __stdcall CreateInstantReplayBuffer(DWORD sampleRate, WORD bitsPerSample, WORD channels, int durationSeconds, const wchar_t* backingDirectory) {
+    Logger::GetInstance().Log("CreateInstantReplayBuffer", LogLevel::Info);
+
+    AudioFormat format;
+    format.SampleRate = sampleRate;
+    format.BitsPerSample = bitsPerSample;
+    format.Channels = channels;
+
+    if (!format.IsValid() || durationSeconds < 0) {
+        Logger::GetInstance().Log("Invalid instant replay buffer format", LogLevel::Error);
+        return nullptr;
+    }
+
+    // Long windows go to a mapped file in backingDirectory, null keeps every window in memory.
+    auto buffer = std::make_unique<InstantReplayBuffer>(format, static_cast<uint32_t>(durationSeconds),
+        backingDirectory ? std::wstring(backingDirectory) : std::wstring());
+    if (!buffer->IsValid())
+        return nullptr;
+
+    return buffer.release();
+}
+
+extern "C" __declspec(dllexport) void __stdcall DestroyInstantReplayBuffer(InstantReplayBuffer* buffer) {
+    delete buffer;
+}
+
+extern "C" __declspec(dllexport) void __stdcall AppendInstantReplayBuffer(InstantReplayBuffer* buffer, const BYTE* data, int size) {
+    if (!buffer || !data || size <= 0)
+        return;
+
+    buffer->Append(data, static_cast<size_t>(size));
+}
+
+extern "C" __declspec(dllexport) void __stdcall AppendSilenceInstantReplayBuffer(InstantReplayBuffer* buffer, UINT64 frames) {
+    if (!buffer)
+        return;
+
+    buffer->AppendSilence(frames);
+}
+
+extern "C" __declspec(dllexport) void __stdcall ResizeInstantReplayBuffer(InstantReplayBuffer* buffer, int durationSeconds) {
+    if (!buffer || durationSeconds < 0)
+        return;
+
+    buffer->Resize(static_cast<uint32_t>(durationSeconds));
+}
+
+extern "C" __declspec(dllexport) void __stdcall ClearInstantReplayBuffer(InstantReplayBuffer* buffer) {
+    if (buffer)
+        buffer->Clear();
+}
+
+extern "C" __declspec(dllexport) UINT64 __stdcall GetInstantReplaySnapshotSize(InstantReplayBuffer* buffer, int seconds) {
+    if (!buffer || seconds <= 0)
+        return 0;
+
+    return buffer->GetSnapshotSize(static_cast<uint32_t>(seconds));
+}
+
+extern "C" __declspec(dllexport) UINT64 __stdcall CopyInstantReplaySnapshot(InstantReplayBuffer* buffer, int seconds, BYTE* destination, UINT64 destinationSize) {
+    if (!buffer || !destination || seconds <= 0)
+        return 0;
+
+    return buffer->CopySnapshot(static_cast<uint32_t>(seconds), destination, static_cast<size_t>(destinationSize));
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall SaveInstantReplayToWav(InstantReplayBuffer* buffer, int seconds, const wchar_t* filePath) {
+    Logger::GetInstance().Log("SaveInstantReplayToWav", LogLevel::Info);
+    if (!buffer || !filePath || seconds <= 0)
+        return FALSE;
+
+    const HRESULT hr = buffer->SaveToWav(static_cast<uint32_t>(seconds), filePath);
+    if (hr == HRESULT_FROM_WIN32(ERROR_OPERATION_ABORTED))
+        Logger::GetInstance().Log("Instant replay was overwritten while being saved", LogLevel::Warning);
+    else if (FAILED(hr))
+        Logger::GetInstance().Log("Failed to write instant replay file, HRESULT = " + std::to_string(hr), LogLevel::Error);
+
+    return SUCCEEDED(hr);
+}
+
+// Bins of `level` covering the last `seconds` of the window, see WaveformPyramid. Returns the number
+// of bins, which may be larger than `capacity`, or -1.
+extern "C" __declspec(dllexport) int __stdcall GetInstantReplayWaveform(InstantReplayBuffer* buffer, int seconds, int level, WaveformBin* bins, int capacity) {
+    if (!buffer || seconds <= 0 || level < 0 || level >= static_cast<int>(WaveformLevelCount) || (!bins && capacity > 0) || capacity < 0)
+        return -1;
+
+    return static_cast<int>(buffer->GetWaveform(static_cast<uint32_t>(seconds), static_cast<uint32_t>(level), bins, static_cast<size_t>(capacity)));
+}
+
+extern "C" __declspec(dllexport) CompressedReplayBuffer* __stdcall CreateCompressedReplayBuffer(DWORD sampleRate, WORD bitsPerSample, WORD channels, int durationSeconds, int codec) {
+    Logger::GetInstance().Log("CreateCompressedReplayBuffer", LogLevel::Info);
+
+    AudioFormat format;
+    format.SampleRate = sampleRate;
+    format.BitsPerSample = bitsPerSample;
+    format.Channels = channels;
+
+    const auto replayCodec = static_cast<ReplayCodec>(codec);
+    if (durationSeconds < 0 || (replayCodec != ReplayCodec::Flac && replayCodec != ReplayCodec::ImaAdpcm) ||
+        !CompressedReplayBuffer::IsSupported(format, replayCodec)) {
+        Logger::GetInstance().Log("Invalid compressed replay buffer format", LogLevel::Error);
+        return nullptr;
+    }
+
+    return new CompressedReplayBuffer(format, static_cast<uint32_t>(durationSeconds), replayCodec);
+}
+
+extern "C" __declspec(dllexport) void __stdcall DestroyCompressedReplayBuffer(CompressedReplayBuffer* buffer) {
+    delete buffer;
+}
+
+extern "C" __declspec(dllexport) void __stdcall AppendCompressedReplayBuffer(CompressedReplayBuffer* buffer, const BYTE* data, int size) {
+    if (!buffer || !data || size <= 0)
+        return;
+
+    buffer->Append(data, static_cast<size_t>(size));
+}
+
+extern "C" __declspec(dllexport) void __stdcall AppendSilenceCompressedReplayBuffer(CompressedReplayBuffer* buffer, UINT64 frames) {
+    if (!buffer)
+        return;
+
+    buffer->AppendSilence(frames);
+}
+
+extern "C" __declspec(dllexport) void __stdcall ResizeCompressedReplayBuffer(CompressedReplayBuffer* buffer, int durationSeconds) {
+    if (!buffer || durationSeconds < 0)
+        return;
+
+    buffer->Resize(static_cast<uint32_t>(durationSeconds));
+}
+
+extern "C" __declspec(dllexport) void __stdcall ClearCompressedReplayBuffer(CompressedReplayBuffer* buffer) {
+    if (buffer)
+        buffer->Clear();
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall GetCompressedReplayStats(CompressedReplayBuffer* buffer, ReplayBufferStats* stats) {
+    if (!buffer || !stats)
+        return FALSE;
+
+    *stats = buffer->GetStats();
+    return TRUE;
+}
+
+extern "C" __declspec(dllexport) int __stdcall GetCompressedReplayWaveform(CompressedReplayBuffer* buffer, int seconds, int level, WaveformBin* bins, int capacity) {
+    if (!buffer || seconds <= 0 || level < 0 || level >= static_cast<int>(WaveformLevelCount) || (!bins && capacity > 0) || capacity < 0)
+        return -1;
+
+    return static_cast<int>(buffer->GetWaveform(static_cast<uint32_t>(seconds), static_cast<uint32_t>(level), bins, static_cast<size_t>(capacity)));
+}
+
+// Only the blocks overlapping the window are decoded, one at a time, while capture keeps appending.
+extern "C" __declspec(dllexport) BOOL __stdcall SaveCompressedReplayToWav(CompressedReplayBuffer* buffer, int seconds, const wchar_t* filePath) {
+    Logger::GetInstance().Log("SaveCompressedReplayToWav", LogLevel::Info);
+    if (!buffer || !filePath || seconds <= 0)
+        return FALSE;
+
+    WavFileWriter writer;
+    if (FAILED(writer.Open(filePath, buffer->GetFormat()))) {
+        Logger::GetInstance().Log("Failed to create instant replay file", LogLevel::Error);
+        return FALSE;
+    }
+
+    bool writeFailed = false;
+    const bool read = buffer->ReadWindow(static_cast<uint32_t>(seconds), [&](const uint8_t* data, size_t size) {
+        writeFailed = FAILED(writer.Append(data, size));
+        return !writeFailed;
+    });
+
+    if (!read) {
+        Logger::GetInstance().Log(writeFailed ? "Failed to write instant replay file" : "Failed to decode instant replay block", LogLevel::Error);
+        writer.Close();
+        return FALSE;
+    }
+
+    return SUCCEEDED(writer.Close());
+}
+
+// One instant replay buffer of a multitrack save. Shared with the managed side.
+struct MultitrackReplaySource {
+    void* Buffer;
+    // CompressedReplayBuffer rather than InstantReplayBuffer.
+    BOOL Compressed;
+    wchar_t Name[MultitrackMaxNameLength];
+};
+
+// Saves the last `seconds` of several replay buffers into one multitrack file. All windows end
+// now, a track holding less audio than the others starts later in the file.
+extern "C" __declspec(dllexport) BOOL __stdcall SaveInstantReplaysToMultitrack(const MultitrackReplaySource* sources, int count, int seconds, const wchar_t* filePath) {
+    Logger::GetInstance().Log("SaveInstantReplaysToMultitrack", LogLevel::Info);
+    if (!sources || count <= 0 || !filePath || seconds <= 0)
+        return FALSE;
+
+    std::vector<MultitrackTrack> tracks(count);
+    std::vector<UINT64> frameCounts(count);
+    std::vector<MultitrackWriter::TrackSource> trackSources;
+    std::vector<std::unique_ptr<InstantReplayBuffer::SnapshotLock>> locks;
+    std::vector<CompressedReplayBuffer::WindowReader> windows;
+    windows.reserve(count);
+    bool overwritten = false;
+
+    for (int i = 0; i < count; ++i) {
+        const auto& source = sources[i];
+        if (!source.Buffer)
+            return FALSE;
+
+        tracks[i].Name.assign(source.Name, wcsnlen(source.Name, MultitrackMaxNameLength));
+        if (source.Compressed) {
+            auto* buffer = static_cast<CompressedReplayBuffer*>(source.Buffer);
+            tracks[i].Format = buffer->GetFormat();
+
+            // Blocks are decoded as the writer gets to them, one may span several chunks.
+            auto& window = windows.emplace_back(buffer->OpenWindow(static_cast<uint32_t>(seconds)));
+            frameCounts[i] = window.GetFrames();
+            const size_t bytesPerFrame = buffer->GetFormat().BytesPerFrame();
+            trackSources.push_back([&window, bytesPerFrame, data = static_cast<const uint8_t*>(nullptr), size = size_t{ 0 }](uint8_t* destination, size_t frames, size_t& read) mutable {
+                read = 0;
+                while (read < frames) {
+                    if (size == 0 && !window.Next(data, size)) {
+                        return !window.IsFailed();
+                    }
+
+                    const size_t copied = (std::min)(frames - read, size / bytesPerFrame);
+                    memcpy(destination + read * bytesPerFrame, data, copied * bytesPerFrame);
+                    data += copied * bytesPerFrame;
+                    size -= copied * bytesPerFrame;
+                    read += copied;
+                }
+                return true;
+            });
+        }
+        else {
+            auto* buffer = static_cast<InstantReplayBuffer*>(source.Buffer);
+            tracks[i].Format = buffer->GetFormat();
+
+            // Read straight from the ring like SaveInstantReplayToWav, checking after every chunk
+            // that capture did not lap the save.
+            locks.push_back(std::make_unique<InstantReplayBuffer::SnapshotLock>(*buffer));
+            const auto snapshot = buffer->Snapshot(static_cast<uint32_t>(seconds));
+            frameCounts[i] = snapshot.FrameCount;
+            const size_t bytesPerFrame = buffer->GetFormat().BytesPerFrame();
+            trackSources.push_back([buffer, snapshot, bytesPerFrame, &overwritten, offset = size_t{ 0 }](uint8_t* destination, size_t frames, size_t& read) mutable {
+                const size_t chunkStart = offset;
+                size_t remaining = frames * bytesPerFrame;
+                size_t spanStart = 0;
+                for (const auto& span : snapshot.Spans) {
+                    if (offset < spanStart + span.Size && remaining > 0) {
+                        const size_t size = (std::min)(spanStart + span.Size - offset, remaining);
+                        memcpy(destination + (offset - chunkStart), span.Data + (offset - spanStart), size);
+                        offset += size;
+                        remaining -= size;
+                    }
+                    spanStart += span.Size;
+                }
+
+                read = (offset - chunkStart) / bytesPerFrame;
+                overwritten = !buffer->IsIntact(snapshot.StartFrame + chunkStart / bytesPerFrame);
+                return !overwritten;
+            });
         }
-        activeAppCaptures.erase(appIt);
     }
+
+    double longest = 0.0;
+    for (int i = 0; i < count; ++i) {
+        longest = (std::max)(longest, static_cast<double>(frameCounts[i]) / tracks[i].Format.SampleRate);
+    }
+    for (int i = 0; i < count; ++i) {
+        const double duration = static_cast<double>(frameCounts[i]) / tracks[i].Format.SampleRate;
+        tracks[i].StartMicroseconds = static_cast<UINT64>(std::llround((longest - duration) * 1e6));
+    }
+
+    MultitrackWriter writer;
+    if (FAILED(writer.Open(filePath, tracks))) {
+        Logger::GetInstance().Log("Failed to create multitrack instant replay file", LogLevel::Error);
+        return FALSE;
+    }
+
+    if (FAILED(writer.WriteInterleaved(trackSources))) {
+        Logger::GetInstance().Log(overwritten ? "Instant replay was overwritten while being saved" : "Failed to write multitrack instant replay file",
+            overwritten ? LogLevel::Warning : LogLevel::Error);
+        writer.Close();
+        return FALSE;
+    }
+
+    return SUCCEEDED(writer.Close());
+}
+
+extern "C" __declspec(dllexport) MultitrackReader* __stdcall OpenMultitrackReader(const wchar_t* filePath) {
+    Logger::GetInstance().Log("OpenMultitrackReader", LogLevel::Info);
+    if (!filePath)
+        return nullptr;
+
+    auto reader = std::make_unique<MultitrackReader>();
+    if (!reader->Open(filePath)) {
+        Logger::GetInstance().Log("Not a complete multitrack file", LogLevel::Error);
+        return nullptr;
+    }
+
+    return reader.release();
+}
+
+extern "C" __declspec(dllexport) void __stdcall CloseMultitrackReader(MultitrackReader* reader) {
+    delete reader;
+}
+
+extern "C" __declspec(dllexport) int __stdcall GetMultitrackTrackCount(MultitrackReader* reader) {
+    if (!reader)
+        return 0;
+
+    return static_cast<int>(reader->GetTrackCount());
+}
+
+// Reads `frames` frames of a track from any position, returns the number of frames copied.
+extern "C" __declspec(dllexport) UINT64 __stdcall ReadMultitrackTrack(MultitrackReader* reader, int track, UINT64 startFrame, BYTE* destination, UINT64 frames) {
+    if (!reader || !destination || track < 0 || static_cast<uint32_t>(track) >= reader->GetTrackCount())
+        return 0;
+
+    return reader->Read(static_cast<uint32_t>(track), startFrame, destination, static_cast<size_t>(frames));
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall ExtractMultitrackTrackToWav(MultitrackReader* reader, int track, const wchar_t* filePath) {
+    Logger::GetInstance().Log("ExtractMultitrackTrackToWav", LogLevel::Info);
+    if (!reader || !filePath || track < 0 || static_cast<uint32_t>(track) >= reader->GetTrackCount())
+        return FALSE;
+
+    WavFileWriter writer;
+    if (FAILED(writer.Open(filePath, reader->GetTrack(static_cast<uint32_t>(track)).Format))) {
+        Logger::GetInstance().Log("Failed to create track file", LogLevel::Error);
+        return FALSE;
+    }
+
+    bool writeFailed = false;
+    const bool read = reader->Extract(static_cast<uint32_t>(track), [&](const uint8_t* data, size_t size) {
+        writeFailed = FAILED(writer.Append(data, size));
+        return !writeFailed;
+    });
+
+    if (!read) {
+        Logger::GetInstance().Log(writeFailed ? "Failed to write track file" : "Damaged chunk in multitrack file", LogLevel::Error);
+        writer.Close();
+        return FALSE;
+    }
+
+    return SUCCEEDED(writer.Close());
+}
+
+// journalSegmentMs > 0 makes the recording recoverable after a crash, see RecoverInterruptedRecording.
+extern "C" __declspec(dllexport) WavFileWriter* __stdcall CreateWavFileWriter(const wchar_t* filePath, DWORD sampleRate, WORD bitsPerSample, WORD channels, BOOL isFloat,
+    DWORD journalSegmentMs) {
+    Logger::GetInstance().Log("CreateWavFileWriter", LogLevel::Info);
+    if (!filePath)
+        return nullptr;
+
+    AudioFormat format;
+    format.SampleRate = sampleRate;
+    format.BitsPerSample = bitsPerSample;
+    format.Channels = channels;
+    format.IsFloat = isFloat != FALSE;
+
+    auto writer = std::make_unique<WavFileWriter>();
+    if (const auto hr = writer->Open(filePath, format, journalSegmentMs); FAILED(hr)) {
+        Logger::GetInstance().Log("Failed to create WAV file, HRESULT = " + std::to_string(hr), LogLevel::Error);
+        return nullptr;
+    }
+
+    return writer.release();
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall AppendWavFileWriter(WavFileWriter* writer, const BYTE* data, int size) {
+    if (!writer || !data || size <= 0)
+        return FALSE;
+
+    return SUCCEEDED(writer->Append(data, static_cast<size_t>(size)));
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall AppendSilenceWavFileWriter(WavFileWriter* writer, UINT64 frames) {
+    if (!writer)
+        return FALSE;
+
+    return SUCCEEDED(writer->AppendSilence(frames));
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall CloseWavFileWriter(WavFileWriter* writer) {
+    Logger::GetInstance().Log("CloseWavFileWriter", LogLevel::Info);
+    if (!writer)
+        return FALSE;
+
+    const auto hr = writer->Close();
+    delete writer;
+
+    return SUCCEEDED(hr);
+}
+
+extern "C" __declspec(dllexport) FlacFileWriter* __stdcall CreateFlacFileWriter(const wchar_t* filePath, DWORD sampleRate, WORD bitsPerSample, WORD channels, BOOL isFloat,
+    int compressionLevel, DWORD journalSegmentMs) {
+    Logger::GetInstance().Log("CreateFlacFileWriter", LogLevel::Info);
+    if (!filePath)
+        return nullptr;
+
+    AudioFormat format;
+    format.SampleRate = sampleRate;
+    format.BitsPerSample = bitsPerSample;
+    format.Channels = channels;
+    format.IsFloat = isFloat != FALSE;
+
+    auto writer = std::make_unique<FlacFileWriter>();
+    if (const auto hr = writer->Open(filePath, format, compressionLevel, journalSegmentMs); FAILED(hr)) {
+        Logger::GetInstance().Log("Failed to create FLAC file, HRESULT = " + std::to_string(hr), LogLevel::Error);
+        return nullptr;
+    }
+
+    return writer.release();
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall AppendFlacFileWriter(FlacFileWriter* writer, const BYTE* data, int size) {
+    if (!writer || !data || size <= 0)
+        return FALSE;
+
+    return SUCCEEDED(writer->Append(data, static_cast<size_t>(size)));
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall AppendSilenceFlacFileWriter(FlacFileWriter* writer, UINT64 frames) {
+    if (!writer)
+        return FALSE;
+
+    return SUCCEEDED(writer->AppendSilence(frames));
+}
+
+extern "C" __declspec(dllexport) BOOL __stdcall CloseFlacFileWriter(FlacFileWriter* writer) {
+    Logger::GetInstance().Log("CloseFlacFileWriter", LogLevel::Info);
+    if (!writer)
+        return FALSE;
+
+    const auto hr = writer->Close();
+    delete writer;
+
+    return SUCCEEDED(hr);
+}
+
+// Rebuilds a recording that was interrupted before it was closed, filePath is the recording
+// itself and <filePath>.journal has to exist. See RecordingJournal.h.
+extern "C" __declspec(dllexport) HRESULT __stdcall RecoverInterruptedRecording(const wchar_t* filePath, RecoveredRecording* result) {
+    if (!filePath || !result)
+        return E_POINTER;
+
+    const auto hr = RecoverRecording(filePath, *result);
+    if (FAILED(hr)) {
+        Logger::GetInstance().Log("Failed to recover recording, HRESULT = " + std::to_string(hr), LogLevel::Error);
+        return hr;
+    }
+
+    Logger::GetInstance().Log("Recovered recording, " + std::to_string(result->Segments) + " segments" +
+        (result->Damaged ? ", damaged segments dropped" : ""), LogLevel::Info);
+    return S_OK;
+}
+
+// Bins of `level` from the waveform sidecar of a recording, filePath is the recording itself.
+// Returns the number of bins, which may be larger than `capacity`, or -1 if there is no sidecar.
+extern "C" __declspec(dllexport) int __stdcall ReadRecordingWaveform(const wchar_t* filePath, int level, WaveformBin* bins, int capacity) {
+    if (!filePath || level < 0 || level >= static_cast<int>(WaveformLevelCount) || (!bins && capacity > 0) || capacity < 0)
+        return -1;
+
+    std::vector<WaveformBin> stored;
+    if (!ReadWaveformFile(WaveformPyramid::GetPath(filePath), static_cast<uint32_t>(level), stored))
+        return -1;
+
+    std::copy_n(stored.begin(), (std::min)(stored.size(), static_cast<size_t>(capacity)), bins);
+    return static_cast<int>(stored.size());
+}
+
+// Compresses a finished WAV recording, the WAV file is left in place.
+extern "C" __declspec(dllexport) HRESULT __stdcall EncodeWavToFlac(const wchar_t* wavPath, const wchar_t* flacPath, int compressionLevel) {
+    Logger::GetInstance().Log("EncodeWavToFlac", LogLevel::Info);
+    if (!wavPath || !flacPath)
+        return E_POINTER;
+
+    WavFileReader reader;
+    if (!reader.Open(wavPath))
+        return HRESULT_FROM_WIN32(ERROR_OPEN_FAILED);
+
+    FlacFileWriter writer;
+    if (const auto hr = writer.Open(flacPath, reader.GetFormat(), compressionLevel); FAILED(hr))
+        return hr;
+
+    // One second per read.
+    const size_t chunkFrames = reader.GetFormat().SampleRate;
+    std::vector<BYTE> chunk(chunkFrames * reader.GetFormat().BytesPerFrame());
+    while (const size_t frames = reader.Read(chunk.data(), chunkFrames)) {
+        if (const auto hr = writer.Append(chunk.data(), frames * reader.GetFormat().BytesPerFrame()); FAILED(hr))
+            return hr;
+    }
+
+    return writer.Close();
 }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "CaptureSink.h"
+#include "CaptureStats.h"
+#include "PolyphaseResampler.h"
+
+// One stream of a capture. Implementations produce PCM packets on their own clock (audio engine
+// event, timer, file) and hand them to their CaptureSink; StartCaptureEx and StopCapture only see
+// this interface.
+class AudioCaptureSource {
+public:
+    virtual ~AudioCaptureSource() = default;
+
+    virtual HRESULT StartCaptureAsync() = 0;
+    virtual HRESULT StopCaptureAsync() = 0;
+
+    // Deliver the stream at `sampleRate`, set before StartCaptureAsync. By default the sink
+    // resamples; a source able to produce the rate natively overrides this.
+    virtual void SetTargetSampleRate(uint32_t sampleRate, ResamplerQuality quality) { m_Sink.SetTargetSampleRate(sampleRate, quality); }
+
+    // Batch the stream's transport writes, set before StartCaptureAsync.
+    void SetCoalescing(const WriteCoalescing& coalescing) { m_Sink.SetCoalescing(coalescing); }
+
+    // Silence records and near-silence detection, set before StartCaptureAsync.
+    void SetSilenceHandling(const SilenceHandling& handling) { m_Sink.SetSilenceHandling(handling); }
+
+    // Also feed the packets to a mixdown, set before StartCaptureAsync.
+    void SetMixerInput(std::shared_ptr<MixerInput> mixerInput) { m_Sink.SetMixerInput(std::move(mixerInput)); }
+
+    DWORD GetPipeId() const { return m_PipeId; }
+
+    // Lock-free snapshot of the stream's counters, callable while the capture runs.
+    void GetStats(CaptureStats& stats) const {
+        m_Sink.GetStats(stats);
+        stats.PipeId = m_PipeId;
+    }
+
+    void GetLevels(StreamLevels& levels) const {
+        m_Sink.GetLevels(levels);
+        levels.PipeId = m_PipeId;
+    }
+
+protected:
+    AudioCaptureSource(long long captureId, DWORD pipeId, TransportType transport) :
+        m_Sink(captureId, transport), m_PipeId(pipeId) {}
+
+    CaptureSink m_Sink;
+    DWORD m_PipeId;
+};
@@ -4,11 +4,41 @@
 #include <functiondiscoverykeys_devpkey.h>
 #include <functional>
 #include <fstream>
-#include <thread>
-#include <limits>
-#include <stdexcept>
 
-AudioDeviceCapture::AudioDeviceCapture(long long captureId) : m_CaptureId(captureId) {}
+static bool GetSampleFormat(const WAVEFORMATEX* format, SampleFormat& sampleFormat) {
+    bool isFloat = format->wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+    WORD validBits = format->wBitsPerSample;
+
+    if (format->wFormatTag == WAVE_FORMAT_EXTENSIBLE) {
+        const auto* formatExt = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(format);
+        isFloat = formatExt->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+        if (formatExt->Samples.wValidBitsPerSample != 0) {
+            validBits = formatExt->Samples.wValidBitsPerSample;
+        }
+    }
+
+    if (isFloat) {
+        sampleFormat = SampleFormat::Float32;
+        return format->wBitsPerSample == 32;
+    }
+
+    switch (format->wBitsPerSample) {
+    case 16:
+        sampleFormat = SampleFormat::Int16;
+        return true;
+    case 24:
+        sampleFormat = SampleFormat::Int24;
+        return true;
+    case 32:
+        sampleFormat = validBits == 24 ? SampleFormat::Int24In32 : SampleFormat::Int32;
+        return true;
+    default:
+        return false;
+    }
+}
+
+AudioDeviceCapture::AudioDeviceCapture(long long captureId, const std::wstring& deviceId, DWORD pipeId, TransportType transport) :
+    AudioCaptureSource(captureId, pipeId, transport), m_DeviceId(deviceId) {}
 
 AudioDeviceCapture::~AudioDeviceCapture() {
     StopCaptureAsync();
@@ -22,14 +52,14 @@ HRESULT AudioDeviceCapture::InitializeCapture() {
     return S_OK;
 }
 
-HRESULT AudioDeviceCapture::StartCaptureAsync(const std::wstring& deviceId, DWORD pipeId) {
+HRESULT AudioDeviceCapture::StartCaptureAsync() {
     RETURN_IF_FAILED(InitializeCapture());
 
     wil::com_ptr_nothrow<IMMDeviceEnumerator> enumerator;
     RETURN_IF_FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_INPROC_SERVER, __uuidof(IMMDeviceEnumerator), reinterpret_cast<void**>(&enumerator)));
 
     wil::com_ptr_nothrow<IMMDevice> device;
-    RETURN_IF_FAILED(enumerator->GetDevice(deviceId.c_str(), &device));
+    RETURN_IF_FAILED(enumerator->GetDevice(m_DeviceId.c_str(), &device));
 
     RETURN_IF_FAILED(device->Activate(__uuidof(IAudioClient), CLSCTX_INPROC_SERVER, nullptr, reinterpret_cast<void**>(&m_AudioClient)));
 
@@ -43,6 +73,12 @@ HRESULT AudioDeviceCapture::StartCaptureAsync(const std::wstring& deviceId, DWOR
         }
     }
 
+    // The stream is announced with the mix format's bit depth, float mixes are delivered as int32.
+    SampleFormat sampleFormat;
+    RETURN_HR_IF(AUDCLNT_E_UNSUPPORTED_FORMAT, !GetSampleFormat(m_CaptureFormat, sampleFormat));
+    RETURN_IF_FAILED(m_Sink.SetFormat(sampleFormat, CaptureSink::GetDefaultStreamFormat(sampleFormat),
+        m_CaptureFormat->nChannels, m_CaptureFormat->nSamplesPerSec));
+
     RETURN_IF_FAILED(m_AudioClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_EVENTCALLBACK, 10000000, 0, m_CaptureFormat, NULL));
     RETURN_IF_FAILED(m_AudioClient->GetService(IID_PPV_ARGS(&m_AudioCaptureClient)));
 
@@ -50,25 +86,30 @@ HRESULT AudioDeviceCapture::StartCaptureAsync(const std::wstring& deviceId, DWOR
 
     RETURN_IF_FAILED(m_AudioClient->SetEventHandle(m_SampleReadyEvent.get()));
 
-    RETURN_IF_WIN32_BOOL_FALSE(CreateServerPipe(pipeId));
+    RETURN_IF_FAILED(m_Sink.Open(m_PipeId));
 
-    RETURN_IF_FAILED(m_AudioClient->Start());
+    RETURN_IF_FAILED(CaptureScheduler::GetInstance().Register(m_SampleReadyEvent.get(),
+        [this]() { OnAudioSampleRequested(); }, m_SampleReadyRegistration));
 
-    std::thread([this]() {
-        while (WaitForSingleObject(m_SampleReadyEvent.get(), INFINITE) == WAIT_OBJECT_0) {
-            OnAudioSampleRequested();
-        }
-        }).detach();
+    if (const auto hr = m_AudioClient->Start(); FAILED(hr)) {
+        CaptureScheduler::GetInstance().Unregister(m_SampleReadyRegistration);
+        m_SampleReadyRegistration = 0;
+        return hr;
+    }
 
     return S_OK;
 }
 
 HRESULT AudioDeviceCapture::StopCaptureAsync() {
+    // No callback is running once this returns, so the sink can be closed safely.
+    CaptureScheduler::GetInstance().Unregister(m_SampleReadyRegistration);
+    m_SampleReadyRegistration = 0;
+
     if (m_AudioClient) {
         m_AudioClient->Stop();
     }
 
-    ClosePipe();
+    m_Sink.Close();
     return S_OK;
 }
 
@@ -80,63 +121,9 @@ HRESULT AudioDeviceCapture::OnAudioSampleRequested() {
     while (SUCCEEDED(m_AudioCaptureClient->GetNextPacketSize(&numFramesAvailable)) && numFramesAvailable > 0) {
         RETURN_IF_FAILED(m_AudioCaptureClient->GetBuffer(&pData, &numFramesAvailable, &dwFlags, nullptr, nullptr));
 
-        DWORD dataSize = numFramesAvailable * m_CaptureFormat->nBlockAlign;
-
-        if (m_CaptureFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE &&
-            reinterpret_cast<WAVEFORMATEXTENSIBLE*>(m_CaptureFormat)->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) {
-            const float* floatData = reinterpret_cast<const float*>(pData);
-            std::vector<int32_t> pcmData(numFramesAvailable);
-
-            for (UINT32 i = 0; i < numFramesAvailable; ++i) {
-                pcmData[i] = static_cast<int32_t>(floatData[i] * (std::numeric_limits<int32_t>::max)());
-            }
-
-            size_t dataSize = pcmData.size() * sizeof(int32_t);
-            if (dataSize > static_cast<size_t>((std::numeric_limits<int32_t>::max)())) {
-                throw std::overflow_error("Data size exceeds int32_t limits.");
-            }
-
-            int32_t dataSizeInt32 = static_cast<int32_t>(dataSize);
-
-            WriteToPipe(reinterpret_cast<const BYTE*>(pcmData.data()), dataSizeInt32);
-        }
-        else {
-            WriteToPipe(pData, dataSize);
-        }
+        m_Sink.Deliver(pData, numFramesAvailable, dwFlags);
 
         m_AudioCaptureClient->ReleaseBuffer(numFramesAvailable);
     }
     return S_OK;
 }
-
-BOOL AudioDeviceCapture::CreateServerPipe(DWORD pipeId) {
-    TCHAR pipeName[256];
-    swprintf_s(pipeName, _countof(pipeName), L"\\\\.\\pipe\\AudioDataPipe_%lu_%lld", pipeId, m_CaptureId);
-
-    m_hPipe = CreateNamedPipeW(
-        pipeName,
-        PIPE_ACCESS_OUTBOUND,
-        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
-        1,
-        1024 * 16,
-        0,
-        0,
-        NULL
-    );
-
-    return m_hPipe != INVALID_HANDLE_VALUE;
-}
-
-void AudioDeviceCapture::WriteToPipe(const BYTE* data, DWORD dataSize) {
-    if (m_hPipe != INVALID_HANDLE_VALUE) {
-        DWORD written = 0;
-        WriteFile(m_hPipe, data, dataSize, &written, NULL);
-    }
-}
-
-void AudioDeviceCapture::ClosePipe() {
-    if (m_hPipe != NULL) {
-        CloseHandle(m_hPipe);
-        m_hPipe = NULL;
-    }
-}
@@ -8,26 +8,26 @@
 #include <mfapi.h>
 #include <string>
 
-class AudioDeviceCapture {
+#include "AudioCaptureSource.h"
+#include "CaptureScheduler.h"
+
+class AudioDeviceCapture : public AudioCaptureSource {
 public:
-    AudioDeviceCapture(long long captureId);
-    ~AudioDeviceCapture();
+    AudioDeviceCapture(long long captureId, const std::wstring& deviceId, DWORD pipeId, TransportType transport = TransportType::NamedPipe);
+    ~AudioDeviceCapture() override;
 
-    HRESULT StartCaptureAsync(const std::wstring& deviceId, DWORD pipeId);
-    HRESULT StopCaptureAsync();
+    HRESULT StartCaptureAsync() override;
+    HRESULT StopCaptureAsync() override;
 
 private:
     HRESULT InitializeCapture();
     HRESULT OnAudioSampleRequested();
-    BOOL CreateServerPipe(DWORD pipeId);
-    void WriteToPipe(const BYTE* data, DWORD dataSize);
-    void ClosePipe();
 
     wil::com_ptr_nothrow<IAudioClient> m_AudioClient;
     wil::com_ptr_nothrow<IAudioCaptureClient> m_AudioCaptureClient;
     WAVEFORMATEX* m_CaptureFormat{};
     UINT32 m_BufferFrames = 0;
     wil::unique_event_nothrow m_SampleReadyEvent;
-    HANDLE m_hPipe = NULL;
-    long long m_CaptureId;
+    CaptureScheduler::RegistrationId m_SampleReadyRegistration = 0;
+    std::wstring m_DeviceId;
 };
@@ -8,7 +8,7 @@
 #include <Audioclient.h>
 #include "Logger.h"
 
-AudioDeviceManagerBase::AudioDeviceManagerBase() : deviceEnumerator(nullptr), stateChangedCallback(nullptr) {
+AudioDeviceManagerBase::AudioDeviceManagerBase(EDataFlow dataFlow) : deviceEnumerator(nullptr), stateChangedCallback(nullptr), m_DataFlow(dataFlow) {
     if (FAILED(CoInitialize(nullptr))) {
         std::string message = "Failed to initialize COM library";
         Logger::GetInstance().Log(message, LogLevel::Error);
@@ -23,6 +23,10 @@ AudioDeviceManagerBase::AudioDeviceManagerBase() : deviceEnumerator(nullptr), st
 }
 
 AudioDeviceManagerBase::~AudioDeviceManagerBase() {
+    if (notificationClient) {
+        deviceEnumerator->UnregisterEndpointNotificationCallback(notificationClient.get());
+        notificationClient.reset();
+    }
     if (deviceEnumerator) {
         deviceEnumerator->Release();
     }
@@ -73,7 +77,24 @@ std::vector<wil::com_ptr_nothrow<IMMDevice>> AudioDeviceManagerBase::GetActiveDe
     return devices;
 }
 
-std::optional<AudioDeviceInfo> AudioDeviceManagerBase::GetDeviceInfo(wil::com_ptr_nothrow<IMMDevice> device) {
+std::vector<std::wstring> AudioDeviceManagerBase::EnumerateDevices(DeviceFlow flow) {
+    std::vector<std::wstring> deviceIds;
+
+    for (auto& device : GetActiveDevices(flow == DeviceFlow::Capture ? eCapture : eRender)) {
+        wil::unique_cotaskmem_string deviceId;
+        if (FAILED(device->GetId(&deviceId))) {
+            Logger::GetInstance().Log("Failed to get device ID", LogLevel::Warning);
+            continue;
+        }
+
+        deviceIds.emplace_back(deviceId.get());
+    }
+
+    return deviceIds;
+}
+
+std::optional<DeviceEntry> AudioDeviceManagerBase::ReadDevice(const std::wstring& deviceId) {
+    auto device = GetDevice(deviceId);
     if (!device) {
         Logger::GetInstance().Log("Invalid device pointer", LogLevel::Warning);
         return std::nullopt;
@@ -91,30 +112,38 @@ std::optional<AudioDeviceInfo> AudioDeviceManagerBase::GetDeviceInfo(wil::com_pt
         return std::nullopt;
     }
 
-    wil::unique_cotaskmem_string deviceId;
-    if (FAILED(device->GetId(&deviceId))) {
-        Logger::GetInstance().Log("Failed to get device ID", LogLevel::Warning);
-        return std::nullopt;
-    }
-
     WAVEFORMATEX* waveFormat = GetDeviceFormat(device);
     if (!waveFormat) {
         Logger::GetInstance().Log("Failed to get device format", LogLevel::Warning);
         return std::nullopt;
     }
 
-    AudioDeviceInfo deviceInfo = {
-        HashDeviceId(deviceId.get()),
-        SysAllocString(deviceId.get()),
-        SysAllocString(name.pwszVal),
-        waveFormat->nSamplesPerSec,
-        waveFormat->wBitsPerSample,
-        waveFormat->nChannels
-    };
+    DeviceEntry entry;
+    entry.PipeId = HashDeviceId(deviceId);
+    entry.Id = deviceId;
+    entry.Name = name.pwszVal ? name.pwszVal : L"";
+    entry.SampleRate = waveFormat->nSamplesPerSec;
+    entry.BitsPerSample = waveFormat->wBitsPerSample;
+    entry.Channels = waveFormat->nChannels;
 
     CoTaskMemFree(waveFormat);
 
-    return deviceInfo;
+    return entry;
+}
+
+std::vector<SessionEntry> AudioDeviceManagerBase::ReadSessions(const std::wstring& deviceId) {
+    return {};
+}
+
+AudioDeviceInfo AudioDeviceManagerBase::ToDeviceInfo(const DeviceEntry& entry) {
+    return {
+        entry.PipeId,
+        SysAllocString(entry.Id.c_str()),
+        SysAllocString(entry.Name.c_str()),
+        entry.SampleRate,
+        entry.BitsPerSample,
+        entry.Channels
+    };
 }
 
 wil::com_ptr_nothrow<IMMDevice> AudioDeviceManagerBase::GetDevice(const std::wstring& deviceId) const
@@ -134,8 +163,13 @@ wil::com_ptr_nothrow<IMMDevice> AudioDeviceManagerBase::GetDevice(const std::wst
 }
 
 std::optional<AudioDeviceInfo> AudioDeviceManagerBase::GetDeviceInfo(const std::wstring& deviceId) {
-    auto device = GetDevice(deviceId);
-    return GetDeviceInfo(device);
+    WatchDevices();
+
+    auto entry = m_Cache.GetDevice(deviceId);
+    if (!entry) {
+        return std::nullopt;
+    }
+    return ToDeviceInfo(*entry);
 }
 
 DWORD AudioDeviceManagerBase::HashDeviceId(const std::wstring& deviceId) {
@@ -172,28 +206,67 @@ WAVEFORMATEX* AudioDeviceManagerBase::GetDeviceFormat(wil::com_ptr_nothrow<IMMDe
     return waveFormat;
 }
 
-void AudioDeviceManagerBase::RegisterNotificationCallback(DeviceStateChangedCallback callback, EDataFlow flow) {
-    stateChangedCallback = callback;
+bool AudioDeviceManagerBase::WatchDevices() {
+    std::lock_guard lock(m_WatchLock);
+    if (notificationClient) {
+        return true;
+    }
 
-    notificationClient = wil::com_ptr<AudioDeviceNotificationClient>(new AudioDeviceNotificationClient(callback, deviceEnumerator, flow));
+    wil::com_ptr_nothrow<AudioDeviceNotificationClient> client;
+    client.attach(new AudioDeviceNotificationClient(stateChangedCallback, deviceEnumerator, m_DataFlow, &m_Cache, &m_Changes));
 
-    if (FAILED(deviceEnumerator->RegisterEndpointNotificationCallback(notificationClient.get()))) {
-        Logger::GetInstance().Log("Failed to register notification callback", LogLevel::Warning);
+    if (FAILED(deviceEnumerator->RegisterEndpointNotificationCallback(client.get()))) {
+        Logger::GetInstance().Log("Failed to register notification callback, device queries are not cached", LogLevel::Warning);
+        return false;
+    }
+
+    notificationClient = std::move(client);
+    m_Cache.SetDevicesWatched(true);
+    return true;
+}
+
+void AudioDeviceManagerBase::WriteSnapshot(DeviceSnapshotWriter& writer, const wchar_t* deviceId) {
+    WatchDevices();
+
+    std::vector<std::wstring> deviceIds;
+    if (deviceId) {
+        deviceIds.emplace_back(deviceId);
     }
     else {
+        deviceIds = m_Cache.GetDevices(m_DataFlow == eCapture ? DeviceFlow::Capture : DeviceFlow::Render);
+    }
+
+    for (const auto& id : deviceIds) {
+        auto entry = m_Cache.GetDevice(id);
+        if (!entry) {
+            continue;
+        }
+
+        // Only render endpoints have sessions to record.
+        if (m_DataFlow == eRender) {
+            writer.AddDevice(*entry, m_Cache.GetSessions(id));
+        }
+        else {
+            writer.AddDevice(*entry);
+        }
+    }
+}
+
+void AudioDeviceManagerBase::RegisterNotificationCallback(DeviceStateChangedCallback callback) {
+    stateChangedCallback = callback;
+
+    if (WatchDevices()) {
+        notificationClient->SetCallback(callback);
         Logger::GetInstance().Log("Notification callback registered successfully", LogLevel::Info);
     }
 }
 
+// The notifications stay registered for the cache, only the callback goes.
 void AudioDeviceManagerBase::UnregisterNotificationCallback() {
+    std::lock_guard lock(m_WatchLock);
     if (notificationClient) {
-        if (FAILED(deviceEnumerator->UnregisterEndpointNotificationCallback(notificationClient.get()))) {
-            Logger::GetInstance().Log("Failed to unregister notification callback", LogLevel::Warning);
-        }
-        else {
-            Logger::GetInstance().Log("Notification callback unregistered successfully", LogLevel::Info);
-        }
-        notificationClient.reset();
+        notificationClient->SetCallback(nullptr);
+        Logger::GetInstance().Log("Notification callback unregistered successfully", LogLevel::Info);
     }
     stateChangedCallback = nullptr;
 }
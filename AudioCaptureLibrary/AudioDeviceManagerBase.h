@@ -1,29 +1,57 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <mutex>
 #include <optional>
 #include <wil/com.h>
 #include <mmdeviceapi.h>
 #include "AudioDeviceInfo.h"
 #include "AudioDeviceNotificationClient.h"
+#include "DeviceCache.h"
+#include "DeviceChangeLog.h"
+#include "DeviceSnapshot.h"
 
-class AudioDeviceManagerBase {
+// Devices are read through a DeviceCache that the endpoint notifications keep current, see
+// WatchDevices(). The manager is the cache's enumerator.
+class AudioDeviceManagerBase : public DeviceEnumerator {
 public:
-    AudioDeviceManagerBase();
+    explicit AudioDeviceManagerBase(EDataFlow dataFlow);
     virtual ~AudioDeviceManagerBase();
 
-    void RegisterNotificationCallback(DeviceStateChangedCallback callback, EDataFlow flow);
+    void RegisterNotificationCallback(DeviceStateChangedCallback callback);
     void UnregisterNotificationCallback();
 
+    DeviceCacheStats GetCacheStats() const { return m_Cache.GetStats(); }
+    // Device and session state changes as the callbacks report them, recorded once WatchDevices()
+    // succeeded.
+    const DeviceChangeLog& GetChangeLog() const { return m_Changes; }
+
+    // Adds the active devices of the manager's flow with their sessions, or only `deviceId` if given.
+    void WriteSnapshot(DeviceSnapshotWriter& writer, const wchar_t* deviceId = nullptr);
+
+    // DeviceEnumerator, uncached.
+    std::vector<std::wstring> EnumerateDevices(DeviceFlow flow) override;
+    std::optional<DeviceEntry> ReadDevice(const std::wstring& deviceId) override;
+    std::vector<SessionEntry> ReadSessions(const std::wstring& deviceId) override;
+
 protected:
     wil::com_ptr_nothrow<IMMDeviceEnumerator> deviceEnumerator;
     wil::com_ptr_nothrow<AudioDeviceNotificationClient> notificationClient;
     DeviceStateChangedCallback stateChangedCallback;
+    DeviceCache m_Cache{ *this };
+    DeviceChangeLog m_Changes;
 
+    // Registers the endpoint notifications the cache relies on, once. Until that succeeds every
+    // query is read through.
+    bool WatchDevices();
     std::vector<wil::com_ptr_nothrow<IMMDevice>> GetActiveDevices(EDataFlow dataFlow) const;
     wil::com_ptr_nothrow<IMMDevice> GetDevice(const std::wstring& deviceId) const;
     std::optional<AudioDeviceInfo> GetDeviceInfo(const std::wstring& deviceId);
-    std::optional<AudioDeviceInfo> GetDeviceInfo(wil::com_ptr_nothrow<IMMDevice> device);
+    static AudioDeviceInfo ToDeviceInfo(const DeviceEntry& entry);
     DWORD HashDeviceId(const std::wstring& deviceId);
     static WAVEFORMATEX* GetDeviceFormat(wil::com_ptr_nothrow<IMMDevice> device);
+
+private:
+    const EDataFlow m_DataFlow;
+    std::mutex m_WatchLock;
 };
@@ -3,8 +3,9 @@
 
 #include "Logger.h"
 
-AudioDeviceNotificationClient::AudioDeviceNotificationClient(DeviceStateChangedCallback callback, wil::com_ptr<IMMDeviceEnumerator> enumerator, EDataFlow flow)
-    : _refCount(1), _stateChangedCallback(callback), _deviceEnumerator(std::move(enumerator)), _dataFlow(flow) {}
+AudioDeviceNotificationClient::AudioDeviceNotificationClient(DeviceStateChangedCallback callback, wil::com_ptr<IMMDeviceEnumerator> enumerator, EDataFlow flow,
+    DeviceCache* cache, DeviceChangeLog* changes)
+    : _refCount(1), _stateChangedCallback(callback), _deviceEnumerator(std::move(enumerator)), _dataFlow(flow), _cache(cache), _changes(changes) {}
 
 STDMETHODIMP_(ULONG) AudioDeviceNotificationClient::AddRef() {
     return InterlockedIncrement(&_refCount);
@@ -28,13 +29,39 @@ STDMETHODIMP AudioDeviceNotificationClient::QueryInterface(REFIID riid, void** p
     return E_NOINTERFACE;
 }
 
+// Called before anything else of a notification, the callback may query the devices right away.
+static void InvalidateDevice(DeviceCache* cache, LPCWSTR deviceId, bool listChanged) {
+    if (!cache || !deviceId) {
+        return;
+    }
+
+    cache->InvalidateDevice(deviceId);
+    if (listChanged) {
+        cache->InvalidateDeviceLists();
+        cache->InvalidateSessions(deviceId);
+    }
+}
+
 HRESULT STDMETHODCALLTYPE AudioDeviceNotificationClient::OnDeviceAdded(LPCWSTR pwstrDeviceId) {
     Logger::GetInstance().Log("Device Added", LogLevel::Info);
+    InvalidateDevice(_cache, pwstrDeviceId, true);
+
+    // Reported with whatever state it came in, usually active.
+    wil::com_ptr<IMMDevice> device;
+    DWORD state = 0;
+    if (SUCCEEDED(_deviceEnumerator->GetDevice(pwstrDeviceId, &device)) && SUCCEEDED(device->GetState(&state))) {
+        ReportDeviceState(pwstrDeviceId, state, true);
+    }
     return S_OK;
 }
 
 HRESULT STDMETHODCALLTYPE AudioDeviceNotificationClient::OnDeviceRemoved(LPCWSTR pwstrDeviceId) {
     Logger::GetInstance().Log("Device Removed", LogLevel::Info);
+    InvalidateDevice(_cache, pwstrDeviceId, true);
+
+    // Gone from the enumerator already, so its flow is unknown. The side of the other flow does not
+    // list the id and ignores the change.
+    ReportDeviceState(pwstrDeviceId, DEVICE_STATE_NOTPRESENT, false);
     return S_OK;
 }
 
@@ -45,7 +72,7 @@ static std::optional<EDataFlow> GetDeviceDataFlowFromEnumerator(
     for (EDataFlow flow : { eRender, eCapture })
     {
         wil::com_ptr<IMMDeviceCollection> collection;
-        if (FAILED(enumerator->EnumAudioEndpoints(flow, DEVICE_STATE_ACTIVE | DEVICE_STATE_DISABLED | DEVICE_STATE_NOTPRESENT, &collection)))
+        if (FAILED(enumerator->EnumAudioEndpoints(flow, DEVICE_STATEMASK_ALL, &collection)))
             continue;
 
         UINT count = 0;
@@ -73,27 +100,39 @@ static std::optional<EDataFlow> GetDeviceDataFlowFromEnumerator(
 HRESULT STDMETHODCALLTYPE AudioDeviceNotificationClient::OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState)
 {
     Logger::GetInstance().Log("OnDeviceStateChanged called", LogLevel::Debug);
+    InvalidateDevice(_cache, pwstrDeviceId, true);
+    ReportDeviceState(pwstrDeviceId, dwNewState, true);
+    return S_OK;
+}
 
-    if (!_stateChangedCallback) {
-        Logger::GetInstance().Log("Callback is null, skipping", LogLevel::Warning);
-        return S_OK;
+void AudioDeviceNotificationClient::ReportDeviceState(LPCWSTR deviceId, DWORD state, bool checkFlow) {
+    const DeviceStateChangedCallback callback = _stateChangedCallback;
+    if (!callback && !_changes) {
+        Logger::GetInstance().Log("Callback is null, skipping", LogLevel::Debug);
+        return;
     }
 
-    auto flowOpt = GetDeviceDataFlowFromEnumerator(_deviceEnumerator, pwstrDeviceId);
-    if (!flowOpt.has_value()) {
-        Logger::GetInstance().Log("Device not found in either capture or render lists", LogLevel::Warning);
-        return S_OK;
+    if (checkFlow) {
+        auto flowOpt = GetDeviceDataFlowFromEnumerator(_deviceEnumerator, deviceId);
+        if (!flowOpt.has_value()) {
+            Logger::GetInstance().Log("Device not found in either capture or render lists", LogLevel::Warning);
+            return;
+        }
+
+        if (flowOpt.value() != _dataFlow) {
+            Logger::GetInstance().Log("Device flow does not match expected, skipping", LogLevel::Debug);
+            return;
+        }
     }
 
-    if (flowOpt.value() == _dataFlow) {
-        Logger::GetInstance().Log("Device matched expected flow, calling callback", LogLevel::Info);
-        _stateChangedCallback(pwstrDeviceId, static_cast<int>(dwNewState));
+    Logger::GetInstance().Log("Device matched expected flow, calling callback", LogLevel::Info);
+    // Recorded first, the callback may ask for the changes right away.
+    if (_changes) {
+        _changes->RecordDeviceState(deviceId, state);
     }
-    else {
-        Logger::GetInstance().Log("Device flow does not match expected, skipping", LogLevel::Debug);
+    if (callback) {
+        callback(deviceId, static_cast<int>(state));
     }
-
-    return S_OK;
 }
 
 HRESULT STDMETHODCALLTYPE AudioDeviceNotificationClient::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId) {
@@ -103,5 +142,7 @@ HRESULT STDMETHODCALLTYPE AudioDeviceNotificationClient::OnDefaultDeviceChanged(
 
 HRESULT STDMETHODCALLTYPE AudioDeviceNotificationClient::OnPropertyValueChanged(LPCWSTR pwstrDeviceId, const PROPERTYKEY key) {
     Logger::GetInstance().Log("Property Value Changed", LogLevel::Info);
+    // Name and mix format are properties of the endpoint.
+    InvalidateDevice(_cache, pwstrDeviceId, false);
     return S_OK;
 }
@@ -3,12 +3,22 @@
 #include <mmdeviceapi.h>
 #include <audiopolicy.h>
 #include <wil/com.h>
+#include <atomic>
+
+#include "DeviceCache.h"
+#include "DeviceChangeLog.h"
 
 typedef void(__stdcall* DeviceStateChangedCallback)(const wchar_t* deviceId, int newState);
 
+// Forwards state changes of `flow` devices, including devices being added and removed, to the
+// callback and records them in `changes`, and invalidates the device cache on every endpoint
+// change, whether a callback is set or not.
 class AudioDeviceNotificationClient : public IMMNotificationClient {
 public:
-    explicit AudioDeviceNotificationClient(DeviceStateChangedCallback callback, wil::com_ptr<IMMDeviceEnumerator> enumerator, EDataFlow flow);
+    explicit AudioDeviceNotificationClient(DeviceStateChangedCallback callback, wil::com_ptr<IMMDeviceEnumerator> enumerator, EDataFlow flow,
+        DeviceCache* cache = nullptr, DeviceChangeLog* changes = nullptr);
+
+    void SetCallback(DeviceStateChangedCallback callback) { _stateChangedCallback = callback; }
 
     STDMETHODIMP_(ULONG) AddRef() override;
     STDMETHODIMP_(ULONG) Release() override;
@@ -21,8 +31,13 @@ public:
     HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR pwstrDeviceId, const PROPERTYKEY key) override;
 
 private:
+    // `checkFlow` false reports the device whatever its flow.
+    void ReportDeviceState(LPCWSTR deviceId, DWORD state, bool checkFlow);
+
     LONG _refCount;
-    DeviceStateChangedCallback _stateChangedCallback;
+    std::atomic<DeviceStateChangedCallback> _stateChangedCallback;
     EDataFlow _dataFlow;
     wil::com_ptr<IMMDeviceEnumerator> _deviceEnumerator;
+    DeviceCache* _cache;
+    DeviceChangeLog* _changes;
 };
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// Plain description of an interleaved PCM stream, shared by the buffering and file writing code.
+struct AudioFormat {
+    uint32_t SampleRate = 0;
+    uint16_t Channels = 0;
+    uint16_t BitsPerSample = 0;
+    // Significant bits inside each sample container, 0 means the whole container (24-in-32 uses 24).
+    uint16_t ValidBitsPerSample = 0;
+    uint32_t ChannelMask = 0;
+    bool IsFloat = false;
+
+    uint16_t GetValidBitsPerSample() const { return ValidBitsPerSample != 0 ? ValidBitsPerSample : BitsPerSample; }
+    uint32_t BytesPerFrame() const { return static_cast<uint32_t>(Channels) * BitsPerSample / 8; }
+    uint32_t BytesPerSecond() const { return SampleRate * BytesPerFrame(); }
+    bool IsValid() const { return SampleRate > 0 && Channels > 0 && BitsPerSample > 0 && BitsPerSample % 8 == 0; }
+};
@@ -0,0 +1,260 @@
+#include "AudioMixer.h"
+
+#include <wil/result.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "Logger.h"
+#include "SilenceDetector.h"
+
+MixerInput::MixerInput(DWORD pipeId, uint32_t sampleRate, uint32_t channels, size_t ringFrames, ResamplerQuality quality) :
+    m_PipeId(pipeId), m_SampleRate(sampleRate), m_Channels(channels), m_Quality(quality), m_Ring(ringFrames * channels * sizeof(float)) {}
+
+bool MixerInput::SetSourceFormat(SampleFormat format, uint32_t channels, uint32_t sampleRate) {
+    if (channels == 0) {
+        return false;
+    }
+
+    if (sampleRate != m_SampleRate && !m_Resampler.Configure(sampleRate, m_SampleRate, m_Channels, m_Quality)) {
+        Logger::GetInstance().Log("Mixdown skips source " + std::to_string(m_PipeId) + ": cannot resample " +
+            std::to_string(sampleRate) + " Hz to the mix rate of " + std::to_string(m_SampleRate) + " Hz", LogLevel::Warning);
+        return false;
+    }
+
+    m_Converter.Configure(format, SampleFormat::Float32);
+    m_SourceChannels = channels;
+    m_IsActive.store(true, std::memory_order_release);
+    return true;
+}
+
+void MixerInput::Push(const BYTE* data, size_t frames) {
+    if (!m_IsActive.load(std::memory_order_acquire) || frames == 0) {
+        return;
+    }
+
+    const float* samples = reinterpret_cast<const float*>(m_Converter.Convert(data, frames * m_SourceChannels));
+
+    // Fold the source layout onto the mix layout: mono is duplicated, extra channels beyond the
+    // front pair are dropped.
+    const float* block = samples;
+    if (m_SourceChannels != m_Channels) {
+        m_Scratch.resize(frames * m_Channels);
+        for (size_t frame = 0; frame < frames; ++frame) {
+            for (uint32_t channel = 0; channel < m_Channels; ++channel) {
+                m_Scratch[frame * m_Channels + channel] = samples[frame * m_SourceChannels + (std::min)(channel, m_SourceChannels - 1)];
+            }
+        }
+        block = m_Scratch.data();
+    }
+
+    if (m_Resampler.IsConfigured()) {
+        block = m_Resampler.Process(block, frames, frames);
+        if (frames == 0) {
+            return;
+        }
+    }
+
+    if (!m_Ring.TryWrite(block, frames * m_Channels * sizeof(float))) {
+        m_DroppedFrames.fetch_add(frames, std::memory_order_relaxed);
+    }
+}
+
+size_t MixerInput::GetAvailableFrames() const {
+    return m_Ring.ReadableBytes() / (m_Channels * sizeof(float));
+}
+
+size_t MixerInput::Pull(float* destination, size_t frames) {
+    const size_t frameSize = m_Channels * sizeof(float);
+    const size_t size = (std::min)(frames, GetAvailableFrames()) * frameSize;
+
+    SpscRingBuffer::ReadRegion regions[2];
+    m_Ring.GetReadRegions(regions);
+
+    auto* output = reinterpret_cast<BYTE*>(destination);
+    size_t copied = 0;
+    for (const auto& region : regions) {
+        const size_t chunk = (std::min)(region.Size, size - copied);
+        memcpy(output + copied, region.Data, chunk);
+        copied += chunk;
+    }
+    m_Ring.Consume(copied);
+
+    // Whatever the source did not deliver in time is silence.
+    memset(output + copied, 0, frames * frameSize - copied);
+    return copied / frameSize;
+}
+
+AudioMixer::AudioMixer(long long captureId, uint32_t sampleRate, TransportType transport, ResamplerQuality quality) :
+    m_CaptureId(captureId),
+    m_SampleRate(sampleRate),
+    m_Quality(quality),
+    m_Output(CreateAudioTransport(transport)),
+    m_MixBuffer(BlockFrames * Channels),
+    m_InputBuffer(BlockFrames * Channels),
+    m_Limiter(sampleRate) {
+    m_OutputConverter.Configure(SampleFormat::Float32, OutputFormat, true);
+    m_Meter.Configure(SampleFormat::Float32, Channels, sampleRate);
+}
+
+AudioMixer::~AudioMixer() {
+    Stop();
+}
+
+std::shared_ptr<MixerInput> AudioMixer::AddInput(DWORD pipeId) {
+    // Room for a little more than the backlog limit, the mixer discards the excess anyway.
+    auto input = std::make_shared<MixerInput>(pipeId, m_SampleRate, Channels, BlockFrames * MaxBacklogBlocks * 2, m_Quality);
+    m_Inputs.push_back(input);
+    return input;
+}
+
+HRESULT AudioMixer::Start() {
+    RETURN_IF_FAILED(m_StopEvent.create(wil::EventOptions::ManualReset));
+    RETURN_IF_WIN32_BOOL_FALSE(m_Output->Create(MixdownPipeId, m_CaptureId));
+
+    m_IsRunning = true;
+    m_MixThread = std::thread(&AudioMixer::MixThreadProc, this);
+    return S_OK;
+}
+
+void AudioMixer::Stop() {
+    if (!m_IsRunning) {
+        return;
+    }
+    m_IsRunning = false;
+
+    m_StopEvent.SetEvent();
+    m_MixThread.join();
+
+    // Sources are stopped by now, flush what they delivered last.
+    while (MixBlock(true)) {
+    }
+    m_Output->Close();
+
+    for (const auto& input : m_Inputs) {
+        if (const auto dropped = input->GetDroppedFrames(); dropped > 0) {
+            Logger::GetInstance().Log("Mixdown input " + std::to_string(input->GetPipeId()) + " dropped " +
+                std::to_string(dropped) + " frames", LogLevel::Warning);
+        }
+    }
+}
+
+UINT64 AudioMixer::GetDroppedFrames() const {
+    UINT64 dropped = 0;
+    for (const auto& input : m_Inputs) {
+        dropped += input->GetDroppedFrames();
+    }
+    return dropped;
+}
+
+void AudioMixer::GetStats(CaptureStats& stats) const {
+    stats.PipeId = MixdownPipeId;
+    m_Counters.Snapshot(stats);
+    m_Output->GetCounters().Snapshot(stats);
+    stats.DroppedBytes = m_Output->GetDroppedBytes();
+}
+
+void AudioMixer::GetLevels(StreamLevels& levels) const {
+    m_Meter.Read(levels);
+    levels.PipeId = MixdownPipeId;
+}
+
+bool AudioMixer::SetGain(DWORD pipeId, float gain) {
+    for (const auto& input : m_Inputs) {
+        if (input->GetPipeId() == pipeId) {
+            input->SetGain(std::clamp(gain, 0.0f, 8.0f));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AudioMixer::SetMuted(DWORD pipeId, bool muted) {
+    for (const auto& input : m_Inputs) {
+        if (input->GetPipeId() == pipeId) {
+            input->SetMuted(muted);
+            return true;
+        }
+    }
+    return false;
+}
+
+void AudioMixer::MixThreadProc() {
+    // Poll at twice the block rate, sources do not signal the mixer so a late callback never
+    // touches mixer state.
+    const DWORD interval = (std::max)(1ul, static_cast<DWORD>(BlockFrames * 1000 / m_SampleRate / 2));
+
+    while (WaitForSingleObject(m_StopEvent.get(), interval) == WAIT_TIMEOUT) {
+        while (MixBlock(false)) {
+        }
+    }
+}
+
+bool AudioMixer::MixBlock(bool flush) {
+    size_t slowest = SIZE_MAX;
+    size_t fastest = 0;
+    for (const auto& input : m_Inputs) {
+        if (!input->IsActive()) {
+            continue;
+        }
+
+        const size_t available = input->GetAvailableFrames();
+        slowest = (std::min)(slowest, available);
+        fastest = (std::max)(fastest, available);
+    }
+
+    if (flush) {
+        if (fastest == 0) {
+            return false;
+        }
+    }
+    else if (fastest < BlockFrames || (slowest < BlockFrames && fastest < BlockFrames * MaxBacklogBlocks)) {
+        return false;
+    }
+
+    std::fill(m_MixBuffer.begin(), m_MixBuffer.end(), 0.0f);
+
+    bool underrun = false;
+    for (const auto& input : m_Inputs) {
+        if (!input->IsActive()) {
+            continue;
+        }
+
+        // Muted sources are still drained so they stay aligned with the others. A source with
+        // nothing pending is idle rather than late, padding it does not cut into its audio.
+        const size_t pulled = input->Pull(m_InputBuffer.data(), BlockFrames);
+        if (pulled > 0 && pulled < BlockFrames) {
+            underrun = true;
+        }
+
+        const float gain = input->m_Muted.load(std::memory_order_relaxed) ? 0.0f : input->m_Gain.load(std::memory_order_relaxed);
+        if (gain == input->m_AppliedGain) {
+            if (gain != 0.0f) {
+                MixAccumulate(m_MixBuffer.data(), m_InputBuffer.data(), gain, m_MixBuffer.size());
+            }
+        }
+        else {
+            MixAccumulateRamp(m_MixBuffer.data(), m_InputBuffer.data(), input->m_AppliedGain, gain, BlockFrames, Channels);
+            input->m_AppliedGain = gain;
+        }
+    }
+
+    m_Limiter.Process(m_MixBuffer.data(), BlockFrames, Channels);
+    m_Meter.Process(reinterpret_cast<const uint8_t*>(m_MixBuffer.data()), BlockFrames);
+
+    const size_t sampleCount = m_MixBuffer.size();
+    const bool silent = SilenceDetector::IsZero(reinterpret_cast<const uint8_t*>(m_MixBuffer.data()), sampleCount, SampleFormat::Float32);
+    if (silent && m_Records.IsRecordsEnabled()) {
+        m_Records.WriteSilence(*m_Output, BlockFrames);
+    }
+    else {
+        const BYTE* output = m_OutputConverter.Convert(m_MixBuffer.data(), sampleCount);
+        m_Records.WriteAudio(*m_Output, output, static_cast<DWORD>(m_OutputConverter.GetConvertedSize(sampleCount)));
+    }
+
+    // A source that ran dry within the block is a gap in the mix; the last block of a flush is
+    // expected to be partial.
+    m_Counters.RecordPacket(BlockFrames, underrun && !flush, silent);
+
+    return true;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AudioTransport.h"
+#include "CaptureStats.h"
+#include "LevelMeter.h"
+#include "MixKernels.h"
+#include "PolyphaseResampler.h"
+#include "SampleFormatConverter.h"
+#include "SpscRingBuffer.h"
+#include "StreamRecord.h"
+
+// One source feeding an AudioMixer. The capture callback pushes its packets in whatever format it
+// delivers, they are converted to interleaved float at the mixer's channel layout and queued in an
+// SPSC ring that the mixer thread drains block by block. Sources at another rate are resampled to
+// the mix rate on the way in.
+//
+// Capture objects keep a shared reference, so a late callback after the mixer stopped is harmless.
+class MixerInput {
+public:
+    MixerInput(DWORD pipeId, uint32_t sampleRate, uint32_t channels, size_t ringFrames, ResamplerQuality quality);
+
+    // Called before capture starts. Returns false and leaves the input out of the mix if the
+    // source rate cannot be converted to the mix rate.
+    bool SetSourceFormat(SampleFormat format, uint32_t channels, uint32_t sampleRate);
+
+    // Capture thread.
+    void Push(const BYTE* data, size_t frames);
+
+    void SetGain(float gain) { m_Gain.store(gain, std::memory_order_relaxed); }
+    void SetMuted(bool muted) { m_Muted.store(muted, std::memory_order_relaxed); }
+
+    DWORD GetPipeId() const { return m_PipeId; }
+    bool IsActive() const { return m_IsActive.load(std::memory_order_acquire); }
+    UINT64 GetDroppedFrames() const { return m_DroppedFrames.load(std::memory_order_relaxed); }
+
+private:
+    friend class AudioMixer;
+
+    // Mixer thread.
+    size_t GetAvailableFrames() const;
+    size_t Pull(float* destination, size_t frames);
+
+    DWORD m_PipeId;
+    uint32_t m_SampleRate;
+    uint32_t m_Channels;
+    uint32_t m_SourceChannels = 0;
+    SampleFormatConverter m_Converter;
+    std::vector<float> m_Scratch;
+    ResamplerQuality m_Quality;
+    PolyphaseResampler m_Resampler;
+    SpscRingBuffer m_Ring;
+
+    std::atomic<bool> m_IsActive{ false };
+    std::atomic<float> m_Gain{ 1.0f };
+    std::atomic<bool> m_Muted{ false };
+    std::atomic<UINT64> m_DroppedFrames{ 0 };
+
+    // Gain the mixer applied to the previous block, owned by the mixer thread.
+    float m_AppliedGain = 1.0f;
+};
+
+// Sums the sources of one capture into a single stereo track published as one more transport with
+// pipe id MixdownPipeId, so the consumer handles it exactly like any other source.
+//
+// Mixing runs on a dedicated thread in fixed blocks of BlockFrames frames: every source contributes
+// one MixAccumulate pass per block, the cost grows linearly with the number of sources. A block is
+// mixed once every active source has delivered it; a source that falls MaxBacklogBlocks behind the
+// fastest one (stalled device, idle application) is filled with silence instead of holding the mix back.
+// Only a source that ran out part way through a block counts as a discontinuity, an idle one does not.
+class AudioMixer {
+public:
+    static constexpr DWORD MixdownPipeId = 0;
+    // Rate of the application loopback streams.
+    static constexpr uint32_t DefaultSampleRate = 44100;
+    static constexpr uint32_t Channels = 2;
+    static constexpr size_t BlockFrames = 256;
+    static constexpr size_t MaxBacklogBlocks = 8;
+    static constexpr SampleFormat OutputFormat = SampleFormat::Int16;
+
+    AudioMixer(long long captureId, uint32_t sampleRate, TransportType transport, ResamplerQuality quality = ResamplerQuality::Medium);
+    ~AudioMixer();
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    // Batch the mixdown's transport writes, set before Start().
+    void SetCoalescing(const WriteCoalescing& coalescing) { m_Output->SetCoalescing(coalescing); }
+    // With records enabled, blocks that mix to digital silence go out as silence records. The
+    // threshold is applied by the sources, the mix itself is only tested for exact zeros.
+    void SetSilenceHandling(const SilenceHandling& handling) { m_Records.SetRecordsEnabled(handling.Records); }
+
+    // All inputs are added before Start().
+    std::shared_ptr<MixerInput> AddInput(DWORD pipeId);
+
+    HRESULT Start();
+    void Stop();
+
+    bool SetGain(DWORD pipeId, float gain);
+    bool SetMuted(DWORD pipeId, bool muted);
+
+    uint32_t GetSampleRate() const { return m_SampleRate; }
+    UINT64 GetDroppedFrames() const;
+
+    // Stats of the mixdown stream. Every block is a packet; a block where a source was padded with
+    // silence counts as a discontinuity, a block that mixes to digital silence as silent.
+    void GetStats(CaptureStats& stats) const;
+    // Levels of the mix after the limiter.
+    void GetLevels(StreamLevels& levels) const;
+
+private:
+    // Mixes blocks on its own thread to time MixBlock.
+    friend class MixdownBenchmarkRun;
+
+    void MixThreadProc();
+    bool MixBlock(bool flush);
+
+    long long m_CaptureId;
+    uint32_t m_SampleRate;
+    ResamplerQuality m_Quality;
+    std::unique_ptr<AudioTransport> m_Output;
+    std::vector<std::shared_ptr<MixerInput>> m_Inputs;
+
+    std::vector<float> m_MixBuffer;
+    std::vector<float> m_InputBuffer;
+    SoftLimiter m_Limiter;
+    SampleFormatConverter m_OutputConverter;
+    StreamRecordWriter m_Records;
+    StreamCounters m_Counters;
+    LevelMeter m_Meter;
+
+    wil::unique_event_nothrow m_StopEvent;
+    std::thread m_MixThread;
+    bool m_IsRunning = false;
+};
@@ -0,0 +1,224 @@
+#include "AudioPipeWriter.h"
+
+#include <wchar.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "Logger.h"
+
+AudioPipeWriter::~AudioPipeWriter() {
+    Close();
+}
+
+BOOL AudioPipeWriter::Create(DWORD pipeId, long long captureId) {
+    TCHAR pipeName[256];
+    swprintf_s(pipeName, _countof(pipeName), L"\\\\.\\pipe\\AudioDataPipe_%lu_%lld", pipeId, captureId);
+
+    m_hPipe = CreateNamedPipeW(
+        pipeName,
+        PIPE_ACCESS_OUTBOUND,
+        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+        1,
+        1024 * 16,
+        0,
+        0,
+        NULL
+    );
+
+    if (m_hPipe == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    if (FAILED(m_DataReadyEvent.create(wil::EventOptions::None))) {
+        CloseHandle(m_hPipe);
+        m_hPipe = INVALID_HANDLE_VALUE;
+        return FALSE;
+    }
+
+    m_FlushTimer.reset(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+    if (!m_FlushTimer) {
+        m_FlushTimer.reset(CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+    }
+    if (!m_FlushTimer) {
+        CloseHandle(m_hPipe);
+        m_hPipe = INVALID_HANDLE_VALUE;
+        return FALSE;
+    }
+
+    m_Ring = std::make_unique<SpscRingBuffer>(m_RingCapacity);
+    m_StopRequested = false;
+    m_AbortRequested = false;
+    m_WriterIdle = true;
+    m_IsOpen = true;
+    m_WriterThread = std::thread(&AudioPipeWriter::WriterThreadProc, this);
+
+    return TRUE;
+}
+
+bool AudioPipeWriter::Write(const BYTE* data, DWORD dataSize) {
+    if (!m_IsOpen.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    if (!m_Ring->TryWrite(data, dataSize)) {
+        m_DroppedBytes.fetch_add(dataSize, std::memory_order_relaxed);
+        return false;
+    }
+
+    // When coalescing, the writer thread only has to hear about the first packet of a batch, which
+    // starts its deadline, and about the batch reaching the size threshold.
+    if (m_CoalesceLatencyMs.load(std::memory_order_relaxed) != 0) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_WriterIdle.exchange(false, std::memory_order_acq_rel)) {
+            m_PendingSince.store(GetTimestamp(), std::memory_order_relaxed);
+        }
+        else {
+            const DWORD threshold = m_CoalesceBytes.load(std::memory_order_relaxed);
+            if (threshold == 0 || m_Ring->ReadableBytes() < threshold) {
+                return true;
+            }
+        }
+    }
+
+    m_DataReadyEvent.SetEvent();
+    return true;
+}
+
+void AudioPipeWriter::SetCoalescing(const WriteCoalescing& coalescing) {
+    m_CoalesceBytes.store(coalescing.MaxBytes, std::memory_order_relaxed);
+    m_CoalesceLatencyMs.store(coalescing.MaxLatencyMs, std::memory_order_relaxed);
+}
+
+int64_t AudioPipeWriter::GetTimestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AudioPipeWriter::Close() {
+    if (!m_IsOpen.exchange(false)) {
+        return;
+    }
+
+    m_StopRequested = true;
+    m_DataReadyEvent.SetEvent();
+
+    // The writer flushes what is still in the ring. The consumer may have stopped reading while
+    // the writer thread is blocked in WriteFile though, so after FlushTimeoutMs the rest is given
+    // up and the pending I/O cancelled until the thread notices.
+    const HANDLE hThread = m_WriterThread.native_handle();
+    if (WaitForSingleObject(hThread, FlushTimeoutMs) == WAIT_TIMEOUT) {
+        m_AbortRequested = true;
+        while (WaitForSingleObject(hThread, 10) == WAIT_TIMEOUT) {
+            CancelSynchronousIo(hThread);
+        }
+    }
+    m_WriterThread.join();
+
+    CloseHandle(m_hPipe);
+    m_hPipe = INVALID_HANDLE_VALUE;
+
+    if (const auto dropped = GetDroppedBytes(); dropped > 0) {
+        Logger::GetInstance().Log("Pipe writer dropped " + std::to_string(dropped) + " bytes on ring overflow", LogLevel::Warning);
+    }
+}
+
+void AudioPipeWriter::WriterThreadProc() {
+    const HANDLE handles[] = { m_DataReadyEvent.get(), m_FlushTimer.get() };
+
+    while (!m_StopRequested.load(std::memory_order_acquire)) {
+        const DWORD result = WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, INFINITE);
+        if (result != WAIT_OBJECT_0 && result != WAIT_OBJECT_0 + 1) {
+            break;
+        }
+
+        if (m_CoalesceLatencyMs.load(std::memory_order_relaxed) == 0) {
+            DrainRing();
+            continue;
+        }
+
+        const DWORD threshold = m_CoalesceBytes.load(std::memory_order_relaxed);
+        const bool isDue = result == WAIT_OBJECT_0 + 1 || m_StopRequested.load(std::memory_order_acquire);
+        if (!isDue && (threshold == 0 || m_Ring->ReadableBytes() < threshold)) {
+            // First packet of a batch.
+            ArmFlushTimer(m_PendingSince.load(std::memory_order_relaxed));
+            continue;
+        }
+
+        CancelWaitableTimer(m_FlushTimer.get());
+        DrainRing();
+
+        // Hand the next batch's first packet back to the producer. Whatever arrived during the
+        // write and may have been missed by it starts a batch right here.
+        m_WriterIdle.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_Ring->ReadableBytes() > 0 && m_WriterIdle.exchange(false, std::memory_order_acq_rel)) {
+            const int64_t now = GetTimestamp();
+            m_PendingSince.store(now, std::memory_order_relaxed);
+            ArmFlushTimer(now);
+        }
+    }
+
+    // Flush on stop.
+    DrainRing();
+}
+
+void AudioPipeWriter::ArmFlushTimer(int64_t pendingSince) {
+    const int64_t deadline = pendingSince + static_cast<int64_t>(m_CoalesceLatencyMs.load(std::memory_order_relaxed)) * 1000000;
+    LARGE_INTEGER dueTime;
+    // Relative, in 100 ns units; an overdue batch fires right away.
+    dueTime.QuadPart = -(std::max)((deadline - GetTimestamp()) / 100, int64_t{ 1 });
+    SetWaitableTimer(m_FlushTimer.get(), &dueTime, 0, nullptr, nullptr, FALSE);
+}
+
+// Writes everything that is in the ring when called. Packets enter the ring whole, so the
+// amount is always a whole number of frames; a wrapped ring is copied into one buffer to keep
+// it a single WriteFile.
+void AudioPipeWriter::DrainRing() {
+    SpscRingBuffer::ReadRegion regions[2];
+    const size_t available = m_Ring->GetReadRegions(regions);
+    if (available == 0 || m_AbortRequested.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    if (regions[1].Size == 0) {
+        WriteRegion(regions[0].Data, regions[0].Size);
+    }
+    else {
+        if (m_Staging.size() < available) {
+            m_Staging.resize(available);
+        }
+        memcpy(m_Staging.data(), regions[0].Data, regions[0].Size);
+        memcpy(m_Staging.data() + regions[0].Size, regions[1].Data, regions[1].Size);
+        WriteRegion(m_Staging.data(), available);
+    }
+
+    m_Ring->Consume(available);
+}
+
+// Data is consumed even if the client is not connected yet or has gone away, otherwise the ring
+// would fill up and the capture side would start dropping. A short write is continued with the
+// remainder so the byte stream the consumer sees stays intact.
+void AudioPipeWriter::WriteRegion(const BYTE* data, size_t size) {
+    while (size > 0 && !m_AbortRequested.load(std::memory_order_acquire)) {
+        const auto begin = std::chrono::steady_clock::now();
+        DWORD written = 0;
+        const BOOL succeeded = WriteFile(m_hPipe, data, static_cast<DWORD>(size), &written, NULL);
+        const auto elapsed = std::chrono::steady_clock::now() - begin;
+
+        if (!succeeded) {
+            // Nobody listening yet, or the write was cancelled by Close(); neither is a glitch.
+            if (GetLastError() != ERROR_PIPE_LISTENING && !m_AbortRequested.load(std::memory_order_acquire)) {
+                m_Counters.RecordFailedWrite();
+            }
+            return;
+        }
+
+        m_Counters.RecordWrite(size, written, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        if (written == 0) {
+            return;
+        }
+
+        data += written;
+        size -= written;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "AudioTransport.h"
+#include "SpscRingBuffer.h"
+
+// Owns the \\.\pipe\AudioDataPipe_<pipeId>_<captureId> server end of one capture source.
+//
+// Write() is called from the capture callback and only copies into a preallocated SPSC ring,
+// a dedicated writer thread drains the ring into the pipe. A slow consumer therefore never
+// stalls the MMCSS capture thread; if the ring overflows the packet is dropped and counted.
+//
+// With coalescing enabled the writer thread sleeps until a batch is due, on a high resolution
+// timer for the age limit, and the capture side signals it about twice per batch instead of once
+// per packet. What is still in the ring on Close() is flushed.
+class AudioPipeWriter : public AudioTransport {
+public:
+    static constexpr size_t DefaultRingCapacity = 1024 * 1024;
+    // How long Close() waits for the final flush before abandoning it.
+    static constexpr DWORD FlushTimeoutMs = 500;
+
+    explicit AudioPipeWriter(size_t ringCapacity = DefaultRingCapacity) : m_RingCapacity(ringCapacity) {}
+    ~AudioPipeWriter() override;
+
+    AudioPipeWriter(const AudioPipeWriter&) = delete;
+    AudioPipeWriter& operator=(const AudioPipeWriter&) = delete;
+
+    BOOL Create(DWORD pipeId, long long captureId) override;
+    bool Write(const BYTE* data, DWORD dataSize) override;
+    void Close() override;
+
+    UINT64 GetDroppedBytes() const override { return m_DroppedBytes.load(std::memory_order_relaxed); }
+
+    void SetCoalescing(const WriteCoalescing& coalescing) override;
+
+private:
+    static int64_t GetTimestamp();
+
+    void WriterThreadProc();
+    void ArmFlushTimer(int64_t pendingSince);
+    void DrainRing();
+    void WriteRegion(const BYTE* data, size_t size);
+
+    HANDLE m_hPipe = INVALID_HANDLE_VALUE;
+    size_t m_RingCapacity;
+    std::unique_ptr<SpscRingBuffer> m_Ring;
+    wil::unique_event_nothrow m_DataReadyEvent;
+    wil::unique_handle m_FlushTimer;
+    std::thread m_WriterThread;
+    std::atomic<bool> m_IsOpen{ false };
+    std::atomic<bool> m_StopRequested{ false };
+    std::atomic<bool> m_AbortRequested{ false };
+    std::atomic<UINT64> m_DroppedBytes{ 0 };
+
+    std::atomic<DWORD> m_CoalesceBytes{ 0 };
+    std::atomic<DWORD> m_CoalesceLatencyMs{ 0 };
+    // Set by the writer thread once a batch is written; the producer that clears it owns the
+    // next batch's first packet and records when it arrived.
+    std::atomic<bool> m_WriterIdle{ true };
+    std::atomic<int64_t> m_PendingSince{ 0 };
+
+    // Writer thread.
+    std::vector<BYTE> m_Staging;
+};
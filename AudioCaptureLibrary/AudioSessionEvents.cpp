@@ -2,8 +2,10 @@
 
 #include "Logger.h"
 
-AudioSessionEvents::AudioSessionEvents(std::wstring deviceId, std::wstring sessionId, wil::com_ptr<IAudioSessionControl2> sessionControl2, SessionStateChangedCallback callback)
-    : _sessionControl2(std::move(sessionControl2)), _refCount(1), _deviceId(std::move(deviceId)), _sessionId(std::move(sessionId)), _stateChangedCallback(callback) { }
+AudioSessionEvents::AudioSessionEvents(std::wstring deviceId, std::wstring sessionId, wil::com_ptr<IAudioSessionControl2> sessionControl2, SessionStateChangedCallback callback,
+    DeviceCache* cache, DeviceChangeLog* changes)
+    : _sessionControl2(std::move(sessionControl2)), _refCount(1), _deviceId(std::move(deviceId)), _sessionId(std::move(sessionId)), _stateChangedCallback(callback),
+      _cache(cache), _changes(changes) { }
 
 STDMETHODIMP_(ULONG) AudioSessionEvents::AddRef() {
     return InterlockedIncrement(&_refCount);
@@ -29,6 +31,7 @@ STDMETHODIMP AudioSessionEvents::QueryInterface(REFIID riid, void** ppvObject) {
 
 HRESULT STDMETHODCALLTYPE AudioSessionEvents::OnSessionDisconnected(AudioSessionDisconnectReason reason) {
     Logger::GetInstance().Log("Session disconnected", LogLevel::Info);
+    InvalidateSessions();
 
     if (_sessionControl2 && _sessionControl2->IsSystemSoundsSession() == S_OK) {
         Logger::GetInstance().Log("Skipping system sounds session", LogLevel::Debug);
@@ -41,15 +44,17 @@ HRESULT STDMETHODCALLTYPE AudioSessionEvents::OnSessionDisconnected(AudioSession
         return S_OK;
     }
 
-    if (_stateChangedCallback) {
-        _stateChangedCallback(_deviceId.c_str(), _sessionId.c_str(), AudioSessionStateExpired);
-    }
+    ReportState(AudioSessionStateExpired);
 
     return S_OK;
 }
 
 HRESULT STDMETHODCALLTYPE AudioSessionEvents::OnStateChanged(AudioSessionState state) {
     Logger::GetInstance().Log("Session state changed", LogLevel::Info);
+    // Session lists hold no state, only an expired session leaves them.
+    if (state == AudioSessionStateExpired) {
+        InvalidateSessions();
+    }
 
     if (_sessionControl2 && _sessionControl2->IsSystemSoundsSession() == S_OK) {
         Logger::GetInstance().Log("Skipping system sounds session", LogLevel::Debug);
@@ -62,18 +67,18 @@ HRESULT STDMETHODCALLTYPE AudioSessionEvents::OnStateChanged(AudioSessionState s
         return S_OK;
     }
 
-    if (_stateChangedCallback) {
-        _stateChangedCallback(_deviceId.c_str(), _sessionId.c_str(), state);
-    }
+    ReportState(state);
 
     return S_OK;
 }
 
 HRESULT STDMETHODCALLTYPE AudioSessionEvents::OnDisplayNameChanged(LPCWSTR, LPCGUID) {
+    InvalidateSessions();
     return S_OK;
 }
 
 HRESULT STDMETHODCALLTYPE AudioSessionEvents::OnIconPathChanged(LPCWSTR, LPCGUID) {
+    InvalidateSessions();
     return S_OK;
 }
 
@@ -89,6 +94,23 @@ HRESULT STDMETHODCALLTYPE AudioSessionEvents::OnGroupingParamChanged(LPCGUID, LP
     return S_OK;
 }
 
+void AudioSessionEvents::InvalidateSessions() {
+    if (_cache) {
+        _cache->InvalidateSessions(_deviceId);
+    }
+}
+
+// Recorded first, the callback may ask for the changes right away.
+void AudioSessionEvents::ReportState(AudioSessionState state) {
+    if (_changes) {
+        _changes->RecordSessionState(_deviceId, _sessionId, static_cast<DWORD>(state));
+    }
+
+    if (_stateChangedCallback) {
+        _stateChangedCallback(_deviceId.c_str(), _sessionId.c_str(), state);
+    }
+}
+
 void AudioSessionEvents::Unregister() {
     if (_sessionControl2) {
         _sessionControl2->UnregisterAudioSessionNotification(this);
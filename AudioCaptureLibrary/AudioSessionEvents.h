@@ -5,11 +5,15 @@
 #include <audiopolicy.h>
 #include <wil/com.h>
 
+#include "DeviceCache.h"
+#include "DeviceChangeLog.h"
+
 typedef void(__stdcall* SessionStateChangedCallback)(const wchar_t* deviceId, const wchar_t* sessionId, int newState);
 
 class AudioSessionEvents : public IAudioSessionEvents {
 public:
-    explicit AudioSessionEvents(std::wstring deviceId, std::wstring sessionId, wil::com_ptr<IAudioSessionControl2> sessionControl2, SessionStateChangedCallback callback);
+    explicit AudioSessionEvents(std::wstring deviceId, std::wstring sessionId, wil::com_ptr<IAudioSessionControl2> sessionControl2, SessionStateChangedCallback callback,
+        DeviceCache* cache = nullptr, DeviceChangeLog* changes = nullptr);
 
     STDMETHODIMP_(ULONG) AddRef() override;
     STDMETHODIMP_(ULONG) Release() override;
@@ -26,9 +30,14 @@ public:
     void Unregister();
 
 private:
+    void InvalidateSessions();
+    void ReportState(AudioSessionState state);
+
     wil::com_ptr<IAudioSessionControl2> _sessionControl2;
     LONG _refCount;
     std::wstring _deviceId;
     std::wstring _sessionId;
     SessionStateChangedCallback _stateChangedCallback;
+    DeviceCache* _cache;
+    DeviceChangeLog* _changes;
 };
@@ -4,8 +4,9 @@
 
 #include "AudioSessionEvents.h"
 
-AudioSessionNotification::AudioSessionNotification(std::wstring deviceId, SessionStateChangedCallback callback)
-    : _refCount(1), _deviceId(std::move(deviceId)), _stateChangedCallback(callback) { }
+AudioSessionNotification::AudioSessionNotification(std::wstring deviceId, SessionStateChangedCallback callback, DeviceCache* cache,
+    DeviceChangeLog* changes)
+    : _refCount(1), _deviceId(std::move(deviceId)), _stateChangedCallback(callback), _cache(cache), _changes(changes) { }
 
 STDMETHODIMP_(ULONG) AudioSessionNotification::AddRef() {
     return InterlockedIncrement(&_refCount);
@@ -31,6 +32,9 @@ STDMETHODIMP AudioSessionNotification::QueryInterface(REFIID riid, void** ppvObj
 
 HRESULT STDMETHODCALLTYPE AudioSessionNotification::OnSessionCreated(IAudioSessionControl* newSession) {
     Logger::GetInstance().Log("New audio session created", LogLevel::Info);
+    if (_cache) {
+        _cache->InvalidateSessions(_deviceId);
+    }
 
     wil::com_ptr_nothrow<IAudioSessionControl2> sessionControl2;
     if (FAILED(newSession->QueryInterface(__uuidof(IAudioSessionControl2), reinterpret_cast<void**>(&sessionControl2)))) {
@@ -56,7 +60,7 @@ HRESULT STDMETHODCALLTYPE AudioSessionNotification::OnSessionCreated(IAudioSessi
     }
     std::wstring sessionId = sid.get();
 
-    auto events = new AudioSessionEvents(_deviceId, sessionId, sessionControl2, _stateChangedCallback);
+    auto events = new AudioSessionEvents(_deviceId, sessionId, sessionControl2, _stateChangedCallback, _cache, _changes);
     if (FAILED(sessionControl2->RegisterAudioSessionNotification(events))) {
         Logger::GetInstance().Log("RegisterAudioSessionNotification failed", LogLevel::Warning);
         events->Release();
@@ -65,6 +69,9 @@ HRESULT STDMETHODCALLTYPE AudioSessionNotification::OnSessionCreated(IAudioSessi
 
     _sessionEvents[sessionId] = events;
 
+    if (_changes) {
+        _changes->RecordSessionState(_deviceId, sessionId, AudioSessionStateActive);
+    }
     if (_stateChangedCallback) {
         _stateChangedCallback(_deviceId.c_str(), sessionId.c_str(), AudioSessionStateActive);
     }
@@ -106,7 +113,7 @@ void AudioSessionNotification::RegisterEventsForExistingSessions(const wil::com_
         wil::unique_cotaskmem_string sid(sidRaw);
         std::wstring sessionId = sid.get();
 
-        auto events = new AudioSessionEvents(_deviceId, sessionId, sessionControl2, _stateChangedCallback);
+        auto events = new AudioSessionEvents(_deviceId, sessionId, sessionControl2, _stateChangedCallback, _cache, _changes);
         if (SUCCEEDED(sessionControl2->RegisterAudioSessionNotification(events))) {
             _sessionEvents[sessionId] = events;
         } else {
@@ -115,6 +122,16 @@ void AudioSessionNotification::RegisterEventsForExistingSessions(const wil::com_
     }
 }
 
+// Recorded first, the callback may ask for the changes right away.
+void AudioSessionNotification::ReportSessionNames() {
+    if (_changes) {
+        _changes->RecordSessionNames(_deviceId);
+    }
+    if (_stateChangedCallback) {
+        _stateChangedCallback(_deviceId.c_str(), L"", AudioSessionStateActive);
+    }
+}
+
 void AudioSessionNotification::UnregisterAllSessionEvents() {
     Logger::GetInstance().Log("UnregisterAllSessionEvents", LogLevel::Debug);
 
@@ -1,15 +1,21 @@
-#pragma once
+﻿#pragma once
 
 #include <mmdeviceapi.h>
 #include <audiopolicy.h>
 #include <unordered_map>
 
 #include "AudioSessionEvents.h"
+#include "DeviceCache.h"
+#include "DeviceChangeLog.h"
 #include "Logger.h"
 
+// Session notifications of one device. Every session created, expired or renamed invalidates the
+// device's sessions in `cache` and state changes are recorded in `changes`; both have to outlive the
+// registration.
 class AudioSessionNotification : public IAudioSessionNotification {
 public:
-    explicit AudioSessionNotification(std::wstring deviceId, SessionStateChangedCallback callback);
+    explicit AudioSessionNotification(std::wstring deviceId, SessionStateChangedCallback callback, DeviceCache* cache = nullptr,
+        DeviceChangeLog* changes = nullptr);
 
     STDMETHODIMP_(ULONG) AddRef() override;
     STDMETHODIMP_(ULONG) Release() override;
@@ -20,10 +26,16 @@ public:
     void RegisterEventsForExistingSessions(const wil::com_ptr<IAudioSessionManager2>& sessionManager);
     void UnregisterAllSessionEvents();
 
+    // Records a SessionNames change and calls the callback with an empty session id. Safe to call
+    // from any thread.
+    void ReportSessionNames();
+
 private:
     LONG _refCount;
     std::wstring _deviceId;
     SessionStateChangedCallback _stateChangedCallback;
+    DeviceCache* _cache;
+    DeviceChangeLog* _changes;
     wil::com_ptr<IAudioSessionManager2> _sessionManager2;
     std::unordered_map<std::wstring, AudioSessionEvents*> _sessionEvents;
 };
@@ -0,0 +1,14 @@
+#include "AudioTransport.h"
+
+#include "AudioPipeWriter.h"
+#include "SharedMemoryTransport.h"
+
+std::unique_ptr<AudioTransport> CreateAudioTransport(TransportType type) {
+    switch (type) {
+    case TransportType::SharedMemory:
+        return std::make_unique<SharedMemoryTransport>();
+    case TransportType::NamedPipe:
+    default:
+        return std::make_unique<AudioPipeWriter>();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Windows.h>
+#include <memory>
+
+#include "CaptureStats.h"
+
+// How a capture source hands its audio to the consumer.
+enum class TransportType : int {
+    NamedPipe = 0,
+    SharedMemory = 1,
+};
+
+// Batching of transport writes. Packets are held back until MaxBytes are pending or the oldest
+// pending byte is MaxLatencyMs old, whichever comes first, and go out in a single write. Disabled
+// when MaxLatencyMs is 0; MaxBytes 0 flushes on age alone.
+struct WriteCoalescing {
+    DWORD MaxBytes = 0;
+    DWORD MaxLatencyMs = 0;
+
+    bool IsEnabled() const { return MaxLatencyMs != 0; }
+};
+
+// Server end of the per-source channel, named after <pipeId>_<captureId>. Write() is called
+// from the capture callback and must never block.
+class AudioTransport {
+public:
+    virtual ~AudioTransport() = default;
+
+    virtual BOOL Create(DWORD pipeId, long long captureId) = 0;
+    virtual bool Write(const BYTE* data, DWORD dataSize) = 0;
+    virtual void Close() = 0;
+
+    virtual UINT64 GetDroppedBytes() const = 0;
+
+    // Transports without a per-write system call ignore this.
+    virtual void SetCoalescing(const WriteCoalescing&) {}
+
+    const TransportCounters& GetCounters() const { return m_Counters; }
+
+protected:
+    TransportCounters m_Counters;
+};
+
+std::unique_ptr<AudioTransport> CreateAudioTransport(TransportType type);
@@ -0,0 +1,115 @@
+// Quality and speed of the PolyphaseResampler at every quality level for the rate pairs a capture
+// meets: a 1 kHz sine at -6 dBFS is converted in packets of varying size, like a live capture, and
+// compared against the ideal sine at the output rate.
+//
+// Usage: ResamplerBenchmark [seconds of audio per run, default 4]
+//
+// Prints one JSON object per quality and rate pair: signal to error ratio in dB and speed as a
+// multiple of realtime for a stereo stream on one core.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "PolyphaseResampler.h"
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr double Frequency = 1000.0;
+constexpr double Amplitude = 0.5;
+constexpr uint32_t Channels = 2;
+
+struct RatePair {
+    uint32_t Input;
+    uint32_t Output;
+};
+
+constexpr RatePair RatePairs[] = { { 44100, 48000 }, { 48000, 44100 }, { 96000, 48000 }, { 16000, 48000 }, { 48000, 48000 } };
+constexpr ResamplerQuality Qualities[] = { ResamplerQuality::Low, ResamplerQuality::Medium, ResamplerQuality::High };
+
+const char* GetQualityName(ResamplerQuality quality) {
+    switch (quality) {
+    case ResamplerQuality::Low:
+        return "low";
+    case ResamplerQuality::Medium:
+        return "medium";
+    case ResamplerQuality::High:
+        return "high";
+    }
+    return "unknown";
+}
+
+bool Run(ResamplerQuality quality, RatePair rates, double seconds) {
+    PolyphaseResampler resampler;
+    if (!resampler.Configure(rates.Input, rates.Output, Channels, quality)) {
+        std::printf("{\"quality\":\"%s\",\"inputRate\":%u,\"outputRate\":%u,\"error\":\"configure failed\"}\n",
+            GetQualityName(quality), rates.Input, rates.Output);
+        return false;
+    }
+
+    const size_t frames = static_cast<size_t>(seconds * rates.Input);
+    std::vector<float> input(frames * Channels);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        const float value = static_cast<float>(Amplitude * std::sin(2.0 * Pi * Frequency * static_cast<double>(frame) / rates.Input));
+        for (uint32_t channel = 0; channel < Channels; ++channel) {
+            input[frame * Channels + channel] = value;
+        }
+    }
+
+    // Packet sizes wander between 1 and 997 frames so phase and history carry-over are exercised.
+    std::vector<float> output;
+    output.reserve(static_cast<size_t>(seconds * rates.Output + 1024) * Channels);
+    size_t position = 0;
+    size_t packet = 441;
+    const auto start = std::chrono::steady_clock::now();
+    while (position < frames) {
+        const size_t count = std::min(packet, frames - position);
+        size_t outputFrames = 0;
+        const float* converted = resampler.Process(input.data() + position * Channels, count, outputFrames);
+        output.insert(output.end(), converted, converted + outputFrames * Channels);
+        position += count;
+        packet = packet * 3 % 997 + 1;
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Half a second is skipped at both ends, the start-up and the tail left in the filter history.
+    const size_t outputFrames = output.size() / Channels;
+    const size_t margin = rates.Output / 2;
+    double signal = 0.0;
+    double error = 0.0;
+    for (size_t frame = margin; frame + margin < outputFrames; ++frame) {
+        const double expected = Amplitude * std::sin(2.0 * Pi * Frequency * static_cast<double>(frame) / rates.Output);
+        const double difference = output[frame * Channels] - expected;
+        signal += expected * expected;
+        error += difference * difference;
+    }
+
+    std::printf("{\"quality\":\"%s\",\"inputRate\":%u,\"outputRate\":%u,\"channels\":%u,\"audioSeconds\":%.3f"
+        ",\"outputFrames\":%zu,\"expectedFrames\":%zu,\"snrDb\":%.1f,\"realtimePerCore\":%.1f}\n",
+        GetQualityName(quality), rates.Input, rates.Output, Channels, seconds, outputFrames,
+        static_cast<size_t>(static_cast<double>(frames) * rates.Output / rates.Input),
+        error > 0.0 ? 10.0 * std::log10(signal / error) : 999.0, elapsed > 0.0 ? seconds / elapsed : 0.0);
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 4.0;
+    if (seconds < 1.5) {
+        std::fprintf(stderr, "At least 1.5 seconds of audio are needed\n");
+        return 1;
+    }
+
+    bool succeeded = true;
+    for (const auto quality : Qualities) {
+        for (const auto& rates : RatePairs) {
+            succeeded &= Run(quality, rates, seconds);
+        }
+    }
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "AudioTransport.h"
+#include "PolyphaseResampler.h"
+#include "StreamRecord.h"
+
+// Per-capture settings passed to StartCaptureEx. Shared with the managed side, keep it blittable
+// and only append fields.
+struct CaptureOptions {
+    int Transport = static_cast<int>(TransportType::NamedPipe);
+
+    // Adds a stereo mix of all sources, published with pipe id AudioMixer::MixdownPipeId.
+    BOOL MixdownEnabled = FALSE;
+
+    // Common rate all sources (and the mixdown) are delivered at, 0 keeps each source's own rate.
+    DWORD TargetSampleRate = 0;
+    int ResamplerQuality = static_cast<int>(::ResamplerQuality::Medium);
+
+    // Write batching of every stream, see WriteCoalescing. 0 ms writes each packet as it arrives.
+    DWORD CoalesceMaxBytes = 0;
+    DWORD CoalesceMaxLatencyMs = 0;
+
+    // Silence as run-length records instead of zero bytes, see StreamRecordHeader, and the peak
+    // level below which a packet counts as silent (0 only trusts the engine's flag).
+    BOOL SilenceRecords = FALSE;
+    float SilenceThreshold = 0.0f;
+
+    WriteCoalescing GetCoalescing() const { return { CoalesceMaxBytes, CoalesceMaxLatencyMs }; }
+    SilenceHandling GetSilenceHandling() const { return { SilenceRecords != FALSE, SilenceThreshold }; }
+};
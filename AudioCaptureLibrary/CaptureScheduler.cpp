@@ -0,0 +1,95 @@
+#include "CaptureScheduler.h"
+
+#include <avrt.h>
+#include <objbase.h>
+#include <wil/resource.h>
+#include <wil/result.h>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+
+#pragma comment(lib, "avrt.lib")
+
+namespace {
+
+// A control event in front of the source handles, waited on with WaitForMultipleObjects from a
+// COM multithreaded, MMCSS registered worker.
+class Win32SchedulerWait : public SchedulerWait {
+public:
+    HRESULT Create() {
+        RETURN_IF_FAILED(m_ControlEvent.create(wil::EventOptions::None));
+        m_Handles.reserve(MAXIMUM_WAIT_OBJECTS);
+        return S_OK;
+    }
+
+    void EnterThread() override {
+        m_ComResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+        DWORD taskIndex = 0;
+        m_MmcssTask = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+        if (!m_MmcssTask) {
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+        }
+    }
+
+    void LeaveThread() override {
+        if (m_MmcssTask) {
+            AvRevertMmThreadCharacteristics(m_MmcssTask);
+        }
+        if (SUCCEEDED(m_ComResult)) {
+            CoUninitialize();
+        }
+    }
+
+    void Wake() override { m_ControlEvent.SetEvent(); }
+
+    size_t Wait(const Handle* handles, size_t count) override {
+        m_Handles.assign(1, m_ControlEvent.get());
+        m_Handles.insert(m_Handles.end(), handles, handles + count);
+
+        const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(m_Handles.size()), m_Handles.data(), FALSE, INFINITE);
+        if (result == WAIT_OBJECT_0) {
+            return Woken;
+        }
+        if (result > WAIT_OBJECT_0 && result <= WAIT_OBJECT_0 + count) {
+            return result - WAIT_OBJECT_0 - 1;
+        }
+
+        Logger::GetInstance().Log("Capture scheduler wait failed, error " + std::to_string(GetLastError()), LogLevel::Error);
+        return Failed;
+    }
+
+private:
+    wil::unique_event_nothrow m_ControlEvent;
+    std::vector<HANDLE> m_Handles;
+    HRESULT m_ComResult = E_FAIL;
+    HANDLE m_MmcssTask = nullptr;
+};
+
+std::unique_ptr<SchedulerWait> CreateWin32Wait() {
+    auto wait = std::make_unique<Win32SchedulerWait>();
+    if (FAILED(wait->Create())) {
+        return nullptr;
+    }
+    return wait;
+}
+
+}
+
+CaptureScheduler& CaptureScheduler::GetInstance() {
+    // Never destroyed: joining the workers from DLL_PROCESS_DETACH would deadlock on the loader
+    // lock. They are gone anyway once the last capture stopped.
+    static CaptureScheduler* instance = new CaptureScheduler();
+    return *instance;
+}
+
+CaptureScheduler::CaptureScheduler(size_t workerCount)
+    : CaptureSchedulerCore(workerCount, MaxHandlesPerWorker, CreateWin32Wait) {}
+
+HRESULT CaptureScheduler::Register(HANDLE handle, Callback callback, RegistrationId& id) {
+    RETURN_HR_IF(E_INVALIDARG, !handle || !callback);
+    // The arguments are valid, so only creating a new worker's control event can have failed.
+    RETURN_HR_IF(E_OUTOFMEMORY, !CaptureSchedulerCore::Register(handle, std::move(callback), id));
+    return S_OK;
+}
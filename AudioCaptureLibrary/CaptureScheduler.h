@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Windows.h>
+
+#include "CaptureSchedulerCore.h"
+
+// Runs the packet callbacks of all capture sources on a small pool of MMCSS "Pro Audio" threads.
+// A source registers the auto-reset event (or synchronization timer) its audio client signals and
+// the worker it lands on calls back every time the handle fires. Each worker waits on up to
+// MaxHandlesPerWorker handles at once, so the thread count follows the core count instead of the
+// number of sources; a worker is only added beyond that when every worker is full.
+//
+// Workers are started on demand and stopped when their last registration goes away, so no thread
+// outlives the captures using it. The scheduling itself is CaptureSchedulerCore; this class adds
+// the Win32 wait and the HRESULT interface.
+class CaptureScheduler : public CaptureSchedulerCore {
+public:
+    // One wait slot of every worker is its control event.
+    static constexpr size_t MaxHandlesPerWorker = MAXIMUM_WAIT_OBJECTS - 1;
+
+    static CaptureScheduler& GetInstance();
+
+    explicit CaptureScheduler(size_t workerCount = GetDefaultWorkerCount());
+
+    // Calls `callback` on a worker thread each time `handle` is signaled. The handle must stay
+    // open until Unregister returned.
+    HRESULT Register(HANDLE handle, Callback callback, RegistrationId& id);
+};
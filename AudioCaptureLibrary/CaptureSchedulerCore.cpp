@@ -0,0 +1,185 @@
+#include "CaptureSchedulerCore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+class CaptureSchedulerCore::Worker {
+public:
+    struct Entry {
+        RegistrationId Id;
+        SchedulerWait::Handle Handle;
+        Callback OnSignaled;
+    };
+
+    explicit Worker(std::unique_ptr<SchedulerWait> wait) : m_Wait(std::move(wait)) {
+        m_Thread = std::thread(&Worker::ThreadProc, this);
+    }
+
+    ~Worker() {
+        {
+            std::lock_guard lock(m_Lock);
+            m_Stop = true;
+            m_Version.fetch_add(1, std::memory_order_release);
+        }
+        m_Wait->Wake();
+        m_Thread.join();
+    }
+
+    void Add(std::shared_ptr<const Entry> entry) {
+        {
+            std::lock_guard lock(m_Lock);
+            m_Entries.push_back(std::move(entry));
+            m_Version.fetch_add(1, std::memory_order_release);
+        }
+        m_Wait->Wake();
+    }
+
+    // Returns once the worker picked up the new list, i.e. it is between two callbacks and the
+    // removed entry is not part of its wait set anymore.
+    void Remove(RegistrationId id) {
+        std::unique_lock lock(m_Lock);
+        std::erase_if(m_Entries, [id](const auto& entry) { return entry->Id == id; });
+        const uint64_t version = m_Version.fetch_add(1, std::memory_order_release) + 1;
+        m_Wait->Wake();
+        m_Applied.wait(lock, [&] { return m_AppliedVersion >= version; });
+    }
+
+    size_t GetSize() const {
+        std::lock_guard lock(m_Lock);
+        return m_Entries.size();
+    }
+
+private:
+    void ThreadProc() {
+        m_Wait->EnterThread();
+
+        std::vector<std::shared_ptr<const Entry>> entries;
+        std::vector<Handle> handles;
+        uint64_t version = 0;
+        size_t next = 0;
+        bool waitFailed = false;
+
+        for (;;) {
+            if (m_Version.load(std::memory_order_acquire) != version) {
+                std::lock_guard lock(m_Lock);
+                if (m_Stop) {
+                    break;
+                }
+
+                entries = m_Entries;
+                version = m_Version.load(std::memory_order_relaxed);
+                m_AppliedVersion = version;
+                m_Applied.notify_all();
+                next = 0;
+                waitFailed = false;
+            }
+
+            // After a failed wait only the wake-up signal is watched until the registrations change.
+            const size_t count = waitFailed ? 0 : entries.size();
+            handles.resize(count);
+            for (size_t k = 0; k < count; ++k) {
+                handles[k] = entries[(next + k) % count]->Handle;
+            }
+
+            const size_t result = m_Wait->Wait(handles.data(), count);
+            if (result == SchedulerWait::Woken) {
+                continue;
+            }
+
+            if (result < count) {
+                const size_t index = (next + result) % count;
+                entries[index]->OnSignaled();
+
+                // The wait reports the first signaled handle, so the list is rotated to start
+                // behind the one just served; a busy source cannot starve the ones after it.
+                next = (index + 1) % count;
+                continue;
+            }
+
+            waitFailed = true;
+        }
+
+        m_Wait->LeaveThread();
+    }
+
+    std::unique_ptr<SchedulerWait> m_Wait;
+    mutable std::mutex m_Lock;
+    std::condition_variable m_Applied;
+    std::vector<std::shared_ptr<const Entry>> m_Entries;
+    std::atomic<uint64_t> m_Version{ 0 };
+    uint64_t m_AppliedVersion = 0;
+    bool m_Stop = false;
+    std::thread m_Thread;
+};
+
+size_t CaptureSchedulerCore::GetDefaultWorkerCount() {
+    return std::clamp<size_t>(std::thread::hardware_concurrency() / 4, 1, 4);
+}
+
+CaptureSchedulerCore::CaptureSchedulerCore(size_t workerCount, size_t maxHandlesPerWorker, WaitFactory createWait)
+    : m_WorkerCount((std::max)(workerCount, size_t{ 1 })),
+      m_MaxHandlesPerWorker((std::max)(maxHandlesPerWorker, size_t{ 1 })),
+      m_CreateWait(std::move(createWait)) {}
+
+CaptureSchedulerCore::~CaptureSchedulerCore() {
+    std::lock_guard lock(m_Lock);
+    m_Workers.clear();
+}
+
+bool CaptureSchedulerCore::Register(Handle handle, Callback callback, RegistrationId& id) {
+    if (!handle || !callback) {
+        return false;
+    }
+
+    std::lock_guard lock(m_Lock);
+
+    // Least loaded worker with a free slot. Sources are spread over the whole pool before any
+    // worker takes a second one.
+    Worker* target = nullptr;
+    size_t targetSize = 0;
+    for (const auto& worker : m_Workers) {
+        const size_t size = worker->GetSize();
+        if (size < m_MaxHandlesPerWorker && (!target || size < targetSize)) {
+            target = worker.get();
+            targetSize = size;
+        }
+    }
+
+    if (!target || (targetSize > 0 && m_Workers.size() < m_WorkerCount)) {
+        auto wait = m_CreateWait();
+        if (!wait) {
+            return false;
+        }
+        m_Workers.push_back(std::make_unique<Worker>(std::move(wait)));
+        target = m_Workers.back().get();
+    }
+
+    id = m_NextId++;
+    target->Add(std::make_shared<const Worker::Entry>(Worker::Entry{ id, handle, std::move(callback) }));
+    m_Registrations[id] = target;
+    return true;
+}
+
+void CaptureSchedulerCore::Unregister(RegistrationId id) {
+    std::lock_guard lock(m_Lock);
+
+    const auto it = m_Registrations.find(id);
+    if (it == m_Registrations.end()) {
+        return;
+    }
+
+    Worker* worker = it->second;
+    m_Registrations.erase(it);
+    worker->Remove(id);
+
+    if (worker->GetSize() == 0) {
+        std::erase_if(m_Workers, [worker](const auto& candidate) { return candidate.get() == worker; });
+    }
+}
+
+size_t CaptureSchedulerCore::GetWorkerCount() const {
+    std::lock_guard lock(m_Lock);
+    return m_Workers.size();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// The blocking wait of one scheduler worker: a wake-up signal of its own plus the handles of the
+// sources it serves. The Win32 implementation is a control event and WaitForMultipleObjects; keeping
+// it behind this interface lets the scheduling in CaptureSchedulerCore build and be tested without
+// Windows.
+class SchedulerWait {
+public:
+    using Handle = void*;
+
+    // Wait results other than the index of a signaled handle.
+    static constexpr size_t Woken = SIZE_MAX;
+    static constexpr size_t Failed = SIZE_MAX - 1;
+
+    virtual ~SchedulerWait() = default;
+
+    // Called on the worker thread before its first and after its last wait.
+    virtual void EnterThread() {}
+    virtual void LeaveThread() {}
+
+    // Makes the pending or the next Wait return Woken. Called from any thread.
+    virtual void Wake() = 0;
+
+    // Blocks until Wake was called or one of `handles` is signaled. Returns Woken in preference to
+    // any handle, else the lowest signaled index (resetting that handle), or Failed.
+    virtual size_t Wait(const Handle* handles, size_t count) = 0;
+};
+
+// Platform independent part of the CaptureScheduler: spreads registrations over the workers, runs
+// their wait loops and reaps them. The waits come from `createWait`, one per worker.
+class CaptureSchedulerCore {
+public:
+    using Callback = std::function<void()>;
+    using RegistrationId = uint64_t;
+    using Handle = SchedulerWait::Handle;
+    using WaitFactory = std::function<std::unique_ptr<SchedulerWait>()>;
+
+    // A quarter of the logical processors, at least one and at most four.
+    static size_t GetDefaultWorkerCount();
+
+    CaptureSchedulerCore(size_t workerCount, size_t maxHandlesPerWorker, WaitFactory createWait);
+    ~CaptureSchedulerCore();
+
+    CaptureSchedulerCore(const CaptureSchedulerCore&) = delete;
+    CaptureSchedulerCore& operator=(const CaptureSchedulerCore&) = delete;
+
+    // Calls `callback` on a worker thread each time `handle` is signaled. The handle must stay
+    // valid until Unregister returned. False if `handle` or `callback` is empty or a new worker
+    // was needed and its wait could not be created.
+    bool Register(Handle handle, Callback callback, RegistrationId& id);
+
+    // When this returns the callback is not running and will not run again. Unknown ids, including
+    // 0, are ignored. Neither Register nor Unregister may be called from a callback.
+    void Unregister(RegistrationId id);
+
+    size_t GetWorkerCount() const;
+
+private:
+    class Worker;
+
+    size_t m_WorkerCount;
+    size_t m_MaxHandlesPerWorker;
+    WaitFactory m_CreateWait;
+    mutable std::mutex m_Lock;
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+    std::map<RegistrationId, Worker*> m_Registrations;
+    RegistrationId m_NextId = 1;
+};
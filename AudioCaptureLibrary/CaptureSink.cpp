@@ -0,0 +1,107 @@
+#include "CaptureSink.h"
+
+#include <AudioClient.h>
+#include <wil/result.h>
+
+CaptureSink::CaptureSink(long long captureId, TransportType transport) :
+    m_Transport(CreateAudioTransport(transport)), m_CaptureId(captureId) {}
+
+void CaptureSink::SetTargetSampleRate(uint32_t sampleRate, ResamplerQuality quality) {
+    m_TargetSampleRate = sampleRate;
+    m_ResamplerQuality = quality;
+}
+
+void CaptureSink::SetSilenceHandling(const SilenceHandling& handling) {
+    m_Records.SetRecordsEnabled(handling.Records);
+    m_SilenceThreshold = handling.Threshold;
+}
+
+HRESULT CaptureSink::Open(DWORD pipeId) {
+    RETURN_IF_WIN32_BOOL_FALSE(m_Transport->Create(pipeId, m_CaptureId));
+    return S_OK;
+}
+
+HRESULT CaptureSink::SetFormat(SampleFormat sourceFormat, SampleFormat streamFormat, uint32_t channels, uint32_t sampleRate) {
+    RETURN_HR_IF(AUDCLNT_E_UNSUPPORTED_FORMAT, channels == 0 || !m_Converter.Configure(sourceFormat, streamFormat));
+    RETURN_HR_IF(E_INVALIDARG, !m_SilenceDetector.Configure(sourceFormat, m_SilenceThreshold));
+    RETURN_HR_IF(AUDCLNT_E_UNSUPPORTED_FORMAT, !m_Meter.Configure(sourceFormat, channels, sampleRate));
+
+    m_Channels = channels;
+    m_StreamSampleRate = sampleRate;
+    if (m_TargetSampleRate != 0 && m_TargetSampleRate != sampleRate) {
+        RETURN_HR_IF(AUDCLNT_E_UNSUPPORTED_FORMAT, !m_Resampler.Configure(sourceFormat, channels, sampleRate, m_TargetSampleRate, m_ResamplerQuality));
+        m_StreamSampleRate = m_TargetSampleRate;
+    }
+
+    if (m_MixerInput) {
+        m_MixerInput->SetSourceFormat(sourceFormat, channels, m_StreamSampleRate);
+    }
+    return S_OK;
+}
+
+void CaptureSink::Deliver(const BYTE* data, size_t frames, DWORD flags) {
+    const bool discontinuity = (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) != 0;
+    const size_t sourceSampleCount = frames * m_Channels;
+    const bool silent = (flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0 || m_SilenceDetector.IsSilent(data, sourceSampleCount);
+    m_Counters.RecordPacket(frames, discontinuity, silent);
+
+    // Metered as captured, before resampling.
+    if (silent) {
+        m_Meter.ProcessSilence(frames);
+    }
+    else {
+        m_Meter.Process(data, frames);
+    }
+
+    // The engine does not clear the buffer of a silent packet, its content has to be ignored.
+    // All-zero bytes are silence in every sample format.
+    if (silent) {
+        const size_t size = sourceSampleCount * SampleFormatConverter::GetSampleSize(m_Converter.GetSourceFormat());
+        if (m_Silence.size() < size) {
+            m_Silence.resize(size);
+        }
+        data = m_Silence.data();
+    }
+
+    if (m_Resampler.IsConfigured()) {
+        // Audio is missing before this packet, don't filter across the gap.
+        if (discontinuity) {
+            m_Resampler.Reset();
+        }
+
+        data = m_Resampler.Process(data, frames, frames);
+        if (frames == 0) {
+            return;
+        }
+    }
+
+    const size_t sampleCount = frames * m_Channels;
+
+    // Behind a resampler the first silent packets still carry the filter tail of the audio before.
+    if (silent && m_Records.IsRecordsEnabled() &&
+        (!m_Resampler.IsConfigured() || SilenceDetector::IsZero(data, sampleCount, m_Converter.GetSourceFormat()))) {
+        m_Records.WriteSilence(*m_Transport, static_cast<uint32_t>(frames));
+    }
+    else {
+        const BYTE* converted = m_Converter.Convert(data, sampleCount);
+        m_Records.WriteAudio(*m_Transport, converted, static_cast<DWORD>(m_Converter.GetConvertedSize(sampleCount)));
+    }
+
+    if (m_MixerInput) {
+        m_MixerInput->Push(data, frames);
+    }
+}
+
+void CaptureSink::GetStats(CaptureStats& stats) const {
+    m_Counters.Snapshot(stats);
+    m_Transport->GetCounters().Snapshot(stats);
+    stats.DroppedBytes = m_Transport->GetDroppedBytes();
+}
+
+void CaptureSink::Close() {
+    m_Transport->Close();
+}
+
+SampleFormat CaptureSink::GetDefaultStreamFormat(SampleFormat format) {
+    return format == SampleFormat::Float32 ? SampleFormat::Int32 : format;
+}
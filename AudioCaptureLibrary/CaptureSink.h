@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Windows.h>
+#include <memory>
+#include <vector>
+
+#include "AudioMixer.h"
+#include "AudioTransport.h"
+#include "CaptureStats.h"
+#include "LevelMeter.h"
+#include "PolyphaseResampler.h"
+#include "SampleFormatConverter.h"
+#include "SilenceDetector.h"
+#include "StreamRecord.h"
+
+// Downstream half of every capture source: optional resampling to the capture's common rate,
+// conversion to the stream format, the transport write and the mixdown feed. Sources only own the
+// packet clock and call Deliver() for every packet, so a synthetic or file-fed source exercises
+// exactly the same path as a real audio client.
+class CaptureSink {
+public:
+    CaptureSink(long long captureId, TransportType transport);
+
+    CaptureSink(const CaptureSink&) = delete;
+    CaptureSink& operator=(const CaptureSink&) = delete;
+
+    // Both set before the source starts.
+    void SetMixerInput(std::shared_ptr<MixerInput> mixerInput) { m_MixerInput = std::move(mixerInput); }
+    void SetTargetSampleRate(uint32_t sampleRate, ResamplerQuality quality);
+    void SetCoalescing(const WriteCoalescing& coalescing) { m_Transport->SetCoalescing(coalescing); }
+    void SetSilenceHandling(const SilenceHandling& handling);
+
+    // Creates the transport for the stream.
+    HRESULT Open(DWORD pipeId);
+
+    // Called once the source format is known, before the first packet. Packets arrive as
+    // `sourceFormat` and leave through the transport as `streamFormat`.
+    HRESULT SetFormat(SampleFormat sourceFormat, SampleFormat streamFormat, uint32_t channels, uint32_t sampleRate);
+
+    // Capture thread. `data` holds `frames` interleaved frames in the source format, `flags` are the
+    // AUDCLNT_BUFFERFLAGS_XXX the audio engine returned with the packet. Silent packets, flagged or
+    // detected, leave as a silence record when records are enabled and as zeros otherwise.
+    void Deliver(const BYTE* data, size_t frames, DWORD flags = 0);
+
+    void Close();
+
+    // Rate of the stream after resampling.
+    uint32_t GetStreamSampleRate() const { return m_StreamSampleRate; }
+    UINT64 GetDroppedBytes() const { return m_Transport->GetDroppedBytes(); }
+
+    // Lock-free, callable from any thread while the stream runs. Fills everything but PipeId.
+    void GetStats(CaptureStats& stats) const;
+    // Lock-free as well, levels of the last metering period. Fills everything but PipeId.
+    void GetLevels(StreamLevels& levels) const { m_Meter.Read(levels); }
+
+    // Format a source should announce for samples it captures as `format`: float is delivered as
+    // int32, integer formats unchanged.
+    static SampleFormat GetDefaultStreamFormat(SampleFormat format);
+
+private:
+    std::unique_ptr<AudioTransport> m_Transport;
+    std::shared_ptr<MixerInput> m_MixerInput;
+    long long m_CaptureId;
+
+    uint32_t m_TargetSampleRate = 0;
+    ResamplerQuality m_ResamplerQuality = ResamplerQuality::Medium;
+    uint32_t m_StreamSampleRate = 0;
+    uint32_t m_Channels = 0;
+    PcmResampler m_Resampler;
+    SampleFormatConverter m_Converter;
+    float m_SilenceThreshold = 0.0f;
+    SilenceDetector m_SilenceDetector;
+    StreamRecordWriter m_Records;
+    std::vector<BYTE> m_Silence;
+    StreamCounters m_Counters;
+    LevelMeter m_Meter;
+};
@@ -0,0 +1,25 @@
+#include "CaptureStats.h"
+
+namespace {
+
+constexpr double NanosecondsPerMicrosecond = 1000.0;
+
+}
+
+void StreamCounters::Snapshot(CaptureStats& stats) const {
+    stats.Packets = m_Packets.load(std::memory_order_relaxed);
+    stats.Frames = m_Frames.load(std::memory_order_relaxed);
+    stats.Discontinuities = m_Discontinuities.load(std::memory_order_relaxed);
+    stats.SilentPackets = m_SilentPackets.load(std::memory_order_relaxed);
+}
+
+void TransportCounters::Snapshot(CaptureStats& stats) const {
+    stats.BytesWritten = m_BytesWritten.load(std::memory_order_relaxed);
+    stats.ShortWrites = m_ShortWrites.load(std::memory_order_relaxed);
+    stats.FailedWrites = m_FailedWrites.load(std::memory_order_relaxed);
+    stats.WriteCount = m_WriteLatency.GetCount();
+    stats.WriteLatencyMean = m_WriteLatency.GetMean() / NanosecondsPerMicrosecond;
+    stats.WriteLatencyP50 = m_WriteLatency.GetPercentile(50.0) / NanosecondsPerMicrosecond;
+    stats.WriteLatencyP99 = m_WriteLatency.GetPercentile(99.0) / NanosecondsPerMicrosecond;
+    stats.WriteLatencyMax = m_WriteLatency.GetMax() / NanosecondsPerMicrosecond;
+}
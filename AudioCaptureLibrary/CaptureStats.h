@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "LatencyHistogram.h"
+
+// Health of one stream of a capture as returned by GetCaptureStats. Counters are totals since the
+// stream started, the caller diffs two snapshots to get rates. Latencies are in microseconds.
+struct CaptureStats {
+    DWORD PipeId;
+    UINT64 Packets;
+    UINT64 Frames;
+    // Packets the audio engine flagged with AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY, i.e. audio was
+    // lost before it reached us (glitch in the engine or a callback that ran too late).
+    UINT64 Discontinuities;
+    // Packets flagged AUDCLNT_BUFFERFLAGS_SILENT or quieter than the capture's silence threshold.
+    UINT64 SilentPackets;
+    UINT64 BytesWritten;
+    // Writes that moved fewer bytes than requested, and writes that failed outright.
+    UINT64 ShortWrites;
+    UINT64 FailedWrites;
+    // Bytes the transport discarded because the consumer fell behind.
+    UINT64 DroppedBytes;
+    UINT64 WriteCount;
+    double WriteLatencyMean;
+    double WriteLatencyP50;
+    double WriteLatencyP99;
+    double WriteLatencyMax;
+};
+
+// Packet side counters, updated by the thread delivering the stream.
+class StreamCounters {
+public:
+    void RecordPacket(size_t frames, bool discontinuity, bool silent) {
+        m_Packets.fetch_add(1, std::memory_order_relaxed);
+        m_Frames.fetch_add(frames, std::memory_order_relaxed);
+        if (discontinuity) {
+            m_Discontinuities.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (silent) {
+            m_SilentPackets.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Snapshot(CaptureStats& stats) const;
+
+private:
+    std::atomic<uint64_t> m_Packets{ 0 };
+    std::atomic<uint64_t> m_Frames{ 0 };
+    std::atomic<uint64_t> m_Discontinuities{ 0 };
+    std::atomic<uint64_t> m_SilentPackets{ 0 };
+};
+
+// Transport side counters, updated by whichever thread performs the actual write (the pipe writer
+// thread, or the capture callback for shared memory). Latencies are recorded in nanoseconds.
+class TransportCounters {
+public:
+    void RecordWrite(size_t requested, size_t written, uint64_t latencyNs) {
+        m_BytesWritten.fetch_add(written, std::memory_order_relaxed);
+        if (written < requested) {
+            m_ShortWrites.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_WriteLatency.Record(latencyNs);
+    }
+
+    void RecordFailedWrite() { m_FailedWrites.fetch_add(1, std::memory_order_relaxed); }
+
+    void Snapshot(CaptureStats& stats) const;
+
+private:
+    std::atomic<uint64_t> m_BytesWritten{ 0 };
+    std::atomic<uint64_t> m_ShortWrites{ 0 };
+    std::atomic<uint64_t> m_FailedWrites{ 0 };
+    LatencyHistogram m_WriteLatency;
+};
@@ -0,0 +1,411 @@
+#include "CompressedReplayBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "FlacDecoder.h"
+
+namespace {
+
+// Multiples of 64 frames keep the FLAC Rice partitions fine grained at any sample rate.
+uint32_t GetBlockFramesFor(uint32_t sampleRate) {
+    const uint64_t frames = (static_cast<uint64_t>(sampleRate) * CompressedReplayBuffer::BlockMilliseconds / 1000 + 63) / 64 * 64;
+    return static_cast<uint32_t>(std::clamp<uint64_t>(frames, 64, FlacEncoder::MaxBlockSize / 64 * 64));
+}
+
+}
+
+// Turns blocks back into PCM of the buffer format. One per read, the buffer itself stays const.
+class CompressedReplayBuffer::BlockDecoder {
+public:
+    explicit BlockDecoder(const CompressedReplayBuffer& buffer) : m_Buffer(buffer) {
+        const bool wide = buffer.m_Codec == ReplayCodec::Flac && buffer.m_FlacEncoder.GetBitsPerSample() > 16;
+        m_Converter.Configure(wide ? SampleFormat::Int24In32 : SampleFormat::Int16, buffer.m_SampleFormat);
+        m_FlacDecoder.Configure(wide ? 24 : 16, buffer.m_Format.Channels);
+    }
+
+    // Returns the decoded frames of `block` or nullptr, valid until the next call.
+    const uint8_t* Decode(const Block& block) {
+        const uint16_t channels = m_Buffer.m_Format.Channels;
+        const size_t samples = static_cast<size_t>(block.Frames) * channels;
+
+        if (block.Data.empty()) {
+            m_Silence.resize(static_cast<size_t>(block.Frames) * m_Buffer.m_BytesPerFrame);
+            return m_Silence.data();
+        }
+
+        if (m_Buffer.m_Codec == ReplayCodec::ImaAdpcm) {
+            m_Narrow.resize(samples);
+            if (!ImaAdpcmCodec::Decode(block.Data.data(), block.Data.size(), channels, block.Frames, m_Narrow.data())) {
+                return nullptr;
+            }
+            return m_Converter.Convert(m_Narrow.data(), samples);
+        }
+
+        if (!m_FlacDecoder.DecodeFrame(block.Data.data(), block.Data.size()) || m_FlacDecoder.GetFrameCount() != block.Frames) {
+            return nullptr;
+        }
+
+        if (m_FlacDecoder.GetBitsPerSample() == 16) {
+            m_Narrow.resize(samples);
+            for (uint16_t channel = 0; channel < channels; ++channel) {
+                const int32_t* source = m_FlacDecoder.GetChannel(channel);
+                for (size_t frame = 0; frame < block.Frames; ++frame) {
+                    m_Narrow[frame * channels + channel] = static_cast<int16_t>(source[frame]);
+                }
+            }
+            return m_Converter.Convert(m_Narrow.data(), samples);
+        }
+
+        m_Wide.resize(samples);
+        for (uint16_t channel = 0; channel < channels; ++channel) {
+            const int32_t* source = m_FlacDecoder.GetChannel(channel);
+            for (size_t frame = 0; frame < block.Frames; ++frame) {
+                m_Wide[frame * channels + channel] = static_cast<int32_t>(static_cast<uint32_t>(source[frame]) << 8);
+            }
+        }
+        return m_Converter.Convert(m_Wide.data(), samples);
+    }
+
+private:
+    const CompressedReplayBuffer& m_Buffer;
+    FlacDecoder m_FlacDecoder;
+    SampleFormatConverter m_Converter;
+    std::vector<int16_t> m_Narrow;
+    std::vector<int32_t> m_Wide;
+    std::vector<uint8_t> m_Silence;
+};
+
+bool CompressedReplayBuffer::IsSupported(const AudioFormat& format, ReplayCodec codec) {
+    SampleFormat sampleFormat;
+    if (!format.IsValid() || !SampleFormatConverter::FromAudioFormat(format, sampleFormat)) {
+        return false;
+    }
+
+    switch (codec) {
+    case ReplayCodec::Flac:
+        return format.Channels <= FlacEncoder::MaxChannels && format.SampleRate < (1u << 20);
+    case ReplayCodec::ImaAdpcm:
+        return true;
+    }
+    return false;
+}
+
+CompressedReplayBuffer::CompressedReplayBuffer(const AudioFormat& format, uint32_t durationSeconds, ReplayCodec codec)
+    : m_Format(format),
+      m_BytesPerFrame(format.BytesPerFrame()),
+      m_Codec(codec),
+      m_BlockFrames(GetBlockFramesFor(format.SampleRate)),
+      m_DurationSeconds(durationSeconds) {
+    SampleFormatConverter::FromAudioFormat(format, m_SampleFormat);
+
+    if (codec == ReplayCodec::Flac) {
+        FlacEncoderSettings settings;
+        settings.SampleRate = format.SampleRate;
+        settings.Channels = format.Channels;
+        settings.Format = m_SampleFormat;
+        settings.CompressionLevel = FlacEncoder::DefaultCompressionLevel;
+        settings.BlockSize = m_BlockFrames;
+        m_FlacEncoder.Configure(settings);
+    }
+    else {
+        m_AdpcmConverter.Configure(m_SampleFormat, SampleFormat::Int16);
+        m_AdpcmCodec.Configure(format.Channels);
+    }
+
+    m_Pending.reserve(static_cast<size_t>(m_BlockFrames) * m_BytesPerFrame);
+
+    m_Waveform.Configure(format);
+    m_Waveform.SetCapacity(GetWaveformCapacity());
+}
+
+void CompressedReplayBuffer::Append(const uint8_t* data, size_t size) {
+    if (m_BytesPerFrame == 0 || size == 0) {
+        return;
+    }
+
+    std::lock_guard writerLock(m_WriterMutex);
+    {
+        std::lock_guard waveformLock(m_WaveformMutex);
+        m_Waveform.Append(data, size);
+    }
+
+    const size_t blockSize = static_cast<size_t>(m_BlockFrames) * m_BytesPerFrame;
+    while (size > 0) {
+        const size_t count = (std::min)(size, blockSize - m_Pending.size());
+        {
+            std::lock_guard indexLock(m_IndexMutex);
+            m_Pending.insert(m_Pending.end(), data, data + count);
+        }
+        data += count;
+        size -= count;
+
+        if (m_Pending.size() == blockSize) {
+            EncodePending();
+        }
+    }
+}
+
+void CompressedReplayBuffer::AppendSilence(uint64_t frames) {
+    if (m_BytesPerFrame == 0 || frames == 0) {
+        return;
+    }
+
+    std::lock_guard writerLock(m_WriterMutex);
+    {
+        std::lock_guard waveformLock(m_WaveformMutex);
+        m_Waveform.AppendSilence(frames);
+    }
+
+    // Records start on frame boundaries, a partial frame here means the stream lost bytes before.
+    const size_t blockSize = static_cast<size_t>(m_BlockFrames) * m_BytesPerFrame;
+    const size_t pendingFrames = m_Pending.size() / m_BytesPerFrame;
+    {
+        std::lock_guard indexLock(m_IndexMutex);
+        m_Pending.resize(pendingFrames * m_BytesPerFrame);
+    }
+
+    // Complete the block being filled, it may already hold audio.
+    if (pendingFrames > 0) {
+        const uint64_t count = (std::min)(frames, static_cast<uint64_t>(m_BlockFrames - pendingFrames));
+        {
+            std::lock_guard indexLock(m_IndexMutex);
+            m_Pending.resize(m_Pending.size() + static_cast<size_t>(count) * m_BytesPerFrame);
+        }
+        frames -= count;
+
+        if (m_Pending.size() == blockSize) {
+            EncodePending();
+        }
+    }
+
+    // Blocks beyond the window would be evicted right away.
+    const uint64_t windowBlocks = static_cast<uint64_t>(m_DurationSeconds) * m_Format.SampleRate / m_BlockFrames + 1;
+    const uint64_t silentBlocks = frames / m_BlockFrames;
+    for (uint64_t i = (silentBlocks > windowBlocks ? silentBlocks - windowBlocks : 0); i < silentBlocks; ++i) {
+        PushBlock(nullptr, 0);
+    }
+    frames -= silentBlocks * m_BlockFrames;
+
+    if (frames > 0) {
+        std::lock_guard indexLock(m_IndexMutex);
+        m_Pending.resize(static_cast<size_t>(frames) * m_BytesPerFrame);
+    }
+}
+
+void CompressedReplayBuffer::EncodePending() {
+    // Readers only read m_Pending, so it is encoded without blocking them; the PCM stays visible
+    // until the block replaces it.
+    const auto start = std::chrono::steady_clock::now();
+    m_Encoded.clear();
+    if (m_Codec == ReplayCodec::Flac) {
+        m_FlacEncoder.Encode(m_Pending.data(), m_BlockFrames, m_Encoded);
+    }
+    else {
+        const uint8_t* converted = m_AdpcmConverter.Convert(m_Pending.data(), static_cast<size_t>(m_BlockFrames) * m_Format.Channels);
+        m_AdpcmCodec.Encode(reinterpret_cast<const int16_t*>(converted), m_BlockFrames, m_Encoded);
+    }
+    m_EncodeNanoseconds += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    m_EncodedFrames += m_BlockFrames;
+
+    PushBlock(m_Encoded.data(), m_Encoded.size());
+}
+
+void CompressedReplayBuffer::PushBlock(const uint8_t* data, size_t size) {
+    // Copied out of the scratch buffer so that a block holds no more than its payload.
+    std::shared_ptr<Block> block;
+    if (!m_Recycled.empty()) {
+        block = std::move(m_Recycled.back());
+        m_Recycled.pop_back();
+    }
+    else {
+        block = std::make_shared<Block>();
+    }
+    block->Frames = m_BlockFrames;
+    block->Data.assign(data, data + size);
+
+    std::lock_guard indexLock(m_IndexMutex);
+    m_CompressedBytes += block->Data.size();
+    m_Blocks.push_back(std::move(block));
+    m_Pending.clear();
+    Evict();
+}
+
+void CompressedReplayBuffer::Evict() {
+    const uint64_t windowFrames = static_cast<uint64_t>(m_DurationSeconds) * m_Format.SampleRate;
+    const size_t maxBlocks = static_cast<size_t>((windowFrames + m_BlockFrames - 1) / m_BlockFrames);
+
+    while (m_Blocks.size() > maxBlocks) {
+        std::shared_ptr<Block> block = std::move(m_Blocks.front());
+        m_Blocks.pop_front();
+        m_CompressedBytes -= block->Data.size();
+
+        // A block still held by a save is simply released by it later.
+        if (block.use_count() == 1 && m_Recycled.size() < MaxRecycledBlocks) {
+            m_Recycled.push_back(std::move(block));
+        }
+    }
+}
+
+void CompressedReplayBuffer::Resize(uint32_t durationSeconds) {
+    std::lock_guard writerLock(m_WriterMutex);
+    std::lock_guard indexLock(m_IndexMutex);
+
+    m_DurationSeconds = durationSeconds;
+    Evict();
+
+    std::lock_guard waveformLock(m_WaveformMutex);
+    m_Waveform.SetCapacity(GetWaveformCapacity());
+}
+
+void CompressedReplayBuffer::Clear() {
+    std::lock_guard writerLock(m_WriterMutex);
+    std::lock_guard indexLock(m_IndexMutex);
+
+    const uint32_t durationSeconds = m_DurationSeconds;
+    m_DurationSeconds = 0;
+    Evict();
+    m_DurationSeconds = durationSeconds;
+
+    m_Pending.clear();
+    m_FlacEncoder.Reset();
+    m_AdpcmCodec.Reset();
+
+    std::lock_guard waveformLock(m_WaveformMutex);
+    m_Waveform.Clear();
+}
+
+uint64_t CompressedReplayBuffer::GetWindowFrames(uint32_t seconds) const {
+    const uint64_t stored = static_cast<uint64_t>(m_Blocks.size()) * m_BlockFrames + m_Pending.size() / m_BytesPerFrame;
+    const uint64_t requested = static_cast<uint64_t>((std::min)(seconds, m_DurationSeconds)) * m_Format.SampleRate;
+    return (std::min)(requested, stored);
+}
+
+// The window and the block being filled, which is part of every window.
+uint64_t CompressedReplayBuffer::GetWaveformCapacity() const {
+    return static_cast<uint64_t>(m_DurationSeconds) * m_Format.SampleRate + m_BlockFrames;
+}
+
+size_t CompressedReplayBuffer::GetWaveform(uint32_t seconds, uint32_t level, WaveformBin* bins, size_t capacity) const {
+    uint64_t frames = 0;
+    {
+        std::lock_guard indexLock(m_IndexMutex);
+        frames = m_BytesPerFrame != 0 ? GetWindowFrames(seconds) : 0;
+    }
+
+    std::lock_guard waveformLock(m_WaveformMutex);
+    return m_Waveform.GetLastBins(level, frames, bins, capacity);
+}
+
+size_t CompressedReplayBuffer::GetWindowSize(uint32_t seconds) const {
+    if (m_BytesPerFrame == 0) {
+        return 0;
+    }
+
+    std::lock_guard indexLock(m_IndexMutex);
+    return static_cast<size_t>(GetWindowFrames(seconds) * m_BytesPerFrame);
+}
+
+CompressedReplayBuffer::WindowReader::WindowReader(const CompressedReplayBuffer& buffer) :
+    m_Decoder(std::make_unique<BlockDecoder>(buffer)), m_BytesPerFrame(buffer.m_BytesPerFrame) {}
+
+CompressedReplayBuffer::WindowReader::WindowReader(WindowReader&&) noexcept = default;
+CompressedReplayBuffer::WindowReader& CompressedReplayBuffer::WindowReader::operator=(WindowReader&&) noexcept = default;
+CompressedReplayBuffer::WindowReader::~WindowReader() = default;
+
+bool CompressedReplayBuffer::WindowReader::Next(const uint8_t*& data, size_t& size) {
+    if (m_Failed) {
+        return false;
+    }
+
+    if (m_NextBlock < m_Blocks.size()) {
+        const Block& block = *m_Blocks[m_NextBlock++];
+        data = m_Decoder->Decode(block);
+        if (!data) {
+            m_Failed = true;
+            return false;
+        }
+
+        const size_t offset = static_cast<size_t>(m_SkipFrames * m_BytesPerFrame);
+        m_SkipFrames = 0;
+        data += offset;
+        size = static_cast<size_t>(block.Frames) * m_BytesPerFrame - offset;
+        return true;
+    }
+
+    if (m_PendingRead || m_Pending.empty()) {
+        return false;
+    }
+
+    m_PendingRead = true;
+    data = m_Pending.data();
+    size = m_Pending.size();
+    return true;
+}
+
+CompressedReplayBuffer::WindowReader CompressedReplayBuffer::OpenWindow(uint32_t seconds) const {
+    WindowReader reader(*this);
+    if (m_BytesPerFrame == 0) {
+        return reader;
+    }
+
+    std::lock_guard indexLock(m_IndexMutex);
+
+    const uint64_t frames = GetWindowFrames(seconds);
+    const uint64_t pendingFrames = m_Pending.size() / m_BytesPerFrame;
+    const uint64_t pendingUsed = (std::min)(frames, pendingFrames);
+    const size_t blockCount = static_cast<size_t>((frames - pendingUsed + m_BlockFrames - 1) / m_BlockFrames);
+
+    reader.m_Frames = frames;
+    reader.m_Blocks.assign(m_Blocks.end() - static_cast<ptrdiff_t>(blockCount), m_Blocks.end());
+    reader.m_SkipFrames = static_cast<uint64_t>(blockCount) * m_BlockFrames - (frames - pendingUsed);
+    reader.m_Pending.assign(m_Pending.begin() + static_cast<ptrdiff_t>((pendingFrames - pendingUsed) * m_BytesPerFrame),
+        m_Pending.begin() + static_cast<ptrdiff_t>(pendingFrames * m_BytesPerFrame));
+    return reader;
+}
+
+bool CompressedReplayBuffer::ReadWindow(uint32_t seconds, const WindowSink& sink) const {
+    WindowReader reader = OpenWindow(seconds);
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    while (reader.Next(data, size)) {
+        if (!sink(data, size)) {
+            return false;
+        }
+    }
+
+    return !reader.IsFailed();
+}
+
+ReplayBufferStats CompressedReplayBuffer::GetStats() const {
+    ReplayBufferStats stats = {};
+    stats.Codec = static_cast<uint32_t>(m_Codec);
+    stats.PcmBytesPerMinute = static_cast<uint64_t>(m_Format.BytesPerSecond()) * 60;
+
+    std::lock_guard writerLock(m_WriterMutex);
+    std::lock_guard indexLock(m_IndexMutex);
+
+    uint64_t memory = m_Pending.capacity() + m_Encoded.capacity();
+    for (const auto& block : m_Blocks) {
+        memory += sizeof(Block) + block->Data.capacity();
+    }
+    for (const auto& block : m_Recycled) {
+        memory += sizeof(Block) + block->Data.capacity();
+    }
+
+    stats.BlockCount = static_cast<uint32_t>(m_Blocks.size());
+    stats.StoredFrames = static_cast<uint64_t>(m_Blocks.size()) * m_BlockFrames + (m_BytesPerFrame ? m_Pending.size() / m_BytesPerFrame : 0);
+    stats.CompressedBytes = m_CompressedBytes;
+    stats.MemoryBytes = memory;
+    if (stats.StoredFrames > 0) {
+        stats.MemoryBytesPerMinute = static_cast<uint64_t>(static_cast<double>(memory) * 60.0 * m_Format.SampleRate / static_cast<double>(stats.StoredFrames));
+    }
+    stats.EncodedFrames = m_EncodedFrames;
+    stats.EncodeNanoseconds = m_EncodeNanoseconds;
+    if (m_EncodedFrames > 0 && m_Format.SampleRate > 0) {
+        stats.EncodeLoad = static_cast<double>(m_EncodeNanoseconds) * m_Format.SampleRate / (static_cast<double>(m_EncodedFrames) * 1e9);
+    }
+    return stats;
+}
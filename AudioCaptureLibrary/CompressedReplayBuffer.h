@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "FlacEncoder.h"
+#include "ImaAdpcmCodec.h"
+#include "SampleFormatConverter.h"
+#include "WaveformPyramid.h"
+
+// Values are shared with the managed side.
+enum class ReplayCodec {
+    // FLAC frames: lossless for 16 and 24 bit sources, 32 bit and float are kept with 24 bits.
+    Flac = 0,
+    // 4 bits per sample from a 16 bit version of the source, a quarter of 16 bit PCM.
+    ImaAdpcm = 1,
+};
+
+struct ReplayBufferStats {
+    uint32_t Codec;
+    uint32_t BlockCount;
+    // Frames in the buffer, including the block still being filled.
+    uint64_t StoredFrames;
+    uint64_t CompressedBytes;
+    // Everything the buffer allocated: block payloads and bookkeeping, recycled blocks and the
+    // block being filled.
+    uint64_t MemoryBytes;
+    // MemoryBytes scaled to one minute of stored audio, next to the PCM equivalent.
+    uint64_t MemoryBytesPerMinute;
+    uint64_t PcmBytesPerMinute;
+    uint64_t EncodedFrames;
+    uint64_t EncodeNanoseconds;
+    // Encode time relative to the duration of the encoded audio, 0.01 is 1% of a core.
+    double EncodeLoad;
+};
+
+// Instant replay window of one capture source kept as compressed blocks of about BlockMilliseconds.
+//
+// Every block decodes on its own, so eviction drops whole blocks from the front and a save only
+// decodes the blocks that overlap the requested window. Blocks are immutable and reference counted:
+// a reader copies the block list under a short lock and decodes outside of it while capture keeps
+// appending, a block evicted during a save stays alive until the save let go of it. The block that
+// is still being filled is kept as PCM and is part of every window.
+class CompressedReplayBuffer {
+    class BlockDecoder;
+    struct Block;
+
+public:
+    static constexpr uint32_t BlockMilliseconds = 100;
+
+    // Window taken at one point in time and decoded block by block as it is read, for callers that
+    // interleave several buffers. Keeps its blocks alive but holds no lock; the buffer itself has
+    // to outlive it.
+    class WindowReader {
+    public:
+        WindowReader(WindowReader&&) noexcept;
+        WindowReader& operator=(WindowReader&&) noexcept;
+        ~WindowReader();
+
+        // Next chunk of PCM, at most one block. Returns false at the end of the window or when a
+        // block could not be decoded, see IsFailed().
+        bool Next(const uint8_t*& data, size_t& size);
+        bool IsFailed() const { return m_Failed; }
+        uint64_t GetFrames() const { return m_Frames; }
+
+    private:
+        friend class CompressedReplayBuffer;
+
+        explicit WindowReader(const CompressedReplayBuffer& buffer);
+
+        std::unique_ptr<BlockDecoder> m_Decoder;
+        std::vector<std::shared_ptr<const Block>> m_Blocks;
+        size_t m_NextBlock = 0;
+        std::vector<uint8_t> m_Pending;
+        bool m_PendingRead = false;
+        uint64_t m_SkipFrames = 0;
+        uint64_t m_Frames = 0;
+        uint32_t m_BytesPerFrame = 0;
+        bool m_Failed = false;
+    };
+
+    // Receives the window as PCM in the buffer format, returning false stops the read.
+    using WindowSink = std::function<bool(const uint8_t* data, size_t size)>;
+
+    static bool IsSupported(const AudioFormat& format, ReplayCodec codec);
+
+    CompressedReplayBuffer(const AudioFormat& format, uint32_t durationSeconds, ReplayCodec codec);
+
+    CompressedReplayBuffer(const CompressedReplayBuffer&) = delete;
+    CompressedReplayBuffer& operator=(const CompressedReplayBuffer&) = delete;
+
+    // Accepts an arbitrary byte stream, complete blocks are encoded on the calling thread.
+    void Append(const uint8_t* data, size_t size);
+    // Appends `frames` frames of digital silence. Whole blocks of it are stored without payload and
+    // cost nothing to encode.
+    void AppendSilence(uint64_t frames);
+
+    // Changes the window length, shrinking evicts the oldest blocks right away.
+    void Resize(uint32_t durationSeconds);
+    void Clear();
+
+    // Passes the newest frames of the last `seconds`, oldest first, to `sink` in chunks of at most
+    // one block. Returns false if a block could not be decoded or the sink gave up.
+    bool ReadWindow(uint32_t seconds, const WindowSink& sink) const;
+    WindowReader OpenWindow(uint32_t seconds) const;
+    size_t GetWindowSize(uint32_t seconds) const;
+
+    // Waveform bins of `level` (see WaveformPyramid) covering the last `seconds`, oldest first,
+    // without decoding a block. Returns the number of bins, which may be larger than `capacity`.
+    size_t GetWaveform(uint32_t seconds, uint32_t level, WaveformBin* bins, size_t capacity) const;
+
+    ReplayBufferStats GetStats() const;
+
+    const AudioFormat& GetFormat() const { return m_Format; }
+    uint32_t GetDurationSeconds() const { return m_DurationSeconds; }
+    ReplayCodec GetCodec() const { return m_Codec; }
+    uint32_t GetBlockFrames() const { return m_BlockFrames; }
+
+private:
+    struct Block {
+        uint32_t Frames = 0;
+        // Empty for a block of digital silence.
+        std::vector<uint8_t> Data;
+    };
+
+    // Evicted blocks kept for reuse, enough to cover a save holding on to a few of them.
+    static constexpr size_t MaxRecycledBlocks = 8;
+
+    void EncodePending();
+    // Replaces the pending PCM with a block holding `size` bytes of `data`.
+    void PushBlock(const uint8_t* data, size_t size);
+    // Requires both locks.
+    void Evict();
+    uint64_t GetWindowFrames(uint32_t seconds) const;
+    uint64_t GetWaveformCapacity() const;
+
+    const AudioFormat m_Format;
+    const uint32_t m_BytesPerFrame;
+    const ReplayCodec m_Codec;
+    const uint32_t m_BlockFrames;
+    SampleFormat m_SampleFormat = SampleFormat::Int16;
+
+    // Serializes writers and guards the encoders and m_Recycled.
+    mutable std::mutex m_WriterMutex;
+    // Guards the block list and the pending PCM, held only for short copies.
+    mutable std::mutex m_IndexMutex;
+
+    std::deque<std::shared_ptr<Block>> m_Blocks;
+    std::vector<std::shared_ptr<Block>> m_Recycled;
+    std::vector<uint8_t> m_Pending;
+    std::vector<uint8_t> m_Encoded;
+    uint32_t m_DurationSeconds = 0;
+    uint64_t m_CompressedBytes = 0;
+
+    FlacEncoder m_FlacEncoder;
+    SampleFormatConverter m_AdpcmConverter;
+    ImaAdpcmCodec m_AdpcmCodec;
+
+    uint64_t m_EncodedFrames = 0;
+    uint64_t m_EncodeNanoseconds = 0;
+
+    // Taken after the writer lock.
+    mutable std::mutex m_WaveformMutex;
+    WaveformPyramid m_Waveform;
+};
@@ -0,0 +1,45 @@
+#include "CpuFeatures.h"
+
+#if defined(AUDIO_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static InstructionSet DetectInstructionSet() {
+#ifdef AUDIO_SIMD_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+
+    bool avx2 = false;
+    // AVX state has to be enabled by the OS as well, not only supported by the CPU.
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    if (avx2) {
+        return InstructionSet::Avx2;
+    }
+    if (sse2) {
+        return InstructionSet::Sse2;
+    }
+#endif
+
+    return InstructionSet::Scalar;
+}
+
+InstructionSet GetInstructionSet() {
+    static const InstructionSet instructionSet = DetectInstructionSet();
+    return instructionSet;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// Runtime selection of the vector kernels used by the DSP code. Kernels for wider instruction sets
+// live in the same translation units as the scalar ones and are tagged with AVX2_TARGET, so the
+// library itself does not need to be built with /arch:AVX2.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AUDIO_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+enum class InstructionSet {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// Widest instruction set supported by the CPU and enabled by the OS, detected once.
+InstructionSet GetInstructionSet();
@@ -0,0 +1,42 @@
+#include "Crc32.h"
+
+#include <array>
+
+namespace {
+
+// Slicing by 4: table k advances a byte followed by k zero bytes.
+constexpr auto Crc32Tables = [] {
+    std::array<std::array<uint32_t, 256>, 4> tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (size_t k = 1; k < tables.size(); ++k) {
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}();
+
+}
+
+uint32_t UpdateCrc32(uint32_t crc, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+
+    for (; size >= 4; size -= 4, bytes += 4) {
+        crc ^= static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+            static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+        crc = Crc32Tables[3][crc & 0xFF] ^ Crc32Tables[2][(crc >> 8) & 0xFF] ^
+            Crc32Tables[1][(crc >> 16) & 0xFF] ^ Crc32Tables[0][crc >> 24];
+    }
+    for (; size > 0; --size, ++bytes) {
+        crc = (crc >> 8) ^ Crc32Tables[0][(crc ^ *bytes) & 0xFF];
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 as in zlib and PNG (reflected polynomial 0xEDB88320). Start with 0 and feed the data in
+// pieces of any size, passing the previous result on.
+uint32_t UpdateCrc32(uint32_t crc, const void* data, size_t size);
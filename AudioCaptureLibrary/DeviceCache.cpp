@@ -0,0 +1,162 @@
+#include "DeviceCache.h"
+
+void DeviceCache::SetDevicesWatched(bool watched) {
+    std::lock_guard lock(m_Lock);
+    m_DevicesWatched = watched;
+    ++m_DeviceGeneration;
+
+    if (!watched) {
+        for (auto& list : m_Lists) {
+            list.reset();
+        }
+        for (auto& [deviceId, entry] : m_Entries) {
+            entry.Device.reset();
+        }
+    }
+}
+
+void DeviceCache::SetSessionsWatched(const std::wstring& deviceId, bool watched) {
+    std::lock_guard lock(m_Lock);
+    ++m_SessionGeneration;
+
+    if (watched) {
+        m_Entries[deviceId].SessionsWatched = true;
+        return;
+    }
+
+    if (auto it = m_Entries.find(deviceId); it != m_Entries.end()) {
+        it->second.SessionsWatched = false;
+        it->second.Sessions.reset();
+    }
+}
+
+std::vector<std::wstring> DeviceCache::GetDevices(DeviceFlow flow) {
+    const size_t index = static_cast<size_t>(flow) % FlowCount;
+
+    uint64_t generation = 0;
+    {
+        std::lock_guard lock(m_Lock);
+        if (m_Lists[index]) {
+            ++m_Stats.Hits;
+            return *m_Lists[index];
+        }
+        ++m_Stats.Misses;
+        generation = m_DeviceGeneration;
+    }
+
+    auto devices = m_Enumerator.EnumerateDevices(flow);
+
+    std::lock_guard lock(m_Lock);
+    if (m_DevicesWatched && generation == m_DeviceGeneration) {
+        m_Lists[index] = devices;
+    }
+    return devices;
+}
+
+std::optional<DeviceEntry> DeviceCache::GetDevice(const std::wstring& deviceId) {
+    uint64_t generation = 0;
+    {
+        std::lock_guard lock(m_Lock);
+        if (auto it = m_Entries.find(deviceId); it != m_Entries.end() && it->second.Device) {
+            ++m_Stats.Hits;
+            return it->second.Device;
+        }
+        ++m_Stats.Misses;
+        generation = m_DeviceGeneration;
+    }
+
+    auto device = m_Enumerator.ReadDevice(deviceId);
+
+    std::lock_guard lock(m_Lock);
+    if (device && m_DevicesWatched && generation == m_DeviceGeneration) {
+        m_Entries[deviceId].Device = device;
+    }
+    return device;
+}
+
+std::vector<SessionEntry> DeviceCache::GetSessions(const std::wstring& deviceId) {
+    uint64_t generation = 0;
+    {
+        std::lock_guard lock(m_Lock);
+        if (auto it = m_Entries.find(deviceId); it != m_Entries.end() && it->second.Sessions) {
+            ++m_Stats.Hits;
+            return *it->second.Sessions;
+        }
+        ++m_Stats.Misses;
+        generation = m_SessionGeneration;
+    }
+
+    auto sessions = m_Enumerator.ReadSessions(deviceId);
+
+    std::lock_guard lock(m_Lock);
+    if (generation == m_SessionGeneration) {
+        if (auto it = m_Entries.find(deviceId); it != m_Entries.end() && it->second.SessionsWatched) {
+            it->second.Sessions = sessions;
+        }
+    }
+    return sessions;
+}
+
+void DeviceCache::InvalidateDeviceLists() {
+    std::lock_guard lock(m_Lock);
+    ++m_Stats.Invalidations;
+    ++m_DeviceGeneration;
+
+    for (auto& list : m_Lists) {
+        list.reset();
+    }
+}
+
+void DeviceCache::InvalidateDevice(const std::wstring& deviceId) {
+    std::lock_guard lock(m_Lock);
+    ++m_Stats.Invalidations;
+    ++m_DeviceGeneration;
+
+    if (auto it = m_Entries.find(deviceId); it != m_Entries.end()) {
+        it->second.Device.reset();
+        // Entries of unplugged devices don't pile up.
+        if (!it->second.SessionsWatched) {
+            m_Entries.erase(it);
+        }
+    }
+}
+
+void DeviceCache::InvalidateSessions(const std::wstring& deviceId) {
+    std::lock_guard lock(m_Lock);
+    ++m_Stats.Invalidations;
+    ++m_SessionGeneration;
+
+    if (auto it = m_Entries.find(deviceId); it != m_Entries.end()) {
+        it->second.Sessions.reset();
+    }
+}
+
+void DeviceCache::InvalidateAllSessions() {
+    std::lock_guard lock(m_Lock);
+    ++m_Stats.Invalidations;
+    ++m_SessionGeneration;
+
+    for (auto& [deviceId, entry] : m_Entries) {
+        entry.Sessions.reset();
+    }
+}
+
+void DeviceCache::Clear() {
+    std::lock_guard lock(m_Lock);
+    ++m_Stats.Invalidations;
+    ++m_DeviceGeneration;
+    ++m_SessionGeneration;
+
+    for (auto& list : m_Lists) {
+        list.reset();
+    }
+    for (auto& [deviceId, entry] : m_Entries) {
+        entry.Device.reset();
+        entry.Sessions.reset();
+    }
+}
+
+DeviceCacheStats DeviceCache::GetStats() const {
+    std::lock_guard lock(m_Lock);
+    return m_Stats;
+}
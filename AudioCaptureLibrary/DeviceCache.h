@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class DeviceFlow {
+    Render = 0,
+    Capture = 1,
+};
+
+// Owned copy of an AudioDeviceInfo, turned into BSTRs only when it is handed out.
+struct DeviceEntry {
+    DWORD PipeId = 0;
+    std::wstring Id;
+    std::wstring Name;
+    DWORD SampleRate = 0;
+    WORD BitsPerSample = 0;
+    WORD Channels = 0;
+};
+
+// Owned copy of an AudioSessionInfo.
+struct SessionEntry {
+    DWORD PipeId = 0;
+    std::wstring DisplayName;
+    std::wstring IconPath;
+    std::wstring SessionIdentifier;
+    std::wstring SessionInstanceIdentifier;
+};
+
+// Where DeviceCache reads from on a miss. AudioDeviceManagerBase implements it with the MMDevice
+// API; the device cache benchmark uses a fake that needs no audio stack.
+class DeviceEnumerator {
+public:
+    virtual ~DeviceEnumerator() = default;
+
+    // IDs of the active endpoints of `flow`.
+    virtual std::vector<std::wstring> EnumerateDevices(DeviceFlow flow) = 0;
+    // Name and mix format, nullopt if the device is gone or could not be read.
+    virtual std::optional<DeviceEntry> ReadDevice(const std::wstring& deviceId) = 0;
+    virtual std::vector<SessionEntry> ReadSessions(const std::wstring& deviceId) = 0;
+};
+
+struct DeviceCacheStats {
+    uint64_t Hits;
+    uint64_t Misses;
+    uint64_t Invalidations;
+};
+
+// Device lists, device properties and session lists keyed by device ID, so that repeated queries
+// cost a map lookup instead of activating an audio client per endpoint.
+//
+// Only what a notification will invalidate is kept: device lists and devices once
+// SetDevicesWatched(true) was called, the sessions of a device while SetSessionsWatched() is set for
+// it. Everything else is read through. Failed reads are never kept.
+//
+// Thread-safe. Reads happen outside the lock; a read that raced an invalidation is returned but
+// not kept, so the cache never holds data older than the last notification.
+class DeviceCache {
+public:
+    explicit DeviceCache(DeviceEnumerator& enumerator) : m_Enumerator(enumerator) {}
+
+    DeviceCache(const DeviceCache&) = delete;
+    DeviceCache& operator=(const DeviceCache&) = delete;
+
+    void SetDevicesWatched(bool watched);
+    void SetSessionsWatched(const std::wstring& deviceId, bool watched);
+
+    std::vector<std::wstring> GetDevices(DeviceFlow flow);
+    std::optional<DeviceEntry> GetDevice(const std::wstring& deviceId);
+    std::vector<SessionEntry> GetSessions(const std::wstring& deviceId);
+
+    // Called from notification threads, none of them reads from the enumerator.
+    // Devices were added, removed or changed state.
+    void InvalidateDeviceLists();
+    // Name or format of one device changed.
+    void InvalidateDevice(const std::wstring& deviceId);
+    // A session of the device was created, expired or renamed.
+    void InvalidateSessions(const std::wstring& deviceId);
+    // Something every session list shows changed, such as a process display name.
+    void InvalidateAllSessions();
+    void Clear();
+
+    DeviceCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        std::optional<DeviceEntry> Device;
+        std::optional<std::vector<SessionEntry>> Sessions;
+        bool SessionsWatched = false;
+    };
+
+    static constexpr size_t FlowCount = 2;
+
+    DeviceEnumerator& m_Enumerator;
+
+    mutable std::mutex m_Lock;
+    bool m_DevicesWatched = false;
+    std::optional<std::vector<std::wstring>> m_Lists[FlowCount];
+    std::unordered_map<std::wstring, Entry> m_Entries;
+    // Bumped by every invalidation, a read only stores its result if they did not move meanwhile.
+    uint64_t m_DeviceGeneration = 0;
+    uint64_t m_SessionGeneration = 0;
+
+    DeviceCacheStats m_Stats = {};
+};
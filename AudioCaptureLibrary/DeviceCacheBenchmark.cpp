@@ -0,0 +1,180 @@
+#include "DeviceCacheBenchmark.h"
+
+#include <wil/result.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "DeviceCache.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static uint64_t ToNanoseconds(BenchmarkClock::duration duration) {
+    const auto count = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    return count > 0 ? static_cast<uint64_t>(count) : 0;
+}
+
+static void AppendLatency(std::ostringstream& json, const char* name, const LatencyHistogram& histogram, double unit) {
+    const auto scaled = [unit](uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / unit; };
+    json << ",\"" << name << "\":{"
+        << "\"count\":" << histogram.GetCount()
+        << ",\"mean\":" << histogram.GetMean() / unit
+        << ",\"p50\":" << scaled(histogram.GetPercentile(50.0))
+        << ",\"p90\":" << scaled(histogram.GetPercentile(90.0))
+        << ",\"p99\":" << scaled(histogram.GetPercentile(99.0))
+        << ",\"max\":" << scaled(histogram.GetMax())
+        << "}";
+}
+
+namespace {
+    // Render endpoints with a fixed set of sessions. Every read spins for the configured latency,
+    // Sleep() is too coarse for it.
+    class FakeDeviceEnumerator : public DeviceEnumerator {
+    public:
+        explicit FakeDeviceEnumerator(const DeviceCacheBenchmarkOptions& options) : m_Options(options) {}
+
+        std::vector<std::wstring> EnumerateDevices(DeviceFlow flow) override {
+            std::vector<std::wstring> devices;
+            if (flow != DeviceFlow::Render) {
+                return devices;
+            }
+
+            for (DWORD i = 0; i < m_Options.DeviceCount; ++i) {
+                devices.push_back(GetDeviceId(i));
+            }
+            return devices;
+        }
+
+        std::optional<DeviceEntry> ReadDevice(const std::wstring& deviceId) override {
+            Wait();
+
+            DeviceEntry entry;
+            entry.Id = deviceId;
+            entry.Name = L"Speakers " + deviceId;
+            entry.SampleRate = 48000;
+            entry.BitsPerSample = 32;
+            entry.Channels = 2;
+            return entry;
+        }
+
+        std::vector<SessionEntry> ReadSessions(const std::wstring& deviceId) override {
+            Wait();
+
+            std::vector<SessionEntry> sessions(m_Options.SessionsPerDevice);
+            for (DWORD i = 0; i < sessions.size(); ++i) {
+                sessions[i].PipeId = 1000 + i;
+                sessions[i].DisplayName = L"Process " + std::to_wstring(i);
+                sessions[i].SessionIdentifier = deviceId + L"|" + std::to_wstring(i);
+            }
+            return sessions;
+        }
+
+        uint64_t GetReads() const { return m_Reads.load(std::memory_order_relaxed); }
+
+        static std::wstring GetDeviceId(DWORD index) {
+            return L"{0.0.0.00000000}.{" + std::to_wstring(index) + L"}";
+        }
+
+    private:
+        void Wait() {
+            m_Reads.fetch_add(1, std::memory_order_relaxed);
+            const auto until = BenchmarkClock::now() + std::chrono::microseconds(m_Options.ReadLatencyUs);
+            while (BenchmarkClock::now() < until) {
+                YieldProcessor();
+            }
+        }
+
+        const DeviceCacheBenchmarkOptions& m_Options;
+        std::atomic<uint64_t> m_Reads{ 0 };
+    };
+}
+
+// One GetActiveOutputDevices worth of reads, returns the number of sessions seen so that nothing
+// is optimized away.
+template <typename ListDevices, typename ReadDevice, typename ReadSessions>
+static size_t QueryOutputDevices(ListDevices listDevices, ReadDevice readDevice, ReadSessions readSessions) {
+    size_t sessions = 0;
+    for (const auto& deviceId : listDevices()) {
+        if (readDevice(deviceId)) {
+            sessions += readSessions(deviceId).size();
+        }
+    }
+    return sessions;
+}
+
+HRESULT RunDeviceCacheBenchmark(const DeviceCacheBenchmarkOptions& options, const std::wstring& resultPath) {
+    RETURN_HR_IF(E_INVALIDARG, options.DeviceCount == 0 || options.QueryCount == 0);
+
+    std::ofstream results(std::filesystem::path(resultPath), std::ios::app);
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED), !results);
+
+    size_t sessionsSeen = 0;
+
+    FakeDeviceEnumerator uncachedEnumerator(options);
+    LatencyHistogram uncachedLatency;
+    for (DWORD i = 0; i < options.QueryCount; ++i) {
+        const auto before = BenchmarkClock::now();
+        sessionsSeen += QueryOutputDevices(
+            [&] { return uncachedEnumerator.EnumerateDevices(DeviceFlow::Render); },
+            [&](const std::wstring& id) { return uncachedEnumerator.ReadDevice(id); },
+            [&](const std::wstring& id) { return uncachedEnumerator.ReadSessions(id); });
+        uncachedLatency.Record(ToNanoseconds(BenchmarkClock::now() - before));
+    }
+
+    // Every device has its session notifications registered, as when all of them are recorded.
+    FakeDeviceEnumerator cachedEnumerator(options);
+    DeviceCache cache(cachedEnumerator);
+    cache.SetDevicesWatched(true);
+    for (DWORD i = 0; i < options.DeviceCount; ++i) {
+        cache.SetSessionsWatched(FakeDeviceEnumerator::GetDeviceId(i), true);
+    }
+
+    LatencyHistogram cachedLatency;
+    for (DWORD i = 0; i < options.QueryCount; ++i) {
+        // Alternates between the notifications that arrive most often: a session coming or going and
+        // a device property change.
+        if (options.InvalidateEvery > 0 && i > 0 && i % options.InvalidateEvery == 0) {
+            const DWORD change = i / options.InvalidateEvery;
+            const auto deviceId = FakeDeviceEnumerator::GetDeviceId(change % options.DeviceCount);
+            if (change % 2 == 0) {
+                cache.InvalidateSessions(deviceId);
+            }
+            else {
+                cache.InvalidateDevice(deviceId);
+            }
+        }
+
+        const auto before = BenchmarkClock::now();
+        sessionsSeen += QueryOutputDevices(
+            [&] { return cache.GetDevices(DeviceFlow::Render); },
+            [&](const std::wstring& id) { return cache.GetDevice(id); },
+            [&](const std::wstring& id) { return cache.GetSessions(id); });
+        cachedLatency.Record(ToNanoseconds(BenchmarkClock::now() - before));
+    }
+
+    const DeviceCacheStats stats = cache.GetStats();
+
+    std::ostringstream json;
+    json << "{\"deviceCount\":" << options.DeviceCount
+        << ",\"sessionsPerDevice\":" << options.SessionsPerDevice
+        << ",\"readLatencyUs\":" << options.ReadLatencyUs
+        << ",\"invalidateEvery\":" << options.InvalidateEvery;
+    AppendLatency(json, "uncachedQueryUs", uncachedLatency, 1e3);
+    AppendLatency(json, "cachedQueryUs", cachedLatency, 1e3);
+    json << ",\"uncachedReads\":" << uncachedEnumerator.GetReads()
+        << ",\"cachedReads\":" << cachedEnumerator.GetReads()
+        << ",\"hits\":" << stats.Hits
+        << ",\"misses\":" << stats.Misses
+        << ",\"invalidations\":" << stats.Invalidations
+        << ",\"sessionsSeen\":" << sessionsSeen
+        << "}";
+
+    results << json.str() << std::endl;
+    Logger::GetInstance().Log("Device cache benchmark: " + json.str());
+    return S_OK;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+
+// Settings of RunDeviceCacheBenchmark, shared with the managed side.
+struct DeviceCacheBenchmarkOptions {
+    DWORD DeviceCount = 8;
+    DWORD SessionsPerDevice = 4;
+    // Time the fake enumerator spends per endpoint or session list read, about what activating an
+    // IAudioClient and reading its mix format costs.
+    DWORD ReadLatencyUs = 500;
+    // Full device list queries timed per mode.
+    DWORD QueryCount = 2000;
+    // A device or session change is simulated every InvalidateEvery queries, never when 0.
+    DWORD InvalidateEvery = 50;
+};
+
+// Times the query behind GetActiveOutputDevices (device list, then every device with its sessions)
+// against a fake DeviceEnumerator, once reading straight through and once through a DeviceCache
+// that is invalidated the way AudioDeviceNotificationClient does it.
+//
+// Appends one JSON object to `resultPath`: query latency percentiles in microseconds of both modes,
+// the enumerator reads each needed and the cache hit/miss counters.
+HRESULT RunDeviceCacheBenchmark(const DeviceCacheBenchmarkOptions& options, const std::wstring& resultPath);
@@ -0,0 +1,99 @@
+#include "DeviceChangeLog.h"
+
+#include <cstring>
+
+static constexpr DWORD DeviceChangesVersion = 1;
+
+void DeviceChangeLog::RecordDeviceState(const std::wstring& deviceId, DWORD state) {
+    Record(DeviceChangeKind::DeviceState, deviceId, std::wstring(), state);
+}
+
+void DeviceChangeLog::RecordSessionState(const std::wstring& deviceId, const std::wstring& sessionId, DWORD state) {
+    Record(DeviceChangeKind::SessionState, deviceId, sessionId, state);
+}
+
+void DeviceChangeLog::RecordSessionNames(const std::wstring& deviceId) {
+    Record(DeviceChangeKind::SessionNames, deviceId, std::wstring(), 0);
+}
+
+void DeviceChangeLog::Record(DeviceChangeKind kind, const std::wstring& deviceId, const std::wstring& sessionId, DWORD state) {
+    std::lock_guard lock(m_Lock);
+    m_Changes.push_back({ ++m_Generation, kind, state, deviceId, sessionId });
+    if (m_Changes.size() > m_Capacity) {
+        m_Changes.pop_front();
+    }
+}
+
+uint64_t DeviceChangeLog::GetGeneration() const {
+    std::lock_guard lock(m_Lock);
+    return m_Generation;
+}
+
+bool DeviceChangeLog::GetChangesSince(uint64_t generation, std::vector<DeviceChange>& changes, uint64_t& current) const {
+    std::lock_guard lock(m_Lock);
+    current = m_Generation;
+
+    const uint64_t oldest = m_Changes.empty() ? m_Generation + 1 : m_Changes.front().Generation;
+    if (generation == 0 || generation > m_Generation || generation + 1 < oldest) {
+        return false;
+    }
+
+    // Generations are consecutive, the first change to return is found by subtraction.
+    for (auto it = m_Changes.begin() + static_cast<ptrdiff_t>(generation + 1 - oldest); it != m_Changes.end(); ++it) {
+        changes.push_back(*it);
+    }
+    return true;
+}
+
+void WriteDeviceChanges(uint64_t generation, const std::vector<DeviceChange>& changes, const std::vector<BYTE>* snapshot,
+    std::vector<BYTE>& block) {
+    const size_t changesOffset = sizeof(DeviceChangesHeader);
+    const size_t stringsOffset = changesOffset + (snapshot ? 0 : changes.size()) * sizeof(DeviceChangeRecord);
+
+    size_t stringsSize = 0;
+    if (!snapshot) {
+        for (const auto& change : changes) {
+            stringsSize += (change.DeviceId.size() + change.SessionId.size()) * sizeof(wchar_t);
+        }
+    }
+
+    // Keeps the snapshot's header fields as aligned as they are at the start of a block.
+    const size_t snapshotOffset = (stringsOffset + stringsSize + 7) & ~size_t{ 7 };
+    const size_t size = snapshot ? snapshotOffset + snapshot->size() : stringsOffset + stringsSize;
+    block.assign(size, 0);
+
+    DeviceChangesHeader header = {};
+    header.Version = DeviceChangesVersion;
+    header.Size = static_cast<DWORD>(size);
+    header.Generation = generation;
+    header.ChangesOffset = static_cast<DWORD>(changesOffset);
+
+    if (snapshot) {
+        header.SnapshotOffset = static_cast<DWORD>(snapshotOffset);
+        header.SnapshotSize = static_cast<DWORD>(snapshot->size());
+        std::memcpy(block.data() + snapshotOffset, snapshot->data(), snapshot->size());
+    }
+    else {
+        header.ChangeCount = static_cast<DWORD>(changes.size());
+
+        size_t stringOffset = stringsOffset;
+        const auto writeString = [&block, &stringOffset](const std::wstring& value) {
+            SnapshotString result = { static_cast<DWORD>(stringOffset), static_cast<DWORD>(value.size()) };
+            std::memcpy(block.data() + stringOffset, value.data(), value.size() * sizeof(wchar_t));
+            stringOffset += value.size() * sizeof(wchar_t);
+            return result;
+        };
+
+        for (size_t i = 0; i < changes.size(); ++i) {
+            DeviceChangeRecord record = {};
+            record.Generation = changes[i].Generation;
+            record.Kind = static_cast<DWORD>(changes[i].Kind);
+            record.State = changes[i].State;
+            record.DeviceId = writeString(changes[i].DeviceId);
+            record.SessionId = writeString(changes[i].SessionId);
+            std::memcpy(block.data() + changesOffset + i * sizeof(DeviceChangeRecord), &record, sizeof(record));
+        }
+    }
+
+    std::memcpy(block.data(), &header, sizeof(header));
+}
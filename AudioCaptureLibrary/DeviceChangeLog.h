@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "DeviceSnapshot.h"
+
+// Values shared with the managed side.
+enum class DeviceChangeKind : DWORD {
+    // A device of the log's flow changed state, State is the DEVICE_STATE_XXX.
+    DeviceState = 0,
+    // A session became active or inactive or expired, State is the AudioSessionState.
+    SessionState = 1,
+    // Display names of the device's sessions changed, as process names became known. SessionId is
+    // empty, the sessions have to be read again.
+    SessionNames = 2,
+};
+
+struct DeviceChange {
+    uint64_t Generation;
+    DeviceChangeKind Kind;
+    DWORD State;
+    std::wstring DeviceId;
+    // Empty for device and session name changes.
+    std::wstring SessionId;
+};
+
+// The changes the device and session callbacks report, numbered by a generation that grows by one
+// per change, so that a reader that has seen everything up to some generation can catch up with
+// only what happened since. Only the last `capacity` changes are kept, a reader that fell further
+// behind starts over from a snapshot.
+//
+// Thread-safe, recorded from the notification threads.
+class DeviceChangeLog {
+public:
+    static constexpr size_t DefaultCapacity = 1024;
+
+    explicit DeviceChangeLog(size_t capacity = DefaultCapacity) : m_Capacity(capacity) {}
+
+    void RecordDeviceState(const std::wstring& deviceId, DWORD state);
+    void RecordSessionState(const std::wstring& deviceId, const std::wstring& sessionId, DWORD state);
+    void RecordSessionNames(const std::wstring& deviceId);
+
+    uint64_t GetGeneration() const;
+
+    // Appends the changes after `generation` in order and sets `current` to the generation they
+    // lead up to. Returns false if they are not all kept anymore: `generation` 0, which stands for
+    // nothing seen yet, or one the log never reached (from an earlier load of the library) are
+    // answered the same way.
+    bool GetChangesSince(uint64_t generation, std::vector<DeviceChange>& changes, uint64_t& current) const;
+
+private:
+    void Record(DeviceChangeKind kind, const std::wstring& deviceId, const std::wstring& sessionId, DWORD state);
+
+    const size_t m_Capacity;
+
+    mutable std::mutex m_Lock;
+    std::deque<DeviceChange> m_Changes;
+    uint64_t m_Generation = 0;
+};
+
+// Block returned by the change feed exports, laid out like a device snapshot:
+//
+//   DeviceChangesHeader | DeviceChangeRecord[ChangeCount] | UTF-16 strings | device snapshot
+//
+// Offsets are in bytes from the start of the block, the embedded snapshot's own offsets from its start.
+struct DeviceChangesHeader {
+    DWORD Version;
+    DWORD Size;
+    // Pass this to the next request.
+    ULONGLONG Generation;
+    DWORD ChangeCount;
+    DWORD ChangesOffset;
+    // Set instead of the changes when they are not all kept anymore: every active device as of at
+    // least Generation. Changes after Generation may already show in it.
+    DWORD SnapshotOffset;
+    DWORD SnapshotSize;
+};
+
+struct DeviceChangeRecord {
+    ULONGLONG Generation;
+    DWORD Kind;
+    DWORD State;
+    SnapshotString DeviceId;
+    SnapshotString SessionId;
+};
+
+// Lays out `changes`, or `snapshot` if it is not null, into `block`. Keeps the capacity of `block`.
+void WriteDeviceChanges(uint64_t generation, const std::vector<DeviceChange>& changes, const std::vector<BYTE>* snapshot,
+    std::vector<BYTE>& block);
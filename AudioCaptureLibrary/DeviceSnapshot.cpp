@@ -0,0 +1,84 @@
+#include "DeviceSnapshot.h"
+
+#include <cstring>
+
+void DeviceSnapshotWriter::Reset() {
+    m_Devices.clear();
+    m_Sessions.clear();
+    m_Strings.clear();
+}
+
+void DeviceSnapshotWriter::AddDevice(const DeviceEntry& device, const std::vector<SessionEntry>& sessions) {
+    DeviceSnapshotDevice& record = m_Devices.emplace_back();
+    record.PipeId = device.PipeId;
+    record.Id = AddString(device.Id);
+    record.Name = AddString(device.Name);
+    record.SampleRate = device.SampleRate;
+    record.BitsPerSample = device.BitsPerSample;
+    record.Channels = device.Channels;
+    record.FirstSession = static_cast<DWORD>(m_Sessions.size());
+    record.SessionCount = static_cast<DWORD>(sessions.size());
+
+    for (const auto& session : sessions) {
+        DeviceSnapshotSession& sessionRecord = m_Sessions.emplace_back();
+        sessionRecord.PipeId = session.PipeId;
+        sessionRecord.DisplayName = AddString(session.DisplayName);
+        sessionRecord.IconPath = AddString(session.IconPath);
+        sessionRecord.IsSystemSession = FALSE;
+        sessionRecord.SessionIdentifier = AddString(session.SessionIdentifier);
+        sessionRecord.SessionInstanceIdentifier = AddString(session.SessionInstanceIdentifier);
+    }
+}
+
+const std::vector<BYTE>& DeviceSnapshotWriter::Finish() {
+    const size_t devicesOffset = sizeof(DeviceSnapshotHeader);
+    const size_t sessionsOffset = devicesOffset + m_Devices.size() * sizeof(DeviceSnapshotDevice);
+    const size_t stringsOffset = sessionsOffset + m_Sessions.size() * sizeof(DeviceSnapshotSession);
+    const size_t size = stringsOffset + m_Strings.size() * sizeof(wchar_t);
+
+    const auto place = [stringsOffset](SnapshotString& value) {
+        value.Offset += static_cast<DWORD>(stringsOffset);
+    };
+    for (auto& device : m_Devices) {
+        place(device.Id);
+        place(device.Name);
+    }
+    for (auto& session : m_Sessions) {
+        place(session.DisplayName);
+        place(session.IconPath);
+        place(session.SessionIdentifier);
+        place(session.SessionInstanceIdentifier);
+    }
+
+    DeviceSnapshotHeader header = {};
+    header.Version = Version;
+    header.Size = static_cast<DWORD>(size);
+    header.DeviceCount = static_cast<DWORD>(m_Devices.size());
+    header.DevicesOffset = static_cast<DWORD>(devicesOffset);
+    header.SessionCount = static_cast<DWORD>(m_Sessions.size());
+    header.SessionsOffset = static_cast<DWORD>(sessionsOffset);
+
+    m_Snapshot.resize(size);
+    std::memcpy(m_Snapshot.data(), &header, sizeof(header));
+    if (!m_Devices.empty()) {
+        std::memcpy(m_Snapshot.data() + devicesOffset, m_Devices.data(), m_Devices.size() * sizeof(DeviceSnapshotDevice));
+    }
+    if (!m_Sessions.empty()) {
+        std::memcpy(m_Snapshot.data() + sessionsOffset, m_Sessions.data(), m_Sessions.size() * sizeof(DeviceSnapshotSession));
+    }
+    if (!m_Strings.empty()) {
+        std::memcpy(m_Snapshot.data() + stringsOffset, m_Strings.data(), m_Strings.size() * sizeof(wchar_t));
+    }
+
+    // The records are laid out, a second Finish() must not move the strings again.
+    Reset();
+    return m_Snapshot;
+}
+
+SnapshotString DeviceSnapshotWriter::AddString(const std::wstring& value) {
+    SnapshotString result = {};
+    result.Offset = static_cast<DWORD>(m_Strings.size() * sizeof(wchar_t));
+    result.Length = static_cast<DWORD>(value.size());
+    m_Strings.insert(m_Strings.end(), value.begin(), value.end());
+    return result;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+#include "DeviceCache.h"
+
+// A device snapshot is one block of memory holding devices, their sessions and every string of
+// them, so it crosses the DLL boundary in one copy and is released with the buffer it lives in:
+//
+//   DeviceSnapshotHeader | DeviceSnapshotDevice[DeviceCount] | DeviceSnapshotSession[SessionCount] | UTF-16 strings
+//
+// Every offset is in bytes from the start of the snapshot and every field is 4-byte aligned.
+// Strings are not terminated. Shared with the managed side, see DeviceSnapshotInterop.cs.
+
+struct SnapshotString {
+    DWORD Offset;
+    // In characters.
+    DWORD Length;
+};
+
+struct DeviceSnapshotHeader {
+    DWORD Version;
+    // Bytes of the whole snapshot.
+    DWORD Size;
+    DWORD DeviceCount;
+    DWORD DevicesOffset;
+    DWORD SessionCount;
+    DWORD SessionsOffset;
+};
+
+struct DeviceSnapshotDevice {
+    DWORD PipeId;
+    SnapshotString Id;
+    SnapshotString Name;
+    DWORD SampleRate;
+    WORD BitsPerSample;
+    WORD Channels;
+    // Sessions of the device are SessionCount consecutive entries from FirstSession on.
+    DWORD FirstSession;
+    DWORD SessionCount;
+};
+
+struct DeviceSnapshotSession {
+    DWORD PipeId;
+    SnapshotString DisplayName;
+    SnapshotString IconPath;
+    BOOL IsSystemSession;
+    SnapshotString SessionIdentifier;
+    SnapshotString SessionInstanceIdentifier;
+};
+
+// Builds snapshots. Keeps its buffers between snapshots, so once they have grown to the size of
+// the device graph building one allocates nothing.
+class DeviceSnapshotWriter {
+public:
+    static constexpr DWORD Version = 1;
+
+    void Reset();
+    void AddDevice(const DeviceEntry& device, const std::vector<SessionEntry>& sessions = {});
+
+    // Lays out the devices added since Reset(), valid until the next call to any method.
+    const std::vector<BYTE>& Finish();
+
+private:
+    SnapshotString AddString(const std::wstring& value);
+
+    std::vector<DeviceSnapshotDevice> m_Devices;
+    std::vector<DeviceSnapshotSession> m_Sessions;
+    // String offsets are relative to this until Finish().
+    std::vector<wchar_t> m_Strings;
+    std::vector<BYTE> m_Snapshot;
+};
@@ -0,0 +1,206 @@
+#include "DiskWriterBenchmark.h"
+
+#include <wil/resource.h>
+#include <wil/result.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "AsyncFileWriter.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static constexpr DWORD PacketsPerSecond = 100;
+
+struct BenchmarkFile {
+    std::filesystem::path FilePath;
+    std::thread Thread;
+
+    // Written by the file's thread, read after it has been joined.
+    AsyncWriteStats Stats = {};
+    UINT64 BytesAppended = 0;
+    HRESULT Result = S_OK;
+};
+
+static uint64_t ToNanoseconds(BenchmarkClock::duration duration) {
+    const auto count = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    return count > 0 ? static_cast<uint64_t>(count) : 0;
+}
+
+static void AppendLatency(std::ostringstream& json, const char* name, const LatencyHistogram& histogram) {
+    const auto micros = [](uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1000.0; };
+    json << ",\"" << name << "\":{"
+        << "\"count\":" << histogram.GetCount()
+        << ",\"mean\":" << histogram.GetMean() / 1000.0
+        << ",\"p50\":" << micros(histogram.GetPercentile(50.0))
+        << ",\"p90\":" << micros(histogram.GetPercentile(90.0))
+        << ",\"p99\":" << micros(histogram.GetPercentile(99.0))
+        << ",\"p999\":" << micros(histogram.GetPercentile(99.9))
+        << ",\"max\":" << micros(histogram.GetMax())
+        << "}";
+}
+
+// Appends packets until `end`, on time when paced. `append` writes one packet and returns its result.
+template <typename Append>
+static void WritePackets(const DiskWriterBenchmarkOptions& options, BenchmarkClock::time_point start, BenchmarkClock::time_point end,
+    BenchmarkFile& file, LatencyHistogram& appendLatency, Append&& append) {
+    const size_t packetSize = (std::max)(static_cast<size_t>(options.BytesPerSecond / PacketsPerSecond), static_cast<size_t>(1));
+    std::vector<uint8_t> packet(packetSize);
+    for (size_t i = 0; i < packet.size(); ++i) {
+        packet[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    for (uint64_t index = 0;; ++index) {
+        if (options.Paced) {
+            const auto due = start + std::chrono::milliseconds(index * 1000 / PacketsPerSecond);
+            if (due >= end) {
+                break;
+            }
+            std::this_thread::sleep_until(due);
+        }
+
+        const auto before = BenchmarkClock::now();
+        if (!options.Paced && before >= end) {
+            break;
+        }
+
+        file.Result = append(packet.data(), packet.size());
+        appendLatency.Record(ToNanoseconds(BenchmarkClock::now() - before));
+        if (FAILED(file.Result)) {
+            return;
+        }
+        file.BytesAppended += packet.size();
+    }
+}
+
+static void WriteAsync(const DiskWriterBenchmarkOptions& options, BenchmarkClock::time_point start, BenchmarkClock::time_point end,
+    BenchmarkFile& file, LatencyHistogram& appendLatency, LatencyHistogram& writeLatency) {
+    AsyncWriteSettings settings;
+    settings.BufferSize = options.BufferSize;
+    settings.BufferCount = options.BufferCount;
+    settings.PreallocationStep = static_cast<uint64_t>(options.PreallocationMB) * 1024 * 1024;
+    settings.FlushIntervalMs = options.FlushIntervalMs;
+
+    AsyncFileWriter writer;
+    file.Result = writer.Open(file.FilePath.wstring(), settings);
+    if (FAILED(file.Result)) {
+        return;
+    }
+
+    WritePackets(options, start, end, file, appendLatency, [&](const uint8_t* data, size_t size) {
+        return writer.Append(data, size);
+    });
+
+    const HRESULT closed = writer.Close();
+    if (SUCCEEDED(file.Result)) {
+        file.Result = closed;
+    }
+    file.Stats = writer.GetStats();
+    writeLatency.Merge(writer.GetWriteLatency());
+}
+
+static void WriteSynchronous(const DiskWriterBenchmarkOptions& options, BenchmarkClock::time_point start, BenchmarkClock::time_point end,
+    BenchmarkFile& file, LatencyHistogram& appendLatency) {
+    wil::unique_hfile handle(CreateFileW(file.FilePath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    if (!handle) {
+        file.Result = HRESULT_FROM_WIN32(GetLastError());
+        return;
+    }
+
+    WritePackets(options, start, end, file, appendLatency, [&](const uint8_t* data, size_t size) {
+        DWORD written = 0;
+        if (!WriteFile(handle.get(), data, static_cast<DWORD>(size), &written, nullptr)) {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+        ++file.Stats.Writes;
+        file.Stats.BytesWritten += written;
+        return S_OK;
+    });
+}
+
+HRESULT RunDiskWriterBenchmark(const DiskWriterBenchmarkOptions& options, const std::wstring& resultPath) {
+    RETURN_HR_IF(E_INVALIDARG, options.FileCount == 0 || options.DurationMs == 0 || options.BytesPerSecond == 0);
+
+    std::ofstream results(std::filesystem::path(resultPath), std::ios::app);
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED), !results);
+
+    const std::filesystem::path outputDirectory = options.OutputDirectory && SysStringLen(options.OutputDirectory) > 0 ?
+        std::filesystem::path(options.OutputDirectory) : std::filesystem::temp_directory_path();
+
+    LatencyHistogram appendLatency;
+    LatencyHistogram writeLatency;
+    std::vector<std::unique_ptr<BenchmarkFile>> files;
+
+    // Threads start together a little later so that none gets a head start on the disk.
+    const auto start = BenchmarkClock::now() + std::chrono::milliseconds(100);
+    const auto end = start + std::chrono::milliseconds(options.DurationMs);
+    const auto runId = std::to_wstring(GetTickCount64());
+    for (DWORD i = 0; i < options.FileCount; ++i) {
+        auto file = std::make_unique<BenchmarkFile>();
+        file->FilePath = outputDirectory / (L"DiskWriterBenchmark_" + runId + L"_" + std::to_wstring(i) + L".bin");
+        if (options.Synchronous) {
+            file->Thread = std::thread(WriteSynchronous, std::cref(options), start, end, std::ref(*file), std::ref(appendLatency));
+        }
+        else {
+            file->Thread = std::thread(WriteAsync, std::cref(options), start, end, std::ref(*file), std::ref(appendLatency),
+                std::ref(writeLatency));
+        }
+        files.push_back(std::move(file));
+    }
+
+    AsyncWriteStats total = {};
+    UINT64 bytesAppended = 0;
+    int failedFiles = 0;
+    HRESULT firstError = S_OK;
+    for (auto& file : files) {
+        file->Thread.join();
+        total.BytesWritten += file->Stats.BytesWritten;
+        total.Writes += file->Stats.Writes;
+        total.Flushes += file->Stats.Flushes;
+        total.Stalls += file->Stats.Stalls;
+        total.StallNanoseconds += file->Stats.StallNanoseconds;
+        bytesAppended += file->BytesAppended;
+        if (FAILED(file->Result)) {
+            ++failedFiles;
+            firstError = SUCCEEDED(firstError) ? file->Result : firstError;
+        }
+
+        std::error_code error;
+        std::filesystem::remove(file->FilePath, error);
+    }
+    // Until every file is closed, which includes the writes still queued at the end.
+    const double seconds = std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+
+    std::ostringstream json;
+    json << "{\"files\":" << options.FileCount
+        << ",\"mode\":\"" << (options.Synchronous ? "Synchronous" : "Async") << "\""
+        << ",\"paced\":" << (options.Paced ? "true" : "false")
+        << ",\"bytesPerSecondPerFile\":" << options.BytesPerSecond
+        << ",\"bufferSize\":" << options.BufferSize
+        << ",\"bufferCount\":" << options.BufferCount
+        << ",\"preallocationMB\":" << options.PreallocationMB
+        << ",\"flushIntervalMs\":" << options.FlushIntervalMs
+        << ",\"seconds\":" << seconds
+        << ",\"bytesWritten\":" << total.BytesWritten
+        << ",\"megabytesPerSecond\":" << (seconds > 0.0 ? bytesAppended / 1e6 / seconds : 0.0);
+    AppendLatency(json, "appendLatencyUs", appendLatency);
+    AppendLatency(json, "writeLatencyUs", writeLatency);
+    json << ",\"writes\":" << total.Writes
+        << ",\"flushes\":" << total.Flushes
+        << ",\"stalls\":" << total.Stalls
+        << ",\"stallMs\":" << total.StallNanoseconds / 1e6
+        << ",\"failedFiles\":" << failedFiles
+        << "}";
+
+    results << json.str() << std::endl;
+    Logger::GetInstance().Log("Disk writer benchmark: " + json.str());
+    return firstError;
+}
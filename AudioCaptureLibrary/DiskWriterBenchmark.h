@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Windows.h>
+#include <wtypes.h>
+#include <string>
+
+// Settings of RunDiskWriterBenchmark, shared with the managed side.
+struct DiskWriterBenchmarkOptions {
+    DWORD FileCount = 64;
+    DWORD DurationMs = 10000;
+    // Per file, 48 kHz stereo float by default.
+    DWORD BytesPerSecond = 48000 * 2 * 4;
+    // Appends 10 ms packets in real time like a capture. Otherwise every file is written as fast
+    // as the disk takes it, which measures throughput rather than latency.
+    BOOL Paced = TRUE;
+    // Writes every packet with a blocking WriteFile instead of through AsyncFileWriter, the
+    // baseline to compare against.
+    BOOL Synchronous = FALSE;
+    // See AsyncWriteSettings.
+    DWORD BufferSize = 1024 * 1024;
+    DWORD BufferCount = 3;
+    DWORD PreallocationMB = 64;
+    DWORD FlushIntervalMs = 0;
+    // Where the files are written, the temp directory when null. Files are deleted after the run.
+    BSTR OutputDirectory = nullptr;
+};
+
+// Appends to FileCount files at once, one thread per file, the way the consumers of a multitrack
+// recording do.
+//
+// Appends one JSON object to `resultPath`: throughput in MB/s over all files, latency percentiles
+// in microseconds of the appends (what a capture thread would wait) and of the disk writes, stalls
+// on a full set of buffers and flushes.
+HRESULT RunDiskWriterBenchmark(const DiskWriterBenchmarkOptions& options, const std::wstring& resultPath);
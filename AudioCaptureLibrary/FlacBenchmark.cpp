@@ -0,0 +1,219 @@
+#include "FlacBenchmark.h"
+
+#include <wil/result.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "FlacEncoder.h"
+#include "Logger.h"
+#include "WavFileReader.h"
+
+static constexpr uint32_t SyntheticSampleRate = 48000;
+static constexpr double Pi = 3.14159265358979323846;
+
+struct BenchmarkMaterial {
+    std::string Name;
+    std::string Source;
+    AudioFormat Format;
+    SampleFormat Encoding = SampleFormat::Int16;
+    std::vector<uint8_t> Data;
+};
+
+static uint64_t GetThreadCpuTime() {
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+
+    const auto toTicks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    // 100 ns units
+    return toTicks(kernel) + toTicks(user);
+}
+
+static int16_t ToInt16(double value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0, 1.0) * 32767.0));
+}
+
+static uint32_t NextNoise(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static double Noise(uint32_t& state) {
+    return static_cast<double>(NextNoise(state) >> 8) * (2.0 / 16777216.0) - 1.0;
+}
+
+// Stereo chords of decaying harmonic notes, panned apart, over a faint noise floor.
+static void GenerateMusic(BenchmarkMaterial& material, size_t frames) {
+    constexpr double Notes[] = { 220.0, 277.18, 329.63, 440.0, 164.81, 246.94, 293.66, 392.0 };
+    constexpr size_t NoteCount = std::size(Notes);
+    const size_t noteFrames = SyntheticSampleRate / 2;
+
+    material.Format = { SyntheticSampleRate, 2, 16 };
+    material.Encoding = SampleFormat::Int16;
+    material.Data.resize(frames * material.Format.BytesPerFrame());
+    auto output = reinterpret_cast<int16_t*>(material.Data.data());
+
+    uint32_t noise = 1;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        const double time = static_cast<double>(frame) / SyntheticSampleRate;
+        const size_t note = frame / noteFrames;
+        const double envelope = std::exp(-3.0 * static_cast<double>(frame % noteFrames) / noteFrames);
+
+        double left = 0.0;
+        double right = 0.0;
+        for (size_t voice = 0; voice < 3; ++voice) {
+            const double frequency = Notes[(note + voice * 2) % NoteCount];
+            double value = 0.0;
+            for (int harmonic = 1; harmonic <= 6; ++harmonic) {
+                value += std::sin(2.0 * Pi * frequency * harmonic * time) / (harmonic * harmonic);
+            }
+            const double pan = (voice + 0.5) / 3.0;
+            left += value * (1.0 - pan);
+            right += value * pan;
+        }
+        output[frame * 2] = ToInt16(0.2 * envelope * left + 0.002 * Noise(noise));
+        output[frame * 2 + 1] = ToInt16(0.2 * envelope * right + 0.002 * Noise(noise));
+    }
+}
+
+// Mono speech stand-in: a gliding glottal pulse train shaped by moving formants, in syllables of
+// about a quarter second with pauses between phrases.
+static void GenerateVoice(BenchmarkMaterial& material, size_t frames) {
+    constexpr double Formants[][3] = { { 730, 1090, 2440 }, { 270, 2290, 3010 }, { 530, 1840, 2480 }, { 570, 840, 2410 } };
+
+    material.Format = { SyntheticSampleRate, 1, 16 };
+    material.Encoding = SampleFormat::Int16;
+    material.Data.resize(frames * material.Format.BytesPerFrame());
+    auto output = reinterpret_cast<int16_t*>(material.Data.data());
+
+    uint32_t noise = 7;
+    double phase = 0.0;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        const double time = static_cast<double>(frame) / SyntheticSampleRate;
+        const size_t syllable = static_cast<size_t>(time * 4.0);
+        const bool pause = syllable % 10 >= 8;
+        const double envelope = pause ? 0.0 : std::pow(std::sin(Pi * std::fmod(time * 4.0, 1.0)), 2.0);
+
+        const double fundamental = 120.0 + 25.0 * std::sin(2.0 * Pi * 0.7 * time);
+        phase += fundamental / SyntheticSampleRate;
+        const double* formants = Formants[syllable % std::size(Formants)];
+
+        double value = 0.0;
+        for (int harmonic = 1; harmonic * fundamental < 4000.0; ++harmonic) {
+            const double frequency = harmonic * fundamental;
+            double gain = 0.0;
+            for (int k = 0; k < 3; ++k) {
+                const double distance = (frequency - formants[k]) / 120.0;
+                gain += std::exp(-distance * distance) / (k + 1);
+            }
+            value += gain * std::sin(2.0 * Pi * harmonic * phase) / harmonic;
+        }
+        output[frame] = ToInt16(0.3 * envelope * value + 0.0005 * Noise(noise));
+    }
+}
+
+static HRESULT LoadMaterial(const char* name, BSTR path, DWORD durationMs, void (*generate)(BenchmarkMaterial&, size_t), BenchmarkMaterial& material) {
+    material.Name = name;
+    if (!path || SysStringLen(path) == 0) {
+        material.Source = "synthetic";
+        generate(material, static_cast<size_t>(static_cast<uint64_t>(durationMs) * SyntheticSampleRate / 1000));
+        return S_OK;
+    }
+
+    WavFileReader reader;
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED), !reader.Open(std::filesystem::path(path)));
+
+    material.Source = "file";
+    material.Format = reader.GetFormat();
+    material.Encoding = reader.GetSampleFormat();
+
+    const uint64_t maxFrames = static_cast<uint64_t>(durationMs) * material.Format.SampleRate / 1000;
+    const size_t frames = static_cast<size_t>((std::min)(reader.GetFrameCount(), maxFrames));
+    material.Data.resize(frames * material.Format.BytesPerFrame());
+    material.Data.resize(reader.Read(material.Data.data(), frames) * material.Format.BytesPerFrame());
+    return S_OK;
+}
+
+static HRESULT RunLevel(const BenchmarkMaterial& material, int level, std::ofstream& results) {
+    FlacEncoderSettings settings;
+    settings.SampleRate = material.Format.SampleRate;
+    settings.Channels = material.Format.Channels;
+    settings.Format = material.Encoding;
+    settings.CompressionLevel = level;
+
+    FlacEncoder encoder;
+    RETURN_HR_IF(E_INVALIDARG, !encoder.Configure(settings));
+
+    const size_t frameSize = material.Format.BytesPerFrame();
+    const size_t totalFrames = material.Data.size() / frameSize;
+    const size_t packetFrames = (std::max<size_t>)(material.Format.SampleRate / 100, 1);
+
+    std::vector<uint8_t> output;
+    output.reserve(1 << 20);
+    uint64_t encodedBytes = encoder.GetStreamHeader().size();
+
+    const auto wallStart = std::chrono::steady_clock::now();
+    const uint64_t cpuStart = GetThreadCpuTime();
+    for (size_t frame = 0; frame < totalFrames; frame += packetFrames) {
+        encoder.Encode(material.Data.data() + frame * frameSize, (std::min)(packetFrames, totalFrames - frame), output);
+        encodedBytes += output.size();
+        output.clear();
+    }
+    encoder.Finish(output);
+    encodedBytes += output.size();
+    const uint64_t cpuTime = GetThreadCpuTime() - cpuStart;
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    const double audioSeconds = static_cast<double>(totalFrames) / material.Format.SampleRate;
+    const double cpuSeconds = cpuTime / 1e7;
+
+    std::ostringstream json;
+    json << "{\"material\":\"" << material.Name << "\""
+        << ",\"source\":\"" << material.Source << "\""
+        << ",\"level\":" << level
+        << ",\"sampleRate\":" << material.Format.SampleRate
+        << ",\"channels\":" << material.Format.Channels
+        << ",\"bitsPerSample\":" << encoder.GetBitsPerSample()
+        << ",\"blockSize\":" << encoder.GetBlockSize()
+        << ",\"audioSeconds\":" << audioSeconds
+        << ",\"pcmBytes\":" << material.Data.size()
+        << ",\"encodedBytes\":" << encodedBytes
+        << ",\"ratio\":" << (material.Data.empty() ? 0.0 : static_cast<double>(encodedBytes) / material.Data.size())
+        << ",\"cpuSeconds\":" << cpuSeconds
+        << ",\"wallSeconds\":" << wallSeconds
+        << ",\"realtimePerCore\":" << (cpuSeconds > 0.0 ? audioSeconds / cpuSeconds : 0.0)
+        << "}";
+
+    results << json.str() << std::endl;
+    Logger::GetInstance().Log("FLAC benchmark: " + json.str());
+    return S_OK;
+}
+
+HRESULT RunFlacBenchmark(const FlacBenchmarkOptions& options, const std::wstring& resultPath) {
+    RETURN_HR_IF(E_INVALIDARG, options.DurationMs == 0 || options.MinCompressionLevel < 0 ||
+        options.MaxCompressionLevel > FlacEncoder::MaxCompressionLevel || options.MinCompressionLevel > options.MaxCompressionLevel);
+
+    std::ofstream results(std::filesystem::path(resultPath), std::ios::app);
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED), !results);
+
+    BenchmarkMaterial materials[2];
+    RETURN_IF_FAILED(LoadMaterial("music", options.MusicPath, options.DurationMs, &GenerateMusic, materials[0]));
+    RETURN_IF_FAILED(LoadMaterial("voice", options.VoicePath, options.DurationMs, &GenerateVoice, materials[1]));
+
+    for (const auto& material : materials) {
+        for (int level = options.MinCompressionLevel; level <= options.MaxCompressionLevel; ++level) {
+            RETURN_IF_FAILED(RunLevel(material, level, results));
+        }
+    }
+    return S_OK;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Windows.h>
+#include <wtypes.h>
+#include <string>
+
+// Settings of RunFlacBenchmark, shared with the managed side.
+struct FlacBenchmarkOptions {
+    // WAV files used as the music and voice material. When null a synthetic signal stands in,
+    // which is only good for comparing levels and builds, not for real compression ratios.
+    BSTR MusicPath = nullptr;
+    BSTR VoicePath = nullptr;
+    // Length of the synthetic material, files are cut to it as well.
+    DWORD DurationMs = 30000;
+    int MinCompressionLevel = 0;
+    int MaxCompressionLevel = 8;
+};
+
+// Encodes the music and the voice material in memory at every compression level, in 10 ms packets
+// like a live capture, on the calling thread.
+//
+// Appends one JSON object per material and level to `resultPath`: compression ratio (encoded size
+// over PCM size) and encode speed as a multiple of realtime on one core, from the thread's CPU time.
+HRESULT RunFlacBenchmark(const FlacBenchmarkOptions& options, const std::wstring& resultPath);
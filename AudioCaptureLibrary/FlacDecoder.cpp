@@ -0,0 +1,388 @@
+#include "FlacDecoder.h"
+
+#include <bit>
+
+#include "FlacFormat.h"
+
+namespace {
+
+constexpr uint32_t MaxFixedOrder = 4;
+constexpr uint32_t MaxBitsPerSample = 24;
+
+// Bits per sample by frame header code, 0 refers to STREAMINFO or is reserved.
+constexpr uint32_t SampleSizes[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+
+uint32_t GetBlockSize(uint32_t code) {
+    if (code == 1) {
+        return 192;
+    }
+    if (code >= 2 && code <= 5) {
+        return 576u << (code - 2);
+    }
+    if (code >= 8) {
+        return 256u << (code - 8);
+    }
+    // 0 is reserved, 6 and 7 are read from the end of the header.
+    return 0;
+}
+
+}
+
+class FlacDecoder::BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+
+    // Reads up to 32 bits MSB first. Fails at the end of the data.
+    bool Read(uint32_t bits, uint32_t& value) {
+        if (m_CacheBits < bits) {
+            Refill();
+            if (m_CacheBits < bits) {
+                return false;
+            }
+        }
+        value = bits == 0 ? 0 : static_cast<uint32_t>(m_Cache >> (64 - bits));
+        m_Cache = bits == 0 ? m_Cache : m_Cache << bits;
+        m_CacheBits -= bits;
+        return true;
+    }
+
+    bool ReadSigned(uint32_t bits, int32_t& value) {
+        uint32_t raw = 0;
+        if (!Read(bits, raw)) {
+            return false;
+        }
+        value = bits == 0 ? 0 : static_cast<int32_t>(raw << (32 - bits)) >> (32 - bits);
+        return true;
+    }
+
+    // Counts the zeros before the next set bit and consumes all of them.
+    bool ReadUnary(uint32_t& value) {
+        value = 0;
+        for (;;) {
+            Refill();
+            if (m_CacheBits == 0) {
+                return false;
+            }
+            if (m_Cache == 0) {
+                value += m_CacheBits;
+                m_CacheBits = 0;
+                continue;
+            }
+
+            const auto zeros = static_cast<uint32_t>(std::countl_zero(m_Cache));
+            value += zeros;
+            m_Cache = (m_Cache << zeros) << 1;
+            m_CacheBits -= zeros + 1;
+            return true;
+        }
+    }
+
+    bool ReadRice(uint32_t parameter, int32_t& value) {
+        uint32_t quotient = 0;
+        uint32_t low = 0;
+        if (!ReadUnary(quotient) || !Read(parameter, low)) {
+            return false;
+        }
+        const uint64_t folded = (static_cast<uint64_t>(quotient) << parameter) | low;
+        if (folded > 0xFFFFFFFFu) {
+            return false;
+        }
+        const auto bits = static_cast<uint32_t>(folded);
+        value = static_cast<int32_t>(bits >> 1) ^ -static_cast<int32_t>(bits & 1);
+        return true;
+    }
+
+    void AlignToByte() {
+        const uint32_t padding = m_CacheBits % 8;
+        m_Cache <<= padding;
+        m_CacheBits -= padding;
+    }
+
+    // Bytes consumed so far, only meaningful after AlignToByte.
+    size_t GetBytePosition() const { return m_Position - m_CacheBits / 8; }
+
+private:
+    void Refill() {
+        while (m_CacheBits <= 56 && m_Position < m_Size) {
+            m_Cache |= static_cast<uint64_t>(m_Data[m_Position++]) << (56 - m_CacheBits);
+            m_CacheBits += 8;
+        }
+    }
+
+    const uint8_t* m_Data;
+    size_t m_Size;
+    size_t m_Position = 0;
+    // Unread bits, left aligned.
+    uint64_t m_Cache = 0;
+    uint32_t m_CacheBits = 0;
+};
+
+bool FlacDecoder::Configure(uint32_t bitsPerSample, uint16_t channels) {
+    if (bitsPerSample < 4 || bitsPerSample > MaxBitsPerSample || channels == 0 || channels > 8) {
+        return false;
+    }
+
+    m_BitsPerSample = bitsPerSample;
+    m_Channels = channels;
+    m_FrameCount = 0;
+    m_FrameSize = 0;
+    return true;
+}
+
+bool FlacDecoder::DecodeFrame(const uint8_t* data, size_t size) {
+    m_FrameCount = 0;
+    m_FrameSize = 0;
+    if (m_Channels == 0 || size < 6 || data[0] != 0xFF || (data[1] & 0xFE) != 0xF8 || (data[3] & 1) != 0) {
+        return false;
+    }
+
+    const uint32_t blockSizeCode = data[2] >> 4;
+    const uint32_t sampleRateCode = data[2] & 0x0F;
+    const uint32_t assignment = data[3] >> 4;
+    const uint32_t sampleSizeCode = (data[3] >> 1) & 0x07;
+
+    const uint32_t sampleSize = sampleSizeCode == 0 ? m_BitsPerSample : SampleSizes[sampleSizeCode];
+    const uint16_t channels = static_cast<uint16_t>(assignment < LeftSide ? assignment + 1 : 2);
+    if (sampleSize != m_BitsPerSample || assignment > MidSide || channels != m_Channels || sampleRateCode == 15) {
+        return false;
+    }
+
+    // Frame or sample number, UTF-8 style: the leading ones of the first byte give the length.
+    size_t position = 4;
+    const auto length = static_cast<size_t>(std::countl_one(data[position]));
+    if (length == 1 || length > 7) {
+        return false;
+    }
+    position += length == 0 ? 1 : length;
+
+    uint32_t blockSize = GetBlockSize(blockSizeCode);
+    const size_t extraBlockSize = blockSizeCode == 6 ? 1 : blockSizeCode == 7 ? 2 : 0;
+    const size_t extraSampleRate = sampleRateCode == 12 ? 1 : (sampleRateCode == 13 || sampleRateCode == 14) ? 2 : 0;
+    if (position + extraBlockSize + extraSampleRate + 1 > size) {
+        return false;
+    }
+    if (extraBlockSize > 0) {
+        blockSize = (extraBlockSize == 1 ? data[position] : (data[position] << 8) | data[position + 1]) + 1u;
+    }
+    position += extraBlockSize + extraSampleRate;
+    if (blockSize == 0 || ComputeFlacCrc8(data, position) != data[position]) {
+        return false;
+    }
+    ++position;
+
+    if (m_Samples.size() < static_cast<size_t>(blockSize) * channels) {
+        m_Samples.resize(static_cast<size_t>(blockSize) * channels);
+    }
+    m_FrameCount = blockSize;
+
+    BitReader reader(data + position, size - position);
+    for (uint16_t channel = 0; channel < channels; ++channel) {
+        // The side channel needs one more bit.
+        const bool side = (assignment == LeftSide && channel == 1) || (assignment == RightSide && channel == 0) ||
+            (assignment == MidSide && channel == 1);
+        if (!DecodeSubframe(reader, sampleSize + (side ? 1 : 0), m_Samples.data() + static_cast<size_t>(channel) * blockSize)) {
+            m_FrameCount = 0;
+            return false;
+        }
+    }
+
+    reader.AlignToByte();
+    const size_t crcPosition = position + reader.GetBytePosition();
+    uint32_t crc = 0;
+    if (!reader.Read(16, crc) || ComputeFlacCrc16(data, crcPosition) != crc) {
+        m_FrameCount = 0;
+        return false;
+    }
+    m_FrameSize = crcPosition + 2;
+
+    int32_t* first = m_Samples.data();
+    int32_t* second = first + blockSize;
+    switch (assignment) {
+    case LeftSide:
+        for (size_t i = 0; i < blockSize; ++i) {
+            second[i] = static_cast<int32_t>(static_cast<int64_t>(first[i]) - second[i]);
+        }
+        break;
+    case RightSide:
+        for (size_t i = 0; i < blockSize; ++i) {
+            first[i] = static_cast<int32_t>(static_cast<int64_t>(first[i]) + second[i]);
+        }
+        break;
+    case MidSide:
+        for (size_t i = 0; i < blockSize; ++i) {
+            const int64_t side = second[i];
+            const int64_t mid = (static_cast<int64_t>(first[i]) * 2) | (side & 1);
+            first[i] = static_cast<int32_t>((mid + side) >> 1);
+            second[i] = static_cast<int32_t>((mid - side) >> 1);
+        }
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+bool FlacDecoder::DecodeSubframe(BitReader& reader, uint32_t bitsPerSample, int32_t* samples) {
+    uint32_t header = 0;
+    if (!reader.Read(8, header) || (header & 0x80) != 0) {
+        return false;
+    }
+    const uint32_t type = (header >> 1) & 0x3F;
+
+    uint32_t wastedBits = 0;
+    if (header & 1) {
+        if (!reader.ReadUnary(wastedBits)) {
+            return false;
+        }
+        ++wastedBits;
+        if (wastedBits >= bitsPerSample) {
+            return false;
+        }
+        bitsPerSample -= wastedBits;
+    }
+
+    const size_t frames = m_FrameCount;
+    if (type == 0) {
+        int32_t value = 0;
+        if (!reader.ReadSigned(bitsPerSample, value)) {
+            return false;
+        }
+        for (size_t i = 0; i < frames; ++i) {
+            samples[i] = value;
+        }
+    }
+    else if (type == 1) {
+        for (size_t i = 0; i < frames; ++i) {
+            if (!reader.ReadSigned(bitsPerSample, samples[i])) {
+                return false;
+            }
+        }
+    }
+    else if (type >= 8 && type <= 8 + MaxFixedOrder) {
+        const uint32_t order = type - 8;
+        if (order > frames) {
+            return false;
+        }
+        for (uint32_t i = 0; i < order; ++i) {
+            if (!reader.ReadSigned(bitsPerSample, samples[i])) {
+                return false;
+            }
+        }
+        if (!DecodeResidual(reader, order, samples)) {
+            return false;
+        }
+
+        // Residual is in place, each sample is predicted from the ones already restored.
+        for (size_t i = order; i < frames; ++i) {
+            int64_t prediction = 0;
+            switch (order) {
+            case 1:
+                prediction = samples[i - 1];
+                break;
+            case 2:
+                prediction = 2 * static_cast<int64_t>(samples[i - 1]) - samples[i - 2];
+                break;
+            case 3:
+                prediction = 3 * (static_cast<int64_t>(samples[i - 1]) - samples[i - 2]) + samples[i - 3];
+                break;
+            case 4:
+                prediction = 4 * (static_cast<int64_t>(samples[i - 1]) + samples[i - 3]) - 6 * static_cast<int64_t>(samples[i - 2]) - samples[i - 4];
+                break;
+            default:
+                break;
+            }
+            samples[i] = static_cast<int32_t>(prediction + samples[i]);
+        }
+    }
+    else if (type >= 32) {
+        const uint32_t order = type - 31;
+        if (order > frames) {
+            return false;
+        }
+        for (uint32_t i = 0; i < order; ++i) {
+            if (!reader.ReadSigned(bitsPerSample, samples[i])) {
+                return false;
+            }
+        }
+
+        uint32_t precision = 0;
+        int32_t shift = 0;
+        if (!reader.Read(4, precision) || precision == 15 || !reader.ReadSigned(5, shift) || shift < 0) {
+            return false;
+        }
+        ++precision;
+
+        int32_t coefficients[32] = {};
+        for (uint32_t i = 0; i < order; ++i) {
+            if (!reader.ReadSigned(precision, coefficients[i])) {
+                return false;
+            }
+        }
+        if (!DecodeResidual(reader, order, samples)) {
+            return false;
+        }
+
+        for (size_t i = order; i < frames; ++i) {
+            int64_t sum = 0;
+            for (uint32_t j = 0; j < order; ++j) {
+                sum += static_cast<int64_t>(coefficients[j]) * samples[i - 1 - j];
+            }
+            samples[i] = static_cast<int32_t>((sum >> shift) + samples[i]);
+        }
+    }
+    else {
+        return false;
+    }
+
+    if (wastedBits > 0) {
+        for (size_t i = 0; i < frames; ++i) {
+            samples[i] = static_cast<int32_t>(static_cast<uint32_t>(samples[i]) << wastedBits);
+        }
+    }
+    return true;
+}
+
+bool FlacDecoder::DecodeResidual(BitReader& reader, uint32_t order, int32_t* residual) {
+    uint32_t method = 0;
+    uint32_t partitionOrder = 0;
+    if (!reader.Read(2, method) || method > 1 || !reader.Read(4, partitionOrder)) {
+        return false;
+    }
+
+    const size_t frames = m_FrameCount;
+    const size_t partitionSize = frames >> partitionOrder;
+    if ((partitionSize << partitionOrder) != frames || partitionSize < order) {
+        return false;
+    }
+
+    const uint32_t parameterBits = method == 0 ? 4 : 5;
+    const uint32_t escape = (1u << parameterBits) - 1;
+    size_t index = order;
+    for (size_t partition = 0; partition < (size_t{ 1 } << partitionOrder); ++partition) {
+        const size_t end = (partition + 1) * partitionSize;
+        uint32_t parameter = 0;
+        if (!reader.Read(parameterBits, parameter)) {
+            return false;
+        }
+
+        if (parameter == escape) {
+            uint32_t bits = 0;
+            if (!reader.Read(5, bits)) {
+                return false;
+            }
+            for (; index < end; ++index) {
+                if (!reader.ReadSigned(bits, residual[index])) {
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        for (; index < end; ++index) {
+            if (!reader.ReadRice(parameter, residual[index])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decoder for single FLAC frames of a stream whose parameters are known up front, such as the
+// blocks the compressed replay buffer keeps in memory. Every frame is decoded on its own, there is
+// no state carried between frames. Header and frame CRCs are verified.
+class FlacDecoder {
+public:
+    // Bits per sample and channel count of the stream, used when a frame header refers to
+    // STREAMINFO and to reject frames of a different layout.
+    bool Configure(uint32_t bitsPerSample, uint16_t channels);
+
+    // Decodes the frame at the start of `data`. Returns false for a damaged or unsupported frame.
+    bool DecodeFrame(const uint8_t* data, size_t size);
+
+    // Samples per channel and encoded size of the last decoded frame.
+    size_t GetFrameCount() const { return m_FrameCount; }
+    size_t GetFrameSize() const { return m_FrameSize; }
+    uint32_t GetBitsPerSample() const { return m_BitsPerSample; }
+
+    // Planar samples of the last decoded frame, GetFrameCount() per channel.
+    const int32_t* GetChannel(uint16_t channel) const { return m_Samples.data() + static_cast<size_t>(channel) * m_FrameCount; }
+
+private:
+    class BitReader;
+
+    bool DecodeSubframe(BitReader& reader, uint32_t bitsPerSample, int32_t* samples);
+    bool DecodeResidual(BitReader& reader, uint32_t order, int32_t* residual);
+
+    uint32_t m_BitsPerSample = 0;
+    uint16_t m_Channels = 0;
+    size_t m_FrameCount = 0;
+    size_t m_FrameSize = 0;
+    std::vector<int32_t> m_Samples;
+};
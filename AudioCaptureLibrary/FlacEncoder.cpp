@@ -0,0 +1,998 @@
+#include "FlacEncoder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "CpuFeatures.h"
+#include "FlacFormat.h"
+
+namespace {
+
+struct LevelSpec {
+    uint32_t BlockSize;
+    int StereoMode;
+    uint32_t MaxLpcOrder;
+    bool ExhaustiveOrderSearch;
+    uint32_t MaxPartitionOrder;
+};
+
+// Stereo mode: 0 independent, 1 estimated, 2 exhaustive. Levels 0-2 only use fixed predictors.
+constexpr LevelSpec LevelSpecs[] = {
+    { 1152, 0, 0, false, 3 },
+    { 1152, 1, 0, false, 3 },
+    { 1152, 2, 0, false, 3 },
+    { 4096, 0, 6, false, 4 },
+    { 4096, 1, 8, false, 4 },
+    { 4096, 1, 8, false, 5 },
+    { 4096, 2, 8, false, 6 },
+    { 4096, 2, 12, false, 6 },
+    { 4096, 2, 12, true, 6 },
+};
+
+constexpr uint32_t MaxFixedOrder = 4;
+constexpr int MaxShift = 15;
+constexpr uint32_t MaxRiceParameter = 30;
+constexpr uint32_t MaxNarrowRiceParameter = 14;
+// Size of a subframe header without wasted bits: padding bit, type and wasted bits flag.
+constexpr uint64_t SubframeHeaderBits = 8;
+// Residual coding method and partition order.
+constexpr uint64_t ResidualHeaderBits = 6;
+
+constexpr double Pi = 3.14159265358979323846;
+
+uint8_t GetBlockSizeCode(size_t frames) {
+    switch (frames) {
+    case 192:
+        return 1;
+    case 576:
+        return 2;
+    case 1152:
+        return 3;
+    case 2304:
+        return 4;
+    case 4608:
+        return 5;
+    default:
+        break;
+    }
+    if (frames >= 256 && std::has_single_bit(frames) && frames <= 32768) {
+        return static_cast<uint8_t>(std::countr_zero(frames));
+    }
+    // Size follows the frame number as an 8 or 16 bit value minus one.
+    return frames <= 256 ? 6 : 7;
+}
+
+uint8_t GetSampleRateCode(uint32_t sampleRate) {
+    switch (sampleRate) {
+    case 88200:
+        return 1;
+    case 176400:
+        return 2;
+    case 192000:
+        return 3;
+    case 8000:
+        return 4;
+    case 16000:
+        return 5;
+    case 22050:
+        return 6;
+    case 24000:
+        return 7;
+    case 32000:
+        return 8;
+    case 44100:
+        return 9;
+    case 48000:
+        return 10;
+    case 96000:
+        return 11;
+    default:
+        break;
+    }
+    if (sampleRate % 1000 == 0 && sampleRate / 1000 <= 255) {
+        return 12;
+    }
+    if (sampleRate <= 65535) {
+        return 13;
+    }
+    if (sampleRate % 10 == 0 && sampleRate / 10 <= 65535) {
+        return 14;
+    }
+    // Taken from STREAMINFO.
+    return 0;
+}
+
+inline uint32_t ZigZag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+// Rice parameter for a partition from the sum of its folded residuals, and the resulting size.
+inline uint32_t GetRiceParameter(uint64_t sum, uint64_t count) {
+    uint32_t parameter = 0;
+    while (parameter < MaxRiceParameter && (count << (parameter + 1)) < sum) {
+        ++parameter;
+    }
+    return parameter;
+}
+
+inline uint64_t GetRiceBits(uint64_t sum, uint64_t count, uint32_t parameter) {
+    return count * (parameter + 1) + (sum >> parameter);
+}
+
+// Sums of the absolute residuals of the fixed predictors behind the warm-up samples, returns the
+// order with the smallest one.
+uint32_t EstimateFixedOrder(const int32_t* signal, size_t frames, uint32_t maxOrder, uint64_t& bestSum) {
+    const size_t start = maxOrder;
+    int32_t last0 = start >= 1 ? signal[start - 1] : 0;
+    int32_t last1 = start >= 2 ? signal[start - 1] - signal[start - 2] : 0;
+    int32_t last2 = start >= 3 ? last1 - (signal[start - 2] - signal[start - 3]) : 0;
+    int32_t last3 = start >= 4 ? last2 - ((signal[start - 2] - signal[start - 3]) - (signal[start - 3] - signal[start - 4])) : 0;
+
+    uint64_t sums[MaxFixedOrder + 1] = {};
+    for (size_t i = start; i < frames; ++i) {
+        const int32_t error0 = signal[i];
+        const int32_t error1 = error0 - last0;
+        const int32_t error2 = error1 - last1;
+        const int32_t error3 = error2 - last2;
+        const int32_t error4 = error3 - last3;
+        sums[0] += static_cast<uint32_t>(std::abs(error0));
+        sums[1] += static_cast<uint32_t>(std::abs(error1));
+        sums[2] += static_cast<uint32_t>(std::abs(error2));
+        sums[3] += static_cast<uint32_t>(std::abs(error3));
+        sums[4] += static_cast<uint32_t>(std::abs(error4));
+        last0 = error0;
+        last1 = error1;
+        last2 = error2;
+        last3 = error3;
+    }
+
+    uint32_t best = 0;
+    for (uint32_t order = 1; order <= maxOrder; ++order) {
+        if (sums[order] < sums[best]) {
+            best = order;
+        }
+    }
+    bestSum = sums[best];
+    return best;
+}
+
+// Size estimate of a channel coded with its best fixed predictor, used to pick the stereo assignment.
+uint64_t EstimateFixedBits(const int32_t* signal, size_t frames, uint32_t bitsPerSample) {
+    const uint32_t maxOrder = static_cast<uint32_t>((std::min)(static_cast<size_t>(MaxFixedOrder), frames - 1));
+    uint64_t sum = 0;
+    const uint32_t order = EstimateFixedOrder(signal, frames, maxOrder, sum);
+    const uint64_t count = frames - order;
+    return order * bitsPerSample + GetRiceBits(sum, count, GetRiceParameter(sum, count));
+}
+
+// Residual kernels. The residual of sample `order + k` is stored at residual[k].
+
+void FixedResidualScalar(const int32_t* signal, size_t frames, uint32_t order, int32_t* residual) {
+    for (size_t i = order; i < frames; ++i) {
+        const int32_t* x = signal + i;
+        int32_t value = 0;
+        switch (order) {
+        case 0:
+            value = x[0];
+            break;
+        case 1:
+            value = x[0] - x[-1];
+            break;
+        case 2:
+            value = x[0] - 2 * x[-1] + x[-2];
+            break;
+        case 3:
+            value = x[0] - 3 * x[-1] + 3 * x[-2] - x[-3];
+            break;
+        default:
+            value = x[0] - 4 * x[-1] + 6 * x[-2] - 4 * x[-3] + x[-4];
+            break;
+        }
+        residual[i - order] = value;
+    }
+}
+
+// Prediction fits 32 bits, see CanUse32BitResidual.
+void LpcResidualScalar(const int32_t* signal, size_t frames, const int32_t* coefficients, uint32_t order, int shift, int32_t* residual) {
+    for (size_t i = order; i < frames; ++i) {
+        int32_t prediction = 0;
+        for (uint32_t j = 0; j < order; ++j) {
+            prediction += coefficients[j] * signal[i - j - 1];
+        }
+        residual[i - order] = signal[i] - (prediction >> shift);
+    }
+}
+
+// Any precision, returns false when a residual does not fit 32 bits (the predictor is unusable then).
+bool LpcResidualWide(const int32_t* signal, size_t frames, const int32_t* coefficients, uint32_t order, int shift, int32_t* residual) {
+    for (size_t i = order; i < frames; ++i) {
+        int64_t prediction = 0;
+        for (uint32_t j = 0; j < order; ++j) {
+            prediction += static_cast<int64_t>(coefficients[j]) * signal[i - j - 1];
+        }
+        const int64_t value = signal[i] - (prediction >> shift);
+        if (value < (std::numeric_limits<int32_t>::min)() || value > (std::numeric_limits<int32_t>::max)()) {
+            return false;
+        }
+        residual[i - order] = static_cast<int32_t>(value);
+    }
+    return true;
+}
+
+double DotScalar(const double* first, const double* second, size_t count) {
+    double sums[4] = {};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        sums[0] += first[i] * second[i];
+        sums[1] += first[i + 1] * second[i + 1];
+        sums[2] += first[i + 2] * second[i + 2];
+        sums[3] += first[i + 3] * second[i + 3];
+    }
+    for (; i < count; ++i) {
+        sums[0] += first[i] * second[i];
+    }
+    return (sums[0] + sums[2]) + (sums[1] + sums[3]);
+}
+
+#ifdef AUDIO_SIMD_X86
+
+// Repeated differencing of the sample vectors x[i], x[i-1], ..., x[i-order] leaves the fixed
+// predictor residual of order `order` in differences[0].
+void FixedResidualSse2(const int32_t* signal, size_t frames, uint32_t order, int32_t* residual) {
+    size_t i = order;
+    for (; i + 4 <= frames; i += 4) {
+        __m128i differences[MaxFixedOrder + 1];
+        for (uint32_t j = 0; j <= order; ++j) {
+            differences[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(signal + i - j));
+        }
+        for (uint32_t round = 0; round < order; ++round) {
+            for (uint32_t j = 0; j < order - round; ++j) {
+                differences[j] = _mm_sub_epi32(differences[j], differences[j + 1]);
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(residual + i - order), differences[0]);
+    }
+    FixedResidualScalar(signal + i - order, frames - i + order, order, residual + i - order);
+}
+
+double DotSse2(const double* first, const double* second, size_t count) {
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        low = _mm_add_pd(low, _mm_mul_pd(_mm_loadu_pd(first + i), _mm_loadu_pd(second + i)));
+        high = _mm_add_pd(high, _mm_mul_pd(_mm_loadu_pd(first + i + 2), _mm_loadu_pd(second + i + 2)));
+    }
+    const __m128d sum = _mm_add_pd(low, high);
+    double result = _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+    for (; i < count; ++i) {
+        result += first[i] * second[i];
+    }
+    return result;
+}
+
+AVX2_TARGET void FixedResidualAvx2(const int32_t* signal, size_t frames, uint32_t order, int32_t* residual) {
+    size_t i = order;
+    for (; i + 8 <= frames; i += 8) {
+        __m256i differences[MaxFixedOrder + 1];
+        for (uint32_t j = 0; j <= order; ++j) {
+            differences[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(signal + i - j));
+        }
+        for (uint32_t round = 0; round < order; ++round) {
+            for (uint32_t j = 0; j < order - round; ++j) {
+                differences[j] = _mm256_sub_epi32(differences[j], differences[j + 1]);
+            }
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(residual + i - order), differences[0]);
+    }
+    FixedResidualScalar(signal + i - order, frames - i + order, order, residual + i - order);
+}
+
+// 8 residuals per iteration; needs SSE4.1 for the 32 bit multiply at 128 bits, so there is no SSE2 variant.
+AVX2_TARGET void LpcResidualAvx2(const int32_t* signal, size_t frames, const int32_t* coefficients, uint32_t order, int shift, int32_t* residual) {
+    __m256i broadcast[32];
+    for (uint32_t j = 0; j < order; ++j) {
+        broadcast[j] = _mm256_set1_epi32(coefficients[j]);
+    }
+    const __m128i shiftCount = _mm_cvtsi32_si128(shift);
+
+    size_t i = order;
+    for (; i + 8 <= frames; i += 8) {
+        __m256i prediction = _mm256_setzero_si256();
+        for (uint32_t j = 0; j < order; ++j) {
+            const __m256i history = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(signal + i - j - 1));
+            prediction = _mm256_add_epi32(prediction, _mm256_mullo_epi32(broadcast[j], history));
+        }
+        const __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(signal + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(residual + i - order), _mm256_sub_epi32(current, _mm256_sra_epi32(prediction, shiftCount)));
+    }
+    LpcResidualScalar(signal + i - order, frames - i + order, coefficients, order, shift, residual + i - order);
+}
+
+AVX2_TARGET double DotAvx2(const double* first, const double* second, size_t count) {
+    __m256d low = _mm256_setzero_pd();
+    __m256d high = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        low = _mm256_add_pd(low, _mm256_mul_pd(_mm256_loadu_pd(first + i), _mm256_loadu_pd(second + i)));
+        high = _mm256_add_pd(high, _mm256_mul_pd(_mm256_loadu_pd(first + i + 4), _mm256_loadu_pd(second + i + 4)));
+    }
+    const __m256d sum = _mm256_add_pd(low, high);
+    const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    double result = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    for (; i < count; ++i) {
+        result += first[i] * second[i];
+    }
+    return result;
+}
+
+#endif
+
+using FixedResidualKernel = void (*)(const int32_t*, size_t, uint32_t, int32_t*);
+using LpcResidualKernel = void (*)(const int32_t*, size_t, const int32_t*, uint32_t, int, int32_t*);
+using DotKernel = double (*)(const double*, const double*, size_t);
+
+struct Kernels {
+    FixedResidualKernel FixedResidual = &FixedResidualScalar;
+    LpcResidualKernel LpcResidual = &LpcResidualScalar;
+    DotKernel Dot = &DotScalar;
+};
+
+const Kernels& GetKernels() {
+    static const Kernels kernels = [] {
+        Kernels selected;
+#ifdef AUDIO_SIMD_X86
+        switch (GetInstructionSet()) {
+        case InstructionSet::Avx2:
+            selected.FixedResidual = &FixedResidualAvx2;
+            selected.LpcResidual = &LpcResidualAvx2;
+            selected.Dot = &DotAvx2;
+            break;
+        case InstructionSet::Sse2:
+            selected.FixedResidual = &FixedResidualSse2;
+            selected.Dot = &DotSse2;
+            break;
+        default:
+            break;
+        }
+#endif
+        return selected;
+    }();
+    return kernels;
+}
+
+// The 32 bit kernels cannot overflow when |sample| * |coefficient| * order stays below 2^31.
+bool CanUse32BitResidual(uint32_t bitsPerSample, uint32_t precision, uint32_t order) {
+    return bitsPerSample + precision + std::bit_width(order) - 1 <= 32;
+}
+
+// Tukey window with half of the block tapered, the reference encoder's default.
+void BuildWindow(std::vector<double>& window, size_t frames) {
+    window.assign(frames, 1.0);
+    const size_t taper = frames / 4;
+    for (size_t i = 0; i < taper; ++i) {
+        const double value = 0.5 - 0.5 * std::cos(Pi * static_cast<double>(i) / static_cast<double>(taper));
+        window[i] = value;
+        window[frames - 1 - i] = value;
+    }
+}
+
+// Levinson-Durbin recursion. Row `order - 1` of `coefficients` receives the predictor of that order
+// (FLAC sign convention, prediction = sum of coefficient * past sample) and errors[order - 1] its
+// prediction error. Returns the highest usable order.
+uint32_t ComputeLpcCoefficients(const double* autocorrelation, uint32_t maxOrder, double coefficients[][12], double* errors) {
+    double lpc[12] = {};
+    double error = autocorrelation[0];
+
+    for (uint32_t i = 0; i < maxOrder; ++i) {
+        double reflection = -autocorrelation[i + 1];
+        for (uint32_t j = 0; j < i; ++j) {
+            reflection -= lpc[j] * autocorrelation[i - j];
+        }
+        reflection /= error;
+
+        lpc[i] = reflection;
+        for (uint32_t j = 0; j < i / 2; ++j) {
+            const double previous = lpc[j];
+            lpc[j] += reflection * lpc[i - 1 - j];
+            lpc[i - 1 - j] += reflection * previous;
+        }
+        if (i & 1) {
+            lpc[i / 2] += lpc[i / 2] * reflection;
+        }
+
+        error *= 1.0 - reflection * reflection;
+        for (uint32_t j = 0; j <= i; ++j) {
+            coefficients[i][j] = -lpc[j];
+        }
+        errors[i] = error;
+
+        if (error <= 0.0) {
+            return i + 1;
+        }
+    }
+    return maxOrder;
+}
+
+// Order with the smallest expected frame size, from the prediction error of each order.
+uint32_t EstimateLpcOrder(const double* errors, uint32_t maxOrder, size_t frames, uint32_t bitsPerSample, uint32_t precision) {
+    const double errorScale = 0.5 / static_cast<double>(frames);
+    uint32_t best = 1;
+    double bestBits = (std::numeric_limits<double>::max)();
+    for (uint32_t order = 1; order <= maxOrder; ++order) {
+        const double error = errors[order - 1];
+        const double bitsPerResidual = error > 0.0 ? (std::max)(0.0, 0.5 * std::log2(errorScale * error)) : 0.0;
+        const double bits = bitsPerResidual * static_cast<double>(frames - order) + order * static_cast<double>(bitsPerSample + precision);
+        if (bits < bestBits) {
+            bestBits = bits;
+            best = order;
+        }
+    }
+    return best;
+}
+
+// Quantizes to `precision` bit coefficients with a non-negative shift, carrying the rounding error
+// over to the next coefficient. False if the coefficients are too small for any allowed shift.
+bool QuantizeCoefficients(const double* coefficients, uint32_t order, uint32_t precision, int32_t* quantized, int& shift) {
+    double maxMagnitude = 0.0;
+    for (uint32_t i = 0; i < order; ++i) {
+        maxMagnitude = (std::max)(maxMagnitude, std::abs(coefficients[i]));
+    }
+    if (maxMagnitude <= 0.0) {
+        return false;
+    }
+
+    int exponent = 0;
+    std::frexp(maxMagnitude, &exponent);
+    shift = (std::min)(static_cast<int>(precision) - 1 - exponent, MaxShift);
+    if (shift < 0) {
+        return false;
+    }
+
+    const int32_t maxValue = (1 << (precision - 1)) - 1;
+    const int32_t minValue = -maxValue - 1;
+    double error = 0.0;
+    for (uint32_t i = 0; i < order; ++i) {
+        error += coefficients[i] * static_cast<double>(1 << shift);
+        const int32_t value = std::clamp(static_cast<int32_t>(std::lround(error)), minValue, maxValue);
+        error -= value;
+        quantized[i] = value;
+    }
+    return true;
+}
+
+}
+
+class FlacEncoder::BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& output) : m_Output(output) {}
+
+    // Up to 32 bits, the value is masked to `bits`.
+    void Write(uint32_t value, uint32_t bits) {
+        if (bits == 0) {
+            return;
+        }
+        const uint64_t mask = (uint64_t{ 1 } << bits) - 1;
+        m_Buffer = (m_Buffer << bits) | (value & mask);
+        m_Count += bits;
+        if (m_Count >= 32) {
+            m_Count -= 32;
+            const auto word = static_cast<uint32_t>(m_Buffer >> m_Count);
+            const uint8_t bytes[4] = {
+                static_cast<uint8_t>(word >> 24), static_cast<uint8_t>(word >> 16), static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word)
+            };
+            m_Output.insert(m_Output.end(), bytes, bytes + 4);
+        }
+    }
+
+    void WriteSigned(int32_t value, uint32_t bits) { Write(static_cast<uint32_t>(value), bits); }
+
+    // `zeros` zero bits followed by a one.
+    void WriteUnary(uint32_t zeros) {
+        for (; zeros >= 32; zeros -= 32) {
+            Write(0, 32);
+        }
+        Write(1, zeros + 1);
+    }
+
+    void WriteRice(uint32_t value, uint32_t parameter) {
+        const uint32_t quotient = value >> parameter;
+        if (quotient + 1 + parameter <= 32) {
+            Write((1u << parameter) | (value & ((1u << parameter) - 1)), quotient + 1 + parameter);
+            return;
+        }
+        WriteUnary(quotient);
+        Write(value, parameter);
+    }
+
+    // Pads to a byte boundary and moves everything into the output.
+    void Flush() {
+        if (m_Count % 8 != 0) {
+            Write(0, 8 - m_Count % 8);
+        }
+        while (m_Count > 0) {
+            m_Count -= 8;
+            m_Output.push_back(static_cast<uint8_t>(m_Buffer >> m_Count));
+        }
+    }
+
+private:
+    std::vector<uint8_t>& m_Output;
+    uint64_t m_Buffer = 0;
+    uint32_t m_Count = 0;
+};
+
+bool FlacEncoder::Configure(const FlacEncoderSettings& settings) {
+    if (settings.Channels == 0 || settings.Channels > MaxChannels || settings.SampleRate == 0 || settings.SampleRate >= (1u << 20) ||
+        settings.CompressionLevel < 0 || settings.CompressionLevel > MaxCompressionLevel ||
+        (settings.BlockSize != 0 && (settings.BlockSize < MinBlockSize || settings.BlockSize > MaxBlockSize))) {
+        return false;
+    }
+
+    const SampleFormat blockFormat = settings.Format == SampleFormat::Int16 ? SampleFormat::Int16 : SampleFormat::Int24In32;
+    if (!m_Converter.Configure(settings.Format, blockFormat)) {
+        return false;
+    }
+
+    const LevelSpec& spec = LevelSpecs[settings.CompressionLevel];
+    m_Settings = settings;
+    m_BitsPerSample = blockFormat == SampleFormat::Int16 ? 16 : 24;
+    m_BlockSize = settings.BlockSize != 0 ? settings.BlockSize : spec.BlockSize;
+    m_MaxLpcOrder = spec.MaxLpcOrder;
+    m_MaxPartitionOrder = spec.MaxPartitionOrder;
+    m_StereoMode = settings.Channels == 2 ? static_cast<StereoMode>(spec.StereoMode) : StereoMode::Independent;
+    m_ExhaustiveOrderSearch = spec.ExhaustiveOrderSearch;
+    // Precision of the quantized LPC coefficients, as in the reference encoder.
+    m_Precision = m_BitsPerSample > 16 ? 14 : (m_BlockSize <= 1152 ? 10 : 12);
+
+    m_Block.assign(static_cast<size_t>(m_BlockSize) * settings.Channels, 0);
+    m_Mid.resize(m_StereoMode != StereoMode::Independent ? m_BlockSize : 0);
+    m_Side.resize(m_Mid.size());
+    m_Subframes.resize((std::max<size_t>)(settings.Channels, m_StereoMode != StereoMode::Independent ? 4 : 0));
+    for (auto& subframe : m_Subframes) {
+        subframe.Residual.resize(m_BlockSize);
+    }
+    m_TrialResidual.resize(m_BlockSize);
+    m_Windowed.resize(m_MaxLpcOrder > 0 ? m_BlockSize : 0);
+    m_Window.clear();
+
+    Reset();
+    return true;
+}
+
+void FlacEncoder::Reset() {
+    m_BufferedFrames = 0;
+    m_EncodedFrames = 0;
+    m_FrameNumber = 0;
+    m_MinFrameSize = 0;
+    m_MaxFrameSize = 0;
+}
+
+void FlacEncoder::Encode(const void* data, size_t frames, std::vector<uint8_t>& output) {
+    if (m_BlockSize == 0) {
+        return;
+    }
+
+    const uint16_t channels = m_Settings.Channels;
+    const size_t frameSize = SampleFormatConverter::GetSampleSize(m_Settings.Format) * channels;
+    auto source = static_cast<const uint8_t*>(data);
+
+    while (frames > 0) {
+        const size_t count = (std::min)(frames, m_BlockSize - m_BufferedFrames);
+        const uint8_t* converted = m_Converter.Convert(source, count * channels);
+
+        for (uint16_t channel = 0; channel < channels; ++channel) {
+            int32_t* destination = m_Block.data() + static_cast<size_t>(channel) * m_BlockSize + m_BufferedFrames;
+            if (m_BitsPerSample == 16) {
+                const auto samples = reinterpret_cast<const int16_t*>(converted) + channel;
+                for (size_t frame = 0; frame < count; ++frame) {
+                    destination[frame] = samples[frame * channels];
+                }
+            }
+            else {
+                const auto samples = reinterpret_cast<const int32_t*>(converted) + channel;
+                for (size_t frame = 0; frame < count; ++frame) {
+                    destination[frame] = samples[frame * channels] >> 8;
+                }
+            }
+        }
+
+        source += count * frameSize;
+        frames -= count;
+        m_BufferedFrames += count;
+        if (m_BufferedFrames == m_BlockSize) {
+            EncodeBlock(m_BlockSize, output);
+            m_BufferedFrames = 0;
+        }
+    }
+}
+
+void FlacEncoder::Finish(std::vector<uint8_t>& output) {
+    if (m_BufferedFrames == 0) {
+        return;
+    }
+
+    // The channels of a partial block are not contiguous, move them together first.
+    for (uint16_t channel = 1; channel < m_Settings.Channels; ++channel) {
+        std::memmove(m_Block.data() + channel * m_BufferedFrames, m_Block.data() + static_cast<size_t>(channel) * m_BlockSize,
+            m_BufferedFrames * sizeof(int32_t));
+    }
+    EncodeBlock(m_BufferedFrames, output);
+    m_BufferedFrames = 0;
+}
+
+std::vector<uint8_t> FlacEncoder::GetStreamHeader() const {
+    std::vector<uint8_t> header = { 'f', 'L', 'a', 'C' };
+    header.reserve(StreamHeaderSize);
+
+    BitWriter writer(header);
+    // Last metadata block, type STREAMINFO, 34 bytes.
+    writer.Write(1, 1);
+    writer.Write(0, 7);
+    writer.Write(34, 24);
+
+    writer.Write(m_BlockSize, 16);
+    writer.Write(m_BlockSize, 16);
+    writer.Write(m_MinFrameSize, 24);
+    writer.Write(m_MaxFrameSize, 24);
+    writer.Write(m_Settings.SampleRate, 20);
+    writer.Write(m_Settings.Channels - 1u, 3);
+    writer.Write(m_BitsPerSample - 1, 5);
+    writer.Write(static_cast<uint32_t>(m_EncodedFrames >> 32), 4);
+    writer.Write(static_cast<uint32_t>(m_EncodedFrames), 32);
+    // MD5 of the audio, zero means unknown.
+    for (int i = 0; i < 4; ++i) {
+        writer.Write(0, 32);
+    }
+    writer.Flush();
+    return header;
+}
+
+void FlacEncoder::EncodeBlock(size_t frames, std::vector<uint8_t>& output) {
+    const uint16_t channels = m_Settings.Channels;
+    // Partial blocks are packed, see Finish.
+    const auto channelSamples = [&](uint16_t channel) { return m_Block.data() + channel * frames; };
+
+    uint8_t assignment = static_cast<uint8_t>(channels - 1);
+    Subframe* selected[MaxChannels] = {};
+
+    if (m_StereoMode == StereoMode::Independent) {
+        for (uint16_t channel = 0; channel < channels; ++channel) {
+            EncodeSubframe(channelSamples(channel), frames, m_BitsPerSample, m_Subframes[channel]);
+            selected[channel] = &m_Subframes[channel];
+        }
+    }
+    else {
+        const int32_t* left = channelSamples(0);
+        const int32_t* right = channelSamples(1);
+        for (size_t i = 0; i < frames; ++i) {
+            m_Mid[i] = (left[i] + right[i]) >> 1;
+            m_Side[i] = left[i] - right[i];
+        }
+
+        const int32_t* signals[4] = { left, right, m_Mid.data(), m_Side.data() };
+        const uint32_t bits[4] = { m_BitsPerSample, m_BitsPerSample, m_BitsPerSample, m_BitsPerSample + 1 };
+        // Channel pairs of independent, left/side, right/side and mid/side coding, in frame order.
+        constexpr int Pairs[4][2] = { { 0, 1 }, { 0, 3 }, { 3, 1 }, { 2, 3 } };
+        constexpr uint8_t Assignments[4] = { 1, LeftSide, RightSide, MidSide };
+
+        uint64_t sizes[4] = {};
+        if (m_StereoMode == StereoMode::Exhaustive) {
+            for (int k = 0; k < 4; ++k) {
+                EncodeSubframe(signals[k], frames, bits[k], m_Subframes[k]);
+                sizes[k] = m_Subframes[k].Bits;
+            }
+        }
+        else {
+            for (int k = 0; k < 4; ++k) {
+                sizes[k] = frames > 1 ? EstimateFixedBits(signals[k], frames, bits[k]) : bits[k];
+            }
+        }
+
+        int best = 0;
+        for (int pair = 1; pair < 4; ++pair) {
+            if (sizes[Pairs[pair][0]] + sizes[Pairs[pair][1]] < sizes[Pairs[best][0]] + sizes[Pairs[best][1]]) {
+                best = pair;
+            }
+        }
+
+        assignment = Assignments[best];
+        for (int k = 0; k < 2; ++k) {
+            const int index = Pairs[best][k];
+            if (m_StereoMode == StereoMode::Estimate) {
+                EncodeSubframe(signals[index], frames, bits[index], m_Subframes[index]);
+            }
+            selected[k] = &m_Subframes[index];
+        }
+    }
+
+    const size_t frameStart = output.size();
+
+    // Frame header: sync code with fixed block size, block size and sample rate codes, channel
+    // assignment, sample size, then the frame number in UTF-8 style coding.
+    const uint8_t blockSizeCode = GetBlockSizeCode(frames);
+    const uint8_t sampleRateCode = GetSampleRateCode(m_Settings.SampleRate);
+    output.push_back(0xFF);
+    output.push_back(0xF8);
+    output.push_back(static_cast<uint8_t>((blockSizeCode << 4) | sampleRateCode));
+    output.push_back(static_cast<uint8_t>((assignment << 4) | ((m_BitsPerSample == 16 ? 4 : 6) << 1)));
+
+    const uint32_t number = m_FrameNumber;
+    if (number < 0x80) {
+        output.push_back(static_cast<uint8_t>(number));
+    }
+    else {
+        const int length = number < 0x800 ? 2 : number < 0x10000 ? 3 : number < 0x200000 ? 4 : number < 0x4000000 ? 5 : 6;
+        output.push_back(static_cast<uint8_t>((0xFF00 >> length) | (number >> (6 * (length - 1)))));
+        for (int i = length - 2; i >= 0; --i) {
+            output.push_back(static_cast<uint8_t>(0x80 | ((number >> (6 * i)) & 0x3F)));
+        }
+    }
+
+    if (blockSizeCode == 6) {
+        output.push_back(static_cast<uint8_t>(frames - 1));
+    }
+    else if (blockSizeCode == 7) {
+        output.push_back(static_cast<uint8_t>((frames - 1) >> 8));
+        output.push_back(static_cast<uint8_t>(frames - 1));
+    }
+
+    if (sampleRateCode == 12) {
+        output.push_back(static_cast<uint8_t>(m_Settings.SampleRate / 1000));
+    }
+    else if (sampleRateCode == 13 || sampleRateCode == 14) {
+        const uint32_t value = sampleRateCode == 13 ? m_Settings.SampleRate : m_Settings.SampleRate / 10;
+        output.push_back(static_cast<uint8_t>(value >> 8));
+        output.push_back(static_cast<uint8_t>(value));
+    }
+    output.push_back(ComputeFlacCrc8(output.data() + frameStart, output.size() - frameStart));
+
+    BitWriter writer(output);
+    for (uint16_t channel = 0; channel < channels; ++channel) {
+        WriteSubframe(*selected[channel], frames, writer);
+    }
+    writer.Flush();
+
+    const uint16_t crc = ComputeFlacCrc16(output.data() + frameStart, output.size() - frameStart);
+    output.push_back(static_cast<uint8_t>(crc >> 8));
+    output.push_back(static_cast<uint8_t>(crc));
+
+    const auto frameSize = static_cast<uint32_t>(output.size() - frameStart);
+    m_MinFrameSize = m_MinFrameSize == 0 ? frameSize : (std::min)(m_MinFrameSize, frameSize);
+    m_MaxFrameSize = (std::max)(m_MaxFrameSize, frameSize);
+    m_EncodedFrames += frames;
+    ++m_FrameNumber;
+}
+
+void FlacEncoder::EncodeSubframe(const int32_t* signal, size_t frames, uint32_t bitsPerSample, Subframe& subframe) {
+    subframe.Signal = signal;
+    subframe.BitsPerSample = bitsPerSample;
+    subframe.WastedBits = 0;
+    subframe.Order = 0;
+
+    uint32_t allBits = 0;
+    bool constant = true;
+    for (size_t i = 0; i < frames; ++i) {
+        allBits |= static_cast<uint32_t>(signal[i]);
+        constant &= signal[i] == signal[0];
+    }
+    if (constant) {
+        subframe.Kind = Subframe::Type::Constant;
+        subframe.Bits = SubframeHeaderBits + bitsPerSample;
+        return;
+    }
+
+    // Low bits that are zero in every sample, e.g. 16 bit audio in a 24 bit stream, are signaled
+    // in the subframe header instead of being coded.
+    const auto wasted = static_cast<uint32_t>(std::countr_zero(allBits));
+    if (wasted > 0) {
+        subframe.Shifted.resize(frames);
+        for (size_t i = 0; i < frames; ++i) {
+            subframe.Shifted[i] = signal[i] >> wasted;
+        }
+        signal = subframe.Shifted.data();
+        bitsPerSample -= wasted;
+        subframe.Signal = signal;
+        subframe.BitsPerSample = bitsPerSample;
+        subframe.WastedBits = wasted;
+    }
+
+    const uint64_t headerBits = SubframeHeaderBits + wasted;
+    subframe.Kind = Subframe::Type::Verbatim;
+    subframe.Bits = headerBits + static_cast<uint64_t>(frames) * bitsPerSample;
+
+    const uint32_t maxFixedOrder = static_cast<uint32_t>((std::min)(static_cast<size_t>(MaxFixedOrder), frames - 1));
+    uint64_t sum = 0;
+    const uint32_t fixedOrder = EstimateFixedOrder(signal, frames, maxFixedOrder, sum);
+    GetKernels().FixedResidual(signal, frames, fixedOrder, m_TrialResidual.data());
+    const uint64_t fixedBits = headerBits + fixedOrder * bitsPerSample + ChooseRiceParameters(m_TrialResidual.data(), frames, fixedOrder, m_TrialRice);
+    if (fixedBits < subframe.Bits) {
+        subframe.Kind = Subframe::Type::Fixed;
+        subframe.Order = fixedOrder;
+        subframe.Bits = fixedBits;
+        subframe.Rice = m_TrialRice;
+        std::swap(subframe.Residual, m_TrialResidual);
+    }
+
+    if (m_MaxLpcOrder > 0 && frames > m_MaxLpcOrder) {
+        TryLpc(signal, frames, bitsPerSample, subframe);
+    }
+}
+
+void FlacEncoder::TryLpc(const int32_t* signal, size_t frames, uint32_t bitsPerSample, Subframe& subframe) {
+    if (m_Window.size() != frames) {
+        BuildWindow(m_Window, frames);
+    }
+    for (size_t i = 0; i < frames; ++i) {
+        m_Windowed[i] = signal[i] * m_Window[i];
+    }
+
+    const Kernels& kernels = GetKernels();
+    double autocorrelation[MaxLpcOrder + 1];
+    for (uint32_t lag = 0; lag <= m_MaxLpcOrder; ++lag) {
+        autocorrelation[lag] = kernels.Dot(m_Windowed.data() + lag, m_Windowed.data(), frames - lag);
+    }
+    if (autocorrelation[0] <= 0.0) {
+        return;
+    }
+
+    double coefficients[MaxLpcOrder][MaxLpcOrder] = {};
+    double errors[MaxLpcOrder] = {};
+    const uint32_t maxOrder = ComputeLpcCoefficients(autocorrelation, m_MaxLpcOrder, coefficients, errors);
+
+    uint32_t firstOrder = 1;
+    uint32_t lastOrder = maxOrder;
+    if (!m_ExhaustiveOrderSearch) {
+        firstOrder = lastOrder = EstimateLpcOrder(errors, maxOrder, frames, bitsPerSample, m_Precision);
+    }
+
+    const uint64_t headerBits = SubframeHeaderBits + subframe.WastedBits;
+    for (uint32_t order = firstOrder; order <= lastOrder; ++order) {
+        int32_t quantized[MaxLpcOrder];
+        int shift = 0;
+        if (!QuantizeCoefficients(coefficients[order - 1], order, m_Precision, quantized, shift)) {
+            continue;
+        }
+
+        if (CanUse32BitResidual(bitsPerSample, m_Precision, order)) {
+            kernels.LpcResidual(signal, frames, quantized, order, shift, m_TrialResidual.data());
+        }
+        else if (!LpcResidualWide(signal, frames, quantized, order, shift, m_TrialResidual.data())) {
+            continue;
+        }
+
+        // Warm-up samples, precision, shift and coefficients.
+        const uint64_t bits = headerBits + order * bitsPerSample + 4 + 5 + order * m_Precision +
+            ChooseRiceParameters(m_TrialResidual.data(), frames, order, m_TrialRice);
+        if (bits < subframe.Bits) {
+            subframe.Kind = Subframe::Type::Lpc;
+            subframe.Order = order;
+            subframe.Precision = m_Precision;
+            subframe.Shift = shift;
+            std::copy_n(quantized, order, subframe.Coefficients.begin());
+            subframe.Bits = bits;
+            subframe.Rice = m_TrialRice;
+            std::swap(subframe.Residual, m_TrialResidual);
+        }
+    }
+}
+
+uint64_t FlacEncoder::ChooseRiceParameters(const int32_t* residual, size_t frames, uint32_t order, RiceCoding& rice) {
+    // Partitions have to split the block evenly and the first one has to extend past the warm-up.
+    uint32_t maxPartitionOrder = m_MaxPartitionOrder;
+    while (maxPartitionOrder > 0 && ((frames & ((size_t{ 1 } << maxPartitionOrder) - 1)) != 0 || (frames >> maxPartitionOrder) <= order)) {
+        --maxPartitionOrder;
+    }
+
+    // Sums of the folded residuals of the finest partitioning, coarser ones are merged from it.
+    const size_t partitionSize = frames >> maxPartitionOrder;
+    const size_t partitions = size_t{ 1 } << maxPartitionOrder;
+    m_PartitionSums.resize(partitions);
+    size_t position = 0;
+    for (size_t partition = 0; partition < partitions; ++partition) {
+        const size_t end = (partition + 1) * partitionSize - order;
+        uint64_t sum = 0;
+        for (; position < end; ++position) {
+            sum += ZigZag(residual[position]);
+        }
+        m_PartitionSums[partition] = sum;
+    }
+
+    uint64_t bestBits = (std::numeric_limits<uint64_t>::max)();
+    for (int partitionOrder = static_cast<int>(maxPartitionOrder); partitionOrder >= 0; --partitionOrder) {
+        const size_t count = size_t{ 1 } << partitionOrder;
+        const size_t size = frames >> partitionOrder;
+
+        uint64_t bits = ResidualHeaderBits;
+        uint32_t maxParameter = 0;
+        uint8_t parameters[1 << MaxPartitionOrder];
+        for (size_t partition = 0; partition < count; ++partition) {
+            const uint64_t samples = partition == 0 ? size - order : size;
+            const uint64_t sum = m_PartitionSums[partition];
+            const uint32_t parameter = GetRiceParameter(sum, samples);
+            parameters[partition] = static_cast<uint8_t>(parameter);
+            maxParameter = (std::max)(maxParameter, parameter);
+            bits += GetRiceBits(sum, samples, parameter);
+        }
+        const bool wide = maxParameter > MaxNarrowRiceParameter;
+        bits += count * (wide ? 5 : 4);
+
+        if (bits < bestBits) {
+            bestBits = bits;
+            rice.PartitionOrder = static_cast<uint32_t>(partitionOrder);
+            rice.Wide = wide;
+            std::copy_n(parameters, count, rice.Parameters.begin());
+        }
+
+        for (size_t partition = 0; partition < count / 2; ++partition) {
+            m_PartitionSums[partition] = m_PartitionSums[2 * partition] + m_PartitionSums[2 * partition + 1];
+        }
+    }
+    return bestBits;
+}
+
+void FlacEncoder::WriteSubframe(const Subframe& subframe, size_t frames, BitWriter& writer) const {
+    const uint32_t bitsPerSample = subframe.BitsPerSample;
+    switch (subframe.Kind) {
+    case Subframe::Type::Constant:
+        writer.Write(0, 8);
+        writer.WriteSigned(subframe.Signal[0], bitsPerSample);
+        return;
+    case Subframe::Type::Verbatim:
+        writer.Write(1, 7);
+        break;
+    case Subframe::Type::Fixed:
+        writer.Write(0x08 | subframe.Order, 7);
+        break;
+    case Subframe::Type::Lpc:
+        writer.Write(0x20 | (subframe.Order - 1), 7);
+        break;
+    }
+
+    if (subframe.WastedBits > 0) {
+        writer.Write(1, 1);
+        writer.WriteUnary(subframe.WastedBits - 1);
+    }
+    else {
+        writer.Write(0, 1);
+    }
+
+    if (subframe.Kind == Subframe::Type::Verbatim) {
+        for (size_t i = 0; i < frames; ++i) {
+            writer.WriteSigned(subframe.Signal[i], bitsPerSample);
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < subframe.Order; ++i) {
+        writer.WriteSigned(subframe.Signal[i], bitsPerSample);
+    }
+    if (subframe.Kind == Subframe::Type::Lpc) {
+        writer.Write(subframe.Precision - 1, 4);
+        writer.WriteSigned(subframe.Shift, 5);
+        for (uint32_t i = 0; i < subframe.Order; ++i) {
+            writer.WriteSigned(subframe.Coefficients[i], subframe.Precision);
+        }
+    }
+
+    const RiceCoding& rice = subframe.Rice;
+    writer.Write(rice.Wide ? 1 : 0, 2);
+    writer.Write(rice.PartitionOrder, 4);
+
+    const size_t partitionSize = frames >> rice.PartitionOrder;
+    const uint32_t parameterBits = rice.Wide ? 5 : 4;
+    const int32_t* residual = subframe.Residual.data();
+    for (size_t partition = 0; partition < (size_t{ 1 } << rice.PartitionOrder); ++partition) {
+        const uint32_t parameter = rice.Parameters[partition];
+        writer.Write(parameter, parameterBits);
+
+        const size_t count = partition == 0 ? partitionSize - subframe.Order : partitionSize;
+        for (size_t i = 0; i < count; ++i) {
+            writer.WriteRice(ZigZag(residual[i]), parameter);
+        }
+        residual += count;
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SampleFormatConverter.h"
+
+struct FlacEncoderSettings {
+    uint32_t SampleRate = 0;
+    uint16_t Channels = 0;
+    // Int16 is encoded with 16 bits per sample, all other formats with 24: Int32 loses its 8 least
+    // significant bits and Float32 is rounded.
+    SampleFormat Format = SampleFormat::Int16;
+    // 0 (fastest) to MaxCompressionLevel (smallest), roughly the levels of the reference encoder.
+    int CompressionLevel = 5;
+    // Samples per channel in a frame, 0 uses the block size of the compression level. Multiples of
+    // 64 keep the finer Rice partitions available.
+    uint32_t BlockSize = 0;
+};
+
+// Streaming FLAC encoder. Interleaved PCM is buffered into fixed size blocks and every complete
+// block is encoded as one frame: the channels are decorrelated (left/side, right/side or mid/side
+// for stereo), each channel is predicted with a fixed polynomial or a quantized LPC filter and the
+// residual is Rice coded in adaptive partitions. Autocorrelation and residual computation use the
+// SSE2/AVX2 kernels picked from the CPU features.
+//
+// The caller owns the output: GetStreamHeader() goes first and is rewritten once Finish() knows the
+// final frame sizes and length. The MD5 signature of the stream is left unset.
+class FlacEncoder {
+public:
+    static constexpr int MaxCompressionLevel = 8;
+    static constexpr int DefaultCompressionLevel = 5;
+    // Limit of the format, more channels need a container with a channel layout.
+    static constexpr uint16_t MaxChannels = 8;
+    // "fLaC" marker and the STREAMINFO block.
+    static constexpr size_t StreamHeaderSize = 42;
+    static constexpr uint32_t MinBlockSize = 16;
+    static constexpr uint32_t MaxBlockSize = 65535;
+
+    // Returns false for settings FLAC cannot represent. Starts a new stream.
+    bool Configure(const FlacEncoderSettings& settings);
+
+    // Forgets buffered audio and the counters, the settings are kept.
+    void Reset();
+
+    // Encodes `frames` interleaved frames in the configured format. Complete FLAC frames are appended
+    // to `output`, the remainder of a block is kept until the next call.
+    void Encode(const void* data, size_t frames, std::vector<uint8_t>& output);
+
+    // Encodes whatever is buffered as a last, shorter frame.
+    void Finish(std::vector<uint8_t>& output);
+
+    // StreamHeaderSize bytes describing the stream encoded so far.
+    std::vector<uint8_t> GetStreamHeader() const;
+
+    const FlacEncoderSettings& GetSettings() const { return m_Settings; }
+    uint32_t GetBitsPerSample() const { return m_BitsPerSample; }
+    uint32_t GetBlockSize() const { return m_BlockSize; }
+    // Frames (samples per channel) encoded so far, excluding the buffered remainder.
+    uint64_t GetEncodedFrames() const { return m_EncodedFrames; }
+
+private:
+    class BitWriter;
+
+    static constexpr uint32_t MaxLpcOrder = 12;
+    static constexpr uint32_t MaxPartitionOrder = 6;
+
+    enum class StereoMode {
+        Independent,
+        // Picks the channel assignment from a fixed predictor estimate, only two channels are encoded.
+        Estimate,
+        // Encodes left, right, mid and side and keeps the smallest pair.
+        Exhaustive,
+    };
+
+    struct RiceCoding {
+        uint32_t PartitionOrder = 0;
+        // 5 bit parameters, needed above 14.
+        bool Wide = false;
+        std::array<uint8_t, 1 << MaxPartitionOrder> Parameters{};
+    };
+
+    struct Subframe {
+        enum class Type { Constant, Verbatim, Fixed, Lpc };
+
+        Type Kind = Type::Verbatim;
+        // Samples after removing the wasted bits, points either to the input or to Shifted.
+        const int32_t* Signal = nullptr;
+        std::vector<int32_t> Shifted;
+        uint32_t BitsPerSample = 0;
+        uint32_t WastedBits = 0;
+        uint32_t Order = 0;
+        uint32_t Precision = 0;
+        int Shift = 0;
+        std::array<int32_t, MaxLpcOrder> Coefficients{};
+        std::vector<int32_t> Residual;
+        RiceCoding Rice;
+        uint64_t Bits = 0;
+    };
+
+    void EncodeBlock(size_t frames, std::vector<uint8_t>& output);
+    void EncodeSubframe(const int32_t* signal, size_t frames, uint32_t bitsPerSample, Subframe& subframe);
+    void TryLpc(const int32_t* signal, size_t frames, uint32_t bitsPerSample, Subframe& subframe);
+    uint64_t ChooseRiceParameters(const int32_t* residual, size_t frames, uint32_t order, RiceCoding& rice);
+    void WriteSubframe(const Subframe& subframe, size_t frames, BitWriter& writer) const;
+
+    FlacEncoderSettings m_Settings;
+    uint32_t m_BitsPerSample = 0;
+    uint32_t m_BlockSize = 0;
+    uint32_t m_MaxLpcOrder = 0;
+    uint32_t m_MaxPartitionOrder = 0;
+    uint32_t m_Precision = 0;
+    StereoMode m_StereoMode = StereoMode::Independent;
+    bool m_ExhaustiveOrderSearch = false;
+
+    SampleFormatConverter m_Converter;
+    // Planar block being filled, m_BlockSize samples per channel.
+    std::vector<int32_t> m_Block;
+    size_t m_BufferedFrames = 0;
+
+    // Mid and side of a stereo block.
+    std::vector<int32_t> m_Mid;
+    std::vector<int32_t> m_Side;
+    std::vector<Subframe> m_Subframes;
+    std::vector<double> m_Window;
+    std::vector<double> m_Windowed;
+    std::vector<int32_t> m_TrialResidual;
+    RiceCoding m_TrialRice;
+    std::vector<uint64_t> m_PartitionSums;
+
+    uint64_t m_EncodedFrames = 0;
+    uint32_t m_FrameNumber = 0;
+    uint32_t m_MinFrameSize = 0;
+    uint32_t m_MaxFrameSize = 0;
+};
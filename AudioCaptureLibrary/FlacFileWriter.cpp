@@ -0,0 +1,169 @@
+#include "FlacFileWriter.h"
+
+#include <wil/result.h>
+#include <algorithm>
+#include <string>
+
+#include "Logger.h"
+
+FlacFileWriter::~FlacFileWriter() {
+    Close();
+}
+
+HRESULT FlacFileWriter::Open(const std::wstring& filePath, const AudioFormat& format, int compressionLevel, uint32_t journalSegmentMs) {
+    RETURN_HR_IF(E_INVALIDARG, !format.IsValid());
+    RETURN_HR_IF(E_NOT_VALID_STATE, m_Writer.IsOpen());
+
+    SampleFormat sampleFormat;
+    RETURN_HR_IF(E_INVALIDARG, !SampleFormatConverter::FromAudioFormat(format, sampleFormat));
+
+    FlacEncoderSettings settings;
+    settings.SampleRate = format.SampleRate;
+    settings.Channels = format.Channels;
+    settings.Format = sampleFormat;
+    settings.CompressionLevel = compressionLevel;
+    RETURN_HR_IF(E_INVALIDARG, !m_Encoder.Configure(settings));
+
+    RETURN_IF_FAILED(m_Writer.Open(filePath));
+
+    m_Format = format;
+    m_DataSize = 0;
+    m_FileSize = 0;
+    m_PartialFrame.clear();
+
+    // A sidecar left from an earlier recording of the same name would not match this one.
+    m_WaveformPath = WaveformPyramid::GetPath(filePath);
+    DeleteFileW(m_WaveformPath.c_str());
+    m_Waveform.Configure(format);
+
+    // Frame sizes and length are unknown until Close() rewrites the header.
+    m_Output = m_Encoder.GetStreamHeader();
+    RETURN_IF_FAILED(WriteOutput());
+
+    if (journalSegmentMs != 0) {
+        const UINT64 segmentSize = (std::max)(static_cast<UINT64>(m_Format.SampleRate) * journalSegmentMs / 1000, UINT64{ 1 }) *
+            m_Format.BytesPerFrame();
+        if (const HRESULT hr = m_Journal.Open(filePath, segmentSize, m_FileSize, m_Encoder.GetStreamHeader()); FAILED(hr)) {
+            Logger::GetInstance().Log("Failed to create recording journal, HRESULT = " + std::to_string(hr), LogLevel::Warning);
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT FlacFileWriter::Append(const BYTE* data, size_t dataSize) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_Writer.IsOpen());
+
+    const size_t frameSize = m_Format.BytesPerFrame();
+    m_DataSize += dataSize;
+    m_Waveform.Append(data, dataSize);
+
+    // Complete the frame left over from the previous call first.
+    if (!m_PartialFrame.empty()) {
+        const size_t count = (std::min)(frameSize - m_PartialFrame.size(), dataSize);
+        m_PartialFrame.insert(m_PartialFrame.end(), data, data + count);
+        data += count;
+        dataSize -= count;
+        if (m_PartialFrame.size() < frameSize) {
+            return S_OK;
+        }
+        m_Encoder.Encode(m_PartialFrame.data(), 1, m_Output);
+        m_PartialFrame.clear();
+    }
+
+    const size_t frames = dataSize / frameSize;
+    m_Encoder.Encode(data, frames, m_Output);
+    m_PartialFrame.assign(data + frames * frameSize, data + dataSize);
+
+    RETURN_IF_FAILED(WriteOutput());
+    if (m_Journal.IsSegmentDue(m_DataSize)) {
+        CommitSegment();
+    }
+
+    return S_OK;
+}
+
+HRESULT FlacFileWriter::AppendSilence(UINT64 frames) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_Writer.IsOpen());
+
+    const size_t frameSize = m_Format.BytesPerFrame();
+    m_PartialFrame.clear();
+    m_Waveform.AppendSilence(frames);
+
+    // Fed block by block so that neither the input nor the output grows with the run.
+    const std::vector<BYTE> zeros(static_cast<size_t>(m_Encoder.GetBlockSize()) * frameSize);
+    while (frames > 0) {
+        const size_t count = static_cast<size_t>((std::min)(frames, static_cast<UINT64>(m_Encoder.GetBlockSize())));
+        m_Encoder.Encode(zeros.data(), count, m_Output);
+        m_DataSize += count * frameSize;
+        frames -= count;
+        RETURN_IF_FAILED(WriteOutput());
+    }
+
+    if (m_Journal.IsSegmentDue(m_DataSize)) {
+        CommitSegment();
+    }
+
+    return S_OK;
+}
+
+HRESULT FlacFileWriter::Close() {
+    if (!m_Writer.IsOpen()) {
+        return S_OK;
+    }
+
+    auto closeFile = wil::scope_exit([&] { m_Writer.Close(); });
+
+    if (!m_PartialFrame.empty()) {
+        Logger::GetInstance().Log("FLAC recording ends with a partial frame, " + std::to_string(m_PartialFrame.size()) + " bytes dropped",
+            LogLevel::Warning);
+    }
+    m_Encoder.Finish(m_Output);
+    RETURN_IF_FAILED(WriteOutput());
+
+    // The journal covers the whole recording until it is deleted below.
+    if (m_Journal.IsOpen()) {
+        CommitSegment();
+    }
+
+    // Same size as the placeholder written by Open().
+    const auto header = m_Encoder.GetStreamHeader();
+    RETURN_IF_FAILED(m_Writer.WriteAt(0, header.data(), header.size()));
+
+    // A recording that failed to close keeps its journal for recovery.
+    RETURN_IF_FAILED(m_Writer.Close());
+
+    // The recording is complete without it, a missing sidecar only costs the fast overview.
+    if (m_Waveform.IsConfigured()) {
+        if (const HRESULT hr = m_Waveform.Save(m_WaveformPath); FAILED(hr)) {
+            Logger::GetInstance().Log("Failed to write waveform sidecar, HRESULT = " + std::to_string(hr), LogLevel::Warning);
+        }
+        m_Waveform.Clear();
+    }
+    return m_Journal.Discard();
+}
+
+HRESULT FlacFileWriter::WriteOutput() {
+    RETURN_IF_FAILED(m_Writer.Append(m_Output.data(), m_Output.size()));
+    if (m_Journal.IsOpen()) {
+        m_Journal.Update(m_Output.data(), m_Output.size());
+    }
+
+    m_FileSize += m_Output.size();
+    m_Output.clear();
+    return S_OK;
+}
+
+// Segments end after whole encoded frames, the header reports exactly the frames written so far.
+// Journal failures cost the recording its crash safety, not its data.
+void FlacFileWriter::CommitSegment() {
+    HRESULT hr = m_Writer.Submit();
+    if (SUCCEEDED(hr)) {
+        hr = m_Journal.Commit(m_DataSize, m_Encoder.GetStreamHeader(), m_FileSize);
+    }
+
+    if (FAILED(hr)) {
+        Logger::GetInstance().Log("Recording journal stopped, HRESULT = " + std::to_string(hr), LogLevel::Warning);
+        m_Journal.Discard();
+    }
+}
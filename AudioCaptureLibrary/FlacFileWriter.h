@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+#include "AsyncFileWriter.h"
+#include "AudioFormat.h"
+#include "FlacEncoder.h"
+#include "RecordingJournal.h"
+#include "WaveformPyramid.h"
+
+// Incremental FLAC writer with the same interface as WavFileWriter: PCM is encoded as it is
+// appended and the STREAMINFO block is patched on Close(). Appends of any size are accepted, a
+// partial frame is kept until the next call. Journal segments end on encoded FLAC frames.
+// Like WavFileWriter it leaves a waveform sidecar next to the file.
+class FlacFileWriter {
+public:
+    FlacFileWriter() = default;
+    ~FlacFileWriter();
+
+    FlacFileWriter(const FlacFileWriter&) = delete;
+    FlacFileWriter& operator=(const FlacFileWriter&) = delete;
+
+    // `journalSegmentMs` is the segment duration of the journal, 0 writes none.
+    HRESULT Open(const std::wstring& filePath, const AudioFormat& format, int compressionLevel = FlacEncoder::DefaultCompressionLevel,
+        uint32_t journalSegmentMs = 0);
+    HRESULT Append(const BYTE* data, size_t dataSize);
+    // Silence costs a constant subframe per channel and block.
+    HRESULT AppendSilence(UINT64 frames);
+    HRESULT Close();
+
+    const AudioFormat& GetFormat() const { return m_Format; }
+    UINT64 GetDataSize() const { return m_DataSize; }
+    UINT64 GetFileSize() const { return m_FileSize; }
+
+private:
+    HRESULT WriteOutput();
+    void CommitSegment();
+
+    AsyncFileWriter m_Writer;
+    RecordingJournal m_Journal;
+    WaveformPyramid m_Waveform;
+    std::wstring m_WaveformPath;
+    AudioFormat m_Format;
+    FlacEncoder m_Encoder;
+    std::vector<uint8_t> m_Output;
+    std::vector<uint8_t> m_PartialFrame;
+    UINT64 m_DataSize = 0;
+    UINT64 m_FileSize = 0;
+};
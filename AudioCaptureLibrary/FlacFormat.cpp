@@ -0,0 +1,47 @@
+#include "FlacFormat.h"
+
+#include <array>
+
+namespace {
+
+constexpr auto Crc8Table = [] {
+    std::array<uint8_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+        table[i] = static_cast<uint8_t>(crc);
+    }
+    return table;
+}();
+
+constexpr auto Crc16Table = [] {
+    std::array<uint16_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+        }
+        table[i] = static_cast<uint16_t>(crc);
+    }
+    return table;
+}();
+
+}
+
+uint8_t ComputeFlacCrc8(const uint8_t* data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = Crc8Table[crc ^ data[i]];
+    }
+    return crc;
+}
+
+uint16_t ComputeFlacCrc16(const uint8_t* data, size_t size) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = static_cast<uint16_t>((crc << 8) ^ Crc16Table[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pieces of the FLAC frame format shared by the encoder and the decoder.
+
+// Channel assignment codes of a frame header for the decorrelated stereo modes. Codes below
+// LeftSide are the channel count minus one.
+enum FlacChannelAssignment : uint8_t {
+    LeftSide = 8,
+    RightSide = 9,
+    MidSide = 10,
+};
+
+// CRC-8 (polynomial 0x07) protecting a frame header.
+uint8_t ComputeFlacCrc8(const uint8_t* data, size_t size);
+
+// CRC-16 (polynomial 0x8005) protecting a whole frame.
+uint16_t ComputeFlacCrc16(const uint8_t* data, size_t size);
@@ -0,0 +1,130 @@
+#include "ImaAdpcmCodec.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int MaxStepIndex = 88;
+
+constexpr int16_t StepTable[MaxStepIndex + 1] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060,
+    1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+constexpr int IndexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+struct ChannelState {
+    int Predictor;
+    int StepIndex;
+};
+
+// Applies one code to the state, shared by encoder and decoder so both track the same predictor.
+inline void Apply(ChannelState& state, uint8_t code) {
+    const int step = StepTable[state.StepIndex];
+    int delta = step >> 3;
+    if (code & 4) {
+        delta += step;
+    }
+    if (code & 2) {
+        delta += step >> 1;
+    }
+    if (code & 1) {
+        delta += step >> 2;
+    }
+
+    state.Predictor = std::clamp(state.Predictor + ((code & 8) ? -delta : delta), -32768, 32767);
+    state.StepIndex = std::clamp(state.StepIndex + IndexTable[code], 0, MaxStepIndex);
+}
+
+inline uint8_t Quantize(const ChannelState& state, int sample) {
+    const int step = StepTable[state.StepIndex];
+    int difference = sample - state.Predictor;
+    uint8_t code = 0;
+    if (difference < 0) {
+        code = 8;
+        difference = -difference;
+    }
+    if (difference >= step) {
+        code |= 4;
+        difference -= step;
+    }
+    if (difference >= step >> 1) {
+        code |= 2;
+        difference -= step >> 1;
+    }
+    if (difference >= step >> 2) {
+        code |= 1;
+    }
+    return code;
+}
+
+}
+
+bool ImaAdpcmCodec::Configure(uint16_t channels) {
+    if (channels == 0) {
+        return false;
+    }
+
+    m_Channels = channels;
+    m_StepIndices.assign(channels, 0);
+    return true;
+}
+
+void ImaAdpcmCodec::Reset() {
+    std::fill(m_StepIndices.begin(), m_StepIndices.end(), uint8_t{ 0 });
+}
+
+void ImaAdpcmCodec::Encode(const int16_t* samples, size_t frames, std::vector<uint8_t>& output) {
+    if (m_Channels == 0 || frames == 0) {
+        return;
+    }
+
+    const uint16_t channels = m_Channels;
+    const size_t dataSize = frames / 2;
+    const size_t start = output.size();
+    output.resize(start + GetBlockSize(frames, channels), 0);
+
+    for (uint16_t channel = 0; channel < channels; ++channel) {
+        uint8_t* header = output.data() + start + channel * ChannelHeaderSize;
+        const int16_t first = samples[channel];
+        header[0] = static_cast<uint8_t>(first);
+        header[1] = static_cast<uint8_t>(static_cast<uint16_t>(first) >> 8);
+        header[2] = m_StepIndices[channel];
+
+        ChannelState state = { first, m_StepIndices[channel] };
+        uint8_t* data = output.data() + start + channels * ChannelHeaderSize + channel * dataSize;
+        for (size_t frame = 1; frame < frames; ++frame) {
+            const uint8_t code = Quantize(state, samples[frame * channels + channel]);
+            Apply(state, code);
+            data[(frame - 1) / 2] |= static_cast<uint8_t>(frame % 2 == 1 ? code : code << 4);
+        }
+        m_StepIndices[channel] = static_cast<uint8_t>(state.StepIndex);
+    }
+}
+
+bool ImaAdpcmCodec::Decode(const uint8_t* data, size_t size, uint16_t channels, size_t frames, int16_t* samples) {
+    if (channels == 0 || frames == 0 || size != GetBlockSize(frames, channels)) {
+        return false;
+    }
+
+    const size_t dataSize = frames / 2;
+    for (uint16_t channel = 0; channel < channels; ++channel) {
+        const uint8_t* header = data + channel * ChannelHeaderSize;
+        if (header[2] > MaxStepIndex || header[3] != 0) {
+            return false;
+        }
+
+        ChannelState state = { static_cast<int16_t>(header[0] | (header[1] << 8)), header[2] };
+        samples[channel] = static_cast<int16_t>(state.Predictor);
+
+        const uint8_t* codes = data + channels * ChannelHeaderSize + channel * dataSize;
+        for (size_t frame = 1; frame < frames; ++frame) {
+            const uint8_t byte = codes[(frame - 1) / 2];
+            Apply(state, frame % 2 == 1 ? byte & 0x0F : byte >> 4);
+            samples[frame * channels + channel] = static_cast<int16_t>(state.Predictor);
+        }
+    }
+    return true;
+}
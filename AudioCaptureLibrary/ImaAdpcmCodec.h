@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// IMA ADPCM coding of 16 bit PCM at 4 bits per sample, in blocks that decode on their own.
+//
+// A block starts with one header per channel (first sample as little-endian int16, step index and
+// a zero byte) followed by the remaining samples of each channel as nibbles, low nibble first. The
+// encoder carries the step index over from the previous block, so the adaptation does not restart
+// at every block, but nothing else links two blocks.
+class ImaAdpcmCodec {
+public:
+    static constexpr size_t ChannelHeaderSize = 4;
+
+    bool Configure(uint16_t channels);
+
+    // Forgets the step indices carried between blocks.
+    void Reset();
+
+    static size_t GetBlockSize(size_t frames, uint16_t channels) { return channels * (ChannelHeaderSize + frames / 2); }
+
+    // Encodes `frames` interleaved frames (at least one) as one block appended to `output`.
+    void Encode(const int16_t* samples, size_t frames, std::vector<uint8_t>& output);
+
+    // Decodes a block of `frames` frames into interleaved samples. Returns false if the size does
+    // not match or a header is damaged.
+    static bool Decode(const uint8_t* data, size_t size, uint16_t channels, size_t frames, int16_t* samples);
+
+private:
+    uint16_t m_Channels = 0;
+    std::vector<uint8_t> m_StepIndices;
+};
@@ -7,21 +7,22 @@
 #include "InputAudioDeviceManager.h"
 #include "Logger.h"
 
-InputAudioDeviceManager::InputAudioDeviceManager() = default;
+InputAudioDeviceManager::InputAudioDeviceManager() : AudioDeviceManagerBase(eCapture) {}
 
 InputAudioDeviceManager::~InputAudioDeviceManager() = default;
 
 std::vector<InputAudioDeviceInfo> InputAudioDeviceManager::GetActiveInputDevices() {
     std::vector<InputAudioDeviceInfo> inputDevices;
+    WatchDevices();
 
-    for (auto& device : GetActiveDevices(eCapture)) {
-        auto deviceInfo = GetDeviceInfo(device);
-        if (!deviceInfo.has_value()) {
+    for (const auto& deviceId : m_Cache.GetDevices(DeviceFlow::Capture)) {
+        auto entry = m_Cache.GetDevice(deviceId);
+        if (!entry) {
             continue;
         }
 
         InputAudioDeviceInfo inputInfo;
-        inputInfo.DeviceInfo = deviceInfo.value();
+        inputInfo.DeviceInfo = ToDeviceInfo(*entry);
 
         inputDevices.push_back(inputInfo);
     }
@@ -30,8 +31,7 @@ std::vector<InputAudioDeviceInfo> InputAudioDeviceManager::GetActiveInputDevices
 }
 
 std::optional<InputAudioDeviceInfo> InputAudioDeviceManager::GetInputDeviceInfo(const std::wstring& deviceId) {
-    auto device = GetDevice(deviceId);
-    auto deviceInfo = GetDeviceInfo(device);
+    auto deviceInfo = GetDeviceInfo(deviceId);
 
     if (!deviceInfo.has_value())
         return std::nullopt;
@@ -0,0 +1,330 @@
+#include "InstantReplayBuffer.h"
+
+#include <wil/result.h>
+#include <algorithm>
+#include <cstring>
+
+#include "Logger.h"
+#include "WavFileWriter.h"
+
+InstantReplayBuffer::InstantReplayBuffer(const AudioFormat& format, uint32_t durationSeconds, const std::wstring& backingDirectory)
+    : m_Format(format),
+      m_BytesPerFrame(format.BytesPerFrame()),
+      m_Storage(backingDirectory),
+      m_DurationSeconds(durationSeconds),
+      m_PartialFrame(format.BytesPerFrame()) {
+    AllocateStorage(static_cast<uint64_t>(durationSeconds + GuardSeconds) * m_Format.SampleRate);
+
+    m_Waveform.Configure(format);
+    m_Waveform.SetCapacity(m_CapacityFrames);
+}
+
+void InstantReplayBuffer::AllocateStorage(uint64_t capacityFrames) {
+    m_CapacityFrames = m_Storage.Resize(static_cast<size_t>(capacityFrames * m_BytesPerFrame)) ? capacityFrames : 0;
+    if (m_CapacityFrames == 0 && capacityFrames > 0) {
+        Logger::GetInstance().Log("Failed to allocate instant replay buffer", LogLevel::Error);
+    }
+
+    if (auto* header = m_Storage.GetFileHeader()) {
+        memcpy(header->Magic, ReplayFileMagic, sizeof(header->Magic));
+        header->Version = ReplayFileVersion;
+        header->SampleRate = m_Format.SampleRate;
+        header->Channels = m_Format.Channels;
+        header->BitsPerSample = m_Format.BitsPerSample;
+        header->CapacityFrames = m_CapacityFrames;
+        header->WrittenFrames = m_WrittenFrames.load(std::memory_order_relaxed);
+    }
+}
+
+void InstantReplayBuffer::Append(const uint8_t* data, size_t size) {
+    if (m_BytesPerFrame == 0 || size == 0) {
+        return;
+    }
+
+    std::lock_guard lock(m_WriterMutex);
+    ApplyPendingResize();
+    {
+        std::lock_guard waveformLock(m_WaveformMutex);
+        m_Waveform.Append(data, size);
+    }
+
+    if (m_PartialFrameSize > 0) {
+        const size_t needed = std::min(m_BytesPerFrame - m_PartialFrameSize, size);
+        memcpy(m_PartialFrame.data() + m_PartialFrameSize, data, needed);
+        m_PartialFrameSize += needed;
+        data += needed;
+        size -= needed;
+
+        if (m_PartialFrameSize < m_BytesPerFrame) {
+            return;
+        }
+
+        WriteFrames(m_PartialFrame.data(), 1);
+        m_PartialFrameSize = 0;
+    }
+
+    const uint64_t frames = size / m_BytesPerFrame;
+    WriteFrames(data, frames);
+
+    const size_t remainder = size - static_cast<size_t>(frames * m_BytesPerFrame);
+    if (remainder > 0) {
+        memcpy(m_PartialFrame.data(), data + (size - remainder), remainder);
+        m_PartialFrameSize = remainder;
+    }
+}
+
+void InstantReplayBuffer::AppendSilence(uint64_t frames) {
+    if (m_BytesPerFrame == 0 || frames == 0) {
+        return;
+    }
+
+    std::lock_guard lock(m_WriterMutex);
+    ApplyPendingResize();
+
+    // Records start on frame boundaries, a partial frame here means the stream lost bytes before.
+    m_PartialFrameSize = 0;
+    WriteFrames(nullptr, frames);
+
+    std::lock_guard waveformLock(m_WaveformMutex);
+    m_Waveform.AppendSilence(frames);
+}
+
+void InstantReplayBuffer::WriteFrames(const uint8_t* data, uint64_t frames) {
+    if (frames == 0 || m_CapacityFrames == 0) {
+        return;
+    }
+
+    // Only the newest m_CapacityFrames of an oversized block can survive anyway.
+    if (frames > m_CapacityFrames) {
+        if (data) {
+            data += (frames - m_CapacityFrames) * m_BytesPerFrame;
+        }
+        m_WrittenFrames.fetch_add(frames - m_CapacityFrames, std::memory_order_relaxed);
+        frames = m_CapacityFrames;
+    }
+
+    const uint64_t written = m_WrittenFrames.load(std::memory_order_relaxed);
+
+    // Announce the frames about to be overwritten before touching them, readers validate against this.
+    m_ReservedFrames.store(written + frames, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const uint64_t index = written % m_CapacityFrames;
+    const uint64_t firstPart = std::min(frames, m_CapacityFrames - index);
+
+    if (data) {
+        memcpy(m_Storage.GetData() + index * m_BytesPerFrame, data, static_cast<size_t>(firstPart * m_BytesPerFrame));
+        if (firstPart < frames) {
+            memcpy(m_Storage.GetData(), data + firstPart * m_BytesPerFrame, static_cast<size_t>((frames - firstPart) * m_BytesPerFrame));
+        }
+    }
+    else {
+        memset(m_Storage.GetData() + index * m_BytesPerFrame, 0, static_cast<size_t>(firstPart * m_BytesPerFrame));
+        if (firstPart < frames) {
+            memset(m_Storage.GetData(), 0, static_cast<size_t>((frames - firstPart) * m_BytesPerFrame));
+        }
+    }
+
+    m_WrittenFrames.store(written + frames, std::memory_order_release);
+
+    if (auto* header = m_Storage.GetFileHeader()) {
+        header->WrittenFrames = written + frames;
+    }
+}
+
+void InstantReplayBuffer::Resize(uint32_t durationSeconds) {
+    // A save holds the storage shared for as long as it writes the file. Rather than waiting for it
+    // the new window is left pending and the writer picks it up once the save is done.
+    std::lock_guard writerLock(m_WriterMutex);
+    m_PendingDurationSeconds = durationSeconds;
+    ApplyPendingResize();
+}
+
+void InstantReplayBuffer::ApplyPendingResize() {
+    if (!m_PendingDurationSeconds) {
+        return;
+    }
+
+    std::unique_lock storageLock(m_StorageMutex, std::try_to_lock);
+    if (!storageLock.owns_lock()) {
+        return;
+    }
+
+    const uint32_t durationSeconds = *m_PendingDurationSeconds;
+    m_PendingDurationSeconds.reset();
+
+    const uint64_t newCapacity = static_cast<uint64_t>(durationSeconds + GuardSeconds) * m_Format.SampleRate;
+    const uint64_t written = m_WrittenFrames.load(std::memory_order_relaxed);
+    uint64_t valid = std::min(written, m_CapacityFrames);
+
+    uint8_t* storage = m_Storage.GetData();
+
+    // Linearize the ring so that the oldest frame is at the start of the storage.
+    if (written > m_CapacityFrames) {
+        const uint64_t oldest = written % m_CapacityFrames;
+        std::rotate(storage, storage + oldest * m_BytesPerFrame, storage + m_CapacityFrames * m_BytesPerFrame);
+    }
+
+    // Keep the newest frames when the window shrinks.
+    if (valid > newCapacity) {
+        memmove(storage, storage + (valid - newCapacity) * m_BytesPerFrame,
+            static_cast<size_t>(newCapacity * m_BytesPerFrame));
+        valid = newCapacity;
+    }
+
+    m_ReservedFrames.store(valid, std::memory_order_relaxed);
+    m_WrittenFrames.store(valid, std::memory_order_release);
+
+    AllocateStorage(newCapacity);
+    m_DurationSeconds = durationSeconds;
+
+    std::lock_guard waveformLock(m_WaveformMutex);
+    m_Waveform.SetCapacity(m_CapacityFrames);
+
+    if (m_CapacityFrames == 0) {
+        m_ReservedFrames.store(0, std::memory_order_relaxed);
+        m_WrittenFrames.store(0, std::memory_order_release);
+        m_Waveform.Clear();
+    }
+}
+
+void InstantReplayBuffer::Clear() {
+    std::unique_lock storageLock(m_StorageMutex);
+    std::lock_guard writerLock(m_WriterMutex);
+
+    m_PartialFrameSize = 0;
+    m_ReservedFrames.store(0, std::memory_order_relaxed);
+    m_WrittenFrames.store(0, std::memory_order_release);
+
+    if (auto* header = m_Storage.GetFileHeader()) {
+        header->WrittenFrames = 0;
+    }
+
+    std::lock_guard waveformLock(m_WaveformMutex);
+    m_Waveform.Clear();
+}
+
+uint64_t InstantReplayBuffer::GetSnapshotFrames(uint32_t seconds, uint64_t written) const {
+    const uint64_t guardFrames = static_cast<uint64_t>(GuardSeconds) * m_Format.SampleRate;
+    const uint64_t maxFrames = m_CapacityFrames > guardFrames ? m_CapacityFrames - guardFrames : 0;
+    const uint64_t requested = static_cast<uint64_t>(seconds) * m_Format.SampleRate;
+
+    return std::min({ requested, written, maxFrames });
+}
+
+size_t InstantReplayBuffer::GetWaveform(uint32_t seconds, uint32_t level, WaveformBin* bins, size_t capacity) const {
+    // Limited to the window like a snapshot, the pyramid clamps it to what it has seen.
+    const uint64_t frames = GetSnapshotFrames(seconds, UINT64_MAX);
+
+    std::lock_guard waveformLock(m_WaveformMutex);
+    return m_Waveform.GetLastBins(level, frames, bins, capacity);
+}
+
+ReplaySnapshot InstantReplayBuffer::Snapshot(uint32_t seconds) const {
+    ReplaySnapshot snapshot = {};
+    if (m_CapacityFrames == 0) {
+        return snapshot;
+    }
+
+    const uint64_t written = m_WrittenFrames.load(std::memory_order_acquire);
+    const uint64_t frames = GetSnapshotFrames(seconds, written);
+
+    snapshot.StartFrame = written - frames;
+    snapshot.FrameCount = frames;
+
+    const uint64_t index = snapshot.StartFrame % m_CapacityFrames;
+    const uint64_t firstPart = std::min(frames, m_CapacityFrames - index);
+
+    snapshot.Spans[0] = { m_Storage.GetData() + index * m_BytesPerFrame, static_cast<size_t>(firstPart * m_BytesPerFrame) };
+    snapshot.Spans[1] = { m_Storage.GetData(), static_cast<size_t>((frames - firstPart) * m_BytesPerFrame) };
+
+    return snapshot;
+}
+
+bool InstantReplayBuffer::IsIntact(uint64_t startFrame) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t reserved = m_ReservedFrames.load(std::memory_order_relaxed);
+
+    return reserved <= startFrame + m_CapacityFrames;
+}
+
+size_t InstantReplayBuffer::GetSnapshotSize(uint32_t seconds) const {
+    SnapshotLock lock(*this);
+    return static_cast<size_t>(GetSnapshotFrames(seconds, m_WrittenFrames.load(std::memory_order_acquire)) * m_BytesPerFrame);
+}
+
+size_t InstantReplayBuffer::CopySnapshot(uint32_t seconds, uint8_t* dest, size_t destSize) const {
+    SnapshotLock lock(*this);
+
+    ReplaySnapshot snapshot = Snapshot(seconds);
+
+    // When the caller's buffer is smaller than the window keep the newest frames.
+    const uint64_t destFrames = destSize / m_BytesPerFrame;
+    if (snapshot.FrameCount > destFrames) {
+        const size_t skip = static_cast<size_t>((snapshot.FrameCount - destFrames) * m_BytesPerFrame);
+        if (skip >= snapshot.Spans[0].Size) {
+            snapshot.Spans[1].Data += skip - snapshot.Spans[0].Size;
+            snapshot.Spans[1].Size -= skip - snapshot.Spans[0].Size;
+            snapshot.Spans[0] = snapshot.Spans[1];
+            snapshot.Spans[1] = { nullptr, 0 };
+        }
+        else {
+            snapshot.Spans[0].Data += skip;
+            snapshot.Spans[0].Size -= skip;
+        }
+        snapshot.StartFrame += snapshot.FrameCount - destFrames;
+        snapshot.FrameCount = destFrames;
+    }
+
+    size_t copied = 0;
+    for (const auto& span : snapshot.Spans) {
+        if (span.Size > 0) {
+            memcpy(dest + copied, span.Data, span.Size);
+            copied += span.Size;
+        }
+    }
+
+    return IsIntact(snapshot.StartFrame) ? copied : 0;
+}
+
+HRESULT InstantReplayBuffer::SaveToWav(uint32_t seconds, const std::wstring& filePath) const {
+    WavFileWriter writer;
+    RETURN_IF_FAILED(writer.Open(filePath, m_Format));
+
+    // The spans are written straight from the ring. Capture keeps running, the writer only has to
+    // stay ahead of it, which is checked after every chunk.
+    const size_t chunkSize = 1024 * 1024;
+
+    SnapshotLock lock(*this);
+    const auto snapshot = Snapshot(seconds);
+
+    // Parts of a file-backed window may have been written out, fault them back in ahead of the
+    // copy rather than page by page.
+    if (m_Storage.IsFileBacked()) {
+        WIN32_MEMORY_RANGE_ENTRY ranges[2] = {};
+        ULONG count = 0;
+        for (const auto& span : snapshot.Spans) {
+            if (span.Size > 0) {
+                ranges[count++] = { const_cast<uint8_t*>(span.Data), span.Size };
+            }
+        }
+        PrefetchVirtualMemory(GetCurrentProcess(), count, ranges, 0);
+    }
+
+    uint64_t offset = 0;
+    for (const auto& span : snapshot.Spans) {
+        for (size_t position = 0; position < span.Size; position += chunkSize) {
+            const size_t size = (std::min)(chunkSize, span.Size - position);
+            RETURN_IF_FAILED(writer.Append(span.Data + position, size));
+
+            if (!IsIntact(snapshot.StartFrame + offset / m_BytesPerFrame)) {
+                writer.Close();
+                return HRESULT_FROM_WIN32(ERROR_OPERATION_ABORTED);
+            }
+
+            offset += size;
+        }
+    }
+
+    return writer.Close();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "ReplayStorage.h"
+#include "WaveformPyramid.h"
+
+struct ReplaySpan {
+    const uint8_t* Data;
+    size_t Size;
+};
+
+// The last N seconds of a replay buffer, oldest frame first, as at most two contiguous spans.
+struct ReplaySnapshot {
+    ReplaySpan Spans[2];
+    uint64_t StartFrame;
+    uint64_t FrameCount;
+};
+
+// Frame-granular circular buffer holding the instant replay window of one capture source.
+//
+// Append() is lock-free with respect to readers: exporting a snapshot never blocks capture.
+// A reader takes a SnapshotLock (shared), reads the spans and then checks IsIntact() with the
+// first frame it still relies on to make sure the writer did not lap it. The buffer keeps GuardSeconds of slack beyond the requested
+// duration so that this only happens if a save stalls for longer than that.
+//
+// Given a backing directory, hour-scale windows are kept in a memory-mapped file (see ReplayStorage)
+// rather than in committed memory; the API is the same either way.
+class InstantReplayBuffer {
+public:
+    static constexpr uint32_t GuardSeconds = 1;
+
+    class SnapshotLock {
+    public:
+        explicit SnapshotLock(const InstantReplayBuffer& buffer) : m_Lock(buffer.m_StorageMutex) {}
+    private:
+        std::shared_lock<std::shared_mutex> m_Lock;
+    };
+
+    InstantReplayBuffer(const AudioFormat& format, uint32_t durationSeconds, const std::wstring& backingDirectory = {});
+
+    InstantReplayBuffer(const InstantReplayBuffer&) = delete;
+    InstantReplayBuffer& operator=(const InstantReplayBuffer&) = delete;
+
+    // Accepts an arbitrary byte stream, partial frames are carried over to the next call.
+    void Append(const uint8_t* data, size_t size);
+    // Appends `frames` frames of digital silence, as a silence record of the stream describes them.
+    void AppendSilence(uint64_t frames);
+
+    // Changes the window length keeping the newest frames, reusing the storage when shrinking.
+    // Never waits for a save in progress: the change then takes effect with the first append after it.
+    void Resize(uint32_t durationSeconds);
+    void Clear();
+
+    // Must be called with a SnapshotLock held for as long as the spans are used.
+    ReplaySnapshot Snapshot(uint32_t seconds) const;
+    bool IsIntact(uint64_t startFrame) const;
+
+    // Copies the newest frames of the last `seconds` into dest, returns the number of bytes copied.
+    size_t CopySnapshot(uint32_t seconds, uint8_t* dest, size_t destSize) const;
+    size_t GetSnapshotSize(uint32_t seconds) const;
+
+    // Writes the last `seconds` straight from the ring to a WAV file while capture keeps running.
+    // Fails with ERROR_OPERATION_ABORTED if capture overtook the save.
+    HRESULT SaveToWav(uint32_t seconds, const std::wstring& filePath) const;
+
+    // Waveform bins of `level` (see WaveformPyramid) covering the last `seconds`, oldest first.
+    // Returns the number of bins, which may be larger than `capacity`.
+    size_t GetWaveform(uint32_t seconds, uint32_t level, WaveformBin* bins, size_t capacity) const;
+
+    // False if the storage for the window could not be allocated.
+    bool IsValid() const { return m_CapacityFrames == 0 || m_Storage.GetSize() > 0; }
+    bool IsFileBacked() const { return m_Storage.IsFileBacked(); }
+
+    const AudioFormat& GetFormat() const { return m_Format; }
+    uint32_t GetDurationSeconds() const { return m_DurationSeconds; }
+
+private:
+    // Null `data` writes zeros.
+    void WriteFrames(const uint8_t* data, uint64_t frames);
+    uint64_t GetSnapshotFrames(uint32_t seconds, uint64_t written) const;
+    void AllocateStorage(uint64_t capacityFrames);
+    // Called with m_WriterMutex held, does nothing while a reader holds the storage.
+    void ApplyPendingResize();
+
+    const AudioFormat m_Format;
+    const uint32_t m_BytesPerFrame;
+
+    mutable std::shared_mutex m_StorageMutex;
+    std::mutex m_WriterMutex;
+
+    ReplayStorage m_Storage;
+    uint64_t m_CapacityFrames = 0;
+    uint32_t m_DurationSeconds = 0;
+    // Guarded by m_WriterMutex.
+    std::optional<uint32_t> m_PendingDurationSeconds;
+
+    std::atomic<uint64_t> m_ReservedFrames{ 0 };
+    std::atomic<uint64_t> m_WrittenFrames{ 0 };
+
+    std::vector<uint8_t> m_PartialFrame;
+    size_t m_PartialFrameSize = 0;
+
+    // Follows the window as it slides, so drawing it never reads the audio.
+    mutable std::mutex m_WaveformMutex;
+    WaveformPyramid m_Waveform;
+};
@@ -0,0 +1,81 @@
+#include "IocpIoBackend.h"
+
+#include <wil/result.h>
+#include <string>
+
+#include "Logger.h"
+
+AsyncIoBackend& AsyncIoBackend::GetDefault() {
+    // Never destroyed, see CaptureScheduler::GetInstance.
+    static IocpIoBackend* instance = new IocpIoBackend();
+    return *instance;
+}
+
+HRESULT IocpIoBackend::Attach(HANDLE file) {
+    std::lock_guard lock(m_Lock);
+
+    if (!m_Port) {
+        m_Port.reset(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1));
+        RETURN_LAST_ERROR_IF(!m_Port);
+    }
+    RETURN_LAST_ERROR_IF(CreateIoCompletionPort(file, m_Port.get(), CompletionKey, 0) != m_Port.get());
+
+    if (m_Users++ == 0) {
+        m_Thread = std::thread(&IocpIoBackend::ThreadProc, this);
+    }
+    return S_OK;
+}
+
+void IocpIoBackend::Detach() {
+    std::lock_guard lock(m_Lock);
+
+    if (--m_Users == 0) {
+        PostQueuedCompletionStatus(m_Port.get(), 0, StopKey, nullptr);
+        m_Thread.join();
+    }
+}
+
+bool IocpIoBackend::Submit(AsyncIoRequest& request) {
+    return PostQueuedCompletionStatus(m_Port.get(), 0, SubmitKey, &request.Overlapped) != FALSE;
+}
+
+void IocpIoBackend::ThreadProc() {
+    for (;;) {
+        DWORD bytes = 0;
+        ULONG_PTR key = 0;
+        OVERLAPPED* overlapped = nullptr;
+        const BOOL succeeded = GetQueuedCompletionStatus(m_Port.get(), &bytes, &key, &overlapped, INFINITE);
+        const DWORD error = succeeded ? ERROR_SUCCESS : GetLastError();
+
+        if (!overlapped) {
+            if (key == StopKey) {
+                break;
+            }
+
+            Logger::GetInstance().Log("Disk writer wait failed, error " + std::to_string(error), LogLevel::Error);
+            continue;
+        }
+
+        auto& request = *CONTAINING_RECORD(overlapped, AsyncIoRequest, Overlapped);
+        if (key == SubmitKey) {
+            request.Owner->PrepareWrite(request);
+            Issue(request);
+        }
+        else {
+            request.Owner->CompleteWrite(request, error == ERROR_SUCCESS && bytes != request.Size ? ERROR_WRITE_FAULT : error);
+        }
+    }
+}
+
+void IocpIoBackend::Issue(AsyncIoRequest& request) {
+    request.Overlapped = {};
+    request.Overlapped.Offset = static_cast<DWORD>(request.Offset);
+    request.Overlapped.OffsetHigh = static_cast<DWORD>(request.Offset >> 32);
+    if (!WriteFile(request.File, request.Data, static_cast<DWORD>(request.Size), nullptr, &request.Overlapped)) {
+        const DWORD error = GetLastError();
+        if (error != ERROR_IO_PENDING) {
+            // No completion is queued for a write that failed right away.
+            request.Owner->CompleteWrite(request, error);
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+#include "AsyncIoBackend.h"
+
+// AsyncIoBackend on one I/O completion port. Submitted requests are posted to the port as
+// completion packets too, so the thread only ever waits on the port: it issues a posted request
+// as an overlapped WriteFile and hands its completion back to the target.
+class IocpIoBackend : public AsyncIoBackend {
+public:
+    HRESULT Attach(HANDLE file) override;
+    void Detach() override;
+    bool Submit(AsyncIoRequest& request) override;
+
+private:
+    static constexpr ULONG_PTR CompletionKey = 1;
+    static constexpr ULONG_PTR SubmitKey = 2;
+    static constexpr ULONG_PTR StopKey = 3;
+
+    void ThreadProc();
+    static void Issue(AsyncIoRequest& request);
+
+    std::mutex m_Lock;
+    size_t m_Users = 0;
+    wil::unique_handle m_Port;
+    std::thread m_Thread;
+};
@@ -0,0 +1,91 @@
+#include "LatencyHistogram.h"
+
+#include <bit>
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SubBuckets) {
+        return static_cast<size_t>(value);
+    }
+
+    // Position of the leading bit selects the power of two, the SubBucketBits below it the step.
+    const int exponent = 63 - std::countl_zero(value);
+    const int shift = exponent - SubBucketBits;
+    const size_t step = static_cast<size_t>(value >> shift) & (SubBuckets - 1);
+    return static_cast<size_t>(shift + 1) * SubBuckets + step;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket) {
+    if (bucket < SubBuckets) {
+        return bucket;
+    }
+
+    const int shift = static_cast<int>(bucket / SubBuckets) - 1;
+    const uint64_t step = bucket % SubBuckets;
+    const uint64_t lower = (SubBuckets + step) << shift;
+    return lower + ((uint64_t{ 1 } << shift) - 1);
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    m_Buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_Count.fetch_add(1, std::memory_order_relaxed);
+    m_Sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = m_Max.load(std::memory_order_relaxed);
+    while (value > max && !m_Max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t bucket = 0; bucket < BucketCount; ++bucket) {
+        if (const uint64_t count = other.GetBucketCount(bucket); count > 0) {
+            m_Buckets[bucket].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    m_Count.fetch_add(other.GetCount(), std::memory_order_relaxed);
+    m_Sum.fetch_add(other.m_Sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    const uint64_t otherMax = other.GetMax();
+    uint64_t max = m_Max.load(std::memory_order_relaxed);
+    while (otherMax > max && !m_Max.compare_exchange_weak(max, otherMax, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : m_Buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_Count.store(0, std::memory_order_relaxed);
+    m_Sum.store(0, std::memory_order_relaxed);
+    m_Max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetMean() const {
+    const uint64_t count = GetCount();
+    return count > 0 ? static_cast<double>(m_Sum.load(std::memory_order_relaxed)) / count : 0.0;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+    // Counted from the buckets rather than m_Count, which may run ahead while writers are active.
+    uint64_t total = 0;
+    for (const auto& bucket : m_Buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    const double clamped = percentile < 0.0 ? 0.0 : (percentile > 100.0 ? 100.0 : percentile);
+    uint64_t rank = static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(total) + 0.5);
+    rank = rank == 0 ? 1 : (rank > total ? total : rank);
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += GetBucketCount(bucket);
+        if (seen >= rank) {
+            const uint64_t bound = GetBucketUpperBound(bucket);
+            const uint64_t max = GetMax();
+            return bound < max ? bound : max;
+        }
+    }
+    return GetMax();
+}
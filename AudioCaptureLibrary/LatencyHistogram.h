@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free latency histogram with logarithmic buckets: every power of two is split into
+// SubBuckets linear steps, so a reported percentile is at most 1 / SubBuckets above the true value
+// over the whole uint64 range. Record() is a few relaxed atomic increments and safe from any number
+// of threads; readers see a consistent-enough snapshot without stopping the writers.
+class LatencyHistogram {
+public:
+    static constexpr int SubBucketBits = 3;
+    static constexpr size_t SubBuckets = size_t{ 1 } << SubBucketBits;
+    static constexpr size_t BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+    void Record(uint64_t value);
+    void Merge(const LatencyHistogram& other);
+    void Reset();
+
+    uint64_t GetCount() const { return m_Count.load(std::memory_order_relaxed); }
+    uint64_t GetMax() const { return m_Max.load(std::memory_order_relaxed); }
+    double GetMean() const;
+
+    // Upper bound of the bucket holding the given percentile (0..100), 0 when empty.
+    uint64_t GetPercentile(double percentile) const;
+
+    uint64_t GetBucketCount(size_t bucket) const { return m_Buckets[bucket].load(std::memory_order_relaxed); }
+    static size_t GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketUpperBound(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> m_Buckets{};
+    std::atomic<uint64_t> m_Count{ 0 };
+    std::atomic<uint64_t> m_Sum{ 0 };
+    std::atomic<uint64_t> m_Max{ 0 };
+};
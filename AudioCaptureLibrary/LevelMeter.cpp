@@ -0,0 +1,332 @@
+#include "LevelMeter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CpuFeatures.h"
+
+namespace {
+
+// Levels of one call, one slot per metered channel.
+struct MeterAccumulator {
+    float Peak[MaxMeteredChannels];
+    float SumSquares[MaxMeteredChannels];
+    uint32_t Clipped[MaxMeteredChannels];
+};
+
+// Samples are measured normalized to full scale: `scale` is 1 / full scale and a sample clips once
+// its magnitude reaches `clipLevel`, the largest positive value of the format.
+using MeterKernel = void (*)(const uint8_t* data, size_t frames, uint32_t channels, float scale, float clipLevel, MeterAccumulator& acc);
+
+float ReadInt16(const uint8_t* data) {
+    return static_cast<float>(*reinterpret_cast<const int16_t*>(data));
+}
+
+float ReadInt24(const uint8_t* data) {
+    return static_cast<float>(static_cast<int32_t>(static_cast<uint32_t>(data[0] | (data[1] << 8) | (data[2] << 16)) << 8) >> 8);
+}
+
+float ReadInt32(const uint8_t* data) {
+    return static_cast<float>(*reinterpret_cast<const int32_t*>(data));
+}
+
+float ReadFloat(const uint8_t* data) {
+    const float sample = *reinterpret_cast<const float*>(data);
+    return std::isnan(sample) ? 0.0f : sample;
+}
+
+// Also measures the tails the vector kernels leave, and streams with more channels than they handle.
+template <size_t SampleSize, float (*Read)(const uint8_t*)>
+void MeterScalar(const uint8_t* data, size_t frames, uint32_t channels, float scale, float clipLevel, MeterAccumulator& acc) {
+    const uint32_t metered = (std::min)(channels, MaxMeteredChannels);
+    for (size_t frame = 0; frame < frames; ++frame, data += channels * SampleSize) {
+        for (uint32_t channel = 0; channel < metered; ++channel) {
+            const float sample = Read(data + channel * SampleSize) * scale;
+            const float magnitude = std::fabs(sample);
+            acc.Peak[channel] = (std::max)(acc.Peak[channel], magnitude);
+            acc.SumSquares[channel] += sample * sample;
+            acc.Clipped[channel] += magnitude >= clipLevel ? 1 : 0;
+        }
+    }
+}
+
+#ifdef AUDIO_SIMD_X86
+
+// The vector kernels take `channels` vectors of W samples at a time, i.e. W whole frames, and keep
+// one set of accumulators per vector of the block: lane j of vector k always holds channel
+// (k * W + j) % channels, whatever the channel count up to MaxMeteredChannels.
+
+__m128 LoadInt16Sse2(const uint8_t* data) {
+    const __m128i samples = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+}
+
+__m128 LoadInt32Sse2(const uint8_t* data) {
+    return _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+}
+
+__m128 LoadFloatSse2(const uint8_t* data) {
+    const __m128 samples = _mm_loadu_ps(reinterpret_cast<const float*>(data));
+    return _mm_and_ps(samples, _mm_cmpord_ps(samples, samples));
+}
+
+template <size_t SampleSize, __m128 (*Load)(const uint8_t*), float (*Read)(const uint8_t*)>
+void MeterSse2(const uint8_t* data, size_t frames, uint32_t channels, float scale, float clipLevel, MeterAccumulator& acc) {
+    constexpr size_t Lanes = 4;
+    if (channels > MaxMeteredChannels) {
+        MeterScalar<SampleSize, Read>(data, frames, channels, scale, clipLevel, acc);
+        return;
+    }
+
+    const __m128 scales = _mm_set1_ps(scale);
+    const __m128 clipLevels = _mm_set1_ps(clipLevel);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 peak[MaxMeteredChannels];
+    __m128 sumSquares[MaxMeteredChannels];
+    __m128i clipped[MaxMeteredChannels];
+    for (uint32_t k = 0; k < channels; ++k) {
+        peak[k] = _mm_setzero_ps();
+        sumSquares[k] = _mm_setzero_ps();
+        clipped[k] = _mm_setzero_si128();
+    }
+
+    const size_t blockSize = channels * Lanes * SampleSize;
+    size_t frame = 0;
+    for (; frame + Lanes <= frames; frame += Lanes, data += blockSize) {
+        for (uint32_t k = 0; k < channels; ++k) {
+            const __m128 sample = _mm_mul_ps(Load(data + k * Lanes * SampleSize), scales);
+            const __m128 magnitude = _mm_andnot_ps(signMask, sample);
+            peak[k] = _mm_max_ps(peak[k], magnitude);
+            sumSquares[k] = _mm_add_ps(sumSquares[k], _mm_mul_ps(sample, sample));
+            // Set lanes are -1.
+            clipped[k] = _mm_sub_epi32(clipped[k], _mm_castps_si128(_mm_cmpge_ps(magnitude, clipLevels)));
+        }
+    }
+
+    for (uint32_t k = 0; k < channels; ++k) {
+        alignas(16) float peaks[Lanes];
+        alignas(16) float sums[Lanes];
+        alignas(16) uint32_t clips[Lanes];
+        _mm_store_ps(peaks, peak[k]);
+        _mm_store_ps(sums, sumSquares[k]);
+        _mm_store_si128(reinterpret_cast<__m128i*>(clips), clipped[k]);
+        for (size_t lane = 0; lane < Lanes; ++lane) {
+            const size_t channel = (k * Lanes + lane) % channels;
+            acc.Peak[channel] = (std::max)(acc.Peak[channel], peaks[lane]);
+            acc.SumSquares[channel] += sums[lane];
+            acc.Clipped[channel] += clips[lane];
+        }
+    }
+
+    MeterScalar<SampleSize, Read>(data, frames - frame, channels, scale, clipLevel, acc);
+}
+
+AVX2_TARGET __m256 LoadInt16Avx2(const uint8_t* data) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data))));
+}
+
+AVX2_TARGET __m256 LoadInt32Avx2(const uint8_t* data) {
+    return _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)));
+}
+
+AVX2_TARGET __m256 LoadFloatAvx2(const uint8_t* data) {
+    const __m256 samples = _mm256_loadu_ps(reinterpret_cast<const float*>(data));
+    return _mm256_and_ps(samples, _mm256_cmp_ps(samples, samples, _CMP_ORD_Q));
+}
+
+template <size_t SampleSize, __m256 (*Load)(const uint8_t*), float (*Read)(const uint8_t*)>
+AVX2_TARGET void MeterAvx2(const uint8_t* data, size_t frames, uint32_t channels, float scale, float clipLevel, MeterAccumulator& acc) {
+    constexpr size_t Lanes = 8;
+    if (channels > MaxMeteredChannels) {
+        MeterScalar<SampleSize, Read>(data, frames, channels, scale, clipLevel, acc);
+        return;
+    }
+
+    const __m256 scales = _mm256_set1_ps(scale);
+    const __m256 clipLevels = _mm256_set1_ps(clipLevel);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 peak[MaxMeteredChannels];
+    __m256 sumSquares[MaxMeteredChannels];
+    __m256i clipped[MaxMeteredChannels];
+    for (uint32_t k = 0; k < channels; ++k) {
+        peak[k] = _mm256_setzero_ps();
+        sumSquares[k] = _mm256_setzero_ps();
+        clipped[k] = _mm256_setzero_si256();
+    }
+
+    const size_t blockSize = channels * Lanes * SampleSize;
+    size_t frame = 0;
+    for (; frame + Lanes <= frames; frame += Lanes, data += blockSize) {
+        for (uint32_t k = 0; k < channels; ++k) {
+            const __m256 sample = _mm256_mul_ps(Load(data + k * Lanes * SampleSize), scales);
+            const __m256 magnitude = _mm256_andnot_ps(signMask, sample);
+            peak[k] = _mm256_max_ps(peak[k], magnitude);
+            sumSquares[k] = _mm256_add_ps(sumSquares[k], _mm256_mul_ps(sample, sample));
+            clipped[k] = _mm256_sub_epi32(clipped[k], _mm256_castps_si256(_mm256_cmp_ps(magnitude, clipLevels, _CMP_GE_OQ)));
+        }
+    }
+
+    for (uint32_t k = 0; k < channels; ++k) {
+        alignas(32) float peaks[Lanes];
+        alignas(32) float sums[Lanes];
+        alignas(32) uint32_t clips[Lanes];
+        _mm256_store_ps(peaks, peak[k]);
+        _mm256_store_ps(sums, sumSquares[k]);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(clips), clipped[k]);
+        for (size_t lane = 0; lane < Lanes; ++lane) {
+            const size_t channel = (k * Lanes + lane) % channels;
+            acc.Peak[channel] = (std::max)(acc.Peak[channel], peaks[lane]);
+            acc.SumSquares[channel] += sums[lane];
+            acc.Clipped[channel] += clips[lane];
+        }
+    }
+
+    MeterScalar<SampleSize, Read>(data, frames - frame, channels, scale, clipLevel, acc);
+}
+
+#endif
+
+struct MeterKernelTable {
+    MeterKernel Int16 = &MeterScalar<2, ReadInt16>;
+    MeterKernel Int32 = &MeterScalar<4, ReadInt32>;
+    MeterKernel Float = &MeterScalar<4, ReadFloat>;
+
+    MeterKernelTable() {
+#ifdef AUDIO_SIMD_X86
+        switch (GetInstructionSet()) {
+        case InstructionSet::Avx2:
+            Int16 = &MeterAvx2<2, LoadInt16Avx2, ReadInt16>;
+            Int32 = &MeterAvx2<4, LoadInt32Avx2, ReadInt32>;
+            Float = &MeterAvx2<4, LoadFloatAvx2, ReadFloat>;
+            break;
+        case InstructionSet::Sse2:
+            Int16 = &MeterSse2<2, LoadInt16Sse2, ReadInt16>;
+            Int32 = &MeterSse2<4, LoadInt32Sse2, ReadInt32>;
+            Float = &MeterSse2<4, LoadFloatSse2, ReadFloat>;
+            break;
+        default:
+            break;
+        }
+#endif
+    }
+};
+
+const MeterKernelTable& GetKernels() {
+    static const MeterKernelTable kernels;
+    return kernels;
+}
+
+MeterKernel GetKernel(SampleFormat format) {
+    const auto& kernels = GetKernels();
+    switch (format) {
+    case SampleFormat::Int16:
+        return kernels.Int16;
+    case SampleFormat::Int24:
+        return &MeterScalar<3, ReadInt24>;
+    case SampleFormat::Int32:
+    case SampleFormat::Int24In32:
+        return kernels.Int32;
+    case SampleFormat::Float32:
+        return kernels.Float;
+    }
+    return nullptr;
+}
+
+}
+
+bool LevelMeter::Configure(SampleFormat format, uint32_t channels, uint32_t sampleRate, uint32_t rateHz) {
+    if (!GetKernel(format) || channels == 0 || sampleRate == 0 || rateHz == 0) {
+        return false;
+    }
+
+    m_Format = format;
+    m_Channels = channels;
+    m_MeteredChannels = (std::min)(channels, MaxMeteredChannels);
+    m_FrameSize = channels * SampleFormatConverter::GetSampleSize(format);
+    m_PeriodFrames = (std::max)(sampleRate / rateHz, 1u);
+    // Int24In32 is measured in its 32 bit container, its largest value is that of a 24 bit sample.
+    m_Scale = m_Format == SampleFormat::Int16 ? 1.0f / 32768.0f :
+        m_Format == SampleFormat::Int24 ? 1.0f / 8388608.0f :
+        m_Format == SampleFormat::Float32 ? 1.0f : 1.0f / 2147483648.0f;
+    m_ClipLevel = m_Format == SampleFormat::Int16 ? 32767.0f / 32768.0f :
+        m_Format == SampleFormat::Int24 || m_Format == SampleFormat::Int24In32 ? 8388607.0f / 8388608.0f : 1.0f;
+
+    m_Frames = 0;
+    std::fill(std::begin(m_Peak), std::end(m_Peak), 0.0f);
+    std::fill(std::begin(m_SumSquares), std::end(m_SumSquares), 0.0);
+    std::fill(std::begin(m_Clipped), std::end(m_Clipped), 0);
+    return true;
+}
+
+void LevelMeter::Process(const uint8_t* data, size_t frames) {
+    if (m_PeriodFrames == 0) {
+        return;
+    }
+
+    const MeterKernel kernel = GetKernel(m_Format);
+
+    // Packets are split at period boundaries so every period covers exactly m_PeriodFrames frames.
+    while (frames > 0) {
+        const size_t count = (std::min)(frames, m_PeriodFrames - m_Frames);
+        if (data) {
+            MeterAccumulator acc = {};
+            kernel(data, count, m_Channels, m_Scale, m_ClipLevel, acc);
+            for (uint32_t channel = 0; channel < m_MeteredChannels; ++channel) {
+                m_Peak[channel] = (std::max)(m_Peak[channel], acc.Peak[channel]);
+                m_SumSquares[channel] += acc.SumSquares[channel];
+                m_Clipped[channel] += acc.Clipped[channel];
+            }
+            data += count * m_FrameSize;
+        }
+
+        m_Frames += count;
+        frames -= count;
+        if (m_Frames == m_PeriodFrames) {
+            Publish();
+        }
+    }
+}
+
+void LevelMeter::Publish() {
+    const uint32_t sequence = m_Sequence.load(std::memory_order_relaxed);
+    m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (uint32_t channel = 0; channel < m_MeteredChannels; ++channel) {
+        m_PublishedPeak[channel].store(m_Peak[channel], std::memory_order_relaxed);
+        m_PublishedRms[channel].store(static_cast<float>(std::sqrt(m_SumSquares[channel] / m_Frames)), std::memory_order_relaxed);
+        m_PublishedClipped[channel].store(m_Clipped[channel], std::memory_order_relaxed);
+    }
+    m_PublishedChannels.store(m_MeteredChannels, std::memory_order_relaxed);
+    m_Period.store(m_Period.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    m_Sequence.store(sequence + 2, std::memory_order_release);
+
+    m_Frames = 0;
+    std::fill(std::begin(m_Peak), std::end(m_Peak), 0.0f);
+    std::fill(std::begin(m_SumSquares), std::end(m_SumSquares), 0.0);
+}
+
+void LevelMeter::Read(StreamLevels& levels) const {
+    for (;;) {
+        const uint32_t sequence = m_Sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) != 0) {
+            YieldProcessor();
+            continue;
+        }
+
+        levels.Channels = m_PublishedChannels.load(std::memory_order_relaxed);
+        levels.Period = m_Period.load(std::memory_order_relaxed);
+        for (uint32_t channel = 0; channel < MaxMeteredChannels; ++channel) {
+            levels.Peak[channel] = m_PublishedPeak[channel].load(std::memory_order_relaxed);
+            levels.Rms[channel] = m_PublishedRms[channel].load(std::memory_order_relaxed);
+            levels.ClippedSamples[channel] = m_PublishedClipped[channel].load(std::memory_order_relaxed);
+        }
+
+        // Retry if Publish() ran while the values were copied.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_Sequence.load(std::memory_order_relaxed) == sequence) {
+            return;
+        }
+    }
+}
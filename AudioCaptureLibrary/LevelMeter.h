@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "SampleFormatConverter.h"
+
+// Channels beyond this are not metered.
+static constexpr uint32_t MaxMeteredChannels = 8;
+
+// Levels of one stream of a capture as returned by GetCaptureLevels. Peak and Rms are linear
+// amplitudes relative to full scale over the last metering period; ClippedSamples counts samples
+// at full scale since the stream started.
+struct StreamLevels {
+    DWORD PipeId;
+    DWORD Channels;
+    // Number of periods published so far, unchanged between two reads when no audio arrived.
+    UINT64 Period;
+    float Peak[MaxMeteredChannels];
+    float Rms[MaxMeteredChannels];
+    UINT64 ClippedSamples[MaxMeteredChannels];
+};
+
+// Per-channel peak, RMS and clip counter of one stream. The capture thread scans every packet
+// once with the SSE2/AVX2 kernels picked from the CPU features and publishes the levels of each
+// period of 1/rateHz seconds; readers on any thread get a consistent copy of the last period
+// through a sequence lock, without ever blocking the capture.
+class LevelMeter {
+public:
+    static constexpr uint32_t DefaultRateHz = 30;
+
+    // Before the first packet. Returns false for a format the meter does not know.
+    bool Configure(SampleFormat format, uint32_t channels, uint32_t sampleRate, uint32_t rateHz = DefaultRateHz);
+
+    // Capture thread, `data` holds `frames` interleaved frames in the configured format.
+    void Process(const uint8_t* data, size_t frames);
+    void ProcessSilence(size_t frames) { Process(nullptr, frames); }
+
+    // Any thread. Fills everything but PipeId.
+    void Read(StreamLevels& levels) const;
+
+private:
+    void Publish();
+
+    SampleFormat m_Format = SampleFormat::Int16;
+    uint32_t m_Channels = 0;
+    uint32_t m_MeteredChannels = 0;
+    size_t m_FrameSize = 0;
+    size_t m_PeriodFrames = 0;
+    // 1 / full scale, and the magnitude of the largest positive sample after scaling.
+    float m_Scale = 1.0f;
+    float m_ClipLevel = 1.0f;
+
+    // Current period, capture thread only.
+    size_t m_Frames = 0;
+    float m_Peak[MaxMeteredChannels] = {};
+    double m_SumSquares[MaxMeteredChannels] = {};
+    uint64_t m_Clipped[MaxMeteredChannels] = {};
+
+    // Last published period. m_Sequence is odd while Publish() is writing it.
+    std::atomic<uint32_t> m_Sequence{ 0 };
+    std::atomic<uint32_t> m_PublishedChannels{ 0 };
+    std::atomic<uint64_t> m_Period{ 0 };
+    std::atomic<float> m_PublishedPeak[MaxMeteredChannels];
+    std::atomic<float> m_PublishedRms[MaxMeteredChannels];
+    std::atomic<uint64_t> m_PublishedClipped[MaxMeteredChannels];
+};
@@ -0,0 +1,195 @@
+#include "MixKernels.h"
+
+#include <cmath>
+
+#include "CpuFeatures.h"
+
+namespace {
+
+void MixAccumulateScalar(float* destination, const float* source, float gain, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        destination[i] += source[i] * gain;
+    }
+}
+
+float PeakAbsScalar(const float* samples, size_t count) {
+    float peak = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        const float value = std::fabs(samples[i]);
+        peak = value > peak ? value : peak;
+    }
+    return peak;
+}
+
+#ifdef AUDIO_SIMD_X86
+
+void MixAccumulateSse2(float* destination, const float* source, float gain, size_t count) {
+    const __m128 factor = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128 low = _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), factor));
+        const __m128 high = _mm_add_ps(_mm_loadu_ps(destination + i + 4), _mm_mul_ps(_mm_loadu_ps(source + i + 4), factor));
+        _mm_storeu_ps(destination + i, low);
+        _mm_storeu_ps(destination + i + 4, high);
+    }
+    MixAccumulateScalar(destination + i, source + i, gain, count - i);
+}
+
+float PeakAbsSse2(const float* samples, size_t count) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 peak = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // maxps returns the second operand for NaN, keep the running peak there.
+        peak = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(samples + i), absMask), peak);
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, peak);
+    float result = PeakAbsScalar(samples + i, count - i);
+    for (const float lane : lanes) {
+        result = lane > result ? lane : result;
+    }
+    return result;
+}
+
+AVX2_TARGET void MixAccumulateAvx2(float* destination, const float* source, float gain, size_t count) {
+    const __m256 factor = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256 low = _mm256_add_ps(_mm256_loadu_ps(destination + i), _mm256_mul_ps(_mm256_loadu_ps(source + i), factor));
+        const __m256 high = _mm256_add_ps(_mm256_loadu_ps(destination + i + 8), _mm256_mul_ps(_mm256_loadu_ps(source + i + 8), factor));
+        _mm256_storeu_ps(destination + i, low);
+        _mm256_storeu_ps(destination + i + 8, high);
+    }
+    MixAccumulateScalar(destination + i, source + i, gain, count - i);
+}
+
+AVX2_TARGET float PeakAbsAvx2(const float* samples, size_t count) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 peak = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        peak = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(samples + i), absMask), peak);
+    }
+
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, peak);
+    float result = PeakAbsScalar(samples + i, count - i);
+    for (const float lane : lanes) {
+        result = lane > result ? lane : result;
+    }
+    return result;
+}
+
+#endif
+
+using MixAccumulateKernel = void (*)(float*, const float*, float, size_t);
+using PeakAbsKernel = float (*)(const float*, size_t);
+
+struct MixKernelTable {
+    MixAccumulateKernel Accumulate = &MixAccumulateScalar;
+    PeakAbsKernel Peak = &PeakAbsScalar;
+
+    MixKernelTable() {
+#ifdef AUDIO_SIMD_X86
+        switch (GetInstructionSet()) {
+        case InstructionSet::Avx2:
+            Accumulate = &MixAccumulateAvx2;
+            Peak = &PeakAbsAvx2;
+            break;
+        case InstructionSet::Sse2:
+            Accumulate = &MixAccumulateSse2;
+            Peak = &PeakAbsSse2;
+            break;
+        default:
+            break;
+        }
+#endif
+    }
+};
+
+const MixKernelTable& GetKernels() {
+    static const MixKernelTable kernels;
+    return kernels;
+}
+
+}
+
+void MixAccumulate(float* destination, const float* source, float gain, size_t count) {
+    GetKernels().Accumulate(destination, source, gain, count);
+}
+
+void MixAccumulateRamp(float* destination, const float* source, float startGain, float endGain, size_t frames, uint32_t channels) {
+    if (frames == 0) {
+        return;
+    }
+
+    const float step = (endGain - startGain) / static_cast<float>(frames);
+    float gain = startGain;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        gain += step;
+        for (uint32_t channel = 0; channel < channels; ++channel) {
+            const size_t index = frame * channels + channel;
+            destination[index] += source[index] * gain;
+        }
+    }
+}
+
+float PeakAbs(const float* samples, size_t count) {
+    return GetKernels().Peak(samples, count);
+}
+
+SoftLimiter::SoftLimiter(uint32_t sampleRate, float threshold, float releaseSeconds) :
+    m_SampleRate(sampleRate), m_Threshold(threshold), m_ReleaseSeconds(releaseSeconds) {}
+
+void SoftLimiter::Process(float* samples, size_t frames, uint32_t channels) {
+    if (frames == 0) {
+        return;
+    }
+
+    const size_t count = frames * channels;
+    const float peak = PeakAbs(samples, count);
+
+    // Release towards unity with a one-pole curve, attack immediately to what this block needs.
+    const float release = 1.0f - std::exp(-static_cast<float>(frames) / (m_ReleaseSeconds * static_cast<float>(m_SampleRate)));
+    float target = m_Gain + (1.0f - m_Gain) * release;
+    if (peak * target > m_Threshold) {
+        target = m_Threshold / peak;
+    }
+
+    const float startGain = m_Gain;
+    const float step = (target - startGain) / static_cast<float>(frames);
+    const float knee = 1.0f - m_Threshold;
+
+    bool needsClip = false;
+    float gain = startGain;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        gain += step;
+        for (uint32_t channel = 0; channel < channels; ++channel) {
+            float& sample = samples[frame * channels + channel];
+            sample *= gain;
+            needsClip |= !(std::fabs(sample) <= m_Threshold);
+        }
+    }
+    m_Gain = target;
+
+    // The ramp starts from the previous gain, so the first frames of a sudden peak may still be
+    // above the threshold. Bend them into the remaining headroom instead of clipping hard.
+    if (needsClip) {
+        for (size_t i = 0; i < count; ++i) {
+            const float magnitude = std::fabs(samples[i]);
+            if (magnitude <= m_Threshold) {
+                continue;
+            }
+
+            if (std::isnan(magnitude)) {
+                samples[i] = 0.0f;
+                continue;
+            }
+
+            const float bent = m_Threshold + knee * std::tanh((magnitude - m_Threshold) / knee);
+            samples[i] = std::copysign(bent, samples[i]);
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Float DSP primitives of the mixdown stage, vectorized for the instruction set picked at runtime.
+
+// destination[i] += source[i] * gain
+void MixAccumulate(float* destination, const float* source, float gain, size_t count);
+
+// Same with the gain moving linearly from startGain to endGain over the interleaved block, used
+// when a gain changes so the step does not click.
+void MixAccumulateRamp(float* destination, const float* source, float startGain, float endGain, size_t frames, uint32_t channels);
+
+// Largest absolute sample value, NaN is ignored.
+float PeakAbs(const float* samples, size_t count);
+
+// Block-based peak limiter with a soft knee. Gain reduction is applied instantly (ramped across the
+// block) and recovers with the release time; whatever still exceeds the threshold is saturated
+// smoothly so the output never leaves [-1, 1].
+class SoftLimiter {
+public:
+    explicit SoftLimiter(uint32_t sampleRate, float threshold = 0.89125f, float releaseSeconds = 0.15f);
+
+    void Process(float* samples, size_t frames, uint32_t channels);
+
+    float GetGain() const { return m_Gain; }
+
+private:
+    uint32_t m_SampleRate;
+    float m_Threshold;
+    float m_ReleaseSeconds;
+    float m_Gain = 1.0f;
+};
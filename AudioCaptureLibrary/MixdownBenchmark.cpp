@@ -0,0 +1,102 @@
+#include "MixdownBenchmark.h"
+
+#include <wil/result.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "AudioMixer.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static constexpr double Pi = 3.14159265358979323846;
+
+// Drives one AudioMixer block by block; a friend of AudioMixer so it can skip the mix thread.
+class MixdownBenchmarkRun {
+public:
+    static HRESULT Run(const MixdownBenchmarkOptions& options, DWORD sourceCount, std::ostream& results) {
+        static std::atomic<long long> runCounter{ 0 };
+        const long long captureId = GetTickCount64() * 1000 + (runCounter++ % 1000);
+
+        AudioMixer mixer(captureId, options.SampleRate, TransportType::SharedMemory);
+        std::vector<std::shared_ptr<MixerInput>> inputs;
+        for (DWORD k = 0; k < sourceCount; ++k) {
+            auto input = mixer.AddInput(k + 1);
+            RETURN_HR_IF(E_INVALIDARG, !input->SetSourceFormat(SampleFormat::Float32, AudioMixer::Channels, options.SampleRate));
+            input->SetGain(0.5f);
+            inputs.push_back(std::move(input));
+        }
+        RETURN_IF_WIN32_BOOL_FALSE(mixer.m_Output->Create(AudioMixer::MixdownPipeId, captureId));
+
+        // A second of sines at a different pitch per source, played in a loop.
+        const size_t loopBlocks = (std::max<size_t>)(options.SampleRate / AudioMixer::BlockFrames, 1);
+        std::vector<std::vector<float>> signals(sourceCount, std::vector<float>(loopBlocks * AudioMixer::BlockFrames * AudioMixer::Channels));
+        for (DWORD k = 0; k < sourceCount; ++k) {
+            const double frequency = 110.0 * (k + 1);
+            for (size_t frame = 0; frame < loopBlocks * AudioMixer::BlockFrames; ++frame) {
+                const float value = static_cast<float>(0.25 * std::sin(2.0 * Pi * frequency * static_cast<double>(frame) / options.SampleRate));
+                signals[k][frame * AudioMixer::Channels] = value;
+                signals[k][frame * AudioMixer::Channels + 1] = value;
+            }
+        }
+
+        LatencyHistogram blockTime;
+        uint64_t totalNanoseconds = 0;
+        for (DWORD block = 0; block < options.BlockCount; ++block) {
+            const size_t offset = (block % loopBlocks) * AudioMixer::BlockFrames * AudioMixer::Channels;
+            for (DWORD k = 0; k < sourceCount; ++k) {
+                inputs[k]->Push(reinterpret_cast<const BYTE*>(signals[k].data() + offset), AudioMixer::BlockFrames);
+            }
+
+            const auto start = BenchmarkClock::now();
+            const bool mixed = mixer.MixBlock(false);
+            const auto nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(BenchmarkClock::now() - start).count());
+            RETURN_HR_IF(E_UNEXPECTED, !mixed);
+
+            blockTime.Record(nanoseconds);
+            totalNanoseconds += nanoseconds;
+        }
+        mixer.m_Output->Close();
+
+        const double meanNanoseconds = static_cast<double>(totalNanoseconds) / options.BlockCount;
+        const double blockNanoseconds = 1e9 * AudioMixer::BlockFrames / options.SampleRate;
+
+        std::ostringstream json;
+        json << "{\"sources\":" << sourceCount
+            << ",\"sampleRate\":" << options.SampleRate
+            << ",\"blockFrames\":" << AudioMixer::BlockFrames
+            << ",\"blocks\":" << options.BlockCount
+            << ",\"blockNs\":{"
+            << "\"mean\":" << meanNanoseconds
+            << ",\"p50\":" << blockTime.GetPercentile(50.0)
+            << ",\"p99\":" << blockTime.GetPercentile(99.0)
+            << ",\"max\":" << blockTime.GetMax()
+            << "}"
+            << ",\"nsPerBlockPerSource\":" << meanNanoseconds / sourceCount
+            << ",\"blockDurationShare\":" << meanNanoseconds / blockNanoseconds
+            << ",\"droppedFrames\":" << mixer.GetDroppedFrames()
+            << "}";
+
+        results << json.str() << std::endl;
+        Logger::GetInstance().Log("Mixdown benchmark: " + json.str());
+        return S_OK;
+    }
+};
+
+HRESULT RunMixdownBenchmark(const MixdownBenchmarkOptions& options, const std::wstring& resultPath) {
+    RETURN_HR_IF(E_INVALIDARG, options.MaxSources == 0 || options.BlockCount == 0 || options.SampleRate == 0);
+
+    std::ofstream results(std::filesystem::path(resultPath), std::ios::app);
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED), !results);
+
+    for (DWORD sources = 1; sources <= options.MaxSources; ++sources) {
+        RETURN_IF_FAILED(MixdownBenchmarkRun::Run(options, sources, results));
+    }
+    return S_OK;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+
+// Settings of RunMixdownBenchmark, shared with the managed side.
+struct MixdownBenchmarkOptions {
+    // Runs with N = 1, 2, 3, ... synthetic sources up to and including MaxSources.
+    DWORD MaxSources = 32;
+    // Blocks of AudioMixer::BlockFrames mixed per run.
+    DWORD BlockCount = 4000;
+    DWORD SampleRate = 48000;
+};
+
+// Times AudioMixer::MixBlock on the calling thread, without the mix thread's polling: every
+// source pushes one block of float stereo at the mix rate, then the block is mixed, limited,
+// metered, converted and written to a shared memory transport nobody reads.
+//
+// Appends one JSON object per source count to `resultPath`: block latency percentiles in
+// nanoseconds, nanoseconds per block per source, and the share of the block's duration spent
+// mixing it.
+HRESULT RunMixdownBenchmark(const MixdownBenchmarkOptions& options, const std::wstring& resultPath);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+#include "AudioFormat.h"
+
+// Layout of the multitrack container (.amt), one file holding several time-aligned PCM tracks:
+//
+//   MultitrackFileHeader
+//   MultitrackTrackHeader * TrackCount
+//   chunks, each a MultitrackChunkHeader and Size bytes of interleaved PCM in the track format,
+//       in order of their start time across all tracks
+//   MultitrackIndexEntry * EntryCount, sorted by track and then by start frame
+//   MultitrackTrailer
+//
+// The file is written front to back in one pass, nothing is patched afterwards. Readers start from
+// the trailer at the end of the file. All fields are little endian.
+
+static constexpr uint32_t MultitrackVersion = 1;
+static constexpr uint32_t MultitrackMaxNameLength = 64;
+
+struct MultitrackFileHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t TrackCount;
+    uint32_t Reserved;
+};
+
+struct MultitrackTrackHeader {
+    uint32_t SampleRate;
+    uint16_t Channels;
+    uint16_t BitsPerSample;
+    uint16_t ValidBitsPerSample;
+    uint16_t IsFloat;
+    uint32_t ChannelMask;
+    // Time of the first frame relative to the start of the file, tracks that started later than
+    // others begin later.
+    uint64_t StartMicroseconds;
+    // UTF-16, zero padded.
+    char16_t Name[MultitrackMaxNameLength];
+};
+
+struct MultitrackChunkHeader {
+    uint32_t Track;
+    // Payload bytes, always whole frames.
+    uint32_t Size;
+    uint64_t StartFrame;
+};
+
+struct MultitrackIndexEntry {
+    // File offset of the chunk header.
+    uint64_t Offset;
+    uint64_t StartFrame;
+    uint32_t Track;
+    uint32_t Frames;
+};
+
+struct MultitrackTrailer {
+    uint64_t IndexOffset;
+    uint32_t EntryCount;
+    char Magic[4];
+};
+
+static constexpr char MultitrackFileMagic[4] = { 'A', 'M', 'T', 'K' };
+static constexpr char MultitrackTrailerMagic[4] = { 'A', 'M', 'T', 'I' };
+
+static_assert(sizeof(MultitrackFileHeader) == 16, "File header is part of the file format");
+static_assert(sizeof(MultitrackTrackHeader) == 152, "Track header is part of the file format");
+static_assert(sizeof(MultitrackChunkHeader) == 16, "Chunk header is part of the file format");
+static_assert(sizeof(MultitrackIndexEntry) == 24, "Index entry is part of the file format");
+static_assert(sizeof(MultitrackTrailer) == 16, "Trailer is part of the file format");
+
+inline AudioFormat ToAudioFormat(const MultitrackTrackHeader& header) {
+    AudioFormat format;
+    format.SampleRate = header.SampleRate;
+    format.Channels = header.Channels;
+    format.BitsPerSample = header.BitsPerSample;
+    format.ValidBitsPerSample = header.ValidBitsPerSample;
+    format.ChannelMask = header.ChannelMask;
+    format.IsFloat = header.IsFloat != 0;
+    return format;
+}
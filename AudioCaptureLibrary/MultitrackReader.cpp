@@ -0,0 +1,161 @@
+#include "MultitrackReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool MultitrackReader::Open(const std::filesystem::path& path) {
+    m_Tracks.clear();
+    m_Index.clear();
+    m_File.close();
+    m_File.clear();
+    m_File.open(path, std::ios::binary);
+    if (!m_File) {
+        return false;
+    }
+
+    m_File.seekg(0, std::ios::end);
+    m_FileSize = static_cast<uint64_t>(m_File.tellg());
+
+    MultitrackFileHeader fileHeader;
+    MultitrackTrailer trailer;
+    if (m_FileSize < sizeof(fileHeader) + sizeof(trailer) ||
+        !m_File.seekg(0) || !m_File.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)) ||
+        memcmp(fileHeader.Magic, MultitrackFileMagic, sizeof(fileHeader.Magic)) != 0 || fileHeader.Version != MultitrackVersion ||
+        !m_File.seekg(static_cast<std::streamoff>(m_FileSize - sizeof(trailer))) ||
+        !m_File.read(reinterpret_cast<char*>(&trailer), sizeof(trailer)) ||
+        memcmp(trailer.Magic, MultitrackTrailerMagic, sizeof(trailer.Magic)) != 0) {
+        return false;
+    }
+
+    // The index has to end exactly where the trailer starts, which also bounds both counts.
+    const uint64_t headersEnd = sizeof(fileHeader) + static_cast<uint64_t>(fileHeader.TrackCount) * sizeof(MultitrackTrackHeader);
+    if (trailer.IndexOffset < headersEnd ||
+        trailer.IndexOffset + static_cast<uint64_t>(trailer.EntryCount) * sizeof(MultitrackIndexEntry) != m_FileSize - sizeof(trailer)) {
+        return false;
+    }
+
+    m_File.seekg(sizeof(fileHeader));
+    m_Tracks.resize(fileHeader.TrackCount);
+    for (auto& track : m_Tracks) {
+        MultitrackTrackHeader header;
+        if (!m_File.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+
+        track.Info.Format = ToAudioFormat(header);
+        track.Info.StartMicroseconds = header.StartMicroseconds;
+        track.Info.Name.assign(header.Name, std::find(header.Name, header.Name + MultitrackMaxNameLength, u'\0'));
+        if (!track.Info.Format.IsValid()) {
+            return false;
+        }
+    }
+
+    m_Index.resize(trailer.EntryCount);
+    if (!m_File.seekg(static_cast<std::streamoff>(trailer.IndexOffset)) ||
+        !m_File.read(reinterpret_cast<char*>(m_Index.data()), static_cast<std::streamsize>(m_Index.size() * sizeof(MultitrackIndexEntry)))) {
+        return false;
+    }
+
+    // Every track is one contiguous run of entries, each chunk starting where the previous ended.
+    for (size_t i = 0; i < m_Index.size(); ++i) {
+        const auto& entry = m_Index[i];
+        if (entry.Track >= m_Tracks.size() || entry.Offset < headersEnd || entry.Offset >= trailer.IndexOffset) {
+            return false;
+        }
+
+        Track& track = m_Tracks[entry.Track];
+        if (track.EntryCount == 0) {
+            if (track.Info.FrameCount != 0) {
+                return false;
+            }
+            track.FirstEntry = i;
+        }
+        else if (track.FirstEntry + track.EntryCount != i || entry.StartFrame != track.Info.FrameCount) {
+            return false;
+        }
+
+        ++track.EntryCount;
+        track.Info.FrameCount += entry.Frames;
+    }
+
+    return true;
+}
+
+uint64_t MultitrackReader::GetFrameAt(uint32_t track, uint64_t microseconds) const {
+    const auto& info = m_Tracks[track].Info;
+    if (microseconds <= info.StartMicroseconds) {
+        return 0;
+    }
+
+    const uint64_t frame = (microseconds - info.StartMicroseconds) * info.Format.SampleRate / 1000000;
+    return (std::min)(frame, info.FrameCount);
+}
+
+bool MultitrackReader::ReadChunk(const MultitrackIndexEntry& entry, std::vector<uint8_t>& payload) {
+    const uint32_t bytesPerFrame = m_Tracks[entry.Track].Info.Format.BytesPerFrame();
+
+    MultitrackChunkHeader header;
+    m_File.clear();
+    if (!m_File.seekg(static_cast<std::streamoff>(entry.Offset)) || !m_File.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.Track != entry.Track || header.StartFrame != entry.StartFrame ||
+        header.Size != static_cast<uint64_t>(entry.Frames) * bytesPerFrame || entry.Offset + sizeof(header) + header.Size > m_FileSize) {
+        return false;
+    }
+
+    payload.resize(header.Size);
+    return static_cast<bool>(m_File.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size())));
+}
+
+size_t MultitrackReader::Read(uint32_t track, uint64_t startFrame, void* destination, size_t frames) {
+    if (track >= m_Tracks.size()) {
+        return 0;
+    }
+
+    const Track& range = m_Tracks[track];
+    const uint32_t bytesPerFrame = range.Info.Format.BytesPerFrame();
+    const auto first = m_Index.begin() + static_cast<ptrdiff_t>(range.FirstEntry);
+    const auto last = first + static_cast<ptrdiff_t>(range.EntryCount);
+
+    // The last chunk starting at or before startFrame.
+    auto entry = std::upper_bound(first, last, startFrame,
+        [](uint64_t frame, const MultitrackIndexEntry& e) { return frame < e.StartFrame; });
+    if (entry == first) {
+        return 0;
+    }
+    --entry;
+
+    auto* output = static_cast<uint8_t*>(destination);
+    size_t read = 0;
+    for (; entry != last && read < frames; ++entry) {
+        const uint64_t position = startFrame + read;
+        if (position >= entry->StartFrame + entry->Frames) {
+            break;
+        }
+
+        if (!ReadChunk(*entry, m_Chunk)) {
+            return 0;
+        }
+
+        const size_t offset = static_cast<size_t>(position - entry->StartFrame);
+        const size_t count = (std::min)(static_cast<size_t>(entry->Frames) - offset, frames - read);
+        memcpy(output + read * bytesPerFrame, m_Chunk.data() + offset * bytesPerFrame, count * bytesPerFrame);
+        read += count;
+    }
+
+    return read;
+}
+
+bool MultitrackReader::Extract(uint32_t track, const TrackSink& sink) {
+    if (track >= m_Tracks.size()) {
+        return false;
+    }
+
+    const Track& range = m_Tracks[track];
+    for (size_t i = range.FirstEntry; i < range.FirstEntry + range.EntryCount; ++i) {
+        if (!ReadChunk(m_Index[i], m_Chunk) || !sink(m_Chunk.data(), m_Chunk.size())) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "MultitrackFormat.h"
+
+struct MultitrackTrackInfo {
+    AudioFormat Format;
+    std::u16string Name;
+    uint64_t StartMicroseconds = 0;
+    uint64_t FrameCount = 0;
+};
+
+// Random access reader for multitrack containers. Open() reads the headers and the seek index from
+// the end of the file; a read at any frame of any track finds its chunk with a binary search over
+// that track's part of the index and reads only the chunks it covers.
+class MultitrackReader {
+public:
+    // Receives a track as PCM in its format, returning false stops the extraction.
+    using TrackSink = std::function<bool(const uint8_t* data, size_t size)>;
+
+    // Returns false if the file cannot be opened or is not a complete multitrack container.
+    bool Open(const std::filesystem::path& path);
+
+    uint32_t GetTrackCount() const { return static_cast<uint32_t>(m_Tracks.size()); }
+    const MultitrackTrackInfo& GetTrack(uint32_t track) const { return m_Tracks[track].Info; }
+
+    // Frame of `track` that plays `microseconds` after the start of the file, clamped to the track.
+    uint64_t GetFrameAt(uint32_t track, uint64_t microseconds) const;
+
+    // Reads up to `frames` frames of `track` starting at `startFrame` into `destination`, returns the
+    // number read (0 past the end of the track or on a damaged chunk).
+    size_t Read(uint32_t track, uint64_t startFrame, void* destination, size_t frames);
+
+    // Passes the whole track to `sink`, one chunk at a time. Returns false on a damaged chunk or
+    // when the sink gave up.
+    bool Extract(uint32_t track, const TrackSink& sink);
+
+private:
+    struct Track {
+        MultitrackTrackInfo Info;
+        // Range of the track in m_Index, sorted by start frame.
+        size_t FirstEntry = 0;
+        size_t EntryCount = 0;
+    };
+
+    bool ReadChunk(const MultitrackIndexEntry& entry, std::vector<uint8_t>& payload);
+
+    std::ifstream m_File;
+    uint64_t m_FileSize = 0;
+    std::vector<Track> m_Tracks;
+    std::vector<MultitrackIndexEntry> m_Index;
+    std::vector<uint8_t> m_Chunk;
+};
@@ -0,0 +1,129 @@
+#include "MultitrackWriter.h"
+
+#include <wil/result.h>
+#include <algorithm>
+#include <cstring>
+
+MultitrackWriter::~MultitrackWriter() {
+    Close();
+}
+
+HRESULT MultitrackWriter::Open(const std::wstring& filePath, const std::vector<MultitrackTrack>& tracks) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, m_Writer.IsOpen());
+    RETURN_HR_IF(E_INVALIDARG, tracks.empty());
+    for (const auto& track : tracks) {
+        RETURN_HR_IF(E_INVALIDARG, !track.Format.IsValid());
+    }
+
+    RETURN_IF_FAILED(m_Writer.Open(filePath));
+
+    m_Tracks = tracks;
+    m_TrackFrames.assign(tracks.size(), 0);
+    m_Index.assign(tracks.size(), {});
+
+    MultitrackFileHeader fileHeader = {};
+    memcpy(fileHeader.Magic, MultitrackFileMagic, sizeof(fileHeader.Magic));
+    fileHeader.Version = MultitrackVersion;
+    fileHeader.TrackCount = static_cast<uint32_t>(tracks.size());
+    RETURN_IF_FAILED(m_Writer.Append(&fileHeader, sizeof(fileHeader)));
+
+    for (const auto& track : tracks) {
+        MultitrackTrackHeader header = {};
+        header.SampleRate = track.Format.SampleRate;
+        header.Channels = track.Format.Channels;
+        header.BitsPerSample = track.Format.BitsPerSample;
+        header.ValidBitsPerSample = track.Format.ValidBitsPerSample;
+        header.IsFloat = track.Format.IsFloat ? 1 : 0;
+        header.ChannelMask = track.Format.ChannelMask;
+        header.StartMicroseconds = track.StartMicroseconds;
+        const size_t nameLength = (std::min)(track.Name.size(), static_cast<size_t>(MultitrackMaxNameLength));
+        for (size_t i = 0; i < nameLength; ++i) {
+            header.Name[i] = static_cast<char16_t>(track.Name[i]);
+        }
+        RETURN_IF_FAILED(m_Writer.Append(&header, sizeof(header)));
+    }
+
+    return S_OK;
+}
+
+HRESULT MultitrackWriter::WriteChunk(uint32_t track, const BYTE* data, size_t size) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_Writer.IsOpen());
+    RETURN_HR_IF(E_INVALIDARG, track >= m_Tracks.size());
+
+    const uint32_t bytesPerFrame = m_Tracks[track].Format.BytesPerFrame();
+    RETURN_HR_IF(E_INVALIDARG, size % bytesPerFrame != 0 || size > MAXDWORD);
+    if (size == 0) {
+        return S_OK;
+    }
+
+    const uint32_t frames = static_cast<uint32_t>(size / bytesPerFrame);
+    m_Index[track].push_back({ m_Writer.GetSize(), m_TrackFrames[track], track, frames });
+
+    const MultitrackChunkHeader header = { track, static_cast<uint32_t>(size), m_TrackFrames[track] };
+    RETURN_IF_FAILED(m_Writer.Append(&header, sizeof(header)));
+    RETURN_IF_FAILED(m_Writer.Append(data, size));
+
+    m_TrackFrames[track] += frames;
+    return S_OK;
+}
+
+HRESULT MultitrackWriter::WriteInterleaved(const std::vector<TrackSource>& sources) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_Writer.IsOpen());
+    RETURN_HR_IF(E_INVALIDARG, sources.size() != m_Tracks.size());
+
+    std::vector<bool> finished(sources.size(), false);
+    std::vector<BYTE> chunk;
+    while (true) {
+        // The track whose next chunk starts first, few tracks make a linear scan the cheapest.
+        size_t next = sources.size();
+        double nextTime = 0.0;
+        for (size_t track = 0; track < sources.size(); ++track) {
+            if (finished[track]) {
+                continue;
+            }
+
+            const auto& format = m_Tracks[track].Format;
+            const double time = m_Tracks[track].StartMicroseconds + m_TrackFrames[track] * 1e6 / format.SampleRate;
+            if (next == sources.size() || time < nextTime) {
+                next = track;
+                nextTime = time;
+            }
+        }
+
+        if (next == sources.size()) {
+            return S_OK;
+        }
+
+        const auto& format = m_Tracks[next].Format;
+        const size_t chunkFrames = (std::max)(static_cast<size_t>(format.SampleRate) * ChunkMilliseconds / 1000, static_cast<size_t>(1));
+        chunk.resize(chunkFrames * format.BytesPerFrame());
+
+        size_t read = 0;
+        RETURN_HR_IF(E_ABORT, !sources[next](chunk.data(), chunkFrames, read));
+        if (read == 0) {
+            finished[next] = true;
+            continue;
+        }
+
+        RETURN_IF_FAILED(WriteChunk(static_cast<uint32_t>(next), chunk.data(), (std::min)(read, chunkFrames) * format.BytesPerFrame()));
+    }
+}
+
+HRESULT MultitrackWriter::Close() {
+    if (!m_Writer.IsOpen()) {
+        return S_OK;
+    }
+
+    auto closeFile = wil::scope_exit([&] { m_Writer.Close(); });
+
+    MultitrackTrailer trailer = {};
+    trailer.IndexOffset = m_Writer.GetSize();
+    for (const auto& entries : m_Index) {
+        RETURN_IF_FAILED(m_Writer.Append(entries.data(), entries.size() * sizeof(MultitrackIndexEntry)));
+        trailer.EntryCount += static_cast<uint32_t>(entries.size());
+    }
+    memcpy(trailer.Magic, MultitrackTrailerMagic, sizeof(trailer.Magic));
+    RETURN_IF_FAILED(m_Writer.Append(&trailer, sizeof(trailer)));
+
+    return m_Writer.Close();
+}
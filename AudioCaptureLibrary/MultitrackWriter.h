@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "AsyncFileWriter.h"
+#include "AudioFormat.h"
+#include "MultitrackFormat.h"
+
+struct MultitrackTrack {
+    AudioFormat Format;
+    // Truncated to MultitrackMaxNameLength characters.
+    std::wstring Name;
+    uint64_t StartMicroseconds = 0;
+};
+
+// Writes a multitrack container in a single sequential pass: the headers on Open(), the chunks as
+// they come and the seek index on Close(). Writes go through one AsyncFileWriter, so a save of many
+// tracks costs one file and a handful of large background writes instead of a file per track.
+class MultitrackWriter {
+public:
+    // Duration of the chunks WriteInterleaved() produces, the seek granularity of the file.
+    static constexpr uint32_t ChunkMilliseconds = 100;
+
+    // Fills `destination` with up to `frames` frames of the track and sets `read`, 0 at the end of
+    // the track. Returning false aborts the write.
+    using TrackSource = std::function<bool(uint8_t* destination, size_t frames, size_t& read)>;
+
+    MultitrackWriter() = default;
+    ~MultitrackWriter();
+
+    MultitrackWriter(const MultitrackWriter&) = delete;
+    MultitrackWriter& operator=(const MultitrackWriter&) = delete;
+
+    HRESULT Open(const std::wstring& filePath, const std::vector<MultitrackTrack>& tracks);
+
+    // Appends whole frames of `track`. Chunks should be written in order of their start time so
+    // that the tracks stay interleaved in the file.
+    HRESULT WriteChunk(uint32_t track, const BYTE* data, size_t size);
+
+    // Drains one source per track, chunk by chunk in order of start time.
+    HRESULT WriteInterleaved(const std::vector<TrackSource>& sources);
+
+    HRESULT Close();
+
+private:
+    AsyncFileWriter m_Writer;
+    std::vector<MultitrackTrack> m_Tracks;
+    std::vector<uint64_t> m_TrackFrames;
+    // Per track, concatenated on Close() to get the index sorted by track.
+    std::vector<std::vector<MultitrackIndexEntry>> m_Index;
+};
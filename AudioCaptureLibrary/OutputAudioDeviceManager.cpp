@@ -1,70 +1,74 @@
 #include "OutputAudioDeviceManager.h"
 #include "Logger.h"
 #include <windows.h>
-#include <psapi.h>
 #include <string>
 #include <filesystem>
 
 #pragma comment(lib, "psapi.lib")
-#pragma comment(lib, "Version.lib")
 
-OutputAudioDeviceManager::OutputAudioDeviceManager() = default;
+OutputAudioDeviceManager::OutputAudioDeviceManager() : AudioDeviceManagerBase(eRender) {}
 
 OutputAudioDeviceManager::~OutputAudioDeviceManager() = default;
 
 std::vector<OutputAudioDeviceInfo> OutputAudioDeviceManager::GetActiveOutputDevices() {
     std::vector<OutputAudioDeviceInfo> outputDevices;
+    WatchDevices();
 
-    for (auto& device : GetActiveDevices(eRender)) {
-        auto deviceInfo = GetDeviceInfo(device);
-        if (!deviceInfo) {
+    for (const auto& deviceId : m_Cache.GetDevices(DeviceFlow::Render)) {
+        auto entry = m_Cache.GetDevice(deviceId);
+        if (!entry) {
             continue;
         }
 
-        OutputAudioDeviceInfo outputInfo;
-        outputInfo.DeviceInfo = *deviceInfo;
-
-        auto sessionsVector = GetSessions(device);
-        outputInfo.SessionCount = static_cast<int>(sessionsVector.size());
-        if (outputInfo.SessionCount > 0) {
-            outputInfo.Sessions = new AudioSessionInfo[outputInfo.SessionCount];
-            std::copy(sessionsVector.begin(), sessionsVector.end(), outputInfo.Sessions);
-        }
-        else {
-            outputInfo.Sessions = nullptr;
-        }
-
-        outputDevices.push_back(outputInfo);
+        outputDevices.push_back(ToOutputDeviceInfo(*entry));
     }
 
     return outputDevices;
 }
 
 std::optional<OutputAudioDeviceInfo> OutputAudioDeviceManager::GetOutputDeviceInfo(const std::wstring& deviceId) {
-    auto device = GetDevice(deviceId);
-    auto deviceInfo = GetDeviceInfo(device);
+    WatchDevices();
 
-    if (!deviceInfo.has_value())
+    auto entry = m_Cache.GetDevice(deviceId);
+    if (!entry)
         return std::nullopt;
 
-    OutputAudioDeviceInfo outputDeviceInfo;
-    outputDeviceInfo.DeviceInfo = deviceInfo.value();
+    return ToOutputDeviceInfo(*entry);
+}
 
-    auto sessionsVector = GetSessions(device);
-    outputDeviceInfo.SessionCount = static_cast<int>(sessionsVector.size());
-    if (outputDeviceInfo.SessionCount > 0) {
-        outputDeviceInfo.Sessions = new AudioSessionInfo[outputDeviceInfo.SessionCount];
-        std::copy(sessionsVector.begin(), sessionsVector.end(), outputDeviceInfo.Sessions);
+OutputAudioDeviceInfo OutputAudioDeviceManager::ToOutputDeviceInfo(const DeviceEntry& entry) {
+    OutputAudioDeviceInfo outputInfo;
+    outputInfo.DeviceInfo = ToDeviceInfo(entry);
+
+    auto sessions = m_Cache.GetSessions(entry.Id);
+    outputInfo.SessionCount = static_cast<int>(sessions.size());
+    if (outputInfo.SessionCount > 0) {
+        outputInfo.Sessions = new AudioSessionInfo[outputInfo.SessionCount];
+        for (int i = 0; i < outputInfo.SessionCount; ++i) {
+            const SessionEntry& session = sessions[i];
+            AudioSessionInfo& sessionInfo = outputInfo.Sessions[i];
+            sessionInfo = {};
+            sessionInfo.PipeId = session.PipeId;
+            sessionInfo.DisplayName = SysAllocString(session.DisplayName.c_str());
+            sessionInfo.IconPath = SysAllocString(session.IconPath.c_str());
+            sessionInfo.SessionIdentifier = SysAllocString(session.SessionIdentifier.c_str());
+            sessionInfo.SessionInstanceIdentifier = SysAllocString(session.SessionInstanceIdentifier.c_str());
+        }
     }
     else {
-        outputDeviceInfo.Sessions = nullptr;
+        outputInfo.Sessions = nullptr;
     }
 
-    return outputDeviceInfo;
+    return outputInfo;
 }
 
-std::vector<AudioSessionInfo> OutputAudioDeviceManager::GetSessions(wil::com_ptr_nothrow<IMMDevice> device) {
-    std::vector<AudioSessionInfo> sessions = {};
+std::vector<SessionEntry> OutputAudioDeviceManager::ReadSessions(const std::wstring& deviceId) {
+    std::vector<SessionEntry> sessions = {};
+
+    auto device = GetDevice(deviceId);
+    if (!device) {
+        return sessions;
+    }
 
     wil::com_ptr_nothrow<IAudioSessionManager2> sessionManager;
     if (FAILED(device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_INPROC_SERVER, nullptr, reinterpret_cast<void**>(&sessionManager)))) {
@@ -103,7 +107,7 @@ std::vector<AudioSessionInfo> OutputAudioDeviceManager::GetSessions(wil::com_ptr
             continue;
         }
 
-        AudioSessionInfo sessionInfo = {};
+        SessionEntry sessionInfo;
         sessionInfo.PipeId = pid;
 
         LPWSTR displayName = nullptr;
@@ -119,17 +123,16 @@ std::vector<AudioSessionInfo> OutputAudioDeviceManager::GetSessions(wil::com_ptr
                 finalDisplayName = wDisplayName;
             }
 
-            sessionInfo.DisplayName = SysAllocString(finalDisplayName.c_str());
+            sessionInfo.DisplayName = finalDisplayName;
             CoTaskMemFree(displayName);
         }
         else {
-            std::wstring processName = GetProcessName(pid);
-            sessionInfo.DisplayName = SysAllocString(processName.c_str());
+            sessionInfo.DisplayName = m_ProcessNames.GetDisplayName(pid);
         }
 
         LPWSTR iconPath = nullptr;
         if (SUCCEEDED(sessionControl2->GetIconPath(&iconPath))) {
-            sessionInfo.IconPath = SysAllocString(iconPath);
+            sessionInfo.IconPath = iconPath;
             CoTaskMemFree(iconPath);
         }
 
@@ -139,13 +142,13 @@ std::vector<AudioSessionInfo> OutputAudioDeviceManager::GetSessions(wil::com_ptr
 
         LPWSTR sessionIdentifier = nullptr;
         if (SUCCEEDED(sessionControl2->GetSessionIdentifier(&sessionIdentifier))) {
-            sessionInfo.SessionIdentifier = SysAllocString(sessionIdentifier);
+            sessionInfo.SessionIdentifier = sessionIdentifier;
             CoTaskMemFree(sessionIdentifier);
         }
 
         LPWSTR sessionInstanceIdentifier = nullptr;
         if (SUCCEEDED(sessionControl2->GetSessionInstanceIdentifier(&sessionInstanceIdentifier))) {
-            sessionInfo.SessionInstanceIdentifier = SysAllocString(sessionInstanceIdentifier);
+            sessionInfo.SessionInstanceIdentifier = sessionInstanceIdentifier;
             CoTaskMemFree(sessionInstanceIdentifier);
         }
 
@@ -155,38 +158,6 @@ std::vector<AudioSessionInfo> OutputAudioDeviceManager::GetSessions(wil::com_ptr
     return sessions;
 }
 
-std::wstring OutputAudioDeviceManager::GetProcessName(DWORD processId) {
-    HANDLE processHandle = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
-    if (!processHandle) {
-        return L"<Unknown>";
-    }
-
-    wchar_t exePath[MAX_PATH] = { 0 };
-    if (!GetModuleFileNameEx(processHandle, NULL, exePath, MAX_PATH)) {
-        CloseHandle(processHandle);
-        return L"<Unknown>";
-    }
-    CloseHandle(processHandle);
-
-    std::wstring result = exePath;
-
-    DWORD dummy = 0;
-    DWORD infoSize = GetFileVersionInfoSize(exePath, &dummy);
-    if (infoSize > 0) {
-        std::vector<BYTE> versionInfo(infoSize);
-        if (GetFileVersionInfo(exePath, dummy, infoSize, versionInfo.data())) {
-            void* productNameBuffer = nullptr;
-            UINT productNameLength = 0;
-            if (VerQueryValue(versionInfo.data(), L"\\StringFileInfo\\040904b0\\ProductName", &productNameBuffer, &productNameLength)) {
-                result = static_cast<wchar_t*>(productNameBuffer);
-            }
-        }
-    }
-
-    std::filesystem::path p(result);
-    return p.stem().wstring();
-}
-
 void OutputAudioDeviceManager::RegisterSessionNotificationsForDevice(const std::wstring& deviceId, SessionStateChangedCallback callback) {
     auto device = GetDevice(deviceId);
     if (!device) {
@@ -200,7 +171,7 @@ void OutputAudioDeviceManager::RegisterSessionNotificationsForDevice(const std::
         return;
     }
 
-    auto notification = new AudioSessionNotification(deviceId, callback);
+    auto notification = new AudioSessionNotification(deviceId, callback, &m_Cache, &m_Changes);
     if (FAILED(sessionManager2->RegisterSessionNotification(notification))) {
         Logger::GetInstance().Log("RegisterSessionNotification failed", LogLevel::Warning);
         notification->Release();
@@ -209,15 +180,36 @@ void OutputAudioDeviceManager::RegisterSessionNotificationsForDevice(const std::
 
     notification->RegisterEventsForExistingSessions(sessionManager2);
 
+    std::lock_guard lock(_sessionNotificationsLock);
     _sessionNotifications[deviceId] = notification;
+    m_Cache.SetSessionsWatched(deviceId, true);
 }
 
 void OutputAudioDeviceManager::UnregisterSessionNotificationsForDevice(const std::wstring& deviceId) {
+    std::lock_guard lock(_sessionNotificationsLock);
     auto itNotify = _sessionNotifications.find(deviceId);
     if (itNotify != _sessionNotifications.end()) {
         itNotify->second->UnregisterAllSessionEvents();
         itNotify->second->Release();
         _sessionNotifications.erase(itNotify);
+        m_Cache.SetSessionsWatched(deviceId, false);
     }
 }
 
+void OutputAudioDeviceManager::OnProcessNameResolved() {
+    m_Cache.InvalidateAllSessions();
+
+    // Which sessions showed the file name is not known, so every watched device reports its
+    // sessions renamed. Called back outside the lock, the callback may register devices.
+    std::vector<wil::com_ptr<AudioSessionNotification>> notifications;
+    {
+        std::lock_guard lock(_sessionNotificationsLock);
+        for (const auto& [deviceId, notification] : _sessionNotifications) {
+            notifications.emplace_back(notification);
+        }
+    }
+
+    for (const auto& notification : notifications) {
+        notification->ReportSessionNames();
+    }
+}
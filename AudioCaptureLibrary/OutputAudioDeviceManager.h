@@ -1,10 +1,12 @@
 #pragma once
+#include <mutex>
 #include <unordered_map>
 
 #include "AudioDeviceManagerBase.h"
 #include "AudioDeviceInfo.h"
 #include "AudioSessionEvents.h"
 #include "AudioSessionNotification.h"
+#include "ProcessMetadataCache.h"
 
 class OutputAudioDeviceManager : public AudioDeviceManagerBase {
 public:
@@ -16,9 +18,18 @@ public:
     void RegisterSessionNotificationsForDevice(const std::wstring& deviceId, SessionStateChangedCallback callback);
     void UnregisterSessionNotificationsForDevice(const std::wstring& deviceId);
 
+    // Uncached, sessions are cached only for devices with session notifications registered.
+    std::vector<SessionEntry> ReadSessions(const std::wstring& deviceId) override;
+
 private:
-    std::vector<AudioSessionInfo> GetSessions(wil::com_ptr_nothrow<IMMDevice> device);
-    std::wstring GetProcessName(DWORD processId);
+    OutputAudioDeviceInfo ToOutputDeviceInfo(const DeviceEntry& entry);
+    // Called on the resolver thread of m_ProcessNames.
+    void OnProcessNameResolved();
 
     std::unordered_map<std::wstring, AudioSessionNotification*> _sessionNotifications;
+    // Guards _sessionNotifications, which the resolver thread walks.
+    std::mutex _sessionNotificationsLock;
+    // Session display names of processes without one of their own. Product names arrive after the
+    // session lists that needed them, which are then read again and reported as SessionNames changes.
+    ProcessMetadataCache m_ProcessNames{ [this] { OnProcessNameResolved(); } };
 };
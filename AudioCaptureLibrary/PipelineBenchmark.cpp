@@ -0,0 +1,320 @@
+#include "PipelineBenchmark.h"
+
+#include <Psapi.h>
+#include <wil/result.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "AudioMixer.h"
+#include "AudioTransport.h"
+#include "CaptureScheduler.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include "SharedMemoryReader.h"
+#include "SimulatedCaptureSource.h"
+#include "WavFileWriter.h"
+
+using BenchmarkClock = PacedCaptureSource::Clock;
+
+static constexpr DWORD FirstPipeId = 1000;
+static constexpr size_t ConsumerBufferSize = 64 * 1024;
+
+// One stream of a run and the consumer thread draining it into a WAV file.
+struct BenchmarkStream {
+    DWORD PipeId = 0;
+    std::unique_ptr<SyntheticCaptureSource> Source;
+    std::filesystem::path FilePath;
+    std::thread Consumer;
+
+    // Written by the consumer, read after it has been joined.
+    UINT64 ConsumedBytes = 0;
+    UINT64 LostRecords = 0;
+    HRESULT Result = S_OK;
+};
+
+struct BenchmarkRun {
+    LatencyHistogram CallbackLatency;
+    LatencyHistogram SchedulingDelay;
+    LatencyHistogram EndToEndLatency;
+};
+
+static uint64_t ToNanoseconds(BenchmarkClock::duration duration) {
+    const auto count = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    return count > 0 ? static_cast<uint64_t>(count) : 0;
+}
+
+static uint64_t GetProcessCpuTime() {
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+
+    const auto toTicks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    // 100 ns units
+    return toTicks(kernel) + toTicks(user);
+}
+
+// Reads one stream until its transport closes. For a simulated source the end-to-end latency of
+// every completed packet is measured from the moment the packet's last frame was "captured".
+static void ConsumeStream(BenchmarkStream& stream, long long captureId, TransportType transport, const AudioFormat& format,
+    size_t packetBytes, DWORD delayMs, LatencyHistogram* endToEnd) {
+    WavFileWriter writer;
+    stream.Result = writer.Open(stream.FilePath.wstring(), format);
+
+    const auto packetDuration = std::chrono::duration_cast<BenchmarkClock::duration>(
+        std::chrono::duration<double>(static_cast<double>(packetBytes / format.BytesPerFrame()) / format.SampleRate));
+
+    const auto onData = [&](const BYTE* data, size_t size) {
+        const auto now = BenchmarkClock::now();
+        if (SUCCEEDED(stream.Result)) {
+            stream.Result = writer.Append(data, size);
+        }
+
+        const UINT64 previous = stream.ConsumedBytes;
+        stream.ConsumedBytes += size;
+        if (endToEnd) {
+            for (UINT64 packet = previous / packetBytes; packet < stream.ConsumedBytes / packetBytes; ++packet) {
+                const auto captured = stream.Source->GetStartTime() + packetDuration * static_cast<int64_t>(packet + 1);
+                endToEnd->Record(ToNanoseconds(now - captured));
+            }
+        }
+
+        if (delayMs > 0) {
+            Sleep(delayMs);
+        }
+    };
+
+    std::vector<BYTE> buffer(ConsumerBufferSize);
+    if (transport == TransportType::SharedMemory) {
+        SharedMemoryReader reader;
+        if (const HRESULT hr = reader.Open(stream.PipeId, captureId); FAILED(hr)) {
+            stream.Result = hr;
+            return;
+        }
+
+        int read;
+        while ((read = reader.Read(buffer.data(), static_cast<int>(buffer.size()), 100)) >= 0) {
+            if (read > 0) {
+                onData(buffer.data(), static_cast<size_t>(read));
+            }
+        }
+        stream.LostRecords = reader.GetLostRecords();
+    }
+    else {
+        wchar_t pipeName[256];
+        swprintf_s(pipeName, _countof(pipeName), L"\\\\.\\pipe\\AudioDataPipe_%lu_%lld", stream.PipeId, captureId);
+
+        wil::unique_hfile pipe(CreateFileW(pipeName, GENERIC_READ, 0, nullptr, OPEN_EXISTING, 0, nullptr));
+        if (!pipe) {
+            stream.Result = HRESULT_FROM_WIN32(GetLastError());
+            return;
+        }
+
+        DWORD read = 0;
+        while (ReadFile(pipe.get(), buffer.data(), static_cast<DWORD>(buffer.size()), &read, nullptr) && read > 0) {
+            onData(buffer.data(), read);
+        }
+    }
+
+    writer.Close();
+}
+
+static void AppendLatency(std::ostringstream& json, const char* name, const LatencyHistogram& histogram) {
+    const auto micros = [](uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1000.0; };
+    json << ",\"" << name << "\":{"
+        << "\"count\":" << histogram.GetCount()
+        << ",\"mean\":" << histogram.GetMean() / 1000.0
+        << ",\"p50\":" << micros(histogram.GetPercentile(50.0))
+        << ",\"p90\":" << micros(histogram.GetPercentile(90.0))
+        << ",\"p99\":" << micros(histogram.GetPercentile(99.0))
+        << ",\"p999\":" << micros(histogram.GetPercentile(99.9))
+        << ",\"max\":" << micros(histogram.GetMax())
+        << "}";
+}
+
+static HRESULT RunOnce(const PipelineBenchmarkOptions& options, DWORD sourceCount, const std::filesystem::path& outputDirectory, std::ostream& results) {
+    static std::atomic<long long> runCounter{ 0 };
+    const long long captureId = GetTickCount64() * 1000 + (runCounter++ % 1000);
+
+    const auto transport = static_cast<TransportType>(options.Transport);
+    const DWORD packetFrames = options.PacketFrames != 0 ? options.PacketFrames : (std::max)(1ul, options.SampleRate / 100);
+
+    AudioFormat format;
+    format.SampleRate = options.SampleRate;
+    format.Channels = static_cast<uint16_t>(options.Channels);
+    format.BitsPerSample = 16;
+    const size_t packetBytes = static_cast<size_t>(packetFrames) * format.BytesPerFrame();
+    const WriteCoalescing coalescing{ options.CoalesceMaxBytes, options.CoalesceMaxLatencyMs };
+
+    BenchmarkRun run;
+    std::unique_ptr<AudioMixer> mixer;
+    if (options.MixdownEnabled) {
+        mixer = std::make_unique<AudioMixer>(captureId, options.SampleRate, transport);
+        mixer->SetCoalescing(coalescing);
+    }
+
+    std::vector<std::unique_ptr<BenchmarkStream>> streams;
+    HRESULT hr = S_OK;
+    for (DWORD i = 0; i < sourceCount && SUCCEEDED(hr); ++i) {
+        auto stream = std::make_unique<BenchmarkStream>();
+        stream->PipeId = FirstPipeId + i;
+        stream->FilePath = outputDirectory / (L"PipelineBenchmark_" + std::to_wstring(captureId) + L"_" + std::to_wstring(stream->PipeId) + L".wav");
+
+        SimulatedSourceInfo info{};
+        info.PipeId = stream->PipeId;
+        info.Signal = static_cast<int>(SignalType::Tone);
+        info.Frequency = 220.0f + 10.0f * i;
+        info.Amplitude = 0.25f;
+        info.SampleRate = options.SampleRate;
+        info.Channels = options.Channels;
+        info.PacketFrames = packetFrames;
+        info.JitterMicroseconds = options.JitterMicroseconds;
+
+        stream->Source = std::make_unique<SyntheticCaptureSource>(captureId, info, transport);
+        stream->Source->SetPacketObserver([&run](uint64_t, auto due, auto begin, auto end) {
+            run.CallbackLatency.Record(ToNanoseconds(end - begin));
+            run.SchedulingDelay.Record(ToNanoseconds(begin - due));
+        });
+        stream->Source->SetCoalescing(coalescing);
+        if (mixer) {
+            stream->Source->SetMixerInput(mixer->AddInput(stream->PipeId));
+        }
+
+        hr = stream->Source->StartCaptureAsync();
+        if (SUCCEEDED(hr)) {
+            stream->Consumer = std::thread(ConsumeStream, std::ref(*stream), captureId, transport, format, packetBytes,
+                options.ConsumerDelayMs, &run.EndToEndLatency);
+        }
+        streams.push_back(std::move(stream));
+    }
+
+    std::unique_ptr<BenchmarkStream> mixdown;
+    if (mixer && SUCCEEDED(hr)) {
+        hr = mixer->Start();
+        if (SUCCEEDED(hr)) {
+            AudioFormat mixFormat;
+            mixFormat.SampleRate = mixer->GetSampleRate();
+            mixFormat.Channels = AudioMixer::Channels;
+            mixFormat.BitsPerSample = 16;
+
+            mixdown = std::make_unique<BenchmarkStream>();
+            mixdown->PipeId = AudioMixer::MixdownPipeId;
+            mixdown->FilePath = outputDirectory / (L"PipelineBenchmark_" + std::to_wstring(captureId) + L"_mixdown.wav");
+            mixdown->Consumer = std::thread(ConsumeStream, std::ref(*mixdown), captureId, transport, mixFormat, packetBytes,
+                options.ConsumerDelayMs, nullptr);
+        }
+    }
+
+    PROCESS_MEMORY_COUNTERS_EX memory{};
+    size_t schedulerThreads = 0;
+    const auto start = BenchmarkClock::now();
+    const uint64_t cpuStart = GetProcessCpuTime();
+    if (SUCCEEDED(hr)) {
+        Sleep(options.DurationMs);
+        GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memory), sizeof(memory));
+        schedulerThreads = CaptureScheduler::GetInstance().GetWorkerCount();
+    }
+
+    // Sources first so the mixer and the consumers see the end of every stream.
+    for (auto& stream : streams) {
+        stream->Source->StopCaptureAsync();
+    }
+    const uint64_t cpuTime = GetProcessCpuTime() - cpuStart;
+    const auto elapsed = BenchmarkClock::now() - start;
+    if (mixer) {
+        mixer->Stop();
+    }
+
+    if (mixdown) {
+        streams.push_back(std::move(mixdown));
+    }
+
+    CaptureStats stats{};
+    UINT64 transportWrites = 0;
+    if (mixer) {
+        mixer->GetStats(stats);
+        transportWrites += stats.WriteCount;
+    }
+
+    UINT64 droppedFrames = mixer ? mixer->GetDroppedFrames() : 0;
+    UINT64 droppedBytes = 0;
+    UINT64 consumedBytes = 0;
+    int failedStreams = 0;
+    for (auto& stream : streams) {
+        if (stream->Consumer.joinable()) {
+            stream->Consumer.join();
+        }
+        if (stream->Source) {
+            droppedBytes += stream->Source->GetDroppedBytes();
+            droppedFrames += stream->Source->GetDroppedBytes() / format.BytesPerFrame();
+            stream->Source->GetStats(stats);
+            transportWrites += stats.WriteCount;
+        }
+        droppedFrames += stream->LostRecords * packetFrames;
+        consumedBytes += stream->ConsumedBytes;
+        failedStreams += FAILED(stream->Result) ? 1 : 0;
+
+        std::error_code error;
+        std::filesystem::remove(stream->FilePath, error);
+    }
+    RETURN_IF_FAILED(hr);
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::ostringstream json;
+    json << "{\"sources\":" << sourceCount
+        << ",\"transport\":\"" << (transport == TransportType::SharedMemory ? "SharedMemory" : "NamedPipe") << "\""
+        << ",\"mixdown\":" << (options.MixdownEnabled ? "true" : "false")
+        << ",\"sampleRate\":" << options.SampleRate
+        << ",\"channels\":" << options.Channels
+        << ",\"packetFrames\":" << packetFrames
+        << ",\"jitterUs\":" << options.JitterMicroseconds
+        << ",\"coalesceMaxBytes\":" << options.CoalesceMaxBytes
+        << ",\"coalesceMaxLatencyMs\":" << options.CoalesceMaxLatencyMs
+        << ",\"consumerDelayMs\":" << options.ConsumerDelayMs
+        << ",\"seconds\":" << seconds
+        << ",\"schedulerThreads\":" << schedulerThreads;
+    AppendLatency(json, "callbackLatencyUs", run.CallbackLatency);
+    AppendLatency(json, "schedulingDelayUs", run.SchedulingDelay);
+    AppendLatency(json, "endToEndLatencyUs", run.EndToEndLatency);
+    json << ",\"cpuPercentPerSource\":" << (seconds > 0.0 ? cpuTime / 1e5 / seconds / sourceCount : 0.0)
+        << ",\"workingSetBytes\":" << memory.WorkingSetSize
+        << ",\"privateBytes\":" << memory.PrivateUsage
+        << ",\"consumedBytes\":" << consumedBytes
+        << ",\"transportWritesPerSecond\":" << (seconds > 0.0 ? transportWrites / seconds : 0.0)
+        << ",\"droppedFrames\":" << droppedFrames
+        << ",\"droppedBytes\":" << droppedBytes
+        << ",\"failedStreams\":" << failedStreams
+        << "}";
+
+    results << json.str() << std::endl;
+    Logger::GetInstance().Log("Pipeline benchmark: " + json.str());
+    return S_OK;
+}
+
+HRESULT RunPipelineBenchmark(const PipelineBenchmarkOptions& options, const std::wstring& resultPath) {
+    RETURN_HR_IF(E_INVALIDARG, options.MaxSources == 0 || options.DurationMs == 0 || options.SampleRate == 0 ||
+        options.Channels == 0 || options.Channels > 8);
+
+    std::ofstream results(std::filesystem::path(resultPath), std::ios::app);
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED), !results);
+
+    std::filesystem::path outputDirectory = options.OutputDirectory && SysStringLen(options.OutputDirectory) > 0 ?
+        std::filesystem::path(options.OutputDirectory) : std::filesystem::temp_directory_path();
+
+    for (DWORD sourceCount = 1;; sourceCount = (std::min)(sourceCount * 2, options.MaxSources)) {
+        RETURN_IF_FAILED(RunOnce(options, sourceCount, outputDirectory, results));
+        if (sourceCount == options.MaxSources) {
+            break;
+        }
+    }
+    return S_OK;
+}
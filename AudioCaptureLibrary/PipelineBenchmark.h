@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Windows.h>
+#include <wtypes.h>
+#include <string>
+
+// Settings of RunPipelineBenchmark, shared with the managed side.
+struct PipelineBenchmarkOptions {
+    // Runs with N = 1, 2, 4, ... simulated sources up to and including MaxSources.
+    DWORD MaxSources = 128;
+    DWORD DurationMs = 5000;
+    DWORD SampleRate = 48000;
+    DWORD Channels = 2;
+    // Frames per packet, 0 for 10 ms packets.
+    DWORD PacketFrames = 0;
+    DWORD JitterMicroseconds = 0;
+    int Transport = 0;
+    BOOL MixdownEnabled = FALSE;
+    // Where the consumers write their WAV files, the temp directory when null. Files are deleted
+    // after each run.
+    BSTR OutputDirectory = nullptr;
+    // Write batching of every stream, see WriteCoalescing. Running the benchmark once per setting
+    // gives transport writes per second against end-to-end latency.
+    DWORD CoalesceMaxBytes = 0;
+    DWORD CoalesceMaxLatencyMs = 0;
+    // Slow consumer: every consumer sleeps this long after each read, so the transports back up and
+    // have to drop. The capture callback must stay as fast as without it.
+    DWORD ConsumerDelayMs = 0;
+};
+
+// Drives simulated sources through the whole pipeline: packet delivery, conversion, transport and
+// a consumer per stream that reads the transport and writes a WAV file, all in this process.
+//
+// Every run appends one JSON object per line to `resultPath`:
+// callback and end-to-end latency percentiles in microseconds, CPU time per source, memory,
+// transport writes (system calls for the pipe), dropped frames and the bytes the sources' rings
+// dropped. Returns the first error that prevented a run.
+HRESULT RunPipelineBenchmark(const PipelineBenchmarkOptions& options, const std::wstring& resultPath);
@@ -0,0 +1,291 @@
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#include "CpuFeatures.h"
+
+namespace {
+
+struct QualitySpec {
+    size_t Taps;
+    double AttenuationDb;
+};
+
+constexpr QualitySpec QualitySpecs[] = {
+    { 24, 70.0 },
+    { 48, 96.0 },
+    { 96, 120.0 },
+};
+
+constexpr double Pi = 3.14159265358979323846;
+
+size_t RoundUpTaps(size_t taps) {
+    return (taps + 7) & ~static_cast<size_t>(7);
+}
+
+// Zeroth order modified Bessel function of the first kind, for the Kaiser window.
+double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double halfX = x / 2.0;
+    for (int k = 1; k < 64; ++k) {
+        term *= halfX / k;
+        const double squared = term * term;
+        sum += squared;
+        if (squared < sum * 1e-15) {
+            break;
+        }
+    }
+    return sum;
+}
+
+std::shared_ptr<const ResamplerFilter> BuildFilter(uint32_t inputRate, uint32_t outputRate, ResamplerQuality quality) {
+    const uint32_t divisor = std::gcd(inputRate, outputRate);
+    auto filter = std::make_shared<ResamplerFilter>();
+    filter->InputRate = inputRate;
+    filter->OutputRate = outputRate;
+    filter->Interpolation = outputRate / divisor;
+    filter->Decimation = inputRate / divisor;
+    if (filter->Interpolation > ResamplerFilter::MaxPhases) {
+        return nullptr;
+    }
+
+    const QualitySpec& spec = QualitySpecs[static_cast<int>(quality)];
+    const double bandwidth = (std::min)(1.0, static_cast<double>(outputRate) / inputRate);
+
+    // Kaiser's estimate for the transition width reachable with spec.Taps taps at the narrower of
+    // the two rates. When downsampling the filter is stretched by the ratio to keep that width.
+    const double transition = (spec.AttenuationDb - 7.95) / (2.285 * static_cast<double>(spec.Taps) * 2.0 * Pi);
+    filter->Taps = RoundUpTaps(static_cast<size_t>(std::ceil(static_cast<double>(spec.Taps) / bandwidth)));
+
+    // Cutoff in cycles per sample of the upsampled prototype, placed so the stopband starts at the
+    // Nyquist frequency of the narrower rate.
+    const uint32_t phases = filter->Interpolation;
+    const double cutoff = (0.5 - transition / 2.0) * bandwidth / phases;
+    const double beta = 0.1102 * (spec.AttenuationDb - 8.7);
+    const size_t length = filter->Taps * phases;
+    // Centered on a whole sample of the upsampled rate so the delay can be compensated exactly.
+    const double center = static_cast<double>(length / 2);
+    const double windowScale = 1.0 / BesselI0(beta);
+
+    std::vector<double> prototype(length);
+    double sum = 0.0;
+    for (size_t n = 0; n < length; ++n) {
+        const double t = static_cast<double>(n) - center;
+        const double x = 2.0 * cutoff * t;
+        const double sinc = x == 0.0 ? 1.0 : std::sin(Pi * x) / (Pi * x);
+        const double ratio = t / center;
+        const double window = BesselI0(beta * std::sqrt((std::max)(0.0, 1.0 - ratio * ratio))) * windowScale;
+        prototype[n] = sinc * window;
+        sum += prototype[n];
+    }
+
+    // Each phase has (close to) unity gain at DC.
+    const double gain = phases / sum;
+    filter->Coefficients.resize(length);
+    for (uint32_t phase = 0; phase < phases; ++phase) {
+        float* coefficients = filter->Coefficients.data() + static_cast<size_t>(phase) * filter->Taps;
+        for (size_t tap = 0; tap < filter->Taps; ++tap) {
+            coefficients[filter->Taps - 1 - tap] = static_cast<float>(prototype[phase + tap * phases] * gain);
+        }
+    }
+    return filter;
+}
+
+// Dot products over a multiple of 8 samples.
+float DotScalar(const float* samples, const float* coefficients, size_t taps) {
+    float sums[4] = {};
+    for (size_t i = 0; i < taps; i += 4) {
+        sums[0] += samples[i] * coefficients[i];
+        sums[1] += samples[i + 1] * coefficients[i + 1];
+        sums[2] += samples[i + 2] * coefficients[i + 2];
+        sums[3] += samples[i + 3] * coefficients[i + 3];
+    }
+    return (sums[0] + sums[2]) + (sums[1] + sums[3]);
+}
+
+#ifdef AUDIO_SIMD_X86
+
+inline float HorizontalSum(__m128 value) {
+    const __m128 high = _mm_movehl_ps(value, value);
+    const __m128 pair = _mm_add_ps(value, high);
+    return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 0x55)));
+}
+
+float DotSse2(const float* samples, const float* coefficients, size_t taps) {
+    __m128 low = _mm_setzero_ps();
+    __m128 high = _mm_setzero_ps();
+    for (size_t i = 0; i < taps; i += 8) {
+        low = _mm_add_ps(low, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(coefficients + i)));
+        high = _mm_add_ps(high, _mm_mul_ps(_mm_loadu_ps(samples + i + 4), _mm_loadu_ps(coefficients + i + 4)));
+    }
+    return HorizontalSum(_mm_add_ps(low, high));
+}
+
+AVX2_TARGET float DotAvx2(const float* samples, const float* coefficients, size_t taps) {
+    __m256 first = _mm256_setzero_ps();
+    __m256 second = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= taps; i += 16) {
+        first = _mm256_add_ps(first, _mm256_mul_ps(_mm256_loadu_ps(samples + i), _mm256_loadu_ps(coefficients + i)));
+        second = _mm256_add_ps(second, _mm256_mul_ps(_mm256_loadu_ps(samples + i + 8), _mm256_loadu_ps(coefficients + i + 8)));
+    }
+    if (i < taps) {
+        first = _mm256_add_ps(first, _mm256_mul_ps(_mm256_loadu_ps(samples + i), _mm256_loadu_ps(coefficients + i)));
+    }
+    const __m256 sum = _mm256_add_ps(first, second);
+    return HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1)));
+}
+
+#endif
+
+using DotKernel = float (*)(const float*, const float*, size_t);
+
+DotKernel GetDotKernel() {
+    static const DotKernel kernel = []() -> DotKernel {
+#ifdef AUDIO_SIMD_X86
+        switch (GetInstructionSet()) {
+        case InstructionSet::Avx2:
+            return &DotAvx2;
+        case InstructionSet::Sse2:
+            return &DotSse2;
+        default:
+            break;
+        }
+#endif
+        return &DotScalar;
+    }();
+    return kernel;
+}
+
+}
+
+std::shared_ptr<const ResamplerFilter> ResamplerFilter::Get(uint32_t inputRate, uint32_t outputRate, ResamplerQuality quality) {
+    if (inputRate == 0 || outputRate == 0 || static_cast<size_t>(quality) >= std::size(QualitySpecs)) {
+        return nullptr;
+    }
+
+    static std::mutex cacheLock;
+    static std::map<std::tuple<uint32_t, uint32_t, ResamplerQuality>, std::shared_ptr<const ResamplerFilter>> cache;
+
+    std::lock_guard lock(cacheLock);
+    auto& filter = cache[{ inputRate, outputRate, quality }];
+    if (!filter) {
+        filter = BuildFilter(inputRate, outputRate, quality);
+    }
+    return filter;
+}
+
+bool PolyphaseResampler::Configure(uint32_t inputRate, uint32_t outputRate, uint32_t channels, ResamplerQuality quality) {
+    m_Filter = channels > 0 ? ResamplerFilter::Get(inputRate, outputRate, quality) : nullptr;
+    if (!m_Filter) {
+        return false;
+    }
+
+    m_Channels = channels;
+    Reset();
+    return true;
+}
+
+void PolyphaseResampler::Reset() {
+    if (!m_Filter) {
+        return;
+    }
+
+    const size_t taps = m_Filter->Taps;
+    m_HistoryStride = (std::max)(m_HistoryStride, taps * 2);
+    m_History.assign(m_HistoryStride * m_Channels, 0.0f);
+    m_HistoryFrames = taps - 1;
+
+    // Start half the prototype length in, which cancels the filter's group delay.
+    const size_t delay = taps * m_Filter->Interpolation / 2;
+    m_Position = taps - 1 + delay / m_Filter->Interpolation;
+    m_Phase = static_cast<uint32_t>(delay % m_Filter->Interpolation);
+}
+
+const float* PolyphaseResampler::Process(const float* input, size_t frames, size_t& outputFrames) {
+    outputFrames = 0;
+    if (!m_Filter) {
+        return nullptr;
+    }
+
+    const size_t taps = m_Filter->Taps;
+    const uint32_t interpolation = m_Filter->Interpolation;
+    const uint32_t decimation = m_Filter->Decimation;
+
+    if (m_HistoryFrames + frames > m_HistoryStride) {
+        const size_t stride = m_HistoryFrames + frames;
+        std::vector<float> history(stride * m_Channels);
+        for (uint32_t channel = 0; channel < m_Channels; ++channel) {
+            std::copy_n(m_History.data() + channel * m_HistoryStride, m_HistoryFrames, history.data() + channel * stride);
+        }
+        m_History = std::move(history);
+        m_HistoryStride = stride;
+    }
+
+    for (uint32_t channel = 0; channel < m_Channels; ++channel) {
+        float* history = m_History.data() + channel * m_HistoryStride + m_HistoryFrames;
+        for (size_t frame = 0; frame < frames; ++frame) {
+            history[frame] = input[frame * m_Channels + channel];
+        }
+    }
+    m_HistoryFrames += frames;
+
+    if (m_Position < m_HistoryFrames) {
+        const size_t maxFrames = (m_HistoryFrames - m_Position) * interpolation / decimation + 1;
+        if (m_Output.size() < maxFrames * m_Channels) {
+            m_Output.resize(maxFrames * m_Channels);
+        }
+
+        const DotKernel dot = GetDotKernel();
+        float* output = m_Output.data();
+        while (m_Position < m_HistoryFrames) {
+            const float* coefficients = m_Filter->GetPhase(m_Phase);
+            const float* window = m_History.data() + (m_Position - (taps - 1));
+            for (uint32_t channel = 0; channel < m_Channels; ++channel) {
+                *output++ = dot(window + channel * m_HistoryStride, coefficients, taps);
+            }
+
+            m_Phase += decimation;
+            m_Position += m_Phase / interpolation;
+            m_Phase %= interpolation;
+        }
+        outputFrames = static_cast<size_t>(output - m_Output.data()) / m_Channels;
+    }
+
+    // Keep the Taps - 1 samples before the next output position; when decimating the position can
+    // already be past the end of the input.
+    const size_t discard = (std::min)(m_Position - (taps - 1), m_HistoryFrames);
+    if (discard > 0) {
+        for (uint32_t channel = 0; channel < m_Channels; ++channel) {
+            float* history = m_History.data() + channel * m_HistoryStride;
+            std::copy(history + discard, history + m_HistoryFrames, history);
+        }
+        m_HistoryFrames -= discard;
+        m_Position -= discard;
+    }
+
+    return m_Output.data();
+}
+
+bool PcmResampler::Configure(SampleFormat format, uint32_t channels, uint32_t inputRate, uint32_t outputRate, ResamplerQuality quality) {
+    if (!m_ToFloat.Configure(format, SampleFormat::Float32) ||
+        !m_FromFloat.Configure(SampleFormat::Float32, format, format == SampleFormat::Int16)) {
+        return false;
+    }
+
+    m_Channels = channels;
+    return m_Resampler.Configure(inputRate, outputRate, channels, quality);
+}
+
+const uint8_t* PcmResampler::Process(const void* data, size_t frames, size_t& outputFrames) {
+    const auto* samples = reinterpret_cast<const float*>(m_ToFloat.Convert(data, frames * m_Channels));
+    const float* resampled = m_Resampler.Process(samples, frames, outputFrames);
+    return m_FromFloat.Convert(resampled, outputFrames * m_Channels);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SampleFormatConverter.h"
+
+// Trade-off between filter length and passband width / stopband rejection. Taps per phase and
+// attenuation: Low 24 / 70 dB, Medium 48 / 96 dB, High 96 / 120 dB (doubled and more when
+// downsampling by a large factor, so the transition band stays the same at the output rate).
+enum class ResamplerQuality {
+    Low,
+    Medium,
+    High,
+};
+
+// Kaiser-windowed sinc low-pass for the rational ratio OutputRate / InputRate = Interpolation /
+// Decimation, split into Interpolation phases. Each phase is stored reversed and zero padded to a
+// multiple of 8 taps, so an output sample is a single forward dot product over the input history.
+//
+// Tables are immutable and shared by all resamplers using the same rate pair and quality.
+struct ResamplerFilter {
+    // Rate pairs needing more phases than this (e.g. 44101 -> 48000) are rejected.
+    static constexpr uint32_t MaxPhases = 4096;
+
+    uint32_t InputRate = 0;
+    uint32_t OutputRate = 0;
+    uint32_t Interpolation = 0;
+    uint32_t Decimation = 0;
+    size_t Taps = 0;
+    std::vector<float> Coefficients;
+
+    const float* GetPhase(uint32_t phase) const { return Coefficients.data() + static_cast<size_t>(phase) * Taps; }
+
+    // Builds the table on first use and caches it for the lifetime of the process. Returns nullptr
+    // for invalid rates or a ratio beyond MaxPhases.
+    static std::shared_ptr<const ResamplerFilter> Get(uint32_t inputRate, uint32_t outputRate, ResamplerQuality quality);
+};
+
+// Streaming sample rate converter for interleaved float audio. Packets of any size can be fed,
+// the filter state carries over, so the output is the same as if the stream had been converted
+// in one piece. The filter delay is compensated: output frame n is aligned with input time
+// n / OutputRate, the last half filter length of the stream stays in the history.
+class PolyphaseResampler {
+public:
+    bool Configure(uint32_t inputRate, uint32_t outputRate, uint32_t channels, ResamplerQuality quality = ResamplerQuality::Medium);
+
+    // Converts `frames` input frames. The result stays valid until the next call and is
+    // `outputFrames` frames long, which may be 0 for very small packets.
+    const float* Process(const float* input, size_t frames, size_t& outputFrames);
+
+    // Forgets the stream history, e.g. after a discontinuity.
+    void Reset();
+
+    bool IsConfigured() const { return m_Filter != nullptr; }
+    uint32_t GetInputRate() const { return m_Filter ? m_Filter->InputRate : 0; }
+    uint32_t GetOutputRate() const { return m_Filter ? m_Filter->OutputRate : 0; }
+
+private:
+    std::shared_ptr<const ResamplerFilter> m_Filter;
+    uint32_t m_Channels = 0;
+
+    // Planar input history, m_HistoryStride samples per channel. The first Taps - 1 samples of a
+    // channel are the tail of the previous packet.
+    std::vector<float> m_History;
+    size_t m_HistoryStride = 0;
+    size_t m_HistoryFrames = 0;
+
+    // Newest input sample of the next output frame and its phase.
+    size_t m_Position = 0;
+    uint32_t m_Phase = 0;
+
+    std::vector<float> m_Output;
+};
+
+// PolyphaseResampler for the capture path: takes and returns interleaved PCM in the source's own
+// sample format, converting through float internally.
+class PcmResampler {
+public:
+    bool Configure(SampleFormat format, uint32_t channels, uint32_t inputRate, uint32_t outputRate,
+        ResamplerQuality quality = ResamplerQuality::Medium);
+
+    // Result stays valid until the next call, `outputFrames` frames in the configured format.
+    const uint8_t* Process(const void* data, size_t frames, size_t& outputFrames);
+
+    void Reset() { m_Resampler.Reset(); }
+    bool IsConfigured() const { return m_Resampler.IsConfigured(); }
+
+private:
+    uint32_t m_Channels = 0;
+    SampleFormatConverter m_ToFloat;
+    SampleFormatConverter m_FromFloat;
+    PolyphaseResampler m_Resampler;
+};
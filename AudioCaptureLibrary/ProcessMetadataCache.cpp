@@ -0,0 +1,150 @@
+#include "ProcessMetadataCache.h"
+
+#include <wil/resource.h>
+#include <filesystem>
+#include <vector>
+
+#pragma comment(lib, "Version.lib")
+
+static constexpr wchar_t UnknownProcessName[] = L"<Unknown>";
+
+ProcessMetadataCache::ProcessMetadataCache(std::function<void()> resolved, size_t capacity)
+    : m_Resolved(std::move(resolved)), m_Processes(capacity), m_Names(capacity) {}
+
+ProcessMetadataCache::~ProcessMetadataCache() {
+    {
+        std::lock_guard lock(m_Lock);
+        m_Stop = true;
+    }
+    m_QueueChanged.notify_all();
+
+    if (m_Resolver.joinable()) {
+        m_Resolver.join();
+    }
+}
+
+std::wstring ProcessMetadataCache::GetDisplayName(DWORD processId) {
+    // Limited rights are enough for the start time and the image name, also of elevated processes.
+    wil::unique_handle process(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId));
+    if (!process) {
+        return UnknownProcessName;
+    }
+
+    ProcessKey key = { processId, 0 };
+    FILETIME creationTime = {}, exitTime = {}, kernelTime = {}, userTime = {};
+    if (GetProcessTimes(process.get(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        key.StartTime = (static_cast<uint64_t>(creationTime.dwHighDateTime) << 32) | creationTime.dwLowDateTime;
+    }
+
+    std::wstring exePath;
+    {
+        std::lock_guard lock(m_Lock);
+        if (const std::wstring* cachedPath = m_Processes.Get(key)) {
+            ++m_Stats.Hits;
+            exePath = *cachedPath;
+        }
+        else {
+            ++m_Stats.Misses;
+        }
+    }
+
+    if (exePath.empty()) {
+        std::vector<wchar_t> buffer(MAX_PATH);
+        for (;;) {
+            DWORD size = static_cast<DWORD>(buffer.size());
+            if (QueryFullProcessImageNameW(process.get(), 0, buffer.data(), &size)) {
+                exePath.assign(buffer.data(), size);
+                break;
+            }
+            if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || buffer.size() >= 32768) {
+                return UnknownProcessName;
+            }
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+
+    std::unique_lock lock(m_Lock);
+    m_Processes.Put(key, exePath);
+
+    if (const std::wstring* name = m_Names.Get(exePath)) {
+        return *name;
+    }
+
+    if (m_Queued.insert(exePath).second) {
+        m_Queue.push_back(exePath);
+        if (!m_Resolver.joinable()) {
+            m_Resolver = std::thread(&ProcessMetadataCache::ResolverThread, this);
+        }
+        lock.unlock();
+        m_QueueChanged.notify_one();
+    }
+
+    return ToDisplayName(exePath);
+}
+
+ProcessMetadataStats ProcessMetadataCache::GetStats() const {
+    std::lock_guard lock(m_Lock);
+    return m_Stats;
+}
+
+std::optional<std::wstring> ProcessMetadataCache::ReadProductName(const std::wstring& exePath) {
+    DWORD dummy = 0;
+    DWORD infoSize = GetFileVersionInfoSize(exePath.c_str(), &dummy);
+    if (infoSize == 0) {
+        return std::nullopt;
+    }
+
+    std::vector<BYTE> versionInfo(infoSize);
+    if (!GetFileVersionInfo(exePath.c_str(), dummy, infoSize, versionInfo.data())) {
+        return std::nullopt;
+    }
+
+    void* productNameBuffer = nullptr;
+    UINT productNameLength = 0;
+    if (!VerQueryValue(versionInfo.data(), L"\\StringFileInfo\\040904b0\\ProductName", &productNameBuffer, &productNameLength) ||
+        productNameLength == 0) {
+        return std::nullopt;
+    }
+
+    return std::wstring(static_cast<wchar_t*>(productNameBuffer));
+}
+
+std::wstring ProcessMetadataCache::ToDisplayName(const std::wstring& name) {
+    std::filesystem::path p(name);
+    return p.stem().wstring();
+}
+
+void ProcessMetadataCache::Resolve(const std::wstring& exePath) {
+    auto productName = ReadProductName(exePath);
+    const std::wstring fileName = ToDisplayName(exePath);
+    const std::wstring name = productName ? ToDisplayName(*productName) : fileName;
+
+    {
+        std::lock_guard lock(m_Lock);
+        m_Names.Put(exePath, name);
+        m_Queued.erase(exePath);
+        ++m_Stats.Resolved;
+    }
+
+    // Lookups so far returned the file name, nothing to redo if that is what it stays.
+    if (name != fileName && m_Resolved) {
+        m_Resolved();
+    }
+}
+
+void ProcessMetadataCache::ResolverThread() {
+    std::unique_lock lock(m_Lock);
+    for (;;) {
+        m_QueueChanged.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+        if (m_Stop) {
+            return;
+        }
+
+        std::wstring exePath = std::move(m_Queue.front());
+        m_Queue.pop_front();
+
+        lock.unlock();
+        Resolve(exePath);
+        lock.lock();
+    }
+}
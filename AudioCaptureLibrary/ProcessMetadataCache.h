@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Windows.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+struct ProcessMetadataStats {
+    uint64_t Hits;
+    uint64_t Misses;
+    // Product names read from version resources by the resolver thread.
+    uint64_t Resolved;
+};
+
+// Display names of audio session processes: the product name from the executable's version
+// resource, the file name without extension until that is known or if there is none.
+//
+// Processes are remembered by PID and start time, so a reused PID is never given the name of the
+// process that had it before; product names are remembered per executable path. Both are bounded
+// and evict the least recently used entry. Version resources are read on a background thread, a
+// lookup that needs one returns the file name and `resolved` is called once the product name is
+// known, so that cached session lists can be dropped.
+//
+// Thread-safe.
+class ProcessMetadataCache {
+public:
+    static constexpr size_t DefaultCapacity = 256;
+
+    explicit ProcessMetadataCache(std::function<void()> resolved = nullptr, size_t capacity = DefaultCapacity);
+    ~ProcessMetadataCache();
+
+    ProcessMetadataCache(const ProcessMetadataCache&) = delete;
+    ProcessMetadataCache& operator=(const ProcessMetadataCache&) = delete;
+
+    // "<Unknown>" if the process cannot be opened.
+    std::wstring GetDisplayName(DWORD processId);
+
+    ProcessMetadataStats GetStats() const;
+
+private:
+    struct ProcessKey {
+        DWORD ProcessId;
+        uint64_t StartTime;
+
+        bool operator==(const ProcessKey&) const = default;
+    };
+
+    struct ProcessKeyHash {
+        size_t operator()(const ProcessKey& key) const {
+            return std::hash<uint64_t>()(key.StartTime ^ (static_cast<uint64_t>(key.ProcessId) << 32));
+        }
+    };
+
+    // Map with a recency list, Get() moves the entry to the front and Put() evicts from the back.
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruMap {
+    public:
+        explicit LruMap(size_t capacity) : m_Capacity(capacity) {}
+
+        const Value* Get(const Key& key) {
+            auto it = m_Index.find(key);
+            if (it == m_Index.end()) {
+                return nullptr;
+            }
+
+            m_Order.splice(m_Order.begin(), m_Order, it->second);
+            return &it->second->second;
+        }
+
+        void Put(const Key& key, Value value) {
+            if (auto it = m_Index.find(key); it != m_Index.end()) {
+                it->second->second = std::move(value);
+                m_Order.splice(m_Order.begin(), m_Order, it->second);
+                return;
+            }
+
+            m_Order.emplace_front(key, std::move(value));
+            m_Index[key] = m_Order.begin();
+            if (m_Order.size() > m_Capacity) {
+                m_Index.erase(m_Order.back().first);
+                m_Order.pop_back();
+            }
+        }
+
+    private:
+        size_t m_Capacity;
+        std::list<std::pair<Key, Value>> m_Order;
+        std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash> m_Index;
+    };
+
+    static std::optional<std::wstring> ReadProductName(const std::wstring& exePath);
+    static std::wstring ToDisplayName(const std::wstring& name);
+    void Resolve(const std::wstring& exePath);
+    void ResolverThread();
+
+    std::function<void()> m_Resolved;
+
+    mutable std::mutex m_Lock;
+    LruMap<ProcessKey, std::wstring, ProcessKeyHash> m_Processes;
+    // Display name per executable path, the file name for executables without a product name.
+    LruMap<std::wstring, std::wstring> m_Names;
+    ProcessMetadataStats m_Stats = {};
+
+    // Paths waiting for the resolver, queued once each.
+    std::deque<std::wstring> m_Queue;
+    std::unordered_set<std::wstring> m_Queued;
+    std::condition_variable m_QueueChanged;
+    bool m_Stop = false;
+    std::thread m_Resolver;
+};
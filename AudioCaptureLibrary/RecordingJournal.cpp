@@ -0,0 +1,219 @@
+#include "RecordingJournal.h"
+
+#include <wil/result.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Crc32.h"
+#include "Logger.h"
+
+namespace {
+
+constexpr size_t RecordCrcOffset = offsetof(RecordingJournalRecord, RecordCrc);
+
+struct JournalEntry {
+    RecordingJournalRecord Record;
+    std::vector<uint8_t> Header;
+};
+
+uint32_t ComputeRecordCrc(const RecordingJournalRecord& record, const std::vector<uint8_t>& header) {
+    const uint32_t crc = UpdateCrc32(0, &record, RecordCrcOffset);
+    return UpdateCrc32(crc, header.data(), header.size());
+}
+
+// Records up to the first one that is torn or does not continue the previous.
+std::vector<JournalEntry> ReadJournal(const std::filesystem::path& path) {
+    std::vector<JournalEntry> entries;
+    std::ifstream journal(path, std::ios::binary);
+
+    RecordingJournalHeader header;
+    if (!journal || !journal.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.Magic, RecordingJournalMagic, sizeof(header.Magic)) != 0 || header.Version != RecordingJournalVersion) {
+        return entries;
+    }
+
+    JournalEntry entry;
+    while (journal.read(reinterpret_cast<char*>(&entry.Record), sizeof(entry.Record))) {
+        const auto& record = entry.Record;
+        if (record.HeaderSize > RecordingJournalMaxHeaderSize || record.Segment != entries.size()) {
+            break;
+        }
+
+        entry.Header.resize(record.HeaderSize);
+        if (!journal.read(reinterpret_cast<char*>(entry.Header.data()), static_cast<std::streamsize>(entry.Header.size())) ||
+            ComputeRecordCrc(record, entry.Header) != record.RecordCrc) {
+            break;
+        }
+
+        if (!entries.empty()) {
+            const auto& previous = entries.back().Record;
+            if (record.DataOffset != previous.DataOffset + previous.DataSize) {
+                break;
+            }
+        }
+        if (record.FileSize < record.DataOffset + record.DataSize) {
+            break;
+        }
+
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+bool VerifySegment(std::ifstream& recording, const RecordingJournalRecord& record) {
+    if (!recording.seekg(static_cast<std::streamoff>(record.DataOffset))) {
+        return false;
+    }
+
+    std::vector<char> chunk(static_cast<size_t>((std::min)(record.DataSize, static_cast<uint64_t>(1024 * 1024))));
+    uint32_t crc = 0;
+    for (uint64_t remaining = record.DataSize; remaining > 0;) {
+        const size_t count = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(chunk.size())));
+        if (!recording.read(chunk.data(), static_cast<std::streamsize>(count))) {
+            return false;
+        }
+        crc = UpdateCrc32(crc, chunk.data(), count);
+        remaining -= count;
+    }
+
+    return crc == record.DataCrc;
+}
+
+}
+
+HRESULT RecordingJournal::Open(const std::wstring& filePath, uint64_t segmentSize, uint64_t dataOffset, const std::vector<uint8_t>& header) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, m_File.is_valid());
+    RETURN_HR_IF(E_INVALIDARG, segmentSize == 0 || header.size() > RecordingJournalMaxHeaderSize);
+
+    m_Path = GetPath(filePath);
+    m_File.reset(CreateFileW(m_Path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    RETURN_LAST_ERROR_IF(!m_File.is_valid());
+
+    m_SegmentSize = segmentSize;
+    m_NextCommit = segmentSize;
+    m_Segment = 0;
+    m_SegmentOffset = dataOffset;
+    m_SegmentBytes = 0;
+    m_SegmentCrc = 0;
+
+    RecordingJournalHeader journalHeader = {};
+    memcpy(journalHeader.Magic, RecordingJournalMagic, sizeof(journalHeader.Magic));
+    journalHeader.Version = RecordingJournalVersion;
+    DWORD written = 0;
+    RETURN_IF_WIN32_BOOL_FALSE(WriteFile(m_File.get(), &journalHeader, sizeof(journalHeader), &written, nullptr));
+
+    // Even a recording that dies before its first segment recovers to a valid empty file.
+    return WriteRecord(header, dataOffset);
+}
+
+void RecordingJournal::Update(const void* data, size_t size) {
+    m_SegmentCrc = UpdateCrc32(m_SegmentCrc, data, size);
+    m_SegmentBytes += size;
+}
+
+void RecordingJournal::UpdateZeros(uint64_t size) {
+    static constexpr uint8_t Zeros[4096] = {};
+    for (uint64_t remaining = size; remaining > 0;) {
+        const size_t count = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(sizeof(Zeros))));
+        Update(Zeros, count);
+        remaining -= count;
+    }
+}
+
+HRESULT RecordingJournal::Commit(uint64_t position, const std::vector<uint8_t>& header, uint64_t fileSize) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_File.is_valid());
+    RETURN_HR_IF(E_INVALIDARG, header.size() > RecordingJournalMaxHeaderSize);
+
+    m_NextCommit = position + m_SegmentSize;
+    if (m_SegmentBytes == 0) {
+        return S_OK;
+    }
+
+    ++m_Segment;
+    RETURN_IF_FAILED(WriteRecord(header, fileSize));
+
+    m_SegmentOffset += m_SegmentBytes;
+    m_SegmentBytes = 0;
+    m_SegmentCrc = 0;
+    return S_OK;
+}
+
+HRESULT RecordingJournal::Discard() {
+    if (!m_File.is_valid()) {
+        return S_OK;
+    }
+
+    m_File.reset();
+    RETURN_IF_WIN32_BOOL_FALSE(DeleteFileW(m_Path.c_str()));
+    return S_OK;
+}
+
+HRESULT RecordingJournal::WriteRecord(const std::vector<uint8_t>& header, uint64_t fileSize) {
+    RecordingJournalRecord record = {};
+    record.Segment = m_Segment;
+    record.HeaderSize = static_cast<uint32_t>(header.size());
+    record.DataOffset = m_SegmentOffset;
+    record.DataSize = m_SegmentBytes;
+    record.FileSize = fileSize;
+    record.DataCrc = m_SegmentCrc;
+    record.RecordCrc = ComputeRecordCrc(record, header);
+
+    // One write per record, a crash can only tear the last one.
+    std::vector<uint8_t> bytes(sizeof(record) + header.size());
+    memcpy(bytes.data(), &record, sizeof(record));
+    std::copy(header.begin(), header.end(), bytes.begin() + sizeof(record));
+
+    DWORD written = 0;
+    RETURN_IF_WIN32_BOOL_FALSE(WriteFile(m_File.get(), bytes.data(), static_cast<DWORD>(bytes.size()), &written, nullptr));
+    return S_OK;
+}
+
+HRESULT RecoverRecording(const std::wstring& filePath, RecoveredRecording& result) {
+    result = {};
+    const std::wstring journalPath = RecordingJournal::GetPath(filePath);
+
+    const auto entries = ReadJournal(journalPath);
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), entries.empty());
+
+    // The first entry is the bare header and always holds.
+    size_t kept = 0;
+    {
+        std::ifstream recording(std::filesystem::path(filePath), std::ios::binary);
+        RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), !recording);
+
+        for (size_t i = 1; i < entries.size(); ++i) {
+            if (!VerifySegment(recording, entries[i].Record)) {
+                result.Damaged = TRUE;
+                break;
+            }
+            kept = i;
+        }
+    }
+
+    const auto& last = entries[kept];
+    wil::unique_hfile file(CreateFileW(filePath.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    RETURN_LAST_ERROR_IF(!file.is_valid());
+
+    FILE_END_OF_FILE_INFO endOfFile = {};
+    endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(last.Record.FileSize);
+    RETURN_IF_WIN32_BOOL_FALSE(SetFileInformationByHandle(file.get(), FileEndOfFileInfo, &endOfFile, sizeof(endOfFile)));
+
+    DWORD written = 0;
+    RETURN_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), last.Header.data(), static_cast<DWORD>(last.Header.size()), &written, nullptr));
+    RETURN_IF_WIN32_BOOL_FALSE(FlushFileBuffers(file.get()));
+    file.reset();
+
+    if (!DeleteFileW(journalPath.c_str())) {
+        Logger::GetInstance().Log("Failed to delete the journal of a recovered recording, error " + std::to_string(GetLastError()),
+            LogLevel::Warning);
+    }
+
+    result.FileSize = last.Record.FileSize;
+    result.Segments = static_cast<DWORD>(kept);
+    return S_OK;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sidecar of a recording in progress (<recording>.journal) that makes the recording recoverable
+// after a crash or power loss. The recording is cut into fixed-duration segments; once a segment
+// has been handed to the disk a record is appended here with its position, its CRC-32 and the file
+// header that makes the recording valid up to its end. Layout:
+//
+//   RecordingJournalHeader
+//   records, each a RecordingJournalRecord and HeaderSize bytes of file header
+//
+// A completed recording deletes its journal, so any journal found later belongs to an interrupted
+// one. RecoverRecording() keeps the segments whose checksums still match, at most the last segment
+// and whatever was not yet on the disk is lost. All fields are little endian.
+
+static constexpr uint32_t RecordingJournalVersion = 1;
+static constexpr char RecordingJournalMagic[4] = { 'A', 'R', 'J', 'L' };
+static constexpr uint32_t RecordingJournalMaxHeaderSize = 4096;
+
+struct RecordingJournalHeader {
+    char Magic[4];
+    uint32_t Version;
+};
+
+struct RecordingJournalRecord {
+    // 0 for the header alone, written when the recording is opened.
+    uint32_t Segment;
+    uint32_t HeaderSize;
+    // Bytes of the recording covered by the segment, right after the previous segment.
+    uint64_t DataOffset;
+    uint64_t DataSize;
+    // Size of the recovered file, may add padding after the segment's data.
+    uint64_t FileSize;
+    uint32_t DataCrc;
+    // CRC-32 of the record up to this field and the header bytes, a torn record fails it.
+    uint32_t RecordCrc;
+};
+
+// Returned to the managed side by RecoverRecording.
+struct RecoveredRecording {
+    UINT64 FileSize;
+    // Segments kept, not counting the header-only record.
+    DWORD Segments;
+    // A segment failed its checksum, it and everything after it was cut off.
+    BOOL Damaged;
+};
+
+// Written by the recording's writer, on the writer's thread. Every byte appended to the recording
+// after `dataOffset` has to pass through Update() or UpdateZeros().
+class RecordingJournal {
+public:
+    static constexpr uint32_t DefaultSegmentMilliseconds = 10000;
+
+    static std::wstring GetPath(const std::wstring& filePath) { return filePath + L".journal"; }
+
+    RecordingJournal() = default;
+    ~RecordingJournal() = default;
+
+    RecordingJournal(const RecordingJournal&) = delete;
+    RecordingJournal& operator=(const RecordingJournal&) = delete;
+
+    // `segmentSize` is in the unit of the positions passed to IsSegmentDue(), the writer's input
+    // bytes. `header` is the recording's header as written at `dataOffset`.
+    HRESULT Open(const std::wstring& filePath, uint64_t segmentSize, uint64_t dataOffset, const std::vector<uint8_t>& header);
+    bool IsOpen() const { return m_File.is_valid(); }
+
+    void Update(const void* data, size_t size);
+    void UpdateZeros(uint64_t size);
+
+    bool IsSegmentDue(uint64_t position) const { return m_File.is_valid() && position >= m_NextCommit; }
+
+    // Ends the current segment. The writer has handed its data to the disk and `header` describes
+    // the recording up to here.
+    HRESULT Commit(uint64_t position, const std::vector<uint8_t>& header, uint64_t fileSize);
+
+    // The recording is complete, the journal is deleted.
+    HRESULT Discard();
+
+private:
+    HRESULT WriteRecord(const std::vector<uint8_t>& header, uint64_t fileSize);
+
+    wil::unique_hfile m_File;
+    std::wstring m_Path;
+    uint64_t m_SegmentSize = 0;
+    uint64_t m_NextCommit = 0;
+    uint32_t m_Segment = 0;
+    uint64_t m_SegmentOffset = 0;
+    uint64_t m_SegmentBytes = 0;
+    uint32_t m_SegmentCrc = 0;
+};
+
+// Rebuilds an interrupted recording from its journal: cuts the file after the last segment whose
+// checksum matches, writes that segment's header and deletes the journal. Fails without touching
+// the recording when the journal holds no usable record.
+HRESULT RecoverRecording(const std::wstring& filePath, RecoveredRecording& result);
@@ -0,0 +1,121 @@
+#include "ReplayBufferBenchmark.h"
+
+#include <Psapi.h>
+#include <wil/result.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "InstantReplayBuffer.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static constexpr DWORD PacketsPerSecond = 100;
+
+static uint64_t ToNanoseconds(BenchmarkClock::duration duration) {
+    const auto count = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    return count > 0 ? static_cast<uint64_t>(count) : 0;
+}
+
+static void AppendLatency(std::ostringstream& json, const char* name, const LatencyHistogram& histogram, double unit) {
+    const auto scaled = [unit](uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / unit; };
+    json << ",\"" << name << "\":{"
+        << "\"count\":" << histogram.GetCount()
+        << ",\"mean\":" << histogram.GetMean() / unit
+        << ",\"p50\":" << scaled(histogram.GetPercentile(50.0))
+        << ",\"p90\":" << scaled(histogram.GetPercentile(90.0))
+        << ",\"p99\":" << scaled(histogram.GetPercentile(99.0))
+        << ",\"max\":" << scaled(histogram.GetMax())
+        << "}";
+}
+
+HRESULT RunReplayBufferBenchmark(const ReplayBufferBenchmarkOptions& options, const std::wstring& resultPath) {
+    AudioFormat format;
+    format.SampleRate = options.SampleRate;
+    format.Channels = options.Channels;
+    format.BitsPerSample = options.BitsPerSample;
+    RETURN_HR_IF(E_INVALIDARG, !format.IsValid() || options.WindowSeconds == 0 || options.SaveSeconds == 0);
+
+    std::ofstream results(std::filesystem::path(resultPath), std::ios::app);
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED), !results);
+
+    const std::filesystem::path directory = options.Directory && SysStringLen(options.Directory) > 0 ?
+        std::filesystem::path(options.Directory) : std::filesystem::temp_directory_path();
+
+    InstantReplayBuffer buffer(format, options.WindowSeconds, options.FileBacked ? directory.wstring() : std::wstring());
+    RETURN_HR_IF(E_OUTOFMEMORY, !buffer.IsValid());
+
+    const size_t packetSize = static_cast<size_t>(format.SampleRate / PacketsPerSecond) * format.BytesPerFrame();
+    std::vector<uint8_t> packet(packetSize);
+    for (size_t i = 0; i < packet.size(); ++i) {
+        packet[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    // Fill: the first pass over the window touches every page of the storage.
+    LatencyHistogram appendLatency;
+    const uint64_t packets = static_cast<uint64_t>(options.WindowSeconds) * PacketsPerSecond;
+    const auto fillStart = BenchmarkClock::now();
+    for (uint64_t i = 0; i < packets; ++i) {
+        const auto before = BenchmarkClock::now();
+        buffer.Append(packet.data(), packet.size());
+        appendLatency.Record(ToNanoseconds(BenchmarkClock::now() - before));
+    }
+    const double fillSeconds = std::chrono::duration<double>(BenchmarkClock::now() - fillStart).count();
+
+    PROCESS_MEMORY_COUNTERS_EX memory = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memory), sizeof(memory));
+
+    // Saves race a capture running in real time, the way they do in the application.
+    std::atomic<bool> stop{ false };
+    std::thread capture([&] {
+        auto due = BenchmarkClock::now();
+        while (!stop.load(std::memory_order_relaxed)) {
+            buffer.Append(packet.data(), packet.size());
+            due += std::chrono::milliseconds(1000 / PacketsPerSecond);
+            std::this_thread::sleep_until(due);
+        }
+    });
+
+    LatencyHistogram saveLatency;
+    HRESULT firstError = S_OK;
+    const auto savePath = directory / (L"ReplayBufferBenchmark_" + std::to_wstring(GetTickCount64()) + L".wav");
+    for (DWORD i = 0; i < options.SaveCount; ++i) {
+        const auto before = BenchmarkClock::now();
+        const HRESULT hr = buffer.SaveToWav(options.SaveSeconds, savePath.wstring());
+        saveLatency.Record(ToNanoseconds(BenchmarkClock::now() - before));
+        firstError = SUCCEEDED(firstError) ? hr : firstError;
+
+        std::error_code error;
+        std::filesystem::remove(savePath, error);
+    }
+
+    stop.store(true, std::memory_order_relaxed);
+    capture.join();
+
+    const uint64_t windowBytes = static_cast<uint64_t>(options.WindowSeconds) * format.SampleRate * format.BytesPerFrame();
+
+    std::ostringstream json;
+    json << "{\"windowSeconds\":" << options.WindowSeconds
+        << ",\"windowBytes\":" << windowBytes
+        << ",\"fileBacked\":" << (buffer.IsFileBacked() ? "true" : "false")
+        << ",\"fillSeconds\":" << fillSeconds
+        << ",\"megabytesPerSecond\":" << (fillSeconds > 0.0 ? windowBytes / 1e6 / fillSeconds : 0.0);
+    AppendLatency(json, "appendLatencyUs", appendLatency, 1e3);
+    json << ",\"saveSeconds\":" << options.SaveSeconds;
+    AppendLatency(json, "saveLatencyMs", saveLatency, 1e6);
+    json << ",\"privateBytes\":" << memory.PrivateUsage
+        << ",\"workingSetBytes\":" << memory.WorkingSetSize
+        << ",\"hr\":" << firstError
+        << "}";
+
+    results << json.str() << std::endl;
+    Logger::GetInstance().Log("Replay buffer benchmark: " + json.str());
+    return firstError;
+}
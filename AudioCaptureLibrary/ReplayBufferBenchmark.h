@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Windows.h>
+#include <wtypes.h>
+#include <string>
+
+// Settings of RunReplayBufferBenchmark, shared with the managed side.
+struct ReplayBufferBenchmarkOptions {
+    // An hour of 48 kHz stereo float by default, about 1.4 GB.
+    DWORD WindowSeconds = 3600;
+    DWORD SampleRate = 48000;
+    WORD Channels = 2;
+    WORD BitsPerSample = 32;
+    // Length and number of the saves timed once the window is full.
+    DWORD SaveSeconds = 600;
+    DWORD SaveCount = 5;
+    // Keeps the window in a mapped file (see ReplayStorage) rather than in memory.
+    BOOL FileBacked = TRUE;
+    // Where the backing file and the saves go, the temp directory when null. Both are deleted
+    // after the run.
+    BSTR Directory = nullptr;
+};
+
+// Fills an instant replay window of WindowSeconds as fast as it takes 10 ms packets, then saves
+// the last SaveSeconds SaveCount times while appending continues on another thread.
+//
+// Appends one JSON object to `resultPath`: fill throughput in MB/s, latency percentiles in
+// microseconds of the appends, save latency in milliseconds and the process's private and
+// resident memory with the window full.
+HRESULT RunReplayBufferBenchmark(const ReplayBufferBenchmarkOptions& options, const std::wstring& resultPath);
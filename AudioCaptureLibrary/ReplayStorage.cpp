@@ -0,0 +1,106 @@
+#include "ReplayStorage.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Logger.h"
+
+bool ReplayStorage::Resize(size_t size) {
+    const bool toFile = !m_BackingDirectory.empty() && size >= FileBackedMinSize;
+
+    if (!toFile && !IsFileBacked()) {
+        m_Heap.resize(size);
+        m_Data = m_Heap.data();
+        m_Size = size;
+        return true;
+    }
+
+    // The file keeps its contents across mappings.
+    if (toFile && IsFileBacked()) {
+        m_View.reset();
+        m_Mapping.reset();
+        if (!MapFile(size)) {
+            Release();
+            return false;
+        }
+        return true;
+    }
+
+    const size_t kept = (std::min)(size, m_Size);
+    if (toFile) {
+        if (!MapFile(size)) {
+            Release();
+            return false;
+        }
+        if (kept > 0) {
+            memcpy(m_Data, m_Heap.data(), kept);
+        }
+        std::vector<uint8_t>().swap(m_Heap);
+    }
+    else {
+        std::vector<uint8_t> heap(size);
+        memcpy(heap.data(), m_Data, kept);
+        Release();
+        m_Heap = std::move(heap);
+        m_Data = m_Heap.data();
+        m_Size = size;
+    }
+
+    return true;
+}
+
+bool ReplayStorage::MapFile(size_t size) {
+    if (!m_File.is_valid()) {
+        wchar_t path[MAX_PATH];
+        if (!GetTempFileNameW(m_BackingDirectory.c_str(), L"arb", 0, path)) {
+            Logger::GetInstance().Log("Failed to create replay backing file, error " + std::to_string(GetLastError()), LogLevel::Error);
+            return false;
+        }
+
+        // Temporary files are only written back when memory runs short.
+        m_File.reset(CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr));
+        if (!m_File.is_valid()) {
+            Logger::GetInstance().Log("Failed to open replay backing file, error " + std::to_string(GetLastError()), LogLevel::Error);
+            DeleteFileW(path);
+            return false;
+        }
+    }
+
+    // Setting the size up front allocates the whole ring, running out of disk later would fault on
+    // a write into the mapping.
+    const uint64_t fileSize = FileHeaderSize + static_cast<uint64_t>(size);
+    FILE_END_OF_FILE_INFO endOfFile = {};
+    endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(fileSize);
+    if (!SetFileInformationByHandle(m_File.get(), FileEndOfFileInfo, &endOfFile, sizeof(endOfFile))) {
+        Logger::GetInstance().Log("Failed to size replay backing file, error " + std::to_string(GetLastError()), LogLevel::Error);
+        return false;
+    }
+
+    m_Mapping.reset(CreateFileMappingW(m_File.get(), nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(fileSize >> 32), static_cast<DWORD>(fileSize), nullptr));
+    if (!m_Mapping) {
+        Logger::GetInstance().Log("Failed to map replay backing file, error " + std::to_string(GetLastError()), LogLevel::Error);
+        return false;
+    }
+
+    m_View.reset(static_cast<uint8_t*>(MapViewOfFile(m_Mapping.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0)));
+    if (!m_View) {
+        Logger::GetInstance().Log("Failed to map replay backing file, error " + std::to_string(GetLastError()), LogLevel::Error);
+        m_Mapping.reset();
+        return false;
+    }
+
+    m_Data = m_View.get() + FileHeaderSize;
+    m_Size = size;
+    return true;
+}
+
+void ReplayStorage::Release() {
+    m_View.reset();
+    m_Mapping.reset();
+    m_File.reset();
+    std::vector<uint8_t>().swap(m_Heap);
+    m_Data = nullptr;
+    m_Size = 0;
+}
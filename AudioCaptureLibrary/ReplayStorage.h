@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+static constexpr char ReplayFileMagic[4] = { 'A', 'R', 'P', 'F' };
+static constexpr uint32_t ReplayFileVersion = 1;
+
+// Start of a replay backing file, the ring follows at ReplayStorage::FileHeaderSize. Kept current
+// by the InstantReplayBuffer so that the file describes itself.
+struct ReplayFileHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t SampleRate;
+    uint16_t Channels;
+    uint16_t BitsPerSample;
+    uint64_t CapacityFrames;
+    uint64_t WrittenFrames;
+};
+
+// Memory behind an InstantReplayBuffer. Small windows live on the heap. With a backing directory,
+// windows from FileBackedMinSize on live in a preallocated temporary file mapped into memory
+// instead, so the OS page cache decides how much of an hour-long window stays resident and writes
+// the rest out under memory pressure. The file is deleted when it is closed, also by a crash.
+class ReplayStorage {
+public:
+    static constexpr size_t FileBackedMinSize = 256ull * 1024 * 1024;
+    // One page, keeps the ring page aligned.
+    static constexpr size_t FileHeaderSize = 4096;
+
+    explicit ReplayStorage(std::wstring backingDirectory = {}) : m_BackingDirectory(std::move(backingDirectory)) {}
+
+    ReplayStorage(const ReplayStorage&) = delete;
+    ReplayStorage& operator=(const ReplayStorage&) = delete;
+
+    // Keeps the first min(old, new) bytes, moving between heap and file as the size requires.
+    // Leaves the storage empty on failure.
+    bool Resize(size_t size);
+
+    uint8_t* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+    bool IsFileBacked() const { return m_File.is_valid(); }
+    // Null on the heap.
+    ReplayFileHeader* GetFileHeader() const { return m_View ? reinterpret_cast<ReplayFileHeader*>(m_View.get()) : nullptr; }
+
+private:
+    bool MapFile(size_t size);
+    void Release();
+
+    std::wstring m_BackingDirectory;
+    std::vector<uint8_t> m_Heap;
+    wil::unique_hfile m_File;
+    wil::unique_handle m_Mapping;
+    wil::unique_mapview_ptr<uint8_t> m_View;
+    uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+};
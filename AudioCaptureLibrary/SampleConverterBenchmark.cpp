@@ -0,0 +1,177 @@
+#include "SampleConverterBenchmark.h"
+
+#include <wil/result.h>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "Logger.h"
+#include "SampleFormatConverter.h"
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+static constexpr SampleFormat Formats[] = {
+    SampleFormat::Int16, SampleFormat::Int24, SampleFormat::Int32, SampleFormat::Int24In32, SampleFormat::Float32,
+};
+
+static constexpr InstructionSet InstructionSets[] = { InstructionSet::Scalar, InstructionSet::Sse2, InstructionSet::Avx2 };
+
+static const char* GetFormatName(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::Int16:
+        return "int16";
+    case SampleFormat::Int24:
+        return "int24";
+    case SampleFormat::Int32:
+        return "int32";
+    case SampleFormat::Int24In32:
+        return "int24in32";
+    case SampleFormat::Float32:
+        return "float32";
+    }
+    return "unknown";
+}
+
+static const char* GetInstructionSetName(InstructionSet instructionSet) {
+    switch (instructionSet) {
+    case InstructionSet::Scalar:
+        return "scalar";
+    case InstructionSet::Sse2:
+        return "sse2";
+    case InstructionSet::Avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+static int GetValidBits(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::Int16:
+        return 16;
+    case SampleFormat::Int24:
+    case SampleFormat::Int24In32:
+        return 24;
+    default:
+        return 32;
+    }
+}
+
+// Dither is only added where precision is lost: float to integer, or to fewer integer bits.
+static bool DitherApplies(SampleFormat source, SampleFormat destination) {
+    if (destination == SampleFormat::Float32) {
+        return false;
+    }
+    return source == SampleFormat::Float32 || GetValidBits(destination) < GetValidBits(source);
+}
+
+// Noise slightly beyond full scale, so the saturating paths are part of the measurement.
+static std::vector<uint8_t> GenerateSource(SampleFormat format, size_t sampleCount) {
+    std::vector<float> noise(sampleCount);
+    uint32_t state = 1;
+    for (auto& value : noise) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        value = static_cast<float>(state >> 8) * (2.1f / 16777216.0f) - 1.05f;
+    }
+
+    std::vector<uint8_t> data(sampleCount * SampleFormatConverter::GetSampleSize(format));
+    const auto convert = SampleFormatConverter::GetKernel(SampleFormat::Float32, format, false, InstructionSet::Scalar);
+    if (convert) {
+        DitherState dither;
+        convert(reinterpret_cast<const uint8_t*>(noise.data()), data.data(), sampleCount, dither);
+    }
+    else {
+        memcpy(data.data(), noise.data(), data.size());
+    }
+    return data;
+}
+
+// Samples per second of `kernel` over blocks of `source`, run for about `duration`.
+static double TimeKernel(SampleFormatConverter::Kernel kernel, const std::vector<uint8_t>& source, std::vector<uint8_t>& destination,
+    size_t blockSamples, BenchmarkClock::duration duration) {
+    DitherState dither;
+    kernel(source.data(), destination.data(), blockSamples, dither);
+
+    uint64_t blocks = 0;
+    const auto start = BenchmarkClock::now();
+    auto elapsed = BenchmarkClock::duration::zero();
+    do {
+        // The clock is read once per batch, a call is well below a microsecond.
+        for (int k = 0; k < 64; ++k) {
+            kernel(source.data(), destination.data(), blockSamples, dither);
+        }
+        blocks += 64;
+        elapsed = BenchmarkClock::now() - start;
+    } while (elapsed < duration);
+
+    return static_cast<double>(blocks * blockSamples) / std::chrono::duration<double>(elapsed).count();
+}
+
+HRESULT RunSampleConverterBenchmark(const SampleConverterBenchmarkOptions& options, const std::wstring& resultPath) {
+    RETURN_HR_IF(E_INVALIDARG, options.BlockSamples == 0 || options.DurationMs == 0);
+
+    std::ofstream results(std::filesystem::path(resultPath), std::ios::app);
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED), !results);
+
+    const size_t blockSamples = options.BlockSamples;
+    const auto duration = std::chrono::milliseconds(options.DurationMs);
+    const InstructionSet supported = GetInstructionSet();
+
+    std::vector<std::vector<uint8_t>> sources;
+    for (const auto format : Formats) {
+        sources.push_back(GenerateSource(format, blockSamples));
+    }
+    std::vector<uint8_t> destination(blockSamples * 4);
+
+    for (size_t s = 0; s < std::size(Formats); ++s) {
+        for (const auto destinationFormat : Formats) {
+            const SampleFormat sourceFormat = Formats[s];
+            if (sourceFormat == destinationFormat) {
+                continue;
+            }
+
+            for (const bool dither : { false, true }) {
+                if (dither && !DitherApplies(sourceFormat, destinationFormat)) {
+                    continue;
+                }
+
+                SampleFormatConverter::Kernel previous = nullptr;
+                double scalarRate = 0.0;
+                for (const auto instructionSet : InstructionSets) {
+                    if (instructionSet > supported) {
+                        break;
+                    }
+
+                    const auto kernel = SampleFormatConverter::GetKernel(sourceFormat, destinationFormat, dither, instructionSet);
+                    if (!kernel || kernel == previous) {
+                        continue;
+                    }
+                    previous = kernel;
+
+                    const double rate = TimeKernel(kernel, sources[s], destination, blockSamples, duration);
+                    if (instructionSet == InstructionSet::Scalar) {
+                        scalarRate = rate;
+                    }
+
+                    std::ostringstream json;
+                    json << "{\"source\":\"" << GetFormatName(sourceFormat) << "\""
+                        << ",\"destination\":\"" << GetFormatName(destinationFormat) << "\""
+                        << ",\"dither\":" << (dither ? "true" : "false")
+                        << ",\"instructionSet\":\"" << GetInstructionSetName(instructionSet) << "\""
+                        << ",\"blockSamples\":" << blockSamples
+                        << ",\"samplesPerSecond\":" << rate
+                        << ",\"speedupOverScalar\":" << (scalarRate > 0.0 ? rate / scalarRate : 0.0)
+                        << "}";
+
+                    results << json.str() << std::endl;
+                    Logger::GetInstance().Log("Format converter benchmark: " + json.str());
+                }
+            }
+        }
+    }
+    return S_OK;
+}
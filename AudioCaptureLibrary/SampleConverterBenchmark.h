@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+
+// Settings of RunSampleConverterBenchmark, shared with the managed side.
+struct SampleConverterBenchmarkOptions {
+    // Samples per kernel call, 10 ms of 48 kHz stereo by default.
+    DWORD BlockSamples = 960;
+    // Time each kernel is run for.
+    DWORD DurationMs = 200;
+};
+
+// Runs every SampleFormatConverter kernel on the calling thread: each format pair, with and
+// without dither where dither applies, once per instruction set the CPU supports. Instruction sets
+// without a kernel of their own for a pair are skipped instead of timing the fallback again.
+//
+// Appends one JSON object per kernel to `resultPath`: samples per second and the speedup over the
+// scalar kernel of the same pair.
+HRESULT RunSampleConverterBenchmark(const SampleConverterBenchmarkOptions& options, const std::wstring& resultPath);
@@ -0,0 +1,445 @@
+#include "SampleFormatConverter.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "CpuFeatures.h"
+
+using Kernel = SampleFormatConverter::Kernel;
+
+DitherState::DitherState(uint32_t seed) {
+    for (size_t i = 0; i < LaneCount; ++i) {
+        // Any non-zero start works for xorshift, spread the lanes apart.
+        Lanes[i] = (seed + static_cast<uint32_t>(i) * 0x6C8E9CF5u) | 1u;
+    }
+}
+
+namespace {
+
+template <SampleFormat Format> using Traits = SampleFormatTraits<Format>;
+
+// Scale from [-1, 1) to the integer range and the largest float that still converts without overflow.
+template <SampleFormat Format> constexpr float FloatScale = static_cast<float>(1ull << (Traits<Format>::ValidBits - 1));
+template <SampleFormat Format> constexpr float FloatMax = Traits<Format>::ValidBits < 32 ? FloatScale<Format> - 1.0f : 2147483520.0f;
+
+constexpr float IntToFloatScale = 1.0f / 2147483648.0f;
+
+inline uint32_t NextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Uniform in [0, 1) from the top 23 bits, the vector kernels use the same mapping.
+inline float ToUnit(uint32_t random) {
+    const uint32_t bits = (random >> 9) | 0x3F800000u;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value - 1.0f;
+}
+
+// Triangular noise in (-1, 1) LSB.
+inline float NextTpdf(DitherState& dither) {
+    const float a = ToUnit(NextRandom(dither.Lanes[0]));
+    return a - ToUnit(NextRandom(dither.Lanes[0]));
+}
+
+// Integer samples are widened to a left-justified int32 so every format shares one scale.
+template <SampleFormat Format> int32_t LoadInt(const uint8_t* source);
+
+template <> int32_t LoadInt<SampleFormat::Int16>(const uint8_t* source) {
+    int16_t value;
+    memcpy(&value, source, sizeof(value));
+    return static_cast<int32_t>(static_cast<uint32_t>(value) << 16);
+}
+
+template <> int32_t LoadInt<SampleFormat::Int24>(const uint8_t* source) {
+    return static_cast<int32_t>((static_cast<uint32_t>(source[0]) << 8) |
+        (static_cast<uint32_t>(source[1]) << 16) | (static_cast<uint32_t>(source[2]) << 24));
+}
+
+template <> int32_t LoadInt<SampleFormat::Int32>(const uint8_t* source) {
+    int32_t value;
+    memcpy(&value, source, sizeof(value));
+    return value;
+}
+
+template <> int32_t LoadInt<SampleFormat::Int24In32>(const uint8_t* source) {
+    return static_cast<int32_t>(static_cast<uint32_t>(LoadInt<SampleFormat::Int32>(source)) & 0xFFFFFF00u);
+}
+
+template <SampleFormat Format> float LoadFloat(const uint8_t* source) {
+    if constexpr (Traits<Format>::IsFloat) {
+        float value;
+        memcpy(&value, source, sizeof(value));
+        return value;
+    }
+    else {
+        return static_cast<float>(LoadInt<Format>(source)) * IntToFloatScale;
+    }
+}
+
+// `value` is already in the destination's range.
+template <SampleFormat Format> void StoreInt(uint8_t* destination, int32_t value);
+
+template <> void StoreInt<SampleFormat::Int16>(uint8_t* destination, int32_t value) {
+    const int16_t sample = static_cast<int16_t>(value);
+    memcpy(destination, &sample, sizeof(sample));
+}
+
+template <> void StoreInt<SampleFormat::Int24>(uint8_t* destination, int32_t value) {
+    const uint32_t sample = static_cast<uint32_t>(value);
+    destination[0] = static_cast<uint8_t>(sample);
+    destination[1] = static_cast<uint8_t>(sample >> 8);
+    destination[2] = static_cast<uint8_t>(sample >> 16);
+}
+
+template <> void StoreInt<SampleFormat::Int32>(uint8_t* destination, int32_t value) {
+    memcpy(destination, &value, sizeof(value));
+}
+
+template <> void StoreInt<SampleFormat::Int24In32>(uint8_t* destination, int32_t value) {
+    StoreInt<SampleFormat::Int32>(destination, static_cast<int32_t>(static_cast<uint32_t>(value) << 8));
+}
+
+template <SampleFormat Source, SampleFormat Destination, bool Dither>
+void ConvertScalar(const uint8_t* source, uint8_t* destination, size_t sampleCount, DitherState& dither) {
+    using S = Traits<Source>;
+    using D = Traits<Destination>;
+
+    for (size_t i = 0; i < sampleCount; ++i, source += S::Size, destination += D::Size) {
+        if constexpr (D::IsFloat) {
+            const float value = LoadFloat<Source>(source);
+            memcpy(destination, &value, sizeof(value));
+        }
+        else if constexpr (S::IsFloat) {
+            float value = LoadFloat<Source>(source) * FloatScale<Destination>;
+            if constexpr (Dither) {
+                value += NextTpdf(dither);
+            }
+
+            // NaN becomes silence rather than negative full scale, the vector kernels mask it the same way.
+            value = value == value ? value : 0.0f;
+            value = value > -FloatScale<Destination> ? value : -FloatScale<Destination>;
+            value = value < FloatMax<Destination> ? value : FloatMax<Destination>;
+            StoreInt<Destination>(destination, static_cast<int32_t>(std::lrintf(value)));
+        }
+        else if constexpr (S::ValidBits <= D::ValidBits) {
+            StoreInt<Destination>(destination, LoadInt<Source>(source) >> (32 - D::ValidBits));
+        }
+        else {
+            constexpr int shift = 32 - D::ValidBits;
+            constexpr int64_t lowest = -(int64_t(1) << (D::ValidBits - 1));
+            constexpr int64_t highest = (int64_t(1) << (D::ValidBits - 1)) - 1;
+
+            int64_t value = LoadInt<Source>(source);
+            if constexpr (Dither) {
+                value += static_cast<int64_t>(NextTpdf(dither) * static_cast<float>(1 << shift));
+            }
+
+            value = (value + (int64_t(1) << (shift - 1))) >> shift;
+            value = value < lowest ? lowest : (value > highest ? highest : value);
+            StoreInt<Destination>(destination, static_cast<int32_t>(value));
+        }
+    }
+}
+
+template <SampleFormat Format>
+constexpr bool HasVectorIntKernel = Format == SampleFormat::Int16 || Format == SampleFormat::Int32 || Format == SampleFormat::Int24In32;
+
+#ifdef AUDIO_SIMD_X86
+
+inline __m128i NextRandomSse2(__m128i& state) {
+    state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+    state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+    state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+    return state;
+}
+
+inline __m128 NextTpdfSse2(__m128i& state) {
+    const __m128i exponent = _mm_set1_epi32(0x3F800000);
+    const __m128 a = _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(NextRandomSse2(state), 9), exponent));
+    const __m128 b = _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(NextRandomSse2(state), 9), exponent));
+    return _mm_sub_ps(a, b);
+}
+
+template <SampleFormat Destination, bool Dither>
+inline __m128i FloatToIntSse2(__m128 value, __m128i& state) {
+    value = _mm_mul_ps(value, _mm_set1_ps(FloatScale<Destination>));
+    if constexpr (Dither) {
+        value = _mm_add_ps(value, NextTpdfSse2(state));
+    }
+
+    value = _mm_and_ps(value, _mm_cmpord_ps(value, value));
+    value = _mm_max_ps(value, _mm_set1_ps(-FloatScale<Destination>));
+    value = _mm_min_ps(value, _mm_set1_ps(FloatMax<Destination>));
+    return _mm_cvtps_epi32(value);
+}
+
+template <SampleFormat Destination, bool Dither>
+void ConvertFromFloatSse2(const uint8_t* source, uint8_t* destination, size_t sampleCount, DitherState& dither) {
+    const float* input = reinterpret_cast<const float*>(source);
+    __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither.Lanes));
+    size_t i = 0;
+
+    if constexpr (Destination == SampleFormat::Int16) {
+        for (; i + 8 <= sampleCount; i += 8) {
+            const __m128i low = FloatToIntSse2<Destination, Dither>(_mm_loadu_ps(input + i), state);
+            const __m128i high = FloatToIntSse2<Destination, Dither>(_mm_loadu_ps(input + i + 4), state);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 2), _mm_packs_epi32(low, high));
+        }
+    }
+    else {
+        for (; i + 4 <= sampleCount; i += 4) {
+            __m128i value = FloatToIntSse2<Destination, Dither>(_mm_loadu_ps(input + i), state);
+            if constexpr (Destination == SampleFormat::Int24In32) {
+                value = _mm_slli_epi32(value, 8);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), value);
+        }
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dither.Lanes), state);
+    ConvertScalar<SampleFormat::Float32, Destination, Dither>(source + i * 4, destination + i * Traits<Destination>::Size, sampleCount - i, dither);
+}
+
+template <SampleFormat Source>
+void ConvertToFloatSse2(const uint8_t* source, uint8_t* destination, size_t sampleCount, DitherState& dither) {
+    float* output = reinterpret_cast<float*>(destination);
+    const __m128 scale = _mm_set1_ps(IntToFloatScale);
+    size_t i = 0;
+
+    if constexpr (Source == SampleFormat::Int16) {
+        for (; i + 8 <= sampleCount; i += 8) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+            const __m128i low = _mm_unpacklo_epi16(_mm_setzero_si128(), value);
+            const __m128i high = _mm_unpackhi_epi16(_mm_setzero_si128(), value);
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+            _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+        }
+    }
+    else {
+        const __m128i mask = _mm_set1_epi32(Source == SampleFormat::Int24In32 ? static_cast<int>(0xFFFFFF00u) : -1);
+        for (; i + 4 <= sampleCount; i += 4) {
+            const __m128i value = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4)), mask);
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(value), scale));
+        }
+    }
+
+    ConvertScalar<Source, SampleFormat::Float32, false>(source + i * Traits<Source>::Size, destination + i * 4, sampleCount - i, dither);
+}
+
+AVX2_TARGET inline __m256i NextRandomAvx2(__m256i& state) {
+    state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+    state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+    state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+    return state;
+}
+
+AVX2_TARGET inline __m256 NextTpdfAvx2(__m256i& state) {
+    const __m256i exponent = _mm256_set1_epi32(0x3F800000);
+    const __m256 a = _mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(NextRandomAvx2(state), 9), exponent));
+    const __m256 b = _mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(NextRandomAvx2(state), 9), exponent));
+    return _mm256_sub_ps(a, b);
+}
+
+template <SampleFormat Destination, bool Dither>
+AVX2_TARGET inline __m256i FloatToIntAvx2(__m256 value, __m256i& state) {
+    value = _mm256_mul_ps(value, _mm256_set1_ps(FloatScale<Destination>));
+    if constexpr (Dither) {
+        value = _mm256_add_ps(value, NextTpdfAvx2(state));
+    }
+
+    value = _mm256_and_ps(value, _mm256_cmp_ps(value, value, _CMP_ORD_Q));
+    value = _mm256_max_ps(value, _mm256_set1_ps(-FloatScale<Destination>));
+    value = _mm256_min_ps(value, _mm256_set1_ps(FloatMax<Destination>));
+    return _mm256_cvtps_epi32(value);
+}
+
+template <SampleFormat Destination, bool Dither>
+AVX2_TARGET void ConvertFromFloatAvx2(const uint8_t* source, uint8_t* destination, size_t sampleCount, DitherState& dither) {
+    const float* input = reinterpret_cast<const float*>(source);
+    __m256i state = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dither.Lanes));
+    size_t i = 0;
+
+    if constexpr (Destination == SampleFormat::Int16) {
+        for (; i + 16 <= sampleCount; i += 16) {
+            const __m256i low = FloatToIntAvx2<Destination, Dither>(_mm256_loadu_ps(input + i), state);
+            const __m256i high = FloatToIntAvx2<Destination, Dither>(_mm256_loadu_ps(input + i + 8), state);
+            // packs works per 128 bit lane, restore the sample order afterwards.
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 2), packed);
+        }
+    }
+    else {
+        for (; i + 8 <= sampleCount; i += 8) {
+            __m256i value = FloatToIntAvx2<Destination, Dither>(_mm256_loadu_ps(input + i), state);
+            if constexpr (Destination == SampleFormat::Int24In32) {
+                value = _mm256_slli_epi32(value, 8);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4), value);
+        }
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dither.Lanes), state);
+    ConvertScalar<SampleFormat::Float32, Destination, Dither>(source + i * 4, destination + i * Traits<Destination>::Size, sampleCount - i, dither);
+}
+
+template <SampleFormat Source>
+AVX2_TARGET void ConvertToFloatAvx2(const uint8_t* source, uint8_t* destination, size_t sampleCount, DitherState& dither) {
+    float* output = reinterpret_cast<float*>(destination);
+    const __m256 scale = _mm256_set1_ps(IntToFloatScale);
+    size_t i = 0;
+
+    if constexpr (Source == SampleFormat::Int16) {
+        for (; i + 8 <= sampleCount; i += 8) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+            const __m256i widened = _mm256_slli_epi32(_mm256_cvtepi16_epi32(value), 16);
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(widened), scale));
+        }
+    }
+    else {
+        const __m256i mask = _mm256_set1_epi32(Source == SampleFormat::Int24In32 ? static_cast<int>(0xFFFFFF00u) : -1);
+        for (; i + 8 <= sampleCount; i += 8) {
+            const __m256i value = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4)), mask);
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(value), scale));
+        }
+    }
+
+    ConvertScalar<Source, SampleFormat::Float32, false>(source + i * Traits<Source>::Size, destination + i * 4, sampleCount - i, dither);
+}
+
+#endif
+
+template <SampleFormat Source, SampleFormat Destination, bool Dither>
+Kernel SelectKernel(InstructionSet instructionSet) {
+#ifdef AUDIO_SIMD_X86
+    if constexpr (Source == SampleFormat::Float32 && HasVectorIntKernel<Destination>) {
+        if (instructionSet == InstructionSet::Avx2) {
+            return &ConvertFromFloatAvx2<Destination, Dither>;
+        }
+        if (instructionSet == InstructionSet::Sse2) {
+            return &ConvertFromFloatSse2<Destination, Dither>;
+        }
+    }
+    else if constexpr (Destination == SampleFormat::Float32 && HasVectorIntKernel<Source>) {
+        if (instructionSet == InstructionSet::Avx2) {
+            return &ConvertToFloatAvx2<Source>;
+        }
+        if (instructionSet == InstructionSet::Sse2) {
+            return &ConvertToFloatSse2<Source>;
+        }
+    }
+#else
+    (void)instructionSet;
+#endif
+
+    return &ConvertScalar<Source, Destination, Dither>;
+}
+
+template <SampleFormat Source, bool Dither>
+Kernel SelectKernel(SampleFormat destination, InstructionSet instructionSet) {
+    switch (destination) {
+    case SampleFormat::Int16:
+        return SelectKernel<Source, SampleFormat::Int16, Dither>(instructionSet);
+    case SampleFormat::Int24:
+        return SelectKernel<Source, SampleFormat::Int24, Dither>(instructionSet);
+    case SampleFormat::Int32:
+        return SelectKernel<Source, SampleFormat::Int32, Dither>(instructionSet);
+    case SampleFormat::Int24In32:
+        return SelectKernel<Source, SampleFormat::Int24In32, Dither>(instructionSet);
+    case SampleFormat::Float32:
+        return SelectKernel<Source, SampleFormat::Float32, Dither>(instructionSet);
+    }
+    return nullptr;
+}
+
+template <bool Dither>
+Kernel SelectKernel(SampleFormat source, SampleFormat destination, InstructionSet instructionSet) {
+    switch (source) {
+    case SampleFormat::Int16:
+        return SelectKernel<SampleFormat::Int16, Dither>(destination, instructionSet);
+    case SampleFormat::Int24:
+        return SelectKernel<SampleFormat::Int24, Dither>(destination, instructionSet);
+    case SampleFormat::Int32:
+        return SelectKernel<SampleFormat::Int32, Dither>(destination, instructionSet);
+    case SampleFormat::Int24In32:
+        return SelectKernel<SampleFormat::Int24In32, Dither>(destination, instructionSet);
+    case SampleFormat::Float32:
+        return SelectKernel<SampleFormat::Float32, Dither>(destination, instructionSet);
+    }
+    return nullptr;
+}
+
+}
+
+size_t SampleFormatConverter::GetSampleSize(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::Int16:
+        return Traits<SampleFormat::Int16>::Size;
+    case SampleFormat::Int24:
+        return Traits<SampleFormat::Int24>::Size;
+    case SampleFormat::Int32:
+        return Traits<SampleFormat::Int32>::Size;
+    case SampleFormat::Int24In32:
+        return Traits<SampleFormat::Int24In32>::Size;
+    case SampleFormat::Float32:
+        return Traits<SampleFormat::Float32>::Size;
+    }
+    return 0;
+}
+
+bool SampleFormatConverter::FromAudioFormat(const AudioFormat& format, SampleFormat& sampleFormat) {
+    if (format.IsFloat) {
+        sampleFormat = SampleFormat::Float32;
+        return format.BitsPerSample == 32;
+    }
+
+    switch (format.BitsPerSample) {
+    case 16:
+        sampleFormat = SampleFormat::Int16;
+        return true;
+    case 24:
+        sampleFormat = SampleFormat::Int24;
+        return true;
+    case 32:
+        sampleFormat = format.GetValidBitsPerSample() == 24 ? SampleFormat::Int24In32 : SampleFormat::Int32;
+        return true;
+    default:
+        return false;
+    }
+}
+
+SampleFormatConverter::Kernel SampleFormatConverter::GetKernel(SampleFormat source, SampleFormat destination, bool dither, InstructionSet instructionSet) {
+    if (source == destination) {
+        return nullptr;
+    }
+
+    return dither ? SelectKernel<true>(source, destination, instructionSet) : SelectKernel<false>(source, destination, instructionSet);
+}
+
+bool SampleFormatConverter::Configure(SampleFormat source, SampleFormat destination, bool dither) {
+    if (GetSampleSize(source) == 0 || GetSampleSize(destination) == 0) {
+        return false;
+    }
+
+    m_Source = source;
+    m_Destination = destination;
+    m_Kernel = GetKernel(source, destination, dither, ::GetInstructionSet());
+    return true;
+}
+
+const uint8_t* SampleFormatConverter::Convert(const void* source, size_t sampleCount) {
+    if (!m_Kernel) {
+        return static_cast<const uint8_t*>(source);
+    }
+
+    const size_t size = GetConvertedSize(sampleCount);
+    if (m_Buffer.size() < size) {
+        m_Buffer.resize(size);
+    }
+
+    m_Kernel(static_cast<const uint8_t*>(source), m_Buffer.data(), sampleCount, m_Dither);
+    return m_Buffer.data();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "CpuFeatures.h"
+
+// Interleaved PCM sample encodings. Int24 is packed little-endian 3 byte samples, Int24In32 keeps
+// 24 valid bits in the most significant bits of a 32 bit container (the KSDATAFORMAT convention).
+enum class SampleFormat {
+    Int16,
+    Int24,
+    Int32,
+    Int24In32,
+    Float32,
+};
+
+template <SampleFormat Format> struct SampleFormatTraits;
+
+template <> struct SampleFormatTraits<SampleFormat::Int16> {
+    static constexpr size_t Size = 2;
+    static constexpr int ValidBits = 16;
+    static constexpr bool IsFloat = false;
+};
+
+template <> struct SampleFormatTraits<SampleFormat::Int24> {
+    static constexpr size_t Size = 3;
+    static constexpr int ValidBits = 24;
+    static constexpr bool IsFloat = false;
+};
+
+template <> struct SampleFormatTraits<SampleFormat::Int32> {
+    static constexpr size_t Size = 4;
+    static constexpr int ValidBits = 32;
+    static constexpr bool IsFloat = false;
+};
+
+template <> struct SampleFormatTraits<SampleFormat::Int24In32> {
+    static constexpr size_t Size = 4;
+    static constexpr int ValidBits = 24;
+    static constexpr bool IsFloat = false;
+};
+
+template <> struct SampleFormatTraits<SampleFormat::Float32> {
+    static constexpr size_t Size = 4;
+    static constexpr int ValidBits = 32;
+    static constexpr bool IsFloat = true;
+};
+
+// Per-converter generator state for TPDF dither, one xorshift32 state per SIMD lane.
+struct DitherState {
+    static constexpr size_t LaneCount = 8;
+
+    uint32_t Lanes[LaneCount];
+
+    explicit DitherState(uint32_t seed = 0x9E3779B9u);
+};
+
+// Converts whole interleaved buffers between sample formats into a buffer owned by the converter,
+// which is reused across calls so the capture path does not allocate once it reached its packet size.
+//
+// Every format pair is a separate template instantiation; the common float <-> integer pairs also
+// have SSE2 and AVX2 kernels, picked once at runtime from the CPU features. Conversions to integer
+// formats round to nearest and saturate, narrowing conversions can add TPDF dither of +-1 LSB.
+class SampleFormatConverter {
+public:
+    using Kernel = void (*)(const uint8_t* source, uint8_t* destination, size_t sampleCount, DitherState& dither);
+
+    // Returns false for an unknown format. Identical formats are passed through without a copy.
+    bool Configure(SampleFormat source, SampleFormat destination, bool dither = false);
+
+    // Converts `sampleCount` samples (frames x channels). The result stays valid until the next call
+    // and is GetConvertedSize(sampleCount) bytes long.
+    const uint8_t* Convert(const void* source, size_t sampleCount);
+    size_t GetConvertedSize(size_t sampleCount) const { return sampleCount * GetSampleSize(m_Destination); }
+
+    SampleFormat GetSourceFormat() const { return m_Source; }
+    SampleFormat GetDestinationFormat() const { return m_Destination; }
+
+    static size_t GetSampleSize(SampleFormat format);
+    // Sample format of a WAV style format description, false if there is no matching one.
+    static bool FromAudioFormat(const AudioFormat& format, SampleFormat& sampleFormat);
+
+    // Kernel lookup for an explicit instruction set, falls back to narrower sets where a pair has no
+    // vector kernel. Returns nullptr for identical formats.
+    static Kernel GetKernel(SampleFormat source, SampleFormat destination, bool dither, InstructionSet instructionSet);
+
+private:
+    SampleFormat m_Source = SampleFormat::Float32;
+    SampleFormat m_Destination = SampleFormat::Float32;
+    Kernel m_Kernel = nullptr;
+    DitherState m_Dither;
+    std::vector<uint8_t> m_Buffer;
+};
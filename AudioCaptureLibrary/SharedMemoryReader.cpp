@@ -0,0 +1,53 @@
+#include "SharedMemoryReader.h"
+
+#include <wil/result.h>
+
+#include "SharedMemoryTransport.h"
+
+HRESULT SharedMemoryReader::Open(DWORD pipeId, long long captureId) {
+    // Write access is needed for the ReaderWaiting flag in the ring header.
+    m_Mapping.reset(OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, SharedMemoryTransport::GetMappingName(pipeId, captureId).c_str()));
+    RETURN_LAST_ERROR_IF(!m_Mapping);
+
+    m_View.reset(static_cast<BYTE*>(MapViewOfFile(m_Mapping.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0)));
+    RETURN_LAST_ERROR_IF(!m_View);
+
+    MEMORY_BASIC_INFORMATION info{};
+    RETURN_LAST_ERROR_IF(VirtualQuery(m_View.get(), &info, sizeof(info)) == 0);
+
+    m_ReaderEvent.reset(OpenEventW(SYNCHRONIZE, FALSE, SharedMemoryTransport::GetEventName(pipeId, captureId).c_str()));
+    RETURN_LAST_ERROR_IF(!m_ReaderEvent);
+
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), !m_Reader.Attach(m_View.get(), info.RegionSize));
+
+    return S_OK;
+}
+
+int SharedMemoryReader::Read(BYTE* buffer, int bufferSize, DWORD timeoutMs) {
+    const ULONGLONG deadline = GetTickCount64() + timeoutMs;
+
+    while (true) {
+        size_t bytesRead = 0;
+        switch (m_Reader.Read(buffer, static_cast<size_t>(bufferSize), bytesRead)) {
+        case SharedMemoryRingReader::Result::Data:
+            return static_cast<int>(bytesRead);
+        case SharedMemoryRingReader::Result::Closed:
+            return -1;
+        case SharedMemoryRingReader::Result::Empty:
+            break;
+        }
+
+        const ULONGLONG now = GetTickCount64();
+        if (now >= deadline) {
+            return 0;
+        }
+
+        if (!m_Reader.PrepareToWait()) {
+            continue;
+        }
+
+        if (WaitForSingleObject(m_ReaderEvent.get(), static_cast<DWORD>(deadline - now)) != WAIT_OBJECT_0) {
+            m_Reader.CancelWait();
+        }
+    }
+}
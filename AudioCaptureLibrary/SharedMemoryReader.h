@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+
+#include "SharedMemoryRing.h"
+
+// Consumer end of a SharedMemoryTransport, opened by the same <pipeId>_<captureId> pair.
+class SharedMemoryReader {
+public:
+    HRESULT Open(DWORD pipeId, long long captureId);
+
+    // Copies whole records into `buffer`, waiting up to `timeoutMs` for data.
+    // Returns the number of bytes read, 0 on timeout and -1 once the writer has closed and the ring is drained.
+    int Read(BYTE* buffer, int bufferSize, DWORD timeoutMs);
+
+    UINT64 GetLostRecords() const { return m_Reader.GetLostRecords(); }
+
+private:
+    wil::unique_handle m_Mapping;
+    wil::unique_mapview_ptr<BYTE> m_View;
+    wil::unique_event_nothrow m_ReaderEvent;
+    SharedMemoryRingReader m_Reader;
+};
@@ -0,0 +1,227 @@
+#include "SharedMemoryRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+static uint64_t AlignRecord(uint64_t size) {
+    return (size + SharedMemoryRing::RecordAlignment - 1) & ~static_cast<uint64_t>(SharedMemoryRing::RecordAlignment - 1);
+}
+
+size_t SharedMemoryRing::GetCapacity(size_t capacity) {
+    size_t result = RecordAlignment * 2;
+    while (result < capacity) {
+        result <<= 1;
+    }
+    return result;
+}
+
+size_t SharedMemoryRing::GetRegionSize(size_t capacity) {
+    static_assert(sizeof(SharedMemoryRingHeader) <= DataOffset, "Header must fit in front of the record area");
+    return DataOffset + GetCapacity(capacity);
+}
+
+void SharedMemoryRingWriter::Initialize(void* region, size_t capacity) {
+    m_Header = new (region) SharedMemoryRingHeader{};
+    m_Data = static_cast<uint8_t*>(region) + SharedMemoryRing::DataOffset;
+    m_Capacity = SharedMemoryRing::GetCapacity(capacity);
+
+    m_Header->Capacity = m_Capacity;
+    m_Header->Version = SharedMemoryRingHeader::CurrentVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    m_Header->Magic = SharedMemoryRingHeader::MagicValue;
+}
+
+size_t SharedMemoryRingWriter::GetMaxRecordSize() const {
+    return static_cast<size_t>(m_Capacity / 2 - sizeof(SharedMemoryRecordHeader));
+}
+
+bool SharedMemoryRingWriter::Write(const void* data, uint32_t size, bool& wakeReader) {
+    wakeReader = false;
+
+    const uint64_t recordSize = AlignRecord(sizeof(SharedMemoryRecordHeader) + size);
+    if (!m_Header || recordSize > m_Capacity / 2) {
+        return false;
+    }
+
+    uint64_t position = m_Header->WritePosition.load(std::memory_order_relaxed);
+    const uint64_t sequence = m_Header->WriteSequence.load(std::memory_order_relaxed);
+    uint64_t offset = position & (m_Capacity - 1);
+    const uint64_t padding = (offset + recordSize > m_Capacity) ? m_Capacity - offset : 0;
+
+    // Announce the region about to be overwritten before touching it, readers validate against it.
+    m_Header->ReservePosition.store(position + padding + recordSize, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (padding > 0) {
+        const SharedMemoryRecordHeader paddingHeader = {
+            sequence, static_cast<uint32_t>(padding - sizeof(SharedMemoryRecordHeader)), SharedMemoryRecordHeader::PaddingFlag
+        };
+        memcpy(m_Data + offset, &paddingHeader, sizeof(paddingHeader));
+        position += padding;
+        offset = 0;
+    }
+
+    const SharedMemoryRecordHeader recordHeader = { sequence, size, 0 };
+    memcpy(m_Data + offset, &recordHeader, sizeof(recordHeader));
+    memcpy(m_Data + offset + sizeof(recordHeader), data, size);
+
+    m_Header->WriteSequence.store(sequence + 1, std::memory_order_relaxed);
+    m_Header->WritePosition.store(position + recordSize, std::memory_order_seq_cst);
+
+    if (m_Header->ReaderWaiting.load(std::memory_order_seq_cst) != 0) {
+        wakeReader = m_Header->ReaderWaiting.exchange(0, std::memory_order_acq_rel) != 0;
+    }
+
+    return true;
+}
+
+void SharedMemoryRingWriter::Close() {
+    if (m_Header) {
+        m_Header->Closed.store(1, std::memory_order_release);
+    }
+}
+
+bool SharedMemoryRingReader::Attach(void* region, size_t regionSize) {
+    if (regionSize < SharedMemoryRing::DataOffset) {
+        return false;
+    }
+
+    auto* header = static_cast<SharedMemoryRingHeader*>(region);
+    if (header->Magic != SharedMemoryRingHeader::MagicValue || header->Version != SharedMemoryRingHeader::CurrentVersion) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (header->Capacity == 0 || SharedMemoryRing::DataOffset + header->Capacity > regionSize) {
+        return false;
+    }
+
+    m_Header = header;
+    m_Data = static_cast<const uint8_t*>(region) + SharedMemoryRing::DataOffset;
+    m_Capacity = header->Capacity;
+
+    // Capture usually starts before the consumer attaches. As long as the ring has not wrapped yet
+    // the reader starts at the very first record, otherwise it joins at the live edge.
+    m_LostRecords = 0;
+    if (m_Header->ReservePosition.load(std::memory_order_acquire) <= m_Capacity) {
+        m_ReadPosition = 0;
+        m_ExpectedSequence = 0;
+    }
+    else {
+        m_ReadPosition = m_Header->WritePosition.load(std::memory_order_acquire);
+        m_ExpectedSequence = m_Header->WriteSequence.load(std::memory_order_acquire);
+    }
+
+    return true;
+}
+
+bool SharedMemoryRingReader::IsIntact(uint64_t position) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_Header->ReservePosition.load(std::memory_order_relaxed) - position <= m_Capacity;
+}
+
+void SharedMemoryRingReader::SkipToWriter() {
+    const uint64_t writePosition = m_Header->WritePosition.load(std::memory_order_acquire);
+    const uint64_t writeSequence = m_Header->WriteSequence.load(std::memory_order_acquire);
+
+    // The sequence may already include a record published after writePosition was read,
+    // that record is then simply counted as lost and skipped on the next pass.
+    if (writeSequence > m_ExpectedSequence) {
+        m_LostRecords += writeSequence - m_ExpectedSequence;
+    }
+
+    m_ReadPosition = writePosition;
+    m_ExpectedSequence = writeSequence;
+}
+
+SharedMemoryRingReader::Result SharedMemoryRingReader::Read(uint8_t* destination, size_t destinationSize, size_t& bytesRead) {
+    bytesRead = 0;
+    if (!m_Header) {
+        return Result::Closed;
+    }
+
+    while (true) {
+        const uint64_t writePosition = m_Header->WritePosition.load(std::memory_order_acquire);
+        if (writePosition == m_ReadPosition) {
+            break;
+        }
+
+        if (writePosition - m_ReadPosition > m_Capacity) {
+            SkipToWriter();
+            continue;
+        }
+
+        const uint64_t offset = m_ReadPosition & (m_Capacity - 1);
+        SharedMemoryRecordHeader header;
+        memcpy(&header, m_Data + offset, sizeof(header));
+
+        if (!IsIntact(m_ReadPosition)) {
+            SkipToWriter();
+            continue;
+        }
+
+        if (header.Sequence != m_ExpectedSequence) {
+            if (header.Sequence < m_ExpectedSequence) {
+                // Published concurrently with the Attach() / SkipToWriter() snapshot, see there.
+                const uint64_t recovered = m_ExpectedSequence - header.Sequence;
+                m_LostRecords -= (std::min)(m_LostRecords, recovered);
+                m_ExpectedSequence = header.Sequence;
+            }
+            else {
+                SkipToWriter();
+                continue;
+            }
+        }
+
+        if (header.Flags & SharedMemoryRecordHeader::PaddingFlag) {
+            m_ReadPosition += sizeof(header) + header.Size;
+            continue;
+        }
+
+        if (bytesRead + header.Size > destinationSize) {
+            if (bytesRead > 0) {
+                break;
+            }
+
+            // A record that can never fit the caller's buffer is dropped rather than stalling the stream.
+            m_ReadPosition += AlignRecord(sizeof(header) + header.Size);
+            m_ExpectedSequence++;
+            m_LostRecords++;
+            continue;
+        }
+
+        memcpy(destination + bytesRead, m_Data + offset + sizeof(header), header.Size);
+
+        if (!IsIntact(m_ReadPosition)) {
+            SkipToWriter();
+            continue;
+        }
+
+        bytesRead += header.Size;
+        m_ReadPosition += AlignRecord(sizeof(header) + header.Size);
+        m_ExpectedSequence++;
+    }
+
+    if (bytesRead > 0) {
+        return Result::Data;
+    }
+
+    return m_Header->Closed.load(std::memory_order_acquire) != 0 ? Result::Closed : Result::Empty;
+}
+
+bool SharedMemoryRingReader::PrepareToWait() {
+    m_Header->ReaderWaiting.store(1, std::memory_order_seq_cst);
+
+    if (m_Header->WritePosition.load(std::memory_order_seq_cst) != m_ReadPosition ||
+        m_Header->Closed.load(std::memory_order_acquire) != 0) {
+        m_Header->ReaderWaiting.store(0, std::memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+void SharedMemoryRingReader::CancelWait() {
+    m_Header->ReaderWaiting.store(0, std::memory_order_relaxed);
+}
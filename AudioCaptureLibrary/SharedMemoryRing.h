@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Layout and lock-free logic of the shared-memory audio transport.
+//
+// The mapped region starts with a SharedMemoryRingHeader followed by the record area. The writer
+// (capture callback) never waits for the reader: records are appended with increasing sequence
+// numbers and old records are overwritten. The reader detects that it has been lapped from the
+// sequence numbers and the reserve position, skips to the live edge and reports how many records
+// it lost. Records never wrap, a padding record fills the tail of the area when needed.
+//
+// Everything here is plain memory and atomics, the OS specific mapping and wakeup live in
+// SharedMemoryTransport / SharedMemoryReader.
+
+struct SharedMemoryRingHeader {
+    static constexpr uint32_t MagicValue = 0x4D535241; // "ARSM"
+    static constexpr uint32_t CurrentVersion = 1;
+
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Capacity;
+
+    // Writer-owned cache line.
+    alignas(64) std::atomic<uint64_t> WritePosition;
+    std::atomic<uint64_t> ReservePosition;
+    std::atomic<uint64_t> WriteSequence;
+    std::atomic<uint32_t> Closed;
+
+    // Reader-owned cache line. Set by a reader about to sleep, the writer only signals the
+    // wakeup primitive when it finds this flag set.
+    alignas(64) std::atomic<uint32_t> ReaderWaiting;
+};
+
+struct SharedMemoryRecordHeader {
+    static constexpr uint32_t PaddingFlag = 0x1;
+
+    uint64_t Sequence;
+    uint32_t Size;
+    uint32_t Flags;
+};
+
+static_assert(sizeof(SharedMemoryRecordHeader) == 16, "Record header is part of the shared layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared counters must be lock-free");
+
+class SharedMemoryRing {
+public:
+    static constexpr size_t RecordAlignment = 16;
+    static constexpr size_t DataOffset = 4096;
+
+    // Size of the whole mapped region for a record area of `capacity` bytes (rounded to a power of two).
+    static size_t GetRegionSize(size_t capacity);
+    static size_t GetCapacity(size_t capacity);
+};
+
+class SharedMemoryRingWriter {
+public:
+    // Initializes the header of a freshly mapped, zeroed region.
+    void Initialize(void* region, size_t capacity);
+
+    // Appends one record. Returns false only if the record can never fit (larger than half the ring).
+    // `wakeReader` is set when a sleeping reader has to be signalled.
+    bool Write(const void* data, uint32_t size, bool& wakeReader);
+    void Close();
+
+    size_t GetMaxRecordSize() const;
+
+private:
+    SharedMemoryRingHeader* m_Header = nullptr;
+    uint8_t* m_Data = nullptr;
+    uint64_t m_Capacity = 0;
+};
+
+class SharedMemoryRingReader {
+public:
+    enum class Result {
+        Data,
+        Empty,
+        Closed,
+    };
+
+    // Attaches to an initialized region, returns false if the header is missing or incompatible.
+    bool Attach(void* region, size_t regionSize);
+
+    // Copies as many whole records as fit into `destination`. Lapped records are skipped and
+    // added to the lost counter, the reader then continues from the writer's current position.
+    Result Read(uint8_t* destination, size_t destinationSize, size_t& bytesRead);
+
+    // Announces that the reader is going to sleep. Returns false if data arrived meanwhile.
+    bool PrepareToWait();
+    void CancelWait();
+
+    uint64_t GetLostRecords() const { return m_LostRecords; }
+
+private:
+    bool IsIntact(uint64_t position) const;
+    void SkipToWriter();
+
+    SharedMemoryRingHeader* m_Header = nullptr;
+    const uint8_t* m_Data = nullptr;
+    uint64_t m_Capacity = 0;
+    uint64_t m_ReadPosition = 0;
+    uint64_t m_ExpectedSequence = 0;
+    uint64_t m_LostRecords = 0;
+};
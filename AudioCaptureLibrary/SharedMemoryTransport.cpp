@@ -0,0 +1,92 @@
+#include "SharedMemoryTransport.h"
+
+#include <wchar.h>
+#include <chrono>
+
+#include "Logger.h"
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    Close();
+}
+
+std::wstring SharedMemoryTransport::GetMappingName(DWORD pipeId, long long captureId) {
+    wchar_t name[128];
+    swprintf_s(name, _countof(name), L"Local\\AudioDataMemory_%lu_%lld", pipeId, captureId);
+    return name;
+}
+
+std::wstring SharedMemoryTransport::GetEventName(DWORD pipeId, long long captureId) {
+    wchar_t name[128];
+    swprintf_s(name, _countof(name), L"Local\\AudioDataEvent_%lu_%lld", pipeId, captureId);
+    return name;
+}
+
+BOOL SharedMemoryTransport::Create(DWORD pipeId, long long captureId) {
+    const UINT64 regionSize = SharedMemoryRing::GetRegionSize(m_Capacity);
+
+    m_Mapping.reset(CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        static_cast<DWORD>(regionSize >> 32), static_cast<DWORD>(regionSize), GetMappingName(pipeId, captureId).c_str()));
+    if (!m_Mapping) {
+        return FALSE;
+    }
+
+    // Names include the capture id, an existing mapping means something else owns it.
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        m_Mapping.reset();
+        SetLastError(ERROR_ALREADY_EXISTS);
+        return FALSE;
+    }
+
+    m_View.reset(static_cast<BYTE*>(MapViewOfFile(m_Mapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(regionSize))));
+    if (!m_View) {
+        m_Mapping.reset();
+        return FALSE;
+    }
+
+    if (!m_ReaderEvent.try_create(wil::EventOptions::None, GetEventName(pipeId, captureId).c_str())) {
+        m_View.reset();
+        m_Mapping.reset();
+        return FALSE;
+    }
+
+    m_Writer.Initialize(m_View.get(), m_Capacity);
+    m_IsOpen = true;
+
+    return TRUE;
+}
+
+bool SharedMemoryTransport::Write(const BYTE* data, DWORD dataSize) {
+    if (!m_IsOpen.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    bool wakeReader = false;
+    if (!m_Writer.Write(data, dataSize, wakeReader)) {
+        m_DroppedBytes.fetch_add(dataSize, std::memory_order_relaxed);
+        return false;
+    }
+    m_Counters.RecordWrite(dataSize, dataSize,
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()));
+
+    if (wakeReader) {
+        m_ReaderEvent.SetEvent();
+    }
+
+    return true;
+}
+
+void SharedMemoryTransport::Close() {
+    if (!m_IsOpen.exchange(false)) {
+        return;
+    }
+
+    // The view stays mapped until destruction, a capture callback may still be inside Write().
+    // The reader keeps its own view, so it can drain whatever is left after the writer is gone.
+    m_Writer.Close();
+    m_ReaderEvent.SetEvent();
+
+    if (const auto dropped = GetDroppedBytes(); dropped > 0) {
+        Logger::GetInstance().Log("Shared memory transport dropped " + std::to_string(dropped) + " bytes of oversized packets", LogLevel::Warning);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+#include <atomic>
+#include <string>
+
+#include "AudioTransport.h"
+#include "SharedMemoryRing.h"
+
+// Writer end of the shared-memory transport: a Local\AudioDataMemory_<pipeId>_<captureId> file
+// mapping holding a SharedMemoryRing and a Local\AudioDataEvent_<pipeId>_<captureId> auto-reset
+// event used to wake a sleeping reader.
+//
+// Unlike the pipe there is no writer thread, the capture callback copies straight into the
+// mapping and the event is only set when the reader announced that it is waiting.
+class SharedMemoryTransport : public AudioTransport {
+public:
+    static constexpr size_t DefaultCapacity = 1024 * 1024;
+
+    explicit SharedMemoryTransport(size_t capacity = DefaultCapacity) : m_Capacity(capacity) {}
+    ~SharedMemoryTransport() override;
+
+    SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+    SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+
+    BOOL Create(DWORD pipeId, long long captureId) override;
+    bool Write(const BYTE* data, DWORD dataSize) override;
+    void Close() override;
+
+    UINT64 GetDroppedBytes() const override { return m_DroppedBytes.load(std::memory_order_relaxed); }
+
+    static std::wstring GetMappingName(DWORD pipeId, long long captureId);
+    static std::wstring GetEventName(DWORD pipeId, long long captureId);
+
+private:
+    size_t m_Capacity;
+    wil::unique_handle m_Mapping;
+    wil::unique_mapview_ptr<BYTE> m_View;
+    wil::unique_event_nothrow m_ReaderEvent;
+    SharedMemoryRingWriter m_Writer;
+    std::atomic<bool> m_IsOpen{ false };
+    std::atomic<UINT64> m_DroppedBytes{ 0 };
+};
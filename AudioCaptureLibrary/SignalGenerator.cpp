@@ -0,0 +1,54 @@
+#include "SignalGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double TwoPi = 6.28318530717958647692;
+
+}
+
+void SignalGenerator::Configure(SignalType type, uint32_t sampleRate, uint32_t channels, float frequency, float amplitude, uint32_t seed) {
+    m_Type = type;
+    m_SampleRate = sampleRate;
+    m_Channels = channels;
+    m_Amplitude = std::clamp(amplitude, 0.0f, 1.0f);
+    m_Phase = 0.0;
+    m_PhaseIncrement = sampleRate > 0 ? TwoPi * frequency / sampleRate : 0.0;
+    m_NoiseState = seed != 0 ? seed : 1;
+}
+
+const float* SignalGenerator::Generate(size_t frames) {
+    const size_t samples = frames * m_Channels;
+    if (m_Buffer.size() < samples) {
+        m_Buffer.resize(samples);
+    }
+
+    float* output = m_Buffer.data();
+    switch (m_Type) {
+    case SignalType::Tone:
+        for (size_t frame = 0; frame < frames; ++frame) {
+            const float value = m_Amplitude * static_cast<float>(std::sin(m_Phase));
+            std::fill_n(output + frame * m_Channels, m_Channels, value);
+            m_Phase += m_PhaseIncrement;
+            if (m_Phase >= TwoPi) {
+                m_Phase -= TwoPi;
+            }
+        }
+        break;
+    case SignalType::Noise:
+        for (size_t i = 0; i < samples; ++i) {
+            // xorshift32, uniform in [-1, 1)
+            m_NoiseState ^= m_NoiseState << 13;
+            m_NoiseState ^= m_NoiseState >> 17;
+            m_NoiseState ^= m_NoiseState << 5;
+            output[i] = m_Amplitude * (static_cast<float>(m_NoiseState >> 8) * (2.0f / 16777216.0f) - 1.0f);
+        }
+        break;
+    default:
+        std::fill_n(output, samples, 0.0f);
+        break;
+    }
+    return output;
+}
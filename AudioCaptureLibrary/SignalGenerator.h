@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class SignalType : int {
+    Silence = 0,
+    Tone = 1,
+    Noise = 2,
+};
+
+// Test signal source for the synthetic capture path. Produces interleaved float packets of any
+// size with a continuous phase (tone) or an uninterrupted random sequence (white noise), so the
+// concatenated packets form one clean stream.
+class SignalGenerator {
+public:
+    void Configure(SignalType type, uint32_t sampleRate, uint32_t channels, float frequency = 440.0f, float amplitude = 0.5f, uint32_t seed = 1);
+
+    // The result stays valid until the next call.
+    const float* Generate(size_t frames);
+
+    uint32_t GetSampleRate() const { return m_SampleRate; }
+    uint32_t GetChannels() const { return m_Channels; }
+
+private:
+    SignalType m_Type = SignalType::Silence;
+    uint32_t m_SampleRate = 0;
+    uint32_t m_Channels = 0;
+    float m_Amplitude = 0.0f;
+    double m_Phase = 0.0;
+    double m_PhaseIncrement = 0.0;
+    uint32_t m_NoiseState = 1;
+    std::vector<float> m_Buffer;
+};
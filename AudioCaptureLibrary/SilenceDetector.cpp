@@ -0,0 +1,220 @@
+#include "SilenceDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CpuFeatures.h"
+
+namespace {
+
+bool ExceedsInt16Scalar(const int16_t* samples, size_t count, int32_t limit) {
+    for (size_t i = 0; i < count; ++i) {
+        if (samples[i] > limit || samples[i] < -limit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ExceedsInt32Scalar(const int32_t* samples, size_t count, int32_t limit) {
+    for (size_t i = 0; i < count; ++i) {
+        if (samples[i] > limit || samples[i] < -limit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ExceedsFloatScalar(const float* samples, size_t count, float limit) {
+    for (size_t i = 0; i < count; ++i) {
+        if (samples[i] > limit || samples[i] < -limit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef AUDIO_SIMD_X86
+
+bool ExceedsInt16Sse2(const int16_t* samples, size_t count, int32_t limit) {
+    const __m128i upper = _mm_set1_epi16(static_cast<int16_t>(limit));
+    const __m128i lower = _mm_set1_epi16(static_cast<int16_t>(-limit));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i + 8));
+        const __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi16(low, upper), _mm_cmplt_epi16(low, lower)),
+            _mm_or_si128(_mm_cmpgt_epi16(high, upper), _mm_cmplt_epi16(high, lower)));
+        if (_mm_movemask_epi8(outside) != 0) {
+            return true;
+        }
+    }
+    return ExceedsInt16Scalar(samples + i, count - i, limit);
+}
+
+bool ExceedsInt32Sse2(const int32_t* samples, size_t count, int32_t limit) {
+    const __m128i upper = _mm_set1_epi32(limit);
+    const __m128i lower = _mm_set1_epi32(-limit);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i + 4));
+        const __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(low, upper), _mm_cmplt_epi32(low, lower)),
+            _mm_or_si128(_mm_cmpgt_epi32(high, upper), _mm_cmplt_epi32(high, lower)));
+        if (_mm_movemask_epi8(outside) != 0) {
+            return true;
+        }
+    }
+    return ExceedsInt32Scalar(samples + i, count - i, limit);
+}
+
+bool ExceedsFloatSse2(const float* samples, size_t count, float limit) {
+    const __m128 upper = _mm_set1_ps(limit);
+    const __m128 lower = _mm_set1_ps(-limit);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128 low = _mm_loadu_ps(samples + i);
+        const __m128 high = _mm_loadu_ps(samples + i + 4);
+        // Ordered compares are false for NaN.
+        const __m128 outside = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(low, upper), _mm_cmplt_ps(low, lower)),
+            _mm_or_ps(_mm_cmpgt_ps(high, upper), _mm_cmplt_ps(high, lower)));
+        if (_mm_movemask_ps(outside) != 0) {
+            return true;
+        }
+    }
+    return ExceedsFloatScalar(samples + i, count - i, limit);
+}
+
+AVX2_TARGET bool ExceedsInt16Avx2(const int16_t* samples, size_t count, int32_t limit) {
+    const __m256i upper = _mm256_set1_epi16(static_cast<int16_t>(limit));
+    const __m256i lower = _mm256_set1_epi16(static_cast<int16_t>(-limit));
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+        const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i + 16));
+        const __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi16(low, upper), _mm256_cmpgt_epi16(lower, low)),
+            _mm256_or_si256(_mm256_cmpgt_epi16(high, upper), _mm256_cmpgt_epi16(lower, high)));
+        if (!_mm256_testz_si256(outside, outside)) {
+            return true;
+        }
+    }
+    return ExceedsInt16Scalar(samples + i, count - i, limit);
+}
+
+AVX2_TARGET bool ExceedsInt32Avx2(const int32_t* samples, size_t count, int32_t limit) {
+    const __m256i upper = _mm256_set1_epi32(limit);
+    const __m256i lower = _mm256_set1_epi32(-limit);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+        const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i + 8));
+        const __m256i outside = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(low, upper), _mm256_cmpgt_epi32(lower, low)),
+            _mm256_or_si256(_mm256_cmpgt_epi32(high, upper), _mm256_cmpgt_epi32(lower, high)));
+        if (!_mm256_testz_si256(outside, outside)) {
+            return true;
+        }
+    }
+    return ExceedsInt32Scalar(samples + i, count - i, limit);
+}
+
+AVX2_TARGET bool ExceedsFloatAvx2(const float* samples, size_t count, float limit) {
+    const __m256 upper = _mm256_set1_ps(limit);
+    const __m256 lower = _mm256_set1_ps(-limit);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256 low = _mm256_loadu_ps(samples + i);
+        const __m256 high = _mm256_loadu_ps(samples + i + 8);
+        const __m256 outside = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(low, upper, _CMP_GT_OQ), _mm256_cmp_ps(low, lower, _CMP_LT_OQ)),
+            _mm256_or_ps(_mm256_cmp_ps(high, upper, _CMP_GT_OQ), _mm256_cmp_ps(high, lower, _CMP_LT_OQ)));
+        if (_mm256_movemask_ps(outside) != 0) {
+            return true;
+        }
+    }
+    return ExceedsFloatScalar(samples + i, count - i, limit);
+}
+
+#endif
+
+using ExceedsInt16Kernel = bool (*)(const int16_t*, size_t, int32_t);
+using ExceedsInt32Kernel = bool (*)(const int32_t*, size_t, int32_t);
+using ExceedsFloatKernel = bool (*)(const float*, size_t, float);
+
+struct SilenceKernelTable {
+    ExceedsInt16Kernel Int16 = &ExceedsInt16Scalar;
+    ExceedsInt32Kernel Int32 = &ExceedsInt32Scalar;
+    ExceedsFloatKernel Float = &ExceedsFloatScalar;
+
+    SilenceKernelTable() {
+#ifdef AUDIO_SIMD_X86
+        switch (GetInstructionSet()) {
+        case InstructionSet::Avx2:
+            Int16 = &ExceedsInt16Avx2;
+            Int32 = &ExceedsInt32Avx2;
+            Float = &ExceedsFloatAvx2;
+            break;
+        case InstructionSet::Sse2:
+            Int16 = &ExceedsInt16Sse2;
+            Int32 = &ExceedsInt32Sse2;
+            Float = &ExceedsFloatSse2;
+            break;
+        default:
+            break;
+        }
+#endif
+    }
+};
+
+const SilenceKernelTable& GetKernels() {
+    static const SilenceKernelTable kernels;
+    return kernels;
+}
+
+bool ExceedsInt24(const uint8_t* data, size_t count, int32_t limit) {
+    for (size_t i = 0; i < count; ++i, data += 3) {
+        const int32_t sample = static_cast<int32_t>(static_cast<uint32_t>(data[0] | (data[1] << 8) | (data[2] << 16)) << 8) >> 8;
+        if (sample > limit || sample < -limit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+bool SilenceDetector::Configure(SampleFormat format, float threshold) {
+    if (!(threshold >= 0.0f && threshold < 1.0f)) {
+        return false;
+    }
+
+    m_Format = format;
+    m_Enabled = threshold > 0.0f;
+    m_FloatLimit = threshold;
+    // Int24In32 is compared in its 32 bit container, where full scale is the same as for Int32.
+    const double fullScale = format == SampleFormat::Int16 ? 32768.0 : format == SampleFormat::Int24 ? 8388608.0 : 2147483648.0;
+    m_IntegerLimit = static_cast<int32_t>((std::min)(std::floor(threshold * fullScale), fullScale - 1.0));
+    return true;
+}
+
+bool SilenceDetector::IsSilent(const uint8_t* data, size_t sampleCount) const {
+    return m_Enabled && IsBelow(data, sampleCount, m_Format, m_IntegerLimit, m_FloatLimit);
+}
+
+bool SilenceDetector::IsZero(const uint8_t* data, size_t sampleCount, SampleFormat format) {
+    return IsBelow(data, sampleCount, format, 0, 0.0f);
+}
+
+bool SilenceDetector::IsBelow(const uint8_t* data, size_t sampleCount, SampleFormat format, int32_t integerLimit, float floatLimit) {
+    const auto& kernels = GetKernels();
+    switch (format) {
+    case SampleFormat::Int16:
+        return !kernels.Int16(reinterpret_cast<const int16_t*>(data), sampleCount, integerLimit);
+    case SampleFormat::Int24:
+        return !ExceedsInt24(data, sampleCount, integerLimit);
+    case SampleFormat::Int32:
+    case SampleFormat::Int24In32:
+        return !kernels.Int32(reinterpret_cast<const int32_t*>(data), sampleCount, integerLimit);
+    case SampleFormat::Float32:
+        return !kernels.Float(reinterpret_cast<const float*>(data), sampleCount, floatLimit);
+    }
+    return false;
+}
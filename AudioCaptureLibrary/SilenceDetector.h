@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "SampleFormatConverter.h"
+
+// Recognizes silent packets of sources that never set AUDCLNT_BUFFERFLAGS_SILENT: a packet is
+// silent when no sample is louder than the threshold. The scan uses the SSE2/AVX2 kernels picked
+// from the CPU features and stops at the first louder vector, so audible packets usually cost only
+// a few cache lines.
+class SilenceDetector {
+public:
+    // `threshold` is a linear peak level relative to full scale, 0 disables the detector.
+    bool Configure(SampleFormat format, float threshold);
+
+    bool IsEnabled() const { return m_Enabled; }
+    bool IsSilent(const uint8_t* data, size_t sampleCount) const;
+
+    // Exact digital silence, independent of any threshold. -0.0 counts as zero, NaN is ignored.
+    static bool IsZero(const uint8_t* data, size_t sampleCount, SampleFormat format);
+
+private:
+    static bool IsBelow(const uint8_t* data, size_t sampleCount, SampleFormat format, int32_t integerLimit, float floatLimit);
+
+    SampleFormat m_Format = SampleFormat::Int16;
+    bool m_Enabled = false;
+    // Largest magnitude still considered silent, scaled to the sample format.
+    int32_t m_IntegerLimit = 0;
+    float m_FloatLimit = 0.0f;
+};
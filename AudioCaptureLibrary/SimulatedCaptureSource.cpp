@@ -0,0 +1,140 @@
+#include "SimulatedCaptureSource.h"
+
+#include <wil/result.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "Logger.h"
+
+PacedCaptureSource::PacedCaptureSource(long long captureId, DWORD pipeId, TransportType transport, uint32_t packetFrames, uint32_t jitterMicroseconds) :
+    AudioCaptureSource(captureId, pipeId, transport), m_PacketFrames(packetFrames), m_JitterMicroseconds(jitterMicroseconds) {}
+
+PacedCaptureSource::~PacedCaptureSource() {
+    StopCaptureAsync();
+}
+
+HRESULT PacedCaptureSource::StartCaptureAsync() {
+    RETURN_IF_FAILED(Prepare(m_SampleRate));
+    RETURN_HR_IF(E_INVALIDARG, m_SampleRate == 0);
+    if (m_PacketFrames == 0) {
+        m_PacketFrames = (std::max)(1u, m_SampleRate / 100);
+    }
+
+    // Synchronization timers, every wait on them resets them like the audio engine's event.
+    m_Timer.reset(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+    if (!m_Timer) {
+        // Older systems, millisecond resolution.
+        m_Timer.reset(CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+    }
+    RETURN_LAST_ERROR_IF(!m_Timer);
+
+    RETURN_IF_FAILED(m_Sink.Open(m_PipeId));
+    m_Random.seed(m_PipeId + 1);
+    m_Packet = 0;
+    m_StartTime = Clock::now();
+    ArmTimer();
+
+    if (const auto hr = CaptureScheduler::GetInstance().Register(m_Timer.get(), [this]() { OnTimer(); }, m_TimerRegistration); FAILED(hr)) {
+        CancelWaitableTimer(m_Timer.get());
+        m_Sink.Close();
+        return hr;
+    }
+    return S_OK;
+}
+
+HRESULT PacedCaptureSource::StopCaptureAsync() {
+    if (m_TimerRegistration == 0) {
+        return S_OK;
+    }
+
+    CaptureScheduler::GetInstance().Unregister(m_TimerRegistration);
+    m_TimerRegistration = 0;
+    CancelWaitableTimer(m_Timer.get());
+    m_Sink.Close();
+    return S_OK;
+}
+
+void PacedCaptureSource::ArmTimer() {
+    // Deadlines are derived from the packet index, so rounding and jitter never accumulate.
+    m_Due = m_StartTime + std::chrono::microseconds((m_Packet + 1) * m_PacketFrames * 1000000ull / m_SampleRate);
+    const auto jitter = std::uniform_int_distribution<uint32_t>(0, m_JitterMicroseconds)(m_Random);
+    const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(m_Due - Clock::now()).count() + jitter;
+
+    // A late packet fires right away, relative due times must be negative.
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -(std::max)(wait * 10, 1ll);
+    SetWaitableTimer(m_Timer.get(), &dueTime, 0, nullptr, nullptr, FALSE);
+}
+
+void PacedCaptureSource::OnTimer() {
+    const auto begin = Clock::now();
+    if (DeliverPacket(m_PacketFrames) == 0) {
+        // The timer is simply not armed again, StopCaptureAsync cleans up as usual.
+        Logger::GetInstance().Log("Simulated source " + std::to_string(m_PipeId) + " reached the end of its stream");
+        return;
+    }
+
+    if (m_PacketObserver) {
+        m_PacketObserver(m_Packet, m_Due, begin, Clock::now());
+    }
+
+    ++m_Packet;
+    ArmTimer();
+}
+
+SyntheticCaptureSource::SyntheticCaptureSource(long long captureId, const SimulatedSourceInfo& info, TransportType transport) :
+    PacedCaptureSource(captureId, info.PipeId, transport, info.PacketFrames, info.JitterMicroseconds) {
+    m_Generator.Configure(static_cast<SignalType>(info.Signal), info.SampleRate, info.Channels, info.Frequency, info.Amplitude, info.PipeId + 1);
+}
+
+HRESULT SyntheticCaptureSource::Prepare(uint32_t& sampleRate) {
+    // Announced like an application loopback stream.
+    RETURN_IF_FAILED(m_Sink.SetFormat(SampleFormat::Float32, SampleFormat::Int16, m_Generator.GetChannels(), m_Generator.GetSampleRate()));
+    sampleRate = m_Generator.GetSampleRate();
+    return S_OK;
+}
+
+size_t SyntheticCaptureSource::DeliverPacket(size_t frames) {
+    m_Sink.Deliver(reinterpret_cast<const BYTE*>(m_Generator.Generate(frames)), frames);
+    return frames;
+}
+
+WavFileCaptureSource::WavFileCaptureSource(long long captureId, const SimulatedSourceInfo& info, TransportType transport) :
+    PacedCaptureSource(captureId, info.PipeId, transport, info.PacketFrames, info.JitterMicroseconds),
+    m_Path(info.FilePath ? info.FilePath : L""),
+    m_Loop(info.Loop != FALSE) {}
+
+HRESULT WavFileCaptureSource::Prepare(uint32_t& sampleRate) {
+    RETURN_HR_IF(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), !m_Reader.Open(m_Path));
+
+    const AudioFormat& format = m_Reader.GetFormat();
+    const SampleFormat sampleFormat = m_Reader.GetSampleFormat();
+    RETURN_IF_FAILED(m_Sink.SetFormat(sampleFormat, CaptureSink::GetDefaultStreamFormat(sampleFormat), format.Channels, format.SampleRate));
+    sampleRate = format.SampleRate;
+    return S_OK;
+}
+
+size_t WavFileCaptureSource::DeliverPacket(size_t frames) {
+    const uint32_t frameSize = m_Reader.GetFormat().BytesPerFrame();
+    m_Packet.resize(frames * frameSize);
+
+    size_t read = m_Reader.Read(m_Packet.data(), frames);
+    if (m_Loop && read < frames && m_Reader.GetFrameCount() > 0) {
+        m_Reader.Rewind();
+        read += m_Reader.Read(m_Packet.data() + read * frameSize, frames - read);
+    }
+
+    if (read > 0) {
+        m_Sink.Deliver(m_Packet.data(), read);
+    }
+    return read;
+}
+
+std::unique_ptr<AudioCaptureSource> CreateSimulatedSource(long long captureId, const SimulatedSourceInfo& info, TransportType transport) {
+    if (info.FilePath && SysStringLen(info.FilePath) > 0) {
+        return std::make_unique<WavFileCaptureSource>(captureId, info, transport);
+    }
+    return std::make_unique<SyntheticCaptureSource>(captureId, info, transport);
+}
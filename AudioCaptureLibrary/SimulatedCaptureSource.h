@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Windows.h>
+#include <wtypes.h>
+#include <wil/resource.h>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "AudioCaptureSource.h"
+#include "CaptureScheduler.h"
+#include "SignalGenerator.h"
+#include "WavFileReader.h"
+
+// Description of a source without audio hardware, passed to StartSimulatedCapture.
+struct SimulatedSourceInfo {
+    DWORD PipeId;
+    // SignalType, ignored when FilePath is set.
+    int Signal;
+    // WAV file played instead of a generated signal, its format replaces SampleRate and Channels.
+    BSTR FilePath;
+    float Frequency;
+    float Amplitude;
+    DWORD SampleRate;
+    DWORD Channels;
+    // Frames per packet, 0 for 10 ms packets.
+    DWORD PacketFrames;
+    // Upper bound of the random delay added to each packet.
+    DWORD JitterMicroseconds;
+    // Restart the file at its end instead of ending the stream.
+    BOOL Loop;
+};
+
+// Base of the sources that have no audio client: one packet every PacketFrames / SampleRate
+// seconds, paced by a high resolution waitable timer served by the CaptureScheduler exactly like
+// an audio client's event. Jitter delays single packets like a loaded audio engine would, the
+// long-term cadence does not drift.
+//
+// Derived classes stop the source in their own destructor, DeliverPacket must not run on a
+// partly destroyed object.
+class PacedCaptureSource : public AudioCaptureSource {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Called on the scheduler thread after every delivery with the packet index, the time the packet
+    // was due and the times DeliverPacket started and returned.
+    using PacketObserver = std::function<void(uint64_t packet, Clock::time_point due, Clock::time_point begin, Clock::time_point end)>;
+
+    ~PacedCaptureSource() override;
+
+    HRESULT StartCaptureAsync() override;
+    HRESULT StopCaptureAsync() override;
+
+    // Set before StartCaptureAsync.
+    void SetPacketObserver(PacketObserver observer) { m_PacketObserver = std::move(observer); }
+
+    UINT64 GetDroppedBytes() const { return m_Sink.GetDroppedBytes(); }
+
+    // Packet n holds the audio up to GetStartTime() + (n + 1) packet durations.
+    Clock::time_point GetStartTime() const { return m_StartTime; }
+
+protected:
+    PacedCaptureSource(long long captureId, DWORD pipeId, TransportType transport, uint32_t packetFrames, uint32_t jitterMicroseconds);
+
+    // Configures the sink and returns the rate the packets are produced at.
+    virtual HRESULT Prepare(uint32_t& sampleRate) = 0;
+
+    // Delivers the next packet to the sink, returns the frames delivered. 0 ends the stream.
+    virtual size_t DeliverPacket(size_t frames) = 0;
+
+private:
+    void ArmTimer();
+    void OnTimer();
+
+    uint32_t m_PacketFrames;
+    uint32_t m_JitterMicroseconds;
+    uint32_t m_SampleRate = 0;
+    PacketObserver m_PacketObserver;
+    Clock::time_point m_StartTime;
+    wil::unique_handle m_Timer;
+    CaptureScheduler::RegistrationId m_TimerRegistration = 0;
+
+    // Scheduler thread.
+    uint64_t m_Packet = 0;
+    Clock::time_point m_Due;
+    std::minstd_rand m_Random;
+};
+
+class SyntheticCaptureSource : public PacedCaptureSource {
+public:
+    SyntheticCaptureSource(long long captureId, const SimulatedSourceInfo& info, TransportType transport);
+    ~SyntheticCaptureSource() override { StopCaptureAsync(); }
+
+protected:
+    HRESULT Prepare(uint32_t& sampleRate) override;
+    size_t DeliverPacket(size_t frames) override;
+
+private:
+    SignalGenerator m_Generator;
+};
+
+class WavFileCaptureSource : public PacedCaptureSource {
+public:
+    WavFileCaptureSource(long long captureId, const SimulatedSourceInfo& info, TransportType transport);
+    ~WavFileCaptureSource() override { StopCaptureAsync(); }
+
+protected:
+    HRESULT Prepare(uint32_t& sampleRate) override;
+    size_t DeliverPacket(size_t frames) override;
+
+private:
+    std::filesystem::path m_Path;
+    bool m_Loop;
+    WavFileReader m_Reader;
+    std::vector<BYTE> m_Packet;
+};
+
+std::unique_ptr<AudioCaptureSource> CreateSimulatedSource(long long captureId, const SimulatedSourceInfo& info, TransportType transport);
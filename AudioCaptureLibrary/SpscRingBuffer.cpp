@@ -0,0 +1,59 @@
+#include "SpscRingBuffer.h"
+
+#include <cstring>
+
+static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+SpscRingBuffer::SpscRingBuffer(size_t capacity)
+    : m_Buffer(new uint8_t[RoundUpToPowerOfTwo(capacity)]),
+      m_Capacity(RoundUpToPowerOfTwo(capacity)),
+      m_Mask(RoundUpToPowerOfTwo(capacity) - 1) {}
+
+bool SpscRingBuffer::TryWrite(const void* data, size_t size) {
+    const size_t writePos = m_WritePos.load(std::memory_order_relaxed);
+
+    if (writePos - m_CachedReadPos + size > m_Capacity) {
+        m_CachedReadPos = m_ReadPos.load(std::memory_order_acquire);
+        if (writePos - m_CachedReadPos + size > m_Capacity) {
+            return false;
+        }
+    }
+
+    const size_t offset = writePos & m_Mask;
+    const size_t firstPart = (size < m_Capacity - offset) ? size : m_Capacity - offset;
+    const auto* source = static_cast<const uint8_t*>(data);
+
+    memcpy(m_Buffer.get() + offset, source, firstPart);
+    if (firstPart < size) {
+        memcpy(m_Buffer.get(), source + firstPart, size - firstPart);
+    }
+
+    m_WritePos.store(writePos + size, std::memory_order_release);
+    return true;
+}
+
+size_t SpscRingBuffer::GetReadRegions(ReadRegion regions[2]) {
+    const size_t readPos = m_ReadPos.load(std::memory_order_relaxed);
+    const size_t available = m_WritePos.load(std::memory_order_acquire) - readPos;
+    const size_t offset = readPos & m_Mask;
+    const size_t firstPart = (available < m_Capacity - offset) ? available : m_Capacity - offset;
+
+    regions[0] = { m_Buffer.get() + offset, firstPart };
+    regions[1] = { m_Buffer.get(), available - firstPart };
+
+    return available;
+}
+
+void SpscRingBuffer::Consume(size_t size) {
+    m_ReadPos.store(m_ReadPos.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+size_t SpscRingBuffer::ReadableBytes() const {
+    return m_WritePos.load(std::memory_order_acquire) - m_ReadPos.load(std::memory_order_acquire);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Lock-free single-producer/single-consumer byte ring.
+//
+// The producer is the WASAPI capture callback, the consumer is the transport writer thread.
+// Storage is allocated once in the constructor, so neither side allocates, locks or blocks.
+// Producer and consumer cursors live on separate cache lines to avoid false sharing.
+class SpscRingBuffer {
+public:
+    static constexpr size_t CacheLineSize = 64;
+
+    struct ReadRegion {
+        const uint8_t* Data;
+        size_t Size;
+    };
+
+    // Capacity is rounded up to the next power of two.
+    explicit SpscRingBuffer(size_t capacity);
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    // Producer side. Copies the whole block or nothing, so packets are never split by an overrun.
+    bool TryWrite(const void* data, size_t size);
+
+    // Consumer side. Fills up to two contiguous regions and returns the total readable size.
+    size_t GetReadRegions(ReadRegion regions[2]);
+    void Consume(size_t size);
+
+    size_t ReadableBytes() const;
+    size_t Capacity() const { return m_Capacity; }
+
+private:
+    alignas(CacheLineSize) std::atomic<size_t> m_WritePos{ 0 };
+    size_t m_CachedReadPos = 0;
+
+    alignas(CacheLineSize) std::atomic<size_t> m_ReadPos{ 0 };
+
+    alignas(CacheLineSize) std::unique_ptr<uint8_t[]> m_Buffer;
+    size_t m_Capacity = 0;
+    size_t m_Mask = 0;
+};
@@ -0,0 +1,24 @@
+#include "StreamRecord.h"
+
+#include <cstring>
+
+bool StreamRecordWriter::WriteAudio(AudioTransport& transport, const BYTE* data, DWORD size) {
+    if (!m_RecordsEnabled) {
+        return transport.Write(data, size);
+    }
+
+    const StreamRecordHeader header = { StreamRecordHeader::AudioType, size };
+    m_Record.resize(sizeof(header) + size);
+    memcpy(m_Record.data(), &header, sizeof(header));
+    memcpy(m_Record.data() + sizeof(header), data, size);
+    return transport.Write(m_Record.data(), static_cast<DWORD>(m_Record.size()));
+}
+
+bool StreamRecordWriter::WriteSilence(AudioTransport& transport, uint32_t frames) {
+    if (!m_RecordsEnabled || frames == 0) {
+        return false;
+    }
+
+    const StreamRecordHeader header = { StreamRecordHeader::SilenceType, frames };
+    return transport.Write(reinterpret_cast<const BYTE*>(&header), sizeof(header));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <vector>
+
+#include "AudioTransport.h"
+
+// Framing of a stream with silence records enabled. Every transport write is one record: a
+// StreamRecordHeader followed, for audio, by Size bytes of PCM in the stream format. A silence
+// record has no payload and stands for Size frames of digital silence. Both transports move or
+// drop whole writes, so a consumer never sees a partial record other than at a read boundary.
+struct StreamRecordHeader {
+    static constexpr uint32_t AudioType = 0;
+    static constexpr uint32_t SilenceType = 1;
+
+    uint32_t Type;
+    // Payload bytes for audio, frames for silence.
+    uint32_t Size;
+};
+
+static_assert(sizeof(StreamRecordHeader) == 8, "Record header is part of the stream format");
+
+// How a stream treats silence. Shared by all streams of a capture.
+struct SilenceHandling {
+    // Send silent packets as silence records, which frames the whole stream; otherwise they go out
+    // as zero bytes.
+    bool Records = false;
+    // Packets whose peak stays at or below this linear level are treated like packets the engine
+    // flagged silent, 0 only trusts the flag.
+    float Threshold = 0.0f;
+};
+
+// Writes a stream to its transport as plain PCM or, with records enabled, as framed records.
+// Capture thread only.
+class StreamRecordWriter {
+public:
+    void SetRecordsEnabled(bool enabled) { m_RecordsEnabled = enabled; }
+    bool IsRecordsEnabled() const { return m_RecordsEnabled; }
+
+    bool WriteAudio(AudioTransport& transport, const BYTE* data, DWORD size);
+    // Only valid with records enabled, plain streams carry silence as zero bytes.
+    bool WriteSilence(AudioTransport& transport, uint32_t frames);
+
+private:
+    bool m_RecordsEnabled = false;
+    // Header and payload of an audio record, assembled so that the record is a single write.
+    std::vector<BYTE> m_Record;
+};
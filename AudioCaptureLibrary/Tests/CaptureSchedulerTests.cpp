@@ -0,0 +1,192 @@
+// The capture scheduler's core on portable signals: busy sources do not starve the others,
+// Unregister waits for a running callback, and workers are spread, added and reaped as
+// registrations come and go.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "CaptureSchedulerCore.h"
+#include "TestCheck.h"
+
+namespace {
+
+// Auto-reset event stand-in. All signals and waits share one lock and condition variable, which
+// is plenty for a handful of sources.
+std::mutex g_SignalLock;
+std::condition_variable g_SignalChanged;
+
+struct TestSignal {
+    bool IsSet = false;
+};
+
+void Signal(TestSignal& signal) {
+    std::lock_guard lock(g_SignalLock);
+    signal.IsSet = true;
+    g_SignalChanged.notify_all();
+}
+
+class TestWait : public SchedulerWait {
+public:
+    void Wake() override {
+        std::lock_guard lock(g_SignalLock);
+        m_Woken = true;
+        g_SignalChanged.notify_all();
+    }
+
+    size_t Wait(const Handle* handles, size_t count) override {
+        std::unique_lock lock(g_SignalLock);
+        for (;;) {
+            if (m_Woken) {
+                m_Woken = false;
+                return Woken;
+            }
+            for (size_t k = 0; k < count; ++k) {
+                auto* signal = static_cast<TestSignal*>(handles[k]);
+                if (signal->IsSet) {
+                    signal->IsSet = false;
+                    return k;
+                }
+            }
+            g_SignalChanged.wait(lock);
+        }
+    }
+
+private:
+    bool m_Woken = false;
+};
+
+std::unique_ptr<SchedulerWait> CreateTestWait() {
+    return std::make_unique<TestWait>();
+}
+
+// Polls `condition` for up to five seconds.
+template <typename Condition>
+bool WaitUntil(Condition condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+int TestBusySourceDoesNotStarveOthers() {
+    CaptureSchedulerCore scheduler(1, 8, CreateTestWait);
+
+    // The first source is signaled again from its own callback, so it is always ready and would
+    // win every wait without the rotation.
+    TestSignal busy, quiet;
+    std::atomic<int> busyCalls{ 0 };
+    std::atomic<int> busyCallsWhenServed{ -1 };
+    CaptureSchedulerCore::RegistrationId busyId = 0, quietId = 0;
+    CHECK(scheduler.Register(&busy, [&] { ++busyCalls; Signal(busy); }, busyId));
+    CHECK(scheduler.Register(&quiet, [&] { busyCallsWhenServed = busyCalls.load(); }, quietId));
+    CHECK(scheduler.GetWorkerCount() == 1);
+
+    Signal(busy);
+    CHECK(WaitUntil([&] { return busyCalls > 10; }));
+    const int busyCallsBefore = busyCalls;
+    Signal(quiet);
+    CHECK(WaitUntil([&] { return busyCallsWhenServed >= 0; }));
+    CHECK(busyCallsWhenServed - busyCallsBefore <= 2);
+
+    scheduler.Unregister(busyId);
+    scheduler.Unregister(quietId);
+    return 0;
+}
+
+int TestUnregisterWaitsForCallback() {
+    CaptureSchedulerCore scheduler(1, 8, CreateTestWait);
+
+    TestSignal signal;
+    std::atomic<bool> inCallback{ false };
+    std::atomic<int> calls{ 0 };
+    CaptureSchedulerCore::RegistrationId id = 0;
+    CHECK(scheduler.Register(&signal, [&] {
+        inCallback = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ++calls;
+        inCallback = false;
+    }, id));
+
+    Signal(signal);
+    CHECK(WaitUntil([&] { return inCallback.load(); }));
+    scheduler.Unregister(id);
+    CHECK(!inCallback);
+    CHECK(calls == 1);
+
+    // Not served anymore.
+    Signal(signal);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(calls == 1);
+
+    // Unknown ids and 0 are ignored.
+    scheduler.Unregister(id);
+    scheduler.Unregister(0);
+    return 0;
+}
+
+int TestWorkersAreSpreadAndReaped() {
+    CaptureSchedulerCore scheduler(2, 2, CreateTestWait);
+
+    TestSignal signals[5];
+    CaptureSchedulerCore::RegistrationId ids[5] = {};
+    std::atomic<int> calls[5] = {};
+    const size_t expectedWorkers[5] = { 1, 2, 2, 2, 3 };
+    for (int k = 0; k < 5; ++k) {
+        CHECK(scheduler.Register(&signals[k], [&calls, k] { ++calls[k]; }, ids[k]));
+        // The pool fills up before a worker takes a second source, and only grows past its size
+        // once every worker is full.
+        CHECK(scheduler.GetWorkerCount() == expectedWorkers[k]);
+    }
+
+    for (int k = 0; k < 5; ++k) {
+        Signal(signals[k]);
+    }
+    CHECK(WaitUntil([&] {
+        for (const auto& count : calls) {
+            if (count != 1) {
+                return false;
+            }
+        }
+        return true;
+    }));
+
+    // The overflow worker served only the last source.
+    scheduler.Unregister(ids[4]);
+    CHECK(scheduler.GetWorkerCount() == 2);
+    for (int k = 0; k < 4; ++k) {
+        scheduler.Unregister(ids[k]);
+    }
+    CHECK(scheduler.GetWorkerCount() == 0);
+    return 0;
+}
+
+int TestRejectsInvalidRegistrations() {
+    CaptureSchedulerCore scheduler(1, 8, [] { return std::unique_ptr<SchedulerWait>(); });
+
+    TestSignal signal;
+    CaptureSchedulerCore::RegistrationId id = 0;
+    CHECK(!scheduler.Register(nullptr, [] {}, id));
+    CHECK(!scheduler.Register(&signal, nullptr, id));
+    // A worker whose wait cannot be created is not started.
+    CHECK(!scheduler.Register(&signal, [] {}, id));
+    CHECK(scheduler.GetWorkerCount() == 0);
+    return 0;
+}
+
+}
+
+int main() {
+    RUN_TEST(TestBusySourceDoesNotStarveOthers);
+    RUN_TEST(TestUnregisterWaitsForCallback);
+    RUN_TEST(TestWorkersAreSpreadAndReaped);
+    RUN_TEST(TestRejectsInvalidRegistrations);
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Round trips through the codecs and containers of the portable core.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "Crc32.h"
+#include "FlacDecoder.h"
+#include "FlacEncoder.h"
+#include "ImaAdpcmCodec.h"
+#include "SampleFormatConverter.h"
+#include "SignalGenerator.h"
+#include "TestCheck.h"
+#include "WavFileReader.h"
+#include "WavHeader.h"
+
+namespace {
+
+// A tone with some noise on top, as Int16 stereo.
+std::vector<int16_t> MakeSignal(size_t frames) {
+    SignalGenerator tone, noise;
+    tone.Configure(SignalType::Tone, 48000, 2, 997.0f, 0.5f);
+    noise.Configure(SignalType::Noise, 48000, 2, 0.0f, 0.05f, 7);
+
+    const float* toneSamples = tone.Generate(frames);
+    const float* noiseSamples = noise.Generate(frames);
+    std::vector<float> mixed(frames * 2);
+    for (size_t i = 0; i < mixed.size(); ++i) {
+        mixed[i] = toneSamples[i] + noiseSamples[i];
+    }
+
+    SampleFormatConverter converter;
+    converter.Configure(SampleFormat::Float32, SampleFormat::Int16);
+    const auto* converted = reinterpret_cast<const int16_t*>(converter.Convert(mixed.data(), mixed.size()));
+    return std::vector<int16_t>(converted, converted + mixed.size());
+}
+
+int TestCrc32() {
+    const char text[] = "123456789";
+    CHECK(UpdateCrc32(0, text, 9) == 0xCBF43926u);
+    // Fed in pieces, the result is the same.
+    CHECK(UpdateCrc32(UpdateCrc32(0, text, 4), text + 4, 5) == 0xCBF43926u);
+    return 0;
+}
+
+int TestFlacRoundTrip() {
+    const size_t frames = 48000 + 123;
+    const auto signal = MakeSignal(frames);
+
+    for (int level : { 0, FlacEncoder::DefaultCompressionLevel, FlacEncoder::MaxCompressionLevel }) {
+        FlacEncoderSettings settings;
+        settings.SampleRate = 48000;
+        settings.Channels = 2;
+        settings.Format = SampleFormat::Int16;
+        settings.CompressionLevel = level;
+
+        FlacEncoder encoder;
+        CHECK(encoder.Configure(settings));
+
+        // Uneven pieces, the encoder buffers the block remainder.
+        std::vector<uint8_t> encoded;
+        for (size_t offset = 0; offset < frames;) {
+            const size_t count = std::min<size_t>(frames - offset, 1000 + offset % 777);
+            encoder.Encode(signal.data() + offset * 2, count, encoded);
+            offset += count;
+        }
+        encoder.Finish(encoded);
+        CHECK(encoder.GetEncodedFrames() == frames);
+        CHECK(encoded.size() < signal.size() * sizeof(int16_t));
+
+        FlacDecoder decoder;
+        CHECK(decoder.Configure(16, 2));
+        size_t decoded = 0;
+        for (size_t position = 0; position < encoded.size(); position += decoder.GetFrameSize()) {
+            CHECK(decoder.DecodeFrame(encoded.data() + position, encoded.size() - position));
+            for (size_t i = 0; i < decoder.GetFrameCount(); ++i) {
+                for (uint16_t channel = 0; channel < 2; ++channel) {
+                    CHECK(decoder.GetChannel(channel)[i] == signal[(decoded + i) * 2 + channel]);
+                }
+            }
+            decoded += decoder.GetFrameCount();
+        }
+        CHECK(decoded == frames);
+
+        // A flipped bit is caught by the frame CRC.
+        encoded[encoded.size() / 3] ^= 0x10;
+        bool damaged = false;
+        for (size_t position = 0; position < encoded.size() && !damaged; position += decoder.GetFrameSize()) {
+            damaged = !decoder.DecodeFrame(encoded.data() + position, encoded.size() - position);
+        }
+        CHECK(damaged);
+    }
+    return 0;
+}
+
+int TestImaAdpcmRoundTrip() {
+    const size_t frames = 1024;
+    const auto signal = MakeSignal(frames);
+
+    ImaAdpcmCodec codec;
+    CHECK(codec.Configure(2));
+    std::vector<uint8_t> block;
+    codec.Encode(signal.data(), frames, block);
+    CHECK(block.size() == ImaAdpcmCodec::GetBlockSize(frames, 2));
+
+    std::vector<int16_t> decoded(signal.size());
+    CHECK(ImaAdpcmCodec::Decode(block.data(), block.size(), 2, frames, decoded.data()));
+
+    // Lossy, but it follows the signal closely once the step size adapted.
+    double error = 0.0, power = 0.0;
+    for (size_t i = 256 * 2; i < signal.size(); ++i) {
+        error += std::pow(double(decoded[i]) - signal[i], 2);
+        power += std::pow(double(signal[i]), 2);
+    }
+    CHECK(10.0 * std::log10(power / error) > 20.0);
+
+    CHECK(!ImaAdpcmCodec::Decode(block.data(), block.size() - 1, 2, frames, decoded.data()));
+    return 0;
+}
+
+int TestWavRoundTrip() {
+    const size_t frames = 4410;
+    const auto signal = MakeSignal(frames);
+
+    AudioFormat format;
+    format.SampleRate = 48000;
+    format.Channels = 2;
+    format.BitsPerSample = 16;
+
+    const auto path = std::filesystem::temp_directory_path() / "AudioCaptureCore_CodecTests.wav";
+    {
+        const auto header = BuildWavHeader(format, signal.size() * sizeof(int16_t));
+        CHECK(header.size() == GetWavHeaderSize(format));
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        file.write(reinterpret_cast<const char*>(signal.data()), signal.size() * sizeof(int16_t));
+    }
+
+    WavFileReader reader;
+    CHECK(reader.Open(path));
+    CHECK(reader.GetFormat().SampleRate == 48000 && reader.GetFormat().Channels == 2);
+    CHECK(reader.GetSampleFormat() == SampleFormat::Int16);
+    CHECK(reader.GetFrameCount() == frames);
+
+    std::vector<int16_t> read(signal.size());
+    CHECK(reader.Read(read.data(), frames) == frames);
+    CHECK(read == signal);
+    CHECK(reader.Read(read.data(), frames) == 0);
+
+    reader = WavFileReader();
+    std::filesystem::remove(path);
+    return 0;
+}
+
+}
+
+int main() {
+    RUN_TEST(TestCrc32);
+    RUN_TEST(TestFlacRoundTrip);
+    RUN_TEST(TestImaAdpcmRoundTrip);
+    RUN_TEST(TestWavRoundTrip);
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Float to integer kernels of every instruction set the CPU has: NaN becomes silence, infinities
+// saturate, and the vector kernels agree with the scalar one.
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "SampleFormatConverter.h"
+#include "TestCheck.h"
+
+namespace {
+
+constexpr SampleFormat IntegerFormats[] = { SampleFormat::Int16, SampleFormat::Int24, SampleFormat::Int32, SampleFormat::Int24In32 };
+constexpr InstructionSet InstructionSets[] = { InstructionSet::Scalar, InstructionSet::Sse2, InstructionSet::Avx2 };
+
+// Sign extended value of sample `index`, scaled to 32 bits.
+int64_t LoadSample(const std::vector<uint8_t>& data, SampleFormat format, size_t index) {
+    const size_t size = SampleFormatConverter::GetSampleSize(format);
+    const uint8_t* sample = data.data() + index * size;
+    switch (format) {
+    case SampleFormat::Int16: {
+        int16_t value;
+        memcpy(&value, sample, sizeof(value));
+        return int64_t{ value } << 16;
+    }
+    case SampleFormat::Int24:
+        return static_cast<int32_t>((uint32_t{ sample[0] } << 8) | (uint32_t{ sample[1] } << 16) | (uint32_t{ sample[2] } << 24));
+    default: {
+        int32_t value;
+        memcpy(&value, sample, sizeof(value));
+        return value;
+    }
+    }
+}
+
+std::vector<uint8_t> Convert(SampleFormat destination, InstructionSet instructionSet, const std::vector<float>& input) {
+    std::vector<uint8_t> output(input.size() * SampleFormatConverter::GetSampleSize(destination));
+    DitherState dither;
+    const auto kernel = SampleFormatConverter::GetKernel(SampleFormat::Float32, destination, false, instructionSet);
+    kernel(reinterpret_cast<const uint8_t*>(input.data()), output.data(), input.size(), dither);
+    return output;
+}
+
+int TestNanAndInfinity() {
+    constexpr float Nan = std::numeric_limits<float>::quiet_NaN();
+    constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+    // 19 samples run through the vector body and the scalar tail of every kernel.
+    std::vector<float> input(19);
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] = i % 3 == 0 ? Nan : (i % 3 == 1 ? Infinity : -Infinity);
+    }
+
+    for (const auto instructionSet : InstructionSets) {
+        if (instructionSet > GetInstructionSet()) {
+            break;
+        }
+        for (const auto format : IntegerFormats) {
+            const auto output = Convert(format, instructionSet, input);
+            for (size_t i = 0; i < input.size(); ++i) {
+                const int64_t value = LoadSample(output, format, i);
+                if (i % 3 == 0) {
+                    CHECK(value == 0);
+                }
+                else if (i % 3 == 1) {
+                    CHECK(value > 0x7F000000);
+                }
+                else {
+                    CHECK(value == INT32_MIN);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int TestKernelsAgreeWithScalar() {
+    std::vector<float> input(1001);
+    uint32_t state = 1;
+    for (auto& value : input) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        value = static_cast<float>(state >> 8) * (2.2f / 16777216.0f) - 1.1f;
+    }
+
+    for (const auto format : IntegerFormats) {
+        const auto expected = Convert(format, InstructionSet::Scalar, input);
+        for (const auto instructionSet : InstructionSets) {
+            if (instructionSet > GetInstructionSet()) {
+                break;
+            }
+            CHECK(Convert(format, instructionSet, input) == expected);
+        }
+    }
+    return 0;
+}
+
+}
+
+int main() {
+    RUN_TEST(TestNanAndInfinity);
+    RUN_TEST(TestKernelsAgreeWithScalar);
+    return 0;
+}
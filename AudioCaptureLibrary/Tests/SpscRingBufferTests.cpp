@@ -0,0 +1,163 @@
+// The capture callback's ring: packets go in whole or not at all, and a consumer that falls behind
+// never holds up the producer.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "SpscRingBuffer.h"
+#include "TestCheck.h"
+
+namespace {
+
+// Reads everything readable into `output`.
+size_t Drain(SpscRingBuffer& ring, std::vector<uint8_t>& output) {
+    SpscRingBuffer::ReadRegion regions[2];
+    const size_t available = ring.GetReadRegions(regions);
+    for (const auto& region : regions) {
+        output.insert(output.end(), region.Data, region.Data + region.Size);
+    }
+    ring.Consume(available);
+    return available;
+}
+
+int TestCapacityRoundsUp() {
+    SpscRingBuffer ring(1000);
+    CHECK(ring.Capacity() == 1024);
+    CHECK(ring.ReadableBytes() == 0);
+    return 0;
+}
+
+int TestWrap() {
+    SpscRingBuffer ring(64);
+    std::vector<uint8_t> packet(40);
+
+    // Each packet starts where the previous one ended, so they wrap at different offsets.
+    uint8_t next = 0;
+    std::vector<uint8_t> expected, read;
+    for (int i = 0; i < 50; ++i) {
+        for (auto& value : packet) {
+            value = next++;
+        }
+        CHECK(ring.TryWrite(packet.data(), packet.size()));
+        expected.insert(expected.end(), packet.begin(), packet.end());
+
+        SpscRingBuffer::ReadRegion regions[2];
+        CHECK(ring.GetReadRegions(regions) == packet.size());
+        CHECK(regions[0].Size + regions[1].Size == packet.size());
+        CHECK(Drain(ring, read) == packet.size());
+    }
+    CHECK(read == expected);
+    return 0;
+}
+
+int TestFull() {
+    SpscRingBuffer ring(64);
+    std::vector<uint8_t> packet(16, 0xAB);
+
+    for (int i = 0; i < 4; ++i) {
+        CHECK(ring.TryWrite(packet.data(), packet.size()));
+    }
+    CHECK(ring.ReadableBytes() == 64);
+    CHECK(!ring.TryWrite(packet.data(), 1));
+
+    // Room made by the consumer is seen by the producer again.
+    SpscRingBuffer::ReadRegion regions[2];
+    ring.GetReadRegions(regions);
+    ring.Consume(16);
+    CHECK(ring.TryWrite(packet.data(), packet.size()));
+    CHECK(!ring.TryWrite(packet.data(), 1));
+    return 0;
+}
+
+int TestWholePacketDrop() {
+    SpscRingBuffer ring(64);
+    std::vector<uint8_t> first(40, 1), second(40, 2), third(24, 3);
+
+    CHECK(ring.TryWrite(first.data(), first.size()));
+    // Does not fit: nothing of it may be written, not even the part that would.
+    CHECK(!ring.TryWrite(second.data(), second.size()));
+    CHECK(ring.ReadableBytes() == first.size());
+    CHECK(ring.TryWrite(third.data(), third.size()));
+
+    std::vector<uint8_t> read;
+    Drain(ring, read);
+    std::vector<uint8_t> expected = first;
+    expected.insert(expected.end(), third.begin(), third.end());
+    CHECK(read == expected);
+
+    // Larger than the whole ring.
+    std::vector<uint8_t> huge(65);
+    CHECK(!ring.TryWrite(huge.data(), huge.size()));
+    CHECK(ring.ReadableBytes() == 0);
+    return 0;
+}
+
+// A producer at a steady packet rate against a consumer that stalls: every packet arrives intact
+// or not at all, in order, and no write waits for the consumer.
+int TestSlowConsumer() {
+    constexpr size_t PacketSize = 480 * 4;
+    constexpr uint32_t PacketCount = 2000;
+    SpscRingBuffer ring(PacketSize * 8);
+
+    std::atomic<bool> done{ false };
+    std::vector<uint8_t> read;
+    std::thread consumer([&] {
+        while (!done.load(std::memory_order_acquire) || ring.ReadableBytes() > 0) {
+            Drain(ring, read);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    });
+
+    uint32_t written = 0;
+    auto longestWrite = std::chrono::steady_clock::duration::zero();
+    std::vector<uint8_t> packet(PacketSize);
+    for (uint32_t sequence = 0; sequence < PacketCount; ++sequence) {
+        for (size_t offset = 0; offset < PacketSize; offset += sizeof(sequence)) {
+            std::memcpy(packet.data() + offset, &sequence, sizeof(sequence));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        written += ring.TryWrite(packet.data(), packet.size()) ? 1 : 0;
+        longestWrite = (std::max)(longestWrite, std::chrono::steady_clock::now() - start);
+
+        if (sequence % 4 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+
+    CHECK(written > 0 && written < PacketCount);
+    CHECK(read.size() == static_cast<size_t>(written) * PacketSize);
+
+    uint32_t previous = 0;
+    for (size_t position = 0; position < read.size(); position += PacketSize) {
+        uint32_t sequence;
+        std::memcpy(&sequence, read.data() + position, sizeof(sequence));
+        CHECK(position == 0 || sequence > previous);
+        for (size_t offset = 0; offset < PacketSize; offset += sizeof(sequence)) {
+            CHECK(std::memcmp(read.data() + position + offset, &sequence, sizeof(sequence)) == 0);
+        }
+        previous = sequence;
+    }
+
+    // A write is a copy of two kilobytes; one that waited for the consumer would take a whole stall.
+    CHECK(longestWrite < std::chrono::milliseconds(25));
+    return 0;
+}
+
+}
+
+int main() {
+    RUN_TEST(TestCapacityRoundsUp);
+    RUN_TEST(TestWrap);
+    RUN_TEST(TestFull);
+    RUN_TEST(TestWholePacketDrop);
+    RUN_TEST(TestSlowConsumer);
+    return 0;
+}
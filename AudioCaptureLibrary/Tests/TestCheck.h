@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdio>
+
+// Stops the test at the first failed condition, naming it and its line.
+#define CHECK(condition)                                                                \
+    do {                                                                                \
+        if (!(condition)) {                                                             \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);   \
+            return 1;                                                                   \
+        }                                                                               \
+    } while (false)
+
+// Runs a test function returning 0 on success, passing its result on.
+#define RUN_TEST(test)                                  \
+    do {                                                \
+        if (const int result = test(); result != 0) {   \
+            std::printf("%s failed\n", #test);          \
+            return result;                              \
+        }                                               \
+        std::printf("%s passed\n", #test);              \
+    } while (false)
@@ -0,0 +1,113 @@
+#include "WavFileReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr uint16_t WaveFormatPcm = 0x0001;
+static constexpr uint16_t WaveFormatIeeeFloat = 0x0003;
+static constexpr uint16_t WaveFormatExtensible = 0xFFFE;
+
+static uint16_t GetUInt16(const uint8_t* data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+static uint32_t GetUInt32(const uint8_t* data) {
+    return GetUInt16(data) | (static_cast<uint32_t>(GetUInt16(data + 2)) << 16);
+}
+
+static uint64_t GetUInt64(const uint8_t* data) {
+    return GetUInt32(data) | (static_cast<uint64_t>(GetUInt32(data + 4)) << 32);
+}
+
+bool WavFileReader::Open(const std::filesystem::path& path) {
+    m_File.close();
+    m_File.clear();
+    m_File.open(path, std::ios::binary);
+    if (!m_File) {
+        return false;
+    }
+
+    uint8_t riff[12];
+    if (!m_File.read(reinterpret_cast<char*>(riff), sizeof(riff)) ||
+        (memcmp(riff, "RIFF", 4) != 0 && memcmp(riff, "RF64", 4) != 0) || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    bool hasFormat = false;
+    uint64_t rf64DataSize = 0;
+    uint8_t chunk[8];
+    while (m_File.read(reinterpret_cast<char*>(chunk), sizeof(chunk))) {
+        const uint32_t size = GetUInt32(chunk + 4);
+        const std::streamoff next = static_cast<std::streamoff>(m_File.tellg()) + size + (size & 1);
+
+        if (memcmp(chunk, "ds64", 4) == 0 && size >= 16) {
+            uint8_t ds64[16];
+            if (!m_File.read(reinterpret_cast<char*>(ds64), sizeof(ds64))) {
+                return false;
+            }
+            rf64DataSize = GetUInt64(ds64 + 8);
+        }
+        else if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            uint8_t fmt[40] = {};
+            if (!m_File.read(reinterpret_cast<char*>(fmt), (std::min)(size, static_cast<uint32_t>(sizeof(fmt))))) {
+                return false;
+            }
+
+            uint16_t tag = GetUInt16(fmt);
+            m_Format.Channels = GetUInt16(fmt + 2);
+            m_Format.SampleRate = GetUInt32(fmt + 4);
+            m_Format.BitsPerSample = GetUInt16(fmt + 14);
+            if (tag == WaveFormatExtensible && size >= 40) {
+                m_Format.ValidBitsPerSample = GetUInt16(fmt + 18);
+                m_Format.ChannelMask = GetUInt32(fmt + 20);
+                // The first two bytes of the sub format GUID are the plain format tag.
+                tag = GetUInt16(fmt + 24);
+            }
+            m_Format.IsFloat = tag == WaveFormatIeeeFloat;
+            hasFormat = tag == WaveFormatPcm || tag == WaveFormatIeeeFloat;
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            m_DataOffset = static_cast<uint64_t>(m_File.tellg());
+            m_DataSize = size == UINT32_MAX && rf64DataSize != 0 ? rf64DataSize : size;
+            break;
+        }
+
+        m_File.seekg(next);
+    }
+
+    if (!hasFormat || m_DataOffset == 0 || !m_Format.IsValid() || !SampleFormatConverter::FromAudioFormat(m_Format, m_SampleFormat)) {
+        return false;
+    }
+
+    // A writer that died before patching the header leaves a zero size, take what is there.
+    m_File.clear();
+    m_File.seekg(0, std::ios::end);
+    const uint64_t available = static_cast<uint64_t>(m_File.tellg()) - m_DataOffset;
+    if (m_DataSize == 0 || m_DataSize > available) {
+        m_DataSize = available;
+    }
+    m_DataSize -= m_DataSize % m_Format.BytesPerFrame();
+
+    Rewind();
+    return true;
+}
+
+size_t WavFileReader::Read(void* destination, size_t frames) {
+    const uint32_t frameSize = m_Format.BytesPerFrame();
+    const uint64_t remaining = (m_DataSize - m_Position) / frameSize;
+    const size_t count = static_cast<size_t>((std::min)(static_cast<uint64_t>(frames), remaining));
+    if (count == 0) {
+        return 0;
+    }
+
+    m_File.read(static_cast<char*>(destination), static_cast<std::streamsize>(count * frameSize));
+    const size_t read = static_cast<size_t>(m_File.gcount()) / frameSize;
+    m_Position += static_cast<uint64_t>(read) * frameSize;
+    return read;
+}
+
+void WavFileReader::Rewind() {
+    m_File.clear();
+    m_File.seekg(static_cast<std::streamoff>(m_DataOffset));
+    m_Position = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+#include "AudioFormat.h"
+#include "SampleFormatConverter.h"
+
+// Sequential reader for the PCM and float WAV files the native writer produces (RIFF and RF64,
+// plain or WAVE_FORMAT_EXTENSIBLE fmt chunk). Used to feed recorded audio back into the capture path.
+class WavFileReader {
+public:
+    // Returns false if the file cannot be opened or holds no supported audio.
+    bool Open(const std::filesystem::path& path);
+
+    // Reads up to `frames` frames into `destination`, returns the number read (0 at the end).
+    size_t Read(void* destination, size_t frames);
+    void Rewind();
+
+    const AudioFormat& GetFormat() const { return m_Format; }
+    SampleFormat GetSampleFormat() const { return m_SampleFormat; }
+    uint64_t GetFrameCount() const { return m_Format.IsValid() ? m_DataSize / m_Format.BytesPerFrame() : 0; }
+
+private:
+    std::ifstream m_File;
+    AudioFormat m_Format;
+    SampleFormat m_SampleFormat = SampleFormat::Int16;
+    uint64_t m_DataOffset = 0;
+    uint64_t m_DataSize = 0;
+    uint64_t m_Position = 0;
+};
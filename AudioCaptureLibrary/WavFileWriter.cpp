@@ -0,0 +1,144 @@
+#include "WavFileWriter.h"
+
+#include <wil/result.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "WavHeader.h"
+#include "Logger.h"
+
+WavFileWriter::~WavFileWriter() {
+    Close();
+}
+
+HRESULT WavFileWriter::Open(const std::wstring& filePath, const AudioFormat& format, uint32_t journalSegmentMs) {
+    RETURN_HR_IF(E_INVALIDARG, !format.IsValid());
+    RETURN_HR_IF(E_NOT_VALID_STATE, m_Writer.IsOpen());
+
+    RETURN_IF_FAILED(m_Writer.Open(filePath));
+
+    m_Format = format;
+    m_DataSize = 0;
+
+    // A sidecar left from an earlier recording of the same name would not match this one.
+    m_WaveformPath = WaveformPyramid::GetPath(filePath);
+    DeleteFileW(m_WaveformPath.c_str());
+    m_Waveform.Configure(format);
+
+    // Sizes are placeholders until Close() patches them.
+    const auto header = BuildWavHeader(m_Format, 0);
+    RETURN_IF_FAILED(m_Writer.Append(header.data(), header.size()));
+
+    if (journalSegmentMs != 0) {
+        const UINT64 segmentSize = (std::max)(static_cast<UINT64>(m_Format.SampleRate) * journalSegmentMs / 1000, UINT64{ 1 }) *
+            m_Format.BytesPerFrame();
+        if (const HRESULT hr = m_Journal.Open(filePath, segmentSize, header.size(), header); FAILED(hr)) {
+            Logger::GetInstance().Log("Failed to create recording journal, HRESULT = " + std::to_string(hr), LogLevel::Warning);
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT WavFileWriter::Append(const BYTE* data, size_t dataSize) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_Writer.IsOpen());
+
+    RETURN_IF_FAILED(m_Writer.Append(data, dataSize));
+    m_DataSize += dataSize;
+    m_Waveform.Append(data, dataSize);
+
+    if (m_Journal.IsOpen()) {
+        m_Journal.Update(data, dataSize);
+        if (m_Journal.IsSegmentDue(m_DataSize)) {
+            CommitSegment();
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT WavFileWriter::AppendSilence(UINT64 frames) {
+    RETURN_HR_IF(E_NOT_VALID_STATE, !m_Writer.IsOpen());
+
+    const UINT64 size = frames * m_Format.BytesPerFrame();
+    if (size == 0) {
+        return S_OK;
+    }
+
+    // Zero bytes are not silence for unsigned 8 bit, and can't be left as holes there.
+    if (m_Format.BitsPerSample > 8) {
+        RETURN_IF_FAILED(m_Writer.AppendZeros(size));
+        m_DataSize += size;
+        m_Waveform.AppendSilence(frames);
+
+        if (m_Journal.IsOpen()) {
+            m_Journal.UpdateZeros(size);
+            if (m_Journal.IsSegmentDue(m_DataSize)) {
+                CommitSegment();
+            }
+        }
+        return S_OK;
+    }
+
+    constexpr UINT64 SilenceChunkSize = 64 * 1024;
+    const std::vector<BYTE> silence(static_cast<size_t>((std::min)(size, SilenceChunkSize)), 0x80);
+    for (UINT64 remaining = size; remaining > 0;) {
+        const size_t count = static_cast<size_t>((std::min)(remaining, static_cast<UINT64>(silence.size())));
+        RETURN_IF_FAILED(Append(silence.data(), count));
+        remaining -= count;
+    }
+
+    return S_OK;
+}
+
+HRESULT WavFileWriter::Close() {
+    if (!m_Writer.IsOpen()) {
+        return S_OK;
+    }
+
+    auto closeFile = wil::scope_exit([&] { m_Writer.Close(); });
+
+    // The journal covers the whole recording until it is deleted below.
+    if (m_Journal.IsOpen()) {
+        CommitSegment();
+    }
+
+    // RIFF chunks are word aligned.
+    if (m_DataSize & 1) {
+        const BYTE padding = 0;
+        RETURN_IF_FAILED(m_Writer.Append(&padding, 1));
+    }
+
+    const auto header = BuildWavHeader(m_Format, m_DataSize);
+    RETURN_IF_FAILED(m_Writer.WriteAt(0, header.data(), header.size()));
+
+    if (header[0] == 'R' && header[1] == 'F') {
+        Logger::GetInstance().Log("Recording exceeds 4 GB, written as RF64", LogLevel::Info);
+    }
+
+    // A recording that failed to close keeps its journal for recovery.
+    RETURN_IF_FAILED(m_Writer.Close());
+
+    // The recording is complete without it, a missing sidecar only costs the fast overview.
+    if (m_Waveform.IsConfigured()) {
+        if (const HRESULT hr = m_Waveform.Save(m_WaveformPath); FAILED(hr)) {
+            Logger::GetInstance().Log("Failed to write waveform sidecar, HRESULT = " + std::to_string(hr), LogLevel::Warning);
+        }
+        m_Waveform.Clear();
+    }
+    return m_Journal.Discard();
+}
+
+// Journal failures cost the recording its crash safety, not its data.
+void WavFileWriter::CommitSegment() {
+    HRESULT hr = m_Writer.Submit();
+    if (SUCCEEDED(hr)) {
+        hr = m_Journal.Commit(m_DataSize, BuildWavHeader(m_Format, m_DataSize), m_Writer.GetSize() + (m_DataSize & 1));
+    }
+
+    if (FAILED(hr)) {
+        Logger::GetInstance().Log("Recording journal stopped, HRESULT = " + std::to_string(hr), LogLevel::Warning);
+        m_Journal.Discard();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+
+#include "AsyncFileWriter.h"
+#include "AudioFormat.h"
+#include "RecordingJournal.h"
+#include "WaveformPyramid.h"
+
+// Incremental WAV writer: frames are appended as they arrive and the RIFF sizes are patched
+// on Close(), switching the file to RF64 when it ends up larger than 4 GB.
+// Memory use is constant regardless of the recording length. Writes happen in the background and
+// long runs of silence are left as sparse regions of the file where the volume supports it.
+// With a journal the file can be recovered up to the last segment after a crash, see RecordingJournal.
+// A waveform sidecar is written next to the file on Close(), see WaveformPyramid.
+class WavFileWriter {
+public:
+    WavFileWriter() = default;
+    ~WavFileWriter();
+
+    WavFileWriter(const WavFileWriter&) = delete;
+    WavFileWriter& operator=(const WavFileWriter&) = delete;
+
+    // `journalSegmentMs` is the segment duration of the journal, 0 writes none.
+    HRESULT Open(const std::wstring& filePath, const AudioFormat& format, uint32_t journalSegmentMs = 0);
+    HRESULT Append(const BYTE* data, size_t dataSize);
+    HRESULT AppendSilence(UINT64 frames);
+    HRESULT Close();
+
+    const AudioFormat& GetFormat() const { return m_Format; }
+    UINT64 GetDataSize() const { return m_DataSize; }
+
+private:
+    void CommitSegment();
+
+    AsyncFileWriter m_Writer;
+    RecordingJournal m_Journal;
+    WaveformPyramid m_Waveform;
+    std::wstring m_WaveformPath;
+    AudioFormat m_Format;
+    UINT64 m_DataSize = 0;
+};
@@ -0,0 +1,109 @@
+#include "WavHeader.h"
+
+#include <iterator>
+
+static constexpr uint16_t WaveFormatPcm = 0x0001;
+static constexpr uint16_t WaveFormatIeeeFloat = 0x0003;
+static constexpr uint16_t WaveFormatExtensible = 0xFFFE;
+
+static constexpr uint32_t Ds64ChunkSize = 28;
+static constexpr uint32_t PcmFmtChunkSize = 16;
+static constexpr uint32_t ExtensibleFmtChunkSize = 40;
+
+// KSDATAFORMAT_SUBTYPE_PCM / KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, the first two bytes carry the format tag.
+static constexpr uint8_t SubFormatGuidTail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+static void PutTag(std::vector<uint8_t>& header, const char* tag) {
+    header.insert(header.end(), tag, tag + 4);
+}
+
+static void PutUInt16(std::vector<uint8_t>& header, uint16_t value) {
+    header.push_back(static_cast<uint8_t>(value));
+    header.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+static void PutUInt32(std::vector<uint8_t>& header, uint32_t value) {
+    PutUInt16(header, static_cast<uint16_t>(value));
+    PutUInt16(header, static_cast<uint16_t>(value >> 16));
+}
+
+static void PutUInt64(std::vector<uint8_t>& header, uint64_t value) {
+    PutUInt32(header, static_cast<uint32_t>(value));
+    PutUInt32(header, static_cast<uint32_t>(value >> 32));
+}
+
+static uint32_t GetDefaultChannelMask(uint16_t channels) {
+    switch (channels) {
+    case 1: return 0x4;     // FC
+    case 2: return 0x3;     // FL FR
+    case 4: return 0x33;    // FL FR BL BR
+    case 6: return 0x3F;    // 5.1
+    case 8: return 0x63F;   // 7.1
+    default: return 0;
+    }
+}
+
+bool RequiresExtensibleWavFormat(const AudioFormat& format) {
+    return format.IsFloat ||
+        format.BitsPerSample > 16 ||
+        format.Channels > 2 ||
+        format.GetValidBitsPerSample() != format.BitsPerSample;
+}
+
+size_t GetWavHeaderSize(const AudioFormat& format) {
+    const uint32_t fmtSize = RequiresExtensibleWavFormat(format) ? ExtensibleFmtChunkSize : PcmFmtChunkSize;
+    return 12 + (8 + Ds64ChunkSize) + (8 + fmtSize) + 8;
+}
+
+std::vector<uint8_t> BuildWavHeader(const AudioFormat& format, uint64_t dataSize) {
+    std::vector<uint8_t> header;
+    header.reserve(GetWavHeaderSize(format));
+
+    const bool extensible = RequiresExtensibleWavFormat(format);
+    const uint32_t fmtSize = extensible ? ExtensibleFmtChunkSize : PcmFmtChunkSize;
+    const uint64_t paddedDataSize = dataSize + (dataSize & 1);
+    const uint64_t riffSize = GetWavHeaderSize(format) - 8 + paddedDataSize;
+    const bool isRf64 = riffSize > UINT32_MAX;
+
+    PutTag(header, isRf64 ? "RF64" : "RIFF");
+    PutUInt32(header, isRf64 ? UINT32_MAX : static_cast<uint32_t>(riffSize));
+    PutTag(header, "WAVE");
+
+    PutTag(header, isRf64 ? "ds64" : "JUNK");
+    PutUInt32(header, Ds64ChunkSize);
+    if (isRf64) {
+        const uint32_t blockAlign = format.BytesPerFrame();
+        PutUInt64(header, riffSize);
+        PutUInt64(header, dataSize);
+        PutUInt64(header, blockAlign != 0 ? dataSize / blockAlign : 0);
+        PutUInt32(header, 0);   // no additional chunk size table
+    }
+    else {
+        header.insert(header.end(), Ds64ChunkSize, 0);
+    }
+
+    const uint16_t formatTag = format.IsFloat ? WaveFormatIeeeFloat : WaveFormatPcm;
+
+    PutTag(header, "fmt ");
+    PutUInt32(header, fmtSize);
+    PutUInt16(header, extensible ? WaveFormatExtensible : formatTag);
+    PutUInt16(header, format.Channels);
+    PutUInt32(header, format.SampleRate);
+    PutUInt32(header, format.BytesPerSecond());
+    PutUInt16(header, static_cast<uint16_t>(format.BytesPerFrame()));
+    PutUInt16(header, format.BitsPerSample);
+    if (extensible) {
+        PutUInt16(header, 22);  // cbSize
+        PutUInt16(header, format.GetValidBitsPerSample());
+        PutUInt32(header, format.ChannelMask != 0 ? format.ChannelMask : GetDefaultChannelMask(format.Channels));
+        PutUInt16(header, formatTag);
+        header.insert(header.end(), std::begin(SubFormatGuidTail), std::end(SubFormatGuidTail));
+    }
+
+    PutTag(header, "data");
+    PutUInt32(header, isRf64 ? UINT32_MAX : static_cast<uint32_t>(dataSize));
+
+    return header;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AudioFormat.h"
+
+// RIFF/WAVE header layout used by the native writers.
+//
+// The header always reserves a 28 byte JUNK chunk right after "WAVE". When the file grows past
+// the 4 GB RIFF limit the same bytes become a ds64 chunk and the file is relabelled RF64
+// (EBU Tech 3306), so switching formats on close never moves any audio data.
+
+// WAVE_FORMAT_EXTENSIBLE is used for float, >16 bit containers, padded samples and >2 channels.
+bool RequiresExtensibleWavFormat(const AudioFormat& format);
+
+size_t GetWavHeaderSize(const AudioFormat& format);
+
+// Builds the complete header for a file holding `dataSize` bytes of audio.
+std::vector<uint8_t> BuildWavHeader(const AudioFormat& format, uint64_t dataSize);
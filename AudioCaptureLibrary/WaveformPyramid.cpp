@@ -0,0 +1,322 @@
+#include "WaveformPyramid.h"
+
+#include <wil/resource.h>
+#include <wil/result.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr float BinScale = 32767.0f;
+
+int16_t ToBinValue(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * BinScale));
+}
+
+HRESULT WriteBins(HANDLE file, const WaveformBin* bins, size_t count) {
+    DWORD written = 0;
+    RETURN_IF_WIN32_BOOL_FALSE(WriteFile(file, bins, static_cast<DWORD>(count * sizeof(WaveformBin)), &written, nullptr));
+    return S_OK;
+}
+
+}
+
+bool WaveformPyramid::Configure(const AudioFormat& format) {
+    m_Channels = 0;
+
+    SampleFormat sampleFormat;
+    if (!SampleFormatConverter::FromAudioFormat(format, sampleFormat) || !m_Converter.Configure(sampleFormat, SampleFormat::Float32)) {
+        return false;
+    }
+
+    m_SampleRate = format.SampleRate;
+    m_Channels = format.Channels;
+    m_BytesPerFrame = format.BytesPerFrame();
+    Clear();
+    return true;
+}
+
+void WaveformPyramid::SetCapacity(uint64_t frames) {
+    for (uint32_t index = 0; index < WaveformLevelCount; ++index) {
+        Level& level = m_Levels[index];
+        // One bin more for each partly covered end of the window.
+        const size_t ringSize = static_cast<size_t>(frames / FramesPerBin[index] + 2);
+        const uint64_t kept = (std::min)(static_cast<uint64_t>(GetStoredBins(level)), static_cast<uint64_t>(ringSize));
+
+        // The newest bins keep their indices, in the new layout.
+        std::vector<WaveformBin> bins(ringSize);
+        for (uint64_t bin = level.Completed - kept; bin < level.Completed; ++bin) {
+            bins[static_cast<size_t>(bin % ringSize)] = GetBin(level, bin);
+        }
+
+        level.Bins = std::move(bins);
+        level.RingSize = ringSize;
+    }
+}
+
+void WaveformPyramid::Append(const uint8_t* data, size_t size) {
+    if (m_Channels == 0 || size == 0) {
+        return;
+    }
+
+    // Complete the frame left over from the previous call first.
+    if (!m_PartialFrame.empty()) {
+        const size_t count = (std::min)(m_BytesPerFrame - m_PartialFrame.size(), size);
+        m_PartialFrame.insert(m_PartialFrame.end(), data, data + count);
+        data += count;
+        size -= count;
+        if (m_PartialFrame.size() < m_BytesPerFrame) {
+            return;
+        }
+        AppendFrames(m_PartialFrame.data(), 1);
+        m_PartialFrame.clear();
+    }
+
+    const size_t frames = size / m_BytesPerFrame;
+    AppendFrames(data, frames);
+    m_PartialFrame.assign(data + frames * m_BytesPerFrame, data + size);
+}
+
+void WaveformPyramid::AppendFrames(const uint8_t* data, size_t frames) {
+    if (frames == 0) {
+        return;
+    }
+
+    const float* samples = reinterpret_cast<const float*>(m_Converter.Convert(data, frames * m_Channels));
+    m_Frames += frames;
+
+    // Chunks end on the bins of the finest level.
+    while (frames > 0) {
+        const size_t count = static_cast<size_t>((std::min)(static_cast<uint64_t>(frames), FramesPerBin[0] - m_Levels[0].Pending.Frames));
+        const size_t sampleCount = count * m_Channels;
+
+        float low = FLT_MAX;
+        float high = -FLT_MAX;
+        float sumSquares = 0.0f;
+        for (size_t i = 0; i < sampleCount; ++i) {
+            const float sample = samples[i];
+            // NaN fails every comparison and would poison the sum.
+            if (sample == sample) {
+                low = (std::min)(low, sample);
+                high = (std::max)(high, sample);
+                sumSquares += sample * sample;
+            }
+        }
+
+        Accumulator part;
+        part.Min = low;
+        part.Max = high;
+        part.SumSquares = sumSquares;
+        part.Frames = count;
+        Add(0, part);
+
+        samples += sampleCount;
+        frames -= count;
+    }
+}
+
+void WaveformPyramid::AppendSilence(uint64_t frames) {
+    if (m_Channels == 0) {
+        return;
+    }
+
+    // Silence starts on a frame boundary, as in the stream it stands for.
+    m_PartialFrame.clear();
+    m_Frames += frames;
+    while (frames > 0) {
+        Accumulator part;
+        part.Frames = (std::min)(frames, FramesPerBin[0] - m_Levels[0].Pending.Frames);
+        Add(0, part);
+        frames -= part.Frames;
+    }
+}
+
+void WaveformPyramid::Clear() {
+    m_Frames = 0;
+    m_PartialFrame.clear();
+    for (auto& level : m_Levels) {
+        if (level.RingSize == 0) {
+            level.Bins = {};
+        }
+        level.Completed = 0;
+        level.Pending = {};
+    }
+}
+
+void WaveformPyramid::Merge(Accumulator& acc, const Accumulator& part) {
+    if (part.Frames == 0) {
+        return;
+    }
+
+    if (acc.Frames == 0) {
+        acc = part;
+        return;
+    }
+
+    acc.Min = (std::min)(acc.Min, part.Min);
+    acc.Max = (std::max)(acc.Max, part.Max);
+    acc.SumSquares += part.SumSquares;
+    acc.Frames += part.Frames;
+}
+
+void WaveformPyramid::Add(uint32_t index, const Accumulator& part) {
+    Level& level = m_Levels[index];
+    Accumulator& pending = level.Pending;
+    Merge(pending, part);
+
+    // Parts never cross a bin boundary: the finest level is fed in chunks that end on one, and
+    // every bin is a whole number of bins of the level below.
+    if (pending.Frames < FramesPerBin[index]) {
+        return;
+    }
+
+    const WaveformBin bin = ToBin(pending);
+    if (level.RingSize != 0) {
+        level.Bins[static_cast<size_t>(level.Completed % level.RingSize)] = bin;
+    }
+    else {
+        level.Bins.push_back(bin);
+    }
+    ++level.Completed;
+
+    const Accumulator completed = pending;
+    pending = {};
+    if (index + 1 < WaveformLevelCount) {
+        Add(index + 1, completed);
+    }
+}
+
+WaveformPyramid::Accumulator WaveformPyramid::GetPending(uint32_t index) const {
+    Accumulator pending;
+    for (uint32_t level = 0; level <= index; ++level) {
+        Merge(pending, m_Levels[level].Pending);
+    }
+    return pending;
+}
+
+WaveformBin WaveformPyramid::ToBin(const Accumulator& acc) const {
+    WaveformBin bin = {};
+    // All NaN leaves the range empty.
+    if (acc.Frames == 0 || acc.Min > acc.Max) {
+        return bin;
+    }
+
+    bin.Min = ToBinValue(acc.Min);
+    bin.Max = ToBinValue(acc.Max);
+    const double rms = std::sqrt(acc.SumSquares / (static_cast<double>(acc.Frames) * m_Channels));
+    bin.Rms = static_cast<uint16_t>(std::lround((std::min)(rms, 1.0) * BinScale));
+    return bin;
+}
+
+size_t WaveformPyramid::GetStoredBins(const Level& level) const {
+    return static_cast<size_t>(level.RingSize != 0 ? (std::min)(level.Completed, static_cast<uint64_t>(level.RingSize)) :
+        level.Completed);
+}
+
+const WaveformBin& WaveformPyramid::GetBin(const Level& level, uint64_t index) const {
+    return level.RingSize != 0 ? level.Bins[static_cast<size_t>(index % level.RingSize)] : level.Bins[static_cast<size_t>(index)];
+}
+
+size_t WaveformPyramid::GetLastBins(uint32_t index, uint64_t frames, WaveformBin* bins, size_t capacity) const {
+    if (index >= WaveformLevelCount) {
+        return 0;
+    }
+
+    const Level& level = m_Levels[index];
+    const Accumulator pending = GetPending(index);
+    const uint64_t end = level.Completed + (pending.Frames > 0 ? 1 : 0);
+    const uint64_t oldest = level.Completed - GetStoredBins(level);
+    const uint64_t first = (std::min)((std::max)((m_Frames - (std::min)(frames, m_Frames)) / FramesPerBin[index], oldest), end);
+
+    const size_t count = static_cast<size_t>(end - first);
+    for (size_t i = 0; i < (std::min)(count, capacity); ++i) {
+        const uint64_t bin = first + i;
+        bins[i] = bin < level.Completed ? GetBin(level, bin) : ToBin(pending);
+    }
+    return count;
+}
+
+HRESULT WaveformPyramid::Save(const std::wstring& filePath) const {
+    RETURN_HR_IF(E_NOT_VALID_STATE, m_Channels == 0);
+
+    WaveformFileHeader header = {};
+    memcpy(header.Magic, WaveformFileMagic, sizeof(header.Magic));
+    header.Version = WaveformFileVersion;
+    header.SampleRate = m_SampleRate;
+    header.Channels = m_Channels;
+    header.Frames = m_Frames;
+    header.LevelCount = WaveformLevelCount;
+    for (uint32_t index = 0; index < WaveformLevelCount; ++index) {
+        header.FramesPerBin[index] = FramesPerBin[index];
+        header.BinCount[index] = GetStoredBins(m_Levels[index]) + (GetPending(index).Frames > 0 ? 1 : 0);
+    }
+
+    wil::unique_hfile file(CreateFileW(filePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    RETURN_LAST_ERROR_IF(!file.is_valid());
+
+    DWORD written = 0;
+    RETURN_IF_WIN32_BOOL_FALSE(WriteFile(file.get(), &header, sizeof(header), &written, nullptr));
+
+    for (uint32_t index = 0; index < WaveformLevelCount; ++index) {
+        const Level& level = m_Levels[index];
+        const size_t stored = GetStoredBins(level);
+        if (level.RingSize == 0) {
+            RETURN_IF_FAILED(WriteBins(file.get(), level.Bins.data(), stored));
+        }
+        else {
+            // Oldest bin first, the ring wraps at most once.
+            const size_t start = static_cast<size_t>((level.Completed - stored) % level.RingSize);
+            const size_t head = (std::min)(stored, level.RingSize - start);
+            RETURN_IF_FAILED(WriteBins(file.get(), level.Bins.data() + start, head));
+            RETURN_IF_FAILED(WriteBins(file.get(), level.Bins.data(), stored - head));
+        }
+
+        if (const Accumulator pending = GetPending(index); pending.Frames > 0) {
+            const WaveformBin last = ToBin(pending);
+            RETURN_IF_FAILED(WriteBins(file.get(), &last, 1));
+        }
+    }
+
+    return S_OK;
+}
+
+bool ReadWaveformFile(const std::wstring& filePath, uint32_t level, std::vector<WaveformBin>& bins, WaveformFileHeader* header) {
+    std::ifstream file(std::filesystem::path(filePath), std::ios::binary | std::ios::ate);
+    if (!file || level >= WaveformLevelCount) {
+        return false;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+
+    WaveformFileHeader fileHeader;
+    if (!file.seekg(0) || !file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)) ||
+        memcmp(fileHeader.Magic, WaveformFileMagic, sizeof(fileHeader.Magic)) != 0 || fileHeader.Version != WaveformFileVersion ||
+        fileHeader.LevelCount != WaveformLevelCount) {
+        return false;
+    }
+
+    // Counts are checked against the file before anything is allocated for them.
+    uint64_t offset = sizeof(fileHeader);
+    for (uint32_t index = 0; index < WaveformLevelCount; ++index) {
+        if (fileHeader.BinCount[index] > (fileSize - offset) / sizeof(WaveformBin)) {
+            return false;
+        }
+        if (index < level) {
+            offset += fileHeader.BinCount[index] * sizeof(WaveformBin);
+        }
+    }
+
+    bins.resize(static_cast<size_t>(fileHeader.BinCount[level]));
+    if (!file.seekg(static_cast<std::streamoff>(offset)) ||
+        !file.read(reinterpret_cast<char*>(bins.data()), static_cast<std::streamsize>(bins.size() * sizeof(WaveformBin)))) {
+        return false;
+    }
+
+    if (header) {
+        *header = fileHeader;
+    }
+    return true;
+}
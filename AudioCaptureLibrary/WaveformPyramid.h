@@ -0,0 +1,112 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "SampleFormatConverter.h"
+
+// Sidecar of a finished recording (<recording>.peaks) from which a waveform of any length renders
+// without touching the audio. Layout:
+//
+//   WaveformFileHeader
+//   BinCount[0] WaveformBins of level 0, then those of level 1 and level 2
+//
+// The last bin of each level covers the frames left over at the end. All fields are little endian.
+
+static constexpr uint32_t WaveformFileVersion = 1;
+static constexpr char WaveformFileMagic[4] = { 'A', 'R', 'W', 'F' };
+static constexpr uint32_t WaveformLevelCount = 3;
+
+// Shape of the audio of FramesPerBin frames, all channels together. Values are relative to full
+// scale, 32767 being full scale.
+struct WaveformBin {
+    int16_t Min;
+    int16_t Max;
+    uint16_t Rms;
+};
+
+struct WaveformFileHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t SampleRate;
+    uint32_t Channels;
+    uint64_t Frames;
+    uint32_t LevelCount;
+    uint32_t FramesPerBin[WaveformLevelCount];
+    uint64_t BinCount[WaveformLevelCount];
+};
+
+// Min/max/RMS overview of a stream at WaveformLevelCount zoom levels, built as the audio arrives:
+// every sample is looked at once for the finest level, each coarser level is merged from
+// FramesPerBin ratio bins of the one below.
+//
+// Unbounded by default, for recordings. With a capacity only the bins covering the newest frames
+// are kept, for the sliding window of a replay buffer. Not thread-safe.
+class WaveformPyramid {
+public:
+    static constexpr uint32_t FramesPerBin[WaveformLevelCount] = { 256, 4096, 65536 };
+
+    static std::wstring GetPath(const std::wstring& recordingPath) { return recordingPath + L".peaks"; }
+
+    // Returns false for a format the pyramid can't read, it then ignores all audio.
+    bool Configure(const AudioFormat& format);
+    bool IsConfigured() const { return m_Channels != 0; }
+
+    // From now on keeps only the bins of at least the newest `frames` frames. Without a call every
+    // bin is kept.
+    void SetCapacity(uint64_t frames);
+
+    // Appends of any size are accepted, a partial frame is kept until the next call.
+    void Append(const uint8_t* data, size_t size);
+    void AppendSilence(uint64_t frames);
+    void Clear();
+
+    uint64_t GetFrames() const { return m_Frames; }
+
+    // Copies the bins of `level` covering the last `frames` frames, oldest first and the bin still
+    // being filled last. Returns the number of bins, which may be larger than `capacity`.
+    size_t GetLastBins(uint32_t level, uint64_t frames, WaveformBin* bins, size_t capacity) const;
+
+    HRESULT Save(const std::wstring& filePath) const;
+
+private:
+    struct Accumulator {
+        float Min = 0.0f;
+        float Max = 0.0f;
+        double SumSquares = 0.0;
+        uint64_t Frames = 0;
+    };
+
+    struct Level {
+        // A ring of RingSize bins when there is a capacity.
+        std::vector<WaveformBin> Bins;
+        size_t RingSize = 0;
+        uint64_t Completed = 0;
+        Accumulator Pending;
+    };
+
+    void AppendFrames(const uint8_t* data, size_t frames);
+    static void Merge(Accumulator& acc, const Accumulator& part);
+
+    void Add(uint32_t level, const Accumulator& part);
+    // The bin of `level` still being filled, including what the finer levels hold of it.
+    Accumulator GetPending(uint32_t level) const;
+    WaveformBin ToBin(const Accumulator& acc) const;
+    size_t GetStoredBins(const Level& level) const;
+    const WaveformBin& GetBin(const Level& level, uint64_t index) const;
+
+    SampleFormatConverter m_Converter;
+    uint32_t m_SampleRate = 0;
+    uint32_t m_Channels = 0;
+    uint32_t m_BytesPerFrame = 0;
+    std::vector<uint8_t> m_PartialFrame;
+    uint64_t m_Frames = 0;
+    Level m_Levels[WaveformLevelCount];
+};
+
+// Reads the bins of `level` from a sidecar written by WaveformPyramid::Save().
+bool ReadWaveformFile(const std::wstring& filePath, uint32_t level, std::vector<WaveformBin>& bins, WaveformFileHeader* header = nullptr);
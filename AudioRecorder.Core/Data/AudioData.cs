@@ -1,57 +1,72 @@
 ﻿using System.IO.Pipes;
+using AudioRecorder.Core.Services;
 
 namespace AudioRecorder.Core.Data;
 
 internal enum AudioTargetType
 {
     Process = 0,
-    AudioDevice
+    AudioDevice,
+    Mixdown
 }
 
-internal sealed class AudioData
+internal enum RecordingFileFormat
 {
+    Wav = 0,
+    Flac
+}
+
+// Values match the native ReplayCodec.
+internal enum ReplayCodec
+{
+    Flac = 0,
+    ImaAdpcm
+}
+
+internal sealed class AudioData : IDisposable
+{
+    public const uint DefaultSampleRate = 44100;
+
     private readonly bool _isInstantReplayMode;
-    private readonly Queue<byte> _instantReplayBuffer = new();
-    private readonly List<byte> _standardBuffer = new();
+    // Null keeps the instant replay window as PCM.
+    private readonly ReplayCodec? _replayCodec;
     private readonly object _bufferLock = new();
+    private readonly object _snapshotLock = new();
+    // Keeps the native buffer alive across a resize without holding up AddData.
+    private readonly object _resizeLock = new();
 
-    private int _instantReplayBufferSize;
+    private IntPtr _instantReplayBuffer;
+    private IntPtr _fileWriter;
+    private RecordingFileFormat _fileFormat;
+    private int _instantReplayDurationSeconds;
+    private bool _isDisposed;
 
     public NamedPipeClientStream? PipeClient { get; set; }
+    public IntPtr SharedMemoryReader { get; set; }
     public uint PipeId { get; init; }
     public long CaptureId { get; init; }
-    public uint SampleRate { get; } = 44100;
+    public uint SampleRate { get; init; } = DefaultSampleRate;
     public ushort BitsPerSample { get; } = 16;
     public ushort Channels { get; } = 2;
     public Thread? ProcessingThread { get; set; }
     public bool CancelRequested { get; set; }
     public string Name { get; init; } = string.Empty;
     public AudioTargetType Type { get; }
-    public byte[] Buffer
-    {
-        get
-        {
-            if (_isInstantReplayMode)
-                lock (_bufferLock)
-                {
-                    return _instantReplayBuffer.ToArray();
-                }
-            return _standardBuffer.ToArray();
-        }
-    }
+    public int InstantReplayDurationSeconds => _instantReplayDurationSeconds;
 
-    public AudioData(long captureId, AudioTargetType type, bool isInstantReplayMode = false, int replayDurationSeconds = 0)
+    public AudioData(long captureId, AudioTargetType type, bool isInstantReplayMode = false, int replayDurationSeconds = 0,
+        ReplayCodec? replayCodec = null)
     {
         CaptureId = captureId;
         Type = type;
         _isInstantReplayMode = isInstantReplayMode;
-
-        if (_isInstantReplayMode)
-            SetInstantReplayBufferSize(replayDurationSeconds);
+        _instantReplayDurationSeconds = replayDurationSeconds;
+        _replayCodec = replayCodec;
     }
 
     public AudioData(AudioDeviceInfo deviceInfo, long captureId, AudioTargetType type, bool isInstantReplayMode = false,
-        int replayDurationSeconds = 0) : this(captureId, type, isInstantReplayMode, replayDurationSeconds)
+        int replayDurationSeconds = 0, ReplayCodec? replayCodec = null)
+        : this(captureId, type, isInstantReplayMode, replayDurationSeconds, replayCodec)
     {
         PipeId = deviceInfo.PipeId;
         SampleRate = deviceInfo.SampleRate;
@@ -60,38 +75,186 @@ internal sealed class AudioData
         Name = deviceInfo.Name;
     }
 
-    public void AddData(IEnumerable<byte> data)
+    public void AddData(byte[] data, int count) => AddData(data, 0, count);
+
+    public void AddData(byte[] data, int offset, int count)
     {
         if (_isInstantReplayMode)
         {
             lock (_bufferLock)
             {
-                foreach (var dataByte in data)
-                {
-                    _instantReplayBuffer.Enqueue(dataByte);
-                    if (_instantReplayBuffer.Count > _instantReplayBufferSize)
-                        _instantReplayBuffer.Dequeue();
-                }
+                var buffer = GetInstantReplayBuffer();
+                if (buffer == IntPtr.Zero)
+                    return;
+
+                if (_replayCodec.HasValue)
+                    CompressedReplayBufferInterop.AppendCompressedReplayBuffer(buffer, in data[offset], count);
+                else
+                    InstantReplayBufferInterop.AppendInstantReplayBuffer(buffer, in data[offset], count);
             }
         }
         else
         {
-            _standardBuffer.AddRange(data);
+            lock (_bufferLock)
+            {
+                if (_fileWriter == IntPtr.Zero)
+                    return;
+
+                if (_fileFormat == RecordingFileFormat.Flac)
+                    FlacFileWriterInterop.AppendFlacFileWriter(_fileWriter, in data[offset], count);
+                else
+                    WavFileWriterInterop.AppendWavFileWriter(_fileWriter, in data[offset], count);
+            }
         }
     }
 
-    public void ClearBuffer()
+    // A silence record of the stream, `frames` frames of digital silence.
+    public void AddSilence(ulong frames)
     {
-        if (_isInstantReplayMode)
+        lock (_bufferLock)
         {
-            lock (_bufferLock)
+            if (_isInstantReplayMode)
+            {
+                var buffer = GetInstantReplayBuffer();
+                if (buffer == IntPtr.Zero)
+                    return;
+
+                if (_replayCodec.HasValue)
+                    CompressedReplayBufferInterop.AppendSilenceCompressedReplayBuffer(buffer, frames);
+                else
+                    InstantReplayBufferInterop.AppendSilenceInstantReplayBuffer(buffer, frames);
+            }
+            else if (_fileWriter != IntPtr.Zero)
             {
-                _instantReplayBuffer.Clear();
+                if (_fileFormat == RecordingFileFormat.Flac)
+                    FlacFileWriterInterop.AppendSilenceFlacFileWriter(_fileWriter, frames);
+                else
+                    WavFileWriterInterop.AppendSilenceWavFileWriter(_fileWriter, frames);
             }
         }
-        else
+    }
+
+    public void ClearBuffer()
+    {
+        if (!_isInstantReplayMode)
+            return;
+
+        lock (_bufferLock)
         {
-            _standardBuffer.Clear();
+            var buffer = GetInstantReplayBuffer();
+            if (buffer == IntPtr.Zero)
+                return;
+
+            if (_replayCodec.HasValue)
+                CompressedReplayBufferInterop.ClearCompressedReplayBuffer(buffer);
+            else
+                InstantReplayBufferInterop.ClearInstantReplayBuffer(buffer);
+        }
+    }
+
+    // FLAC is encoded on the processing thread as the data arrives, compressionLevel only applies to it.
+    // Recordings are journaled, an interrupted one is restored by AudioDataProcessor.RecoverInterruptedRecordings.
+    public bool StartRecording(string filePath, RecordingFileFormat format = RecordingFileFormat.Wav,
+        int compressionLevel = FlacFileWriterInterop.DefaultCompressionLevel)
+    {
+        if (_isInstantReplayMode)
+            throw new InvalidOperationException("Recording to a file is not available in instant replay mode.");
+
+        lock (_bufferLock)
+        {
+            _fileFormat = format;
+            _fileWriter = format == RecordingFileFormat.Flac
+                ? FlacFileWriterInterop.CreateFlacFileWriter(filePath, SampleRate, BitsPerSample, Channels,
+                    isFloat: false, compressionLevel, RecordingJournalInterop.DefaultSegmentMilliseconds)
+                : WavFileWriterInterop.CreateWavFileWriter(filePath, SampleRate, BitsPerSample, Channels,
+                    isFloat: false, RecordingJournalInterop.DefaultSegmentMilliseconds);
+            return _fileWriter != IntPtr.Zero;
+        }
+    }
+
+    public void FinishRecording()
+    {
+        lock (_bufferLock)
+        {
+            if (_fileWriter == IntPtr.Zero)
+                return;
+
+            if (_fileFormat == RecordingFileFormat.Flac)
+                FlacFileWriterInterop.CloseFlacFileWriter(_fileWriter);
+            else
+                WavFileWriterInterop.CloseWavFileWriter(_fileWriter);
+            _fileWriter = IntPtr.Zero;
+        }
+    }
+
+    public bool SaveInstantReplay(string filePath)
+    {
+        if (!_isInstantReplayMode)
+            throw new InvalidOperationException("Instant replay can only be saved in instant replay mode.");
+
+        // Capture keeps appending while the snapshot is written out, only disposal waits for it.
+        lock (_snapshotLock)
+        {
+            var buffer = GetInstantReplayBuffer();
+            if (buffer == IntPtr.Zero)
+                return false;
+
+            return _replayCodec.HasValue
+                ? CompressedReplayBufferInterop.SaveCompressedReplayToWav(buffer, _instantReplayDurationSeconds, filePath)
+                : InstantReplayBufferInterop.SaveInstantReplayToWav(buffer, _instantReplayDurationSeconds, filePath);
+        }
+    }
+
+    // For saves that read several sources at once: the native buffer cannot be disposed until
+    // ReleaseReplaySource(), which is only called when this returns true.
+    public bool AcquireReplaySource(out MultitrackReplaySource source)
+    {
+        if (!_isInstantReplayMode)
+            throw new InvalidOperationException("Instant replay can only be saved in instant replay mode.");
+
+        Monitor.Enter(_snapshotLock);
+        source = new MultitrackReplaySource
+        {
+            Buffer = GetInstantReplayBuffer(),
+            Compressed = _replayCodec.HasValue,
+            Name = Name
+        };
+        if (source.Buffer != IntPtr.Zero)
+            return true;
+
+        Monitor.Exit(_snapshotLock);
+        return false;
+    }
+
+    public void ReleaseReplaySource() => Monitor.Exit(_snapshotLock);
+
+    // Memory and encode cost of a compressed instant replay buffer, null for PCM or before the first data.
+    public ReplayBufferStats? GetReplayBufferStats()
+    {
+        if (!_replayCodec.HasValue)
+            return null;
+
+        lock (_bufferLock)
+        {
+            if (_instantReplayBuffer == IntPtr.Zero ||
+                !CompressedReplayBufferInterop.GetCompressedReplayStats(_instantReplayBuffer, out var stats))
+                return null;
+
+            return stats;
+        }
+    }
+
+    // Overview of the instant replay window at `level` of WaveformInterop.FramesPerBin, oldest bin first.
+    public WaveformBin[] GetReplayWaveform(int level)
+    {
+        lock (_bufferLock)
+        {
+            if (_instantReplayBuffer == IntPtr.Zero)
+                return Array.Empty<WaveformBin>();
+
+            return _replayCodec.HasValue
+                ? WaveformInterop.GetCompressedReplayWaveform(_instantReplayBuffer, _instantReplayDurationSeconds, level)
+                : WaveformInterop.GetInstantReplayWaveform(_instantReplayBuffer, _instantReplayDurationSeconds, level);
         }
     }
 
@@ -100,7 +263,59 @@ internal sealed class AudioData
         if (!_isInstantReplayMode)
             throw new InvalidOperationException("Instant replay buffer size can only be set in instant replay mode.");
 
-        var bytesPerSecond = (int)(SampleRate * Channels * BitsPerSample / 8);
-        _instantReplayBufferSize = durationSeconds * bytesPerSecond;
+        lock (_resizeLock)
+        {
+            IntPtr buffer;
+            lock (_bufferLock)
+            {
+                _instantReplayDurationSeconds = durationSeconds;
+                buffer = _instantReplayBuffer;
+            }
+
+            if (buffer == IntPtr.Zero)
+                return;
+
+            if (_replayCodec.HasValue)
+                CompressedReplayBufferInterop.ResizeCompressedReplayBuffer(buffer, durationSeconds);
+            else
+                InstantReplayBufferInterop.ResizeInstantReplayBuffer(buffer, durationSeconds);
+        }
+    }
+
+    public void Dispose()
+    {
+        FinishRecording();
+
+        lock (_snapshotLock)
+        lock (_resizeLock)
+        lock (_bufferLock)
+        {
+            if (_instantReplayBuffer != IntPtr.Zero)
+            {
+                if (_replayCodec.HasValue)
+                    CompressedReplayBufferInterop.DestroyCompressedReplayBuffer(_instantReplayBuffer);
+                else
+                    InstantReplayBufferInterop.DestroyInstantReplayBuffer(_instantReplayBuffer);
+                _instantReplayBuffer = IntPtr.Zero;
+            }
+
+            _isDisposed = true;
+        }
+    }
+
+    // The native buffer is created on first use, once the stream format of the source is known.
+    private IntPtr GetInstantReplayBuffer()
+    {
+        lock (_bufferLock)
+        {
+            if (_instantReplayBuffer == IntPtr.Zero && !_isDisposed)
+                _instantReplayBuffer = _replayCodec.HasValue
+                    ? CompressedReplayBufferInterop.CreateCompressedReplayBuffer(SampleRate, BitsPerSample, Channels,
+                        _instantReplayDurationSeconds, _replayCodec.Value)
+                    : InstantReplayBufferInterop.CreateInstantReplayBuffer(SampleRate, BitsPerSample, Channels,
+                        _instantReplayDurationSeconds, Path.GetTempPath());
+
+            return _instantReplayBuffer;
+        }
     }
 }
@@ -0,0 +1,62 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Data;
+
+internal enum AudioTransportType
+{
+    NamedPipe = 0,
+    SharedMemory
+}
+
+internal enum ResamplerQuality
+{
+    Low = 0,
+    Medium,
+    High
+}
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct CaptureOptions
+{
+    public AudioTransportType Transport;
+
+    // Adds a stereo mix of all sources as one more stream with pipe id MixdownPipeId.
+    [MarshalAs(UnmanagedType.Bool)]
+    public bool MixdownEnabled;
+
+    // Common rate of all streams of the capture, 0 keeps each source's own rate.
+    public uint TargetSampleRate;
+    public ResamplerQuality ResamplerQuality;
+
+    // Batches transport writes until this many bytes are pending or the oldest is this old.
+    // CoalesceMaxLatencyMs = 0 writes every packet as it arrives.
+    public uint CoalesceMaxBytes;
+    public uint CoalesceMaxLatencyMs;
+
+    // Silent packets arrive as silence records instead of zeros, see StreamRecordReader. Packets
+    // peaking at or below SilenceThreshold (linear, 0 to 1) count as silent, 0 only trusts the
+    // engine's silent flag.
+    [MarshalAs(UnmanagedType.Bool)]
+    public bool SilenceRecords;
+    public float SilenceThreshold;
+
+    public const uint MixdownPipeId = 0;
+
+    // What the overlay captures with unless a setting says otherwise: named pipes, every stream at
+    // 48 kHz, writes batched to 64 KB or 20 ms, and silence sent as records below about -100 dBFS
+    // (the smallest 16 bit step).
+    public static CaptureOptions Default => new()
+    {
+        Transport = AudioTransportType.NamedPipe,
+        MixdownEnabled = true,
+        TargetSampleRate = 48000,
+        ResamplerQuality = ResamplerQuality.Medium,
+        CoalesceMaxBytes = 64 * 1024,
+        CoalesceMaxLatencyMs = 20,
+        SilenceRecords = true,
+        SilenceThreshold = 1e-5f
+    };
+
+    public uint GetStreamSampleRate(uint sourceSampleRate) =>
+        TargetSampleRate != 0 ? TargetSampleRate : sourceSampleRate;
+}
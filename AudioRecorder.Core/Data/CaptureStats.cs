@@ -0,0 +1,26 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Data;
+
+// Mirrors the native CaptureStats. Counters are totals since the stream started, latencies are in
+// microseconds.
+[StructLayout(LayoutKind.Sequential)]
+internal struct CaptureStats
+{
+    public uint PipeId;
+    public ulong Packets;
+    public ulong Frames;
+    // Audio the engine lost before handing the packet over.
+    public ulong Discontinuities;
+    public ulong SilentPackets;
+    public ulong BytesWritten;
+    public ulong ShortWrites;
+    public ulong FailedWrites;
+    // Bytes the transport discarded because the reader fell behind.
+    public ulong DroppedBytes;
+    public ulong WriteCount;
+    public double WriteLatencyMean;
+    public double WriteLatencyP50;
+    public double WriteLatencyP99;
+    public double WriteLatencyMax;
+}
@@ -0,0 +1,19 @@
+﻿namespace AudioRecorder.Core.Data;
+
+// Values match the native DeviceChangeKind.
+internal enum DeviceChangeKind
+{
+    DeviceState = 0,
+    SessionState,
+    // Sessions of the device have to be read again for their display names.
+    SessionNames
+}
+
+// A device or session state change as the notification callbacks report it. SessionId is empty for
+// device and session name changes.
+internal readonly record struct DeviceChange(ulong Generation, DeviceChangeKind Kind, int State, string DeviceId, string SessionId);
+
+// What happened after the generation asked for. Snapshot is set instead of Changes when the native
+// change log does not reach back that far: every active device, possibly already showing changes
+// that the next request reports again.
+internal sealed record DeviceChanges(ulong Generation, DeviceChange[] Changes, DeviceSnapshotEntry[]? Snapshot);
@@ -0,0 +1,4 @@
+﻿namespace AudioRecorder.Core.Data;
+
+// A device of a native device snapshot with its sessions, see DeviceSnapshotInterop.
+internal readonly record struct DeviceSnapshotEntry(AudioDeviceInfo Device, AudioSessionInfo[] Sessions);
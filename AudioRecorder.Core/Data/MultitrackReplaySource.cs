@@ -0,0 +1,17 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Data;
+
+// Mirrors the native MultitrackReplaySource, one instant replay buffer of a multitrack save.
+[StructLayout(LayoutKind.Sequential, CharSet = CharSet.Unicode)]
+internal struct MultitrackReplaySource
+{
+    public const int MaxNameLength = 64;
+
+    public IntPtr Buffer;
+    // Buffer is a compressed replay buffer.
+    [MarshalAs(UnmanagedType.Bool)]
+    public bool Compressed;
+    [MarshalAs(UnmanagedType.ByValTStr, SizeConst = MaxNameLength)]
+    public string Name;
+}
@@ -0,0 +1,14 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Data;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct RecoveredRecording
+{
+    public ulong FileSize;
+    // Segments kept.
+    public uint Segments;
+    // A segment failed its checksum and was cut off together with everything after it.
+    [MarshalAs(UnmanagedType.Bool)]
+    public bool Damaged;
+}
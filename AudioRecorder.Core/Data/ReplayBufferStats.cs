@@ -0,0 +1,20 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Data;
+
+// Mirrors the native ReplayBufferStats of a compressed instant replay buffer.
+[StructLayout(LayoutKind.Sequential)]
+internal struct ReplayBufferStats
+{
+    public ReplayCodec Codec;
+    public uint BlockCount;
+    public ulong StoredFrames;
+    public ulong CompressedBytes;
+    public ulong MemoryBytes;
+    public ulong MemoryBytesPerMinute;
+    public ulong PcmBytesPerMinute;
+    public ulong EncodedFrames;
+    public ulong EncodeNanoseconds;
+    // Encode time relative to the encoded audio, 0.01 is 1% of a core.
+    public double EncodeLoad;
+}
@@ -0,0 +1,23 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Data;
+
+// Mirrors the native StreamLevels. Peak and Rms are linear, 1 is full scale, and cover the last
+// metering period; ClippedSamples counts since the stream started. Only the first Channels entries
+// of the arrays are used.
+[StructLayout(LayoutKind.Sequential)]
+internal struct StreamLevels
+{
+    public const int MaxChannels = 8;
+
+    public uint PipeId;
+    public uint Channels;
+    // Unchanged between two reads when the stream delivered no audio in between.
+    public ulong Period;
+    [MarshalAs(UnmanagedType.ByValArray, SizeConst = MaxChannels)]
+    public float[] Peak;
+    [MarshalAs(UnmanagedType.ByValArray, SizeConst = MaxChannels)]
+    public float[] Rms;
+    [MarshalAs(UnmanagedType.ByValArray, SizeConst = MaxChannels)]
+    public ulong[] ClippedSamples;
+}
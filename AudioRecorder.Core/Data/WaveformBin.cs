@@ -0,0 +1,13 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Data;
+
+// Mirrors the native WaveformBin: the shape of WaveformInterop.FramesPerBin[level] frames, all
+// channels together, 32767 being full scale.
+[StructLayout(LayoutKind.Sequential)]
+internal struct WaveformBin
+{
+    public short Min;
+    public short Max;
+    public ushort Rms;
+}
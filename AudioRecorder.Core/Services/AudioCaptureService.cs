@@ -5,16 +5,64 @@ namespace AudioRecorder.Core.Services;
 
 internal static class AudioCaptureService
 {
-    public static long StartCapture(AudioDeviceInfo[] inputDevices, AudioDeviceInfo[] outputDevices, AudioSessionInfo[] sessions)
+    public static long StartCapture(AudioDeviceInfo[] inputDevices, AudioDeviceInfo[] outputDevices, AudioSessionInfo[] sessions,
+        CaptureOptions options = default)
     {
         AudioStateService.Instance.CommitSelection();
 
-        return StartCapture(inputDevices, inputDevices.Length, outputDevices, outputDevices.Length, sessions, sessions.Length);
+        return StartCaptureEx(inputDevices, inputDevices.Length, outputDevices, outputDevices.Length, sessions, sessions.Length,
+            ref options);
     }
 
     [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
     public static extern void StopCapture(long captureId);
 
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool SetMixdownSourceGain(long captureId, uint pipeId, float gain);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool SetMixdownSourceMuted(long captureId, uint pipeId,
+        [MarshalAs(UnmanagedType.Bool)] bool muted);
+
+    // One entry per stream of the capture, the mixdown included; empty once the capture is stopped.
+    public static CaptureStats[] GetCaptureStats(long captureId)
+    {
+        var count = GetCaptureStats(captureId, null, 0);
+        if (count <= 0)
+            return Array.Empty<CaptureStats>();
+
+        // A stream can only disappear between the two calls, never be added.
+        var stats = new CaptureStats[count];
+        count = GetCaptureStats(captureId, stats, stats.Length);
+        return count <= 0 ? Array.Empty<CaptureStats>() : stats[..Math.Min(count, stats.Length)];
+    }
+
+    // Levels of every stream, in the order of GetCaptureStats. The native side publishes about 30 periods
+    // per second, polling at the overlay's frame rate is enough.
+    public static StreamLevels[] GetCaptureLevels(long captureId)
+    {
+        var count = GetCaptureLevels(captureId, null, 0);
+        if (count <= 0)
+            return Array.Empty<StreamLevels>();
+
+        var levels = new StreamLevels[count];
+        count = GetCaptureLevels(captureId, levels, levels.Length);
+        return count <= 0 ? Array.Empty<StreamLevels>() : levels[..Math.Min(count, levels.Length)];
+    }
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    private static extern int GetCaptureStats(long captureId, [Out] CaptureStats[]? stats, int capacity);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    private static extern int GetCaptureLevels(long captureId, [Out] StreamLevels[]? levels, int capacity);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    private static extern long StartCaptureEx([In] AudioDeviceInfo[] inputDevices, int inputDeviceCount,
+        [In] AudioDeviceInfo[] outputDevices, int outputDeviceCount, [In] AudioSessionInfo[] sessions,
+        int sessionCount, [In] ref CaptureOptions options);
+
     [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
     private static extern long StartCapture([In] AudioDeviceInfo[] inputDevices, int inputDeviceCount,
         [In] AudioDeviceInfo[] outputDevices, int outputDeviceCount, [In] AudioSessionInfo[] sessions,
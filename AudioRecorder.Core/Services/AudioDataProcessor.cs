@@ -1,60 +1,117 @@
 ﻿using System.IO.Pipes;
-using System.Text;
 using AudioRecorder.Core.Data;
 
 namespace AudioRecorder.Core.Services;
 
-internal sealed class AudioDataProcessor
+internal sealed class AudioDataProcessor : IDisposable
 {
     private const string PipeNameTemplate = "AudioDataPipe_{0}_{1}";
-    private const string FileNameTemplate = "{0}_{1}_{2}.wav";
-    private const int PipeTimeout = 2000;
+    internal const int PipeTimeout = 2000;
+    private const uint SharedMemoryReadTimeout = 100;
+    // How long Stop() lets a reader finish what the stopped capture still flushed.
+    internal const int DrainTimeout = 1000;
+    private const int SharedMemoryReadBufferSize = 64 * 1024;
+    // Large enough for a whole coalesced batch in one read.
+    private const int PipeReadBufferSize = 64 * 1024;
 
     private readonly bool _isInstantReplayMode;
     private readonly int _instantReplayDuration;
+    private readonly string? _recordingDirectory;
+    private readonly RecordingFileFormat _recordingFormat;
+    private readonly int _compressionLevel;
+    private readonly AudioTransportType _transport;
+    private readonly bool _silenceRecords;
     private readonly AudioData[] _audioDataList;
 
     public long CaptureId { get; }
+    public CaptureHealthMonitor HealthMonitor { get; }
 
     public AudioDataProcessor(long captureId, IEnumerable<AudioDeviceInfo> inputDevices,
         IEnumerable<AudioDeviceInfo> outputDevices, IEnumerable<AudioSessionInfo> sessions, bool isInstantReplayMode = false,
-        int instantReplayDuration = 0)
+        int instantReplayDuration = 0, string? recordingDirectory = null, CaptureOptions captureOptions = default,
+        RecordingFileFormat recordingFormat = RecordingFileFormat.Wav,
+        int compressionLevel = FlacFileWriterInterop.DefaultCompressionLevel, ReplayCodec? replayCodec = null)
     {
         CaptureId = captureId;
         _audioDataList = inputDevices
             .Select(ad => new AudioData(ad, captureId, AudioTargetType.AudioDevice, isInstantReplayMode,
-                instantReplayDuration))
+                instantReplayDuration, replayCodec) { SampleRate = captureOptions.GetStreamSampleRate(ad.SampleRate) })
             .Concat(outputDevices.Select(ad => new AudioData(ad, captureId, AudioTargetType.AudioDevice,
-                isInstantReplayMode, instantReplayDuration)))
+                isInstantReplayMode, instantReplayDuration, replayCodec) { SampleRate = captureOptions.GetStreamSampleRate(ad.SampleRate) }))
             .Concat(sessions.Select(session =>
-                new AudioData(captureId, AudioTargetType.Process, isInstantReplayMode, instantReplayDuration)
-                    { PipeId = session.PipeId, Name = session.DisplayName })).ToArray();
+                new AudioData(captureId, AudioTargetType.Process, isInstantReplayMode, instantReplayDuration, replayCodec)
+                {
+                    PipeId = session.PipeId, Name = session.DisplayName,
+                    SampleRate = captureOptions.GetStreamSampleRate(AudioData.DefaultSampleRate)
+                }))
+            .Concat(captureOptions.MixdownEnabled
+                ? new[]
+                {
+                    new AudioData(captureId, AudioTargetType.Mixdown, isInstantReplayMode, instantReplayDuration, replayCodec)
+                    {
+                        PipeId = CaptureOptions.MixdownPipeId, Name = "Mixdown",
+                        SampleRate = captureOptions.GetStreamSampleRate(AudioData.DefaultSampleRate)
+                    }
+                }
+                : Array.Empty<AudioData>()).ToArray();
         _isInstantReplayMode = isInstantReplayMode;
         _instantReplayDuration = instantReplayDuration;
+        _recordingDirectory = recordingDirectory;
+        _recordingFormat = recordingFormat;
+        _compressionLevel = compressionLevel;
+        _transport = captureOptions.Transport;
+        _silenceRecords = captureOptions.SilenceRecords;
+        HealthMonitor = new CaptureHealthMonitor(captureId);
     }
 
     public bool Start()
     {
         var threadsToStart = new List<Thread>();
 
+        // Standard recordings are streamed to disk as they arrive instead of being kept in memory.
+        var recordingDirectory = !_isInstantReplayMode && _recordingDirectory != null
+            ? CreateTargetDirectory(_recordingDirectory)
+            : null;
+
         foreach (var audioData in _audioDataList)
         {
-            var pipeName = string.Format(PipeNameTemplate, audioData.PipeId, CaptureId);
-
-            var client = new NamedPipeClientStream(".", pipeName, PipeDirection.In);
-            audioData.PipeClient = client;
+            if (recordingDirectory != null && !audioData.StartRecording(
+                    GetUniqueFilePath(recordingDirectory, audioData.Name, GetFileExtension(_recordingFormat)),
+                    _recordingFormat, _compressionLevel))
+                Logger.LogError($"Failed to create recording file for {audioData.Name}.");
 
-            try
+            Thread thread;
+            if (_transport == AudioTransportType.SharedMemory)
             {
-                client.Connect(PipeTimeout);
+                audioData.SharedMemoryReader = SharedMemoryReaderInterop.OpenSharedMemoryReader(audioData.PipeId, CaptureId);
+                if (audioData.SharedMemoryReader == IntPtr.Zero)
+                {
+                    Logger.LogError($"Failed to open shared memory transport for {audioData.Name}.");
+                    return false;
+                }
+
+                thread = new Thread(() => ProcessSharedMemory(audioData, _silenceRecords));
             }
-            catch (TimeoutException)
+            else
             {
-                Logger.LogError("Timeout while trying to connect.");
-                return false;
+                var pipeName = string.Format(PipeNameTemplate, audioData.PipeId, CaptureId);
+
+                var client = CreatePipeClient(pipeName);
+                audioData.PipeClient = client;
+
+                try
+                {
+                    client.Connect(PipeTimeout);
+                }
+                catch (TimeoutException)
+                {
+                    Logger.LogError("Timeout while trying to connect.");
+                    return false;
+                }
+
+                thread = new Thread(() => ProcessPipe(client, audioData, _silenceRecords));
             }
 
-            var thread = new Thread(() => ProcessAudio(audioData));
             audioData.ProcessingThread = thread;
             threadsToStart.Add(thread);
         }
@@ -62,25 +119,34 @@ internal sealed class AudioDataProcessor
         foreach (var thread in threadsToStart)
             thread.Start();
 
+        HealthMonitor.Start();
+
         return true;
     }
 
+    // Call after the capture has been stopped: a reader leaves its loop by itself once it has read
+    // everything the native side flushed, only one that does not is cancelled.
     public void Stop()
     {
+        HealthMonitor.Dispose();
+
         foreach (var audioData in _audioDataList)
         {
-            if (audioData.ProcessingThread != null && audioData.ProcessingThread.IsAlive)
+            if (audioData.ProcessingThread != null && !audioData.ProcessingThread.Join(DrainTimeout))
             {
+                // A shared memory read returns within its timeout, a pipe read once the pipe is closed.
                 audioData.CancelRequested = true;
-                audioData.ProcessingThread.Interrupt();
-                try
-                {
-                    audioData.ProcessingThread.Join();
-                }
-                catch (ThreadInterruptedException) { }
+                audioData.PipeClient?.Close();
+                audioData.ProcessingThread.Join();
             }
 
             audioData.PipeClient?.Close();
+
+            if (audioData.SharedMemoryReader != IntPtr.Zero)
+            {
+                SharedMemoryReaderInterop.CloseSharedMemoryReader(audioData.SharedMemoryReader);
+                audioData.SharedMemoryReader = IntPtr.Zero;
+            }
         }
     }
 
@@ -93,78 +159,165 @@ internal sealed class AudioDataProcessor
             audioData.SetInstantReplayBufferSize(durationSeconds);
     }
 
-    private async void ProcessAudio(AudioData audioData)
+    public void Dispose()
     {
-        if (audioData.PipeClient == null)
-            return;
+        HealthMonitor.Dispose();
 
-        using var reader = new BinaryReader(audioData.PipeClient);
-        var buffer = new byte[4096];
+        foreach (var audioData in _audioDataList)
+            audioData.Dispose();
+    }
+
+    // Opened for overlapped I/O so that closing the pipe ends a read that is still waiting for data.
+    internal static NamedPipeClientStream CreatePipeClient(string pipeName) =>
+        new(".", pipeName, PipeDirection.In, PipeOptions.Asynchronous);
+
+    // Every read blocks until data arrives or the capture closes its end, however long the source is
+    // quiet: a read is never abandoned halfway, so the bytes stay in order and record framing intact.
+    internal static void ProcessPipe(Stream pipe, AudioData audioData, bool silenceRecords)
+    {
+        var buffer = new byte[PipeReadBufferSize];
+        var records = silenceRecords ? new StreamRecordReader() : null;
 
         audioData.ClearBuffer();
 
         try
         {
-            while (audioData.PipeClient.IsConnected && !audioData.CancelRequested)
+            while (!audioData.CancelRequested)
             {
-                var bytesRead = await ReadFromPipeWithTimeoutAsync(reader, buffer, PipeTimeout);
-                if (bytesRead > 0)
-                {
-                    var data = buffer.Take(bytesRead).ToArray();
-                    audioData.AddData(data);
-                }
+                var bytesRead = pipe.Read(buffer, 0, buffer.Length);
+                if (bytesRead == 0)
+                    break;
+
+                if (!Deliver(audioData, records, buffer, bytesRead))
+                    break;
             }
         }
-        catch (EndOfStreamException)
+        catch (Exception ex) when (ex is IOException or ObjectDisposedException or OperationCanceledException)
         {
-            Logger.LogError("Stream closed.");
+            // Stop() closes the pipe to end a read it gave up waiting for.
+            if (!audioData.CancelRequested)
+                Logger.LogError($"An IO exception occured: {ex}");
         }
-        catch (IOException ex)
+    }
+
+    // The native read blocks on the transport's wakeup event, so one thread per source is enough
+    // and no task has to be scheduled per read.
+    private static void ProcessSharedMemory(AudioData audioData, bool silenceRecords)
+    {
+        var buffer = new byte[SharedMemoryReadBufferSize];
+        var records = silenceRecords ? new StreamRecordReader() : null;
+
+        audioData.ClearBuffer();
+
+        while (!audioData.CancelRequested)
         {
-            Logger.LogError($"An IO exception occured: {ex}");
+            var bytesRead = SharedMemoryReaderInterop.ReadSharedMemory(audioData.SharedMemoryReader, buffer,
+                buffer.Length, SharedMemoryReadTimeout);
+            if (bytesRead < 0)
+                break;
+
+            if (bytesRead > 0 && !Deliver(audioData, records, buffer, bytesRead))
+                break;
         }
     }
 
-    private async Task<int> ReadFromPipeWithTimeoutAsync(BinaryReader reader, byte[] buffer, int timeoutMilliseconds)
+    // Hands one read to the audio data, unframing it first when the stream carries silence records.
+    private static bool Deliver(AudioData audioData, StreamRecordReader? records, byte[] buffer, int count)
     {
-        var readTask = Task.Run(() =>
+        if (records == null)
         {
-            try
-            {
-                return reader.Read(buffer, 0, buffer.Length);
-            }
-            catch (ObjectDisposedException)
-            {
-                // ignored
-            }
+            audioData.AddData(buffer, count);
+            return true;
+        }
+
+        if (records.Process(buffer, count, audioData))
+            return true;
 
-            return 0;
-        });
+        Logger.LogError($"Unknown record in the stream of {audioData.Name}, stopped reading it.");
+        return false;
+    }
+
+    // Writes a WAV file per source, or with multitrack all sources into a single container file.
+    public void SaveAllAudioData(string directoryName, bool multitrack = false)
+    {
+        if (!_isInstantReplayMode)
+            throw new InvalidOperationException("Only instant replay is saved on demand, recordings are written while capturing.");
 
-        var completedTask = await Task.WhenAny(readTask, Task.Delay(timeoutMilliseconds));
+        var targetDirectory = CreateTargetDirectory(directoryName);
 
-        if (completedTask == readTask)
-            return await readTask;
+        if (multitrack)
+            SaveMultitrack(GetUniqueFilePath(targetDirectory, "InstantReplay", MultitrackInterop.FileExtension));
 
-        return 0;
+        foreach (var audioData in _audioDataList)
+        {
+            if (!multitrack && !audioData.SaveInstantReplay(GetUniqueFilePath(targetDirectory, audioData.Name, ".wav")))
+                Logger.LogError($"Failed to save instant replay for {audioData.Name}.");
+
+            if (audioData.GetReplayBufferStats() is { } stats)
+                Logger.LogInfo($"Instant replay buffer of {audioData.Name}: {stats.Codec}, " +
+                               $"{stats.MemoryBytesPerMinute / (1024.0 * 1024.0):F2} MiB per minute " +
+                               $"({stats.PcmBytesPerMinute / (1024.0 * 1024.0):F2} MiB as PCM), " +
+                               $"encoding at {stats.EncodeLoad * 100:F2}% of a core.");
+        }
     }
 
-    public void SaveAllAudioData(string directoryName)
+    private void SaveMultitrack(string filePath)
     {
-        foreach (var entry in _audioDataList)
+        var acquired = new List<AudioData>();
+        var sources = new List<MultitrackReplaySource>();
+        try
         {
-            SaveAudioData(entry, directoryName);
+            foreach (var audioData in _audioDataList)
+            {
+                if (!audioData.AcquireReplaySource(out var source))
+                    continue;
+
+                acquired.Add(audioData);
+                sources.Add(source);
+            }
+
+            if (sources.Count == 0)
+                return;
+
+            var seconds = acquired.Max(audioData => audioData.InstantReplayDurationSeconds);
+            if (!MultitrackInterop.SaveInstantReplaysToMultitrack(sources.ToArray(), sources.Count, seconds, filePath))
+                Logger.LogError("Failed to save the multitrack instant replay.");
+        }
+        finally
+        {
+            foreach (var audioData in acquired)
+                audioData.ReleaseReplaySource();
         }
     }
 
-    private void SaveAudioData(AudioData audioData, string directoryName)
+    public void FinishRecording()
     {
-        var audioBuffer = audioData.Buffer.ToArray();
-        audioData.ClearBuffer();
+        foreach (var audioData in _audioDataList)
+            audioData.FinishRecording();
+    }
 
-        var wavData = ConvertToWav(audioBuffer, sampleRate: (int)audioData.SampleRate,
-            bitsPerSample: audioData.BitsPerSample, channels: audioData.Channels);
+    // Restores the recordings below directoryName that a crash or power loss left unfinished, found
+    // by the journal next to them. Must not run while a recording is being written there.
+    public static void RecoverInterruptedRecordings(string directoryName)
+    {
+        if (!Directory.Exists(directoryName))
+            return;
 
+        foreach (var journalPath in Directory.EnumerateFiles(directoryName, "*" + RecordingJournalInterop.JournalExtension,
+                     SearchOption.AllDirectories))
+        {
+            var filePath = journalPath[..^RecordingJournalInterop.JournalExtension.Length];
+            var hr = RecordingJournalInterop.RecoverInterruptedRecording(filePath, out var result);
+            if (hr < 0)
+                Logger.LogError($"Failed to recover {filePath}, HRESULT 0x{hr:X8}.");
+            else
+                Logger.LogInfo($"Recovered {filePath}: {result.Segments} segments, {result.FileSize} bytes" +
+                               (result.Damaged ? ", damaged segments were dropped." : "."));
+        }
+    }
+
+    private static string CreateTargetDirectory(string directoryName)
+    {
         var now = DateTime.Now;
         var dateFolder = now.ToString("dd.MM.yyyy");
         var timeFolder = now.ToString("HH-mm-ss");
@@ -173,49 +326,23 @@ internal sealed class AudioDataProcessor
         if (!Directory.Exists(targetDirectory))
             Directory.CreateDirectory(targetDirectory);
 
-        var filePath = Path.Combine(targetDirectory, $"{audioData.Name}.wav");
+        return targetDirectory;
+    }
+
+    private static string GetFileExtension(RecordingFileFormat format) =>
+        format == RecordingFileFormat.Flac ? ".flac" : ".wav";
+
+    private static string GetUniqueFilePath(string targetDirectory, string name, string extension)
+    {
+        var filePath = Path.Combine(targetDirectory, $"{name}{extension}");
 
         var index = 1;
         while (File.Exists(filePath))
         {
-            filePath = Path.Combine(targetDirectory, $"{audioData.Name}_{index}.wav");
+            filePath = Path.Combine(targetDirectory, $"{name}_{index}{extension}");
             ++index;
         }
 
-        File.WriteAllBytes(filePath, wavData);
-    }
-
-    private byte[] ConvertToWav(byte[] rawAudioBytes, int sampleRate = 44100, int bitsPerSample = 16, int channels = 2)
-    {
-        using var memoryStream = new MemoryStream();
-        using var writer = new BinaryWriter(memoryStream);
-        var blockAlign = channels * bitsPerSample / 8;
-        var averageBytesPerSecond = sampleRate * blockAlign;
-
-        // RIFF header
-        writer.Write(Encoding.UTF8.GetBytes("RIFF"));
-        writer.Write(0); // placeholder for the RIFF chunk size
-        writer.Write(Encoding.UTF8.GetBytes("WAVE"));
-
-        // fmt sub-chunk
-        writer.Write(Encoding.UTF8.GetBytes("fmt "));
-        writer.Write(16); // fmt chunk size (16 for PCM)
-        writer.Write((short)1); // audio format (1 = PCM)
-        writer.Write((short)channels);
-        writer.Write(sampleRate);
-        writer.Write(averageBytesPerSecond);
-        writer.Write((short)blockAlign);
-        writer.Write((short)bitsPerSample);
-
-        // data sub-chunk
-        writer.Write(Encoding.UTF8.GetBytes("data"));
-        writer.Write(rawAudioBytes.Length);
-        writer.Write(rawAudioBytes);
-
-        // Fill in the RIFF chunk size
-        memoryStream.Seek(4, SeekOrigin.Begin);
-        writer.Write((int)(memoryStream.Length - 8));
-
-        return memoryStream.ToArray();
+        return filePath;
     }
-}
\ No newline at end of file
+}
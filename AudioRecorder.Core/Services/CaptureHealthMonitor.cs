@@ -0,0 +1,83 @@
+﻿using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+// Polls GetCaptureStats for one capture and reports streams whose glitch counters moved since the
+// previous poll. The native side only reads atomic counters, so polling once a second costs nothing.
+internal sealed class CaptureHealthMonitor : IDisposable
+{
+    private static readonly TimeSpan PollInterval = TimeSpan.FromSeconds(1);
+
+    private readonly long _captureId;
+    private readonly Dictionary<uint, CaptureStats> _previous = new();
+    private readonly object _syncLock = new();
+    private Timer? _timer;
+
+    public CaptureHealthMonitor(long captureId)
+    {
+        _captureId = captureId;
+    }
+
+    // Raised on the timer thread with the stream's latest stats and a short description.
+    public event Action<CaptureStats, string>? GlitchDetected;
+
+    public IReadOnlyList<CaptureStats> LatestStats { get; private set; } = Array.Empty<CaptureStats>();
+
+    public void Start()
+    {
+        lock (_syncLock)
+            _timer ??= new Timer(_ => Poll(), null, PollInterval, PollInterval);
+    }
+
+    public void Dispose()
+    {
+        lock (_syncLock)
+        {
+            _timer?.Dispose();
+            _timer = null;
+        }
+    }
+
+    private void Poll()
+    {
+        lock (_syncLock)
+        {
+            if (_timer == null)
+                return;
+
+            var stats = AudioCaptureService.GetCaptureStats(_captureId);
+            LatestStats = stats;
+
+            foreach (var current in stats)
+            {
+                if (_previous.TryGetValue(current.PipeId, out var previous))
+                {
+                    var description = Describe(previous, current);
+                    if (description != null)
+                    {
+                        Logger.LogWarning($"Capture {_captureId}, stream {current.PipeId}: {description}");
+                        GlitchDetected?.Invoke(current, description);
+                    }
+                }
+
+                _previous[current.PipeId] = current;
+            }
+        }
+    }
+
+    private static string? Describe(CaptureStats previous, CaptureStats current)
+    {
+        var problems = new List<string>();
+
+        if (current.Discontinuities > previous.Discontinuities)
+            problems.Add($"{current.Discontinuities - previous.Discontinuities} discontinuities");
+        if (current.DroppedBytes > previous.DroppedBytes)
+            problems.Add($"{current.DroppedBytes - previous.DroppedBytes} bytes dropped");
+        if (current.ShortWrites > previous.ShortWrites)
+            problems.Add($"{current.ShortWrites - previous.ShortWrites} short writes");
+        if (current.FailedWrites > previous.FailedWrites)
+            problems.Add($"{current.FailedWrites - previous.FailedWrites} failed writes");
+
+        return problems.Count > 0 ? string.Join(", ", problems) : null;
+    }
+}
@@ -0,0 +1,34 @@
+﻿using System.Runtime.InteropServices;
+using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+internal static class CompressedReplayBufferInterop
+{
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern IntPtr CreateCompressedReplayBuffer(uint sampleRate, ushort bitsPerSample, ushort channels,
+        int durationSeconds, ReplayCodec codec);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void DestroyCompressedReplayBuffer(IntPtr buffer);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void AppendCompressedReplayBuffer(IntPtr buffer, in byte data, int size);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void AppendSilenceCompressedReplayBuffer(IntPtr buffer, ulong frames);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void ResizeCompressedReplayBuffer(IntPtr buffer, int durationSeconds);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void ClearCompressedReplayBuffer(IntPtr buffer);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool GetCompressedReplayStats(IntPtr buffer, out ReplayBufferStats stats);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool SaveCompressedReplayToWav(IntPtr buffer, int seconds, string filePath);
+}
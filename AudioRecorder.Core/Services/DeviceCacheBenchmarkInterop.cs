@@ -0,0 +1,24 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct DeviceCacheBenchmarkOptions
+{
+    public uint DeviceCount;
+    public uint SessionsPerDevice;
+    // Simulated cost of one endpoint or session list read.
+    public uint ReadLatencyUs;
+    public uint QueryCount;
+    // Queries between simulated device or session changes, 0 for none.
+    public uint InvalidateEvery;
+}
+
+internal static class DeviceCacheBenchmarkInterop
+{
+    // Times device list queries with and without the native device cache against a fake enumerator and
+    // appends one JSON object to resultPath (uncachedQueryUs, cachedQueryUs, hits, misses). Returns an HRESULT.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int RunDeviceEnumerationBenchmark(ref DeviceCacheBenchmarkOptions options,
+        [MarshalAs(UnmanagedType.LPWStr)] string resultPath);
+}
@@ -0,0 +1,220 @@
+﻿using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+// Devices and sessions copied out of the library as one block (native DeviceSnapshot.h) instead of a
+// BSTR per string and a native array per device. The block goes into a per-thread buffer that is kept
+// between calls, so a query costs a single P/Invoke once the buffer has grown to fit.
+//
+// The change feed (native DeviceChangeLog.h) comes the same way: the state changes after a generation,
+// or a snapshot when the log has dropped some of them.
+internal static class DeviceSnapshotInterop
+{
+    private const uint Version = 1;
+    private const uint ChangesVersion = 1;
+    private const int InitialBufferSize = 16 * 1024;
+
+    [ThreadStatic]
+    private static byte[]? _buffer;
+
+    // All active render devices when deviceId is null.
+    public static DeviceSnapshotEntry[] GetOutputDevices(string? deviceId = null) =>
+        Read((buffer, capacity) => GetOutputDeviceSnapshot(deviceId, buffer, capacity));
+
+    // All active capture devices when deviceId is null.
+    public static DeviceSnapshotEntry[] GetInputDevices(string? deviceId = null) =>
+        Read((buffer, capacity) => GetInputDeviceSnapshot(deviceId, buffer, capacity));
+
+    // Pass 0 for the first request and the returned Generation for every later one. Null on error.
+    public static DeviceChanges? GetOutputChanges(ulong generation) =>
+        Read<DeviceChanges>((buffer, capacity) => GetOutputDeviceChanges(generation, buffer, capacity), ParseChanges);
+
+    public static DeviceChanges? GetInputChanges(ulong generation) =>
+        Read<DeviceChanges>((buffer, capacity) => GetInputDeviceChanges(generation, buffer, capacity), ParseChanges);
+
+    private static DeviceSnapshotEntry[] Read(Func<byte[], int, int> getSnapshot) =>
+        Read<DeviceSnapshotEntry[]>(getSnapshot, Parse) ?? Array.Empty<DeviceSnapshotEntry>();
+
+    private delegate T? BlockParser<T>(ReadOnlySpan<byte> block) where T : class;
+
+    private static T? Read<T>(Func<byte[], int, int> getBlock, BlockParser<T> parse) where T : class
+    {
+        var buffer = _buffer ??= new byte[InitialBufferSize];
+        while (true)
+        {
+            var size = getBlock(buffer, buffer.Length);
+            if (size < 0)
+                return null;
+            if (size <= buffer.Length)
+                return parse(buffer.AsSpan(0, size));
+
+            // Devices may come and go before the next call, leave some room.
+            buffer = _buffer = new byte[size + size / 2];
+        }
+    }
+
+    private static DeviceChanges? ParseChanges(ReadOnlySpan<byte> block)
+    {
+        if (block.Length < Unsafe.SizeOf<ChangesHeader>())
+            return null;
+
+        var header = MemoryMarshal.Read<ChangesHeader>(block);
+        if (header.Version != ChangesVersion || header.Size > block.Length)
+            return null;
+
+        if (header.SnapshotSize > 0)
+        {
+            var snapshot = Parse(block.Slice((int)header.SnapshotOffset, (int)header.SnapshotSize));
+            return new DeviceChanges(header.Generation, Array.Empty<DeviceChange>(), snapshot);
+        }
+
+        var records = MemoryMarshal.Cast<byte, ChangeRecord>(
+            block.Slice((int)header.ChangesOffset, (int)header.ChangeCount * Unsafe.SizeOf<ChangeRecord>()));
+
+        var changes = new DeviceChange[records.Length];
+        for (var i = 0; i < records.Length; ++i)
+        {
+            ref readonly var record = ref records[i];
+            changes[i] = new DeviceChange(record.Generation, (DeviceChangeKind)record.Kind, (int)record.State,
+                ReadString(block, record.DeviceId), ReadString(block, record.SessionId));
+        }
+
+        return new DeviceChanges(header.Generation, changes, null);
+    }
+
+    private static DeviceSnapshotEntry[] Parse(ReadOnlySpan<byte> snapshot)
+    {
+        if (snapshot.Length < Unsafe.SizeOf<SnapshotHeader>())
+            return Array.Empty<DeviceSnapshotEntry>();
+
+        var header = MemoryMarshal.Read<SnapshotHeader>(snapshot);
+        if (header.Version != Version || header.Size > snapshot.Length)
+            return Array.Empty<DeviceSnapshotEntry>();
+
+        var devices = MemoryMarshal.Cast<byte, SnapshotDevice>(
+            snapshot.Slice((int)header.DevicesOffset, (int)header.DeviceCount * Unsafe.SizeOf<SnapshotDevice>()));
+        var sessions = MemoryMarshal.Cast<byte, SnapshotSession>(
+            snapshot.Slice((int)header.SessionsOffset, (int)header.SessionCount * Unsafe.SizeOf<SnapshotSession>()));
+
+        var entries = new DeviceSnapshotEntry[devices.Length];
+        for (var i = 0; i < devices.Length; ++i)
+        {
+            ref readonly var device = ref devices[i];
+            var deviceInfo = new AudioDeviceInfo
+            {
+                PipeId = device.PipeId,
+                Id = ReadString(snapshot, device.Id),
+                Name = ReadString(snapshot, device.Name),
+                SampleRate = device.SampleRate,
+                BitsPerSample = device.BitsPerSample,
+                Channels = device.Channels
+            };
+
+            var deviceSessions = sessions.Slice((int)device.FirstSession, (int)device.SessionCount);
+            var sessionInfos = new AudioSessionInfo[deviceSessions.Length];
+            for (var j = 0; j < deviceSessions.Length; ++j)
+            {
+                ref readonly var session = ref deviceSessions[j];
+                sessionInfos[j] = new AudioSessionInfo
+                {
+                    PipeId = session.PipeId,
+                    DisplayName = ReadString(snapshot, session.DisplayName),
+                    IconPath = ReadString(snapshot, session.IconPath),
+                    IsSystemSession = session.IsSystemSession != 0,
+                    SessionIdentifier = ReadString(snapshot, session.SessionIdentifier),
+                    SessionInstanceIdentifier = ReadString(snapshot, session.SessionInstanceIdentifier)
+                };
+            }
+
+            entries[i] = new DeviceSnapshotEntry(deviceInfo, sessionInfos);
+        }
+
+        return entries;
+    }
+
+    private static string ReadString(ReadOnlySpan<byte> snapshot, SnapshotString value) =>
+        value.Length == 0
+            ? string.Empty
+            : new string(MemoryMarshal.Cast<byte, char>(snapshot.Slice((int)value.Offset, (int)value.Length * sizeof(char))));
+
+    // Layouts of the native DeviceSnapshot.h.
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SnapshotString
+    {
+        public uint Offset;
+        public uint Length;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SnapshotHeader
+    {
+        public uint Version;
+        public uint Size;
+        public uint DeviceCount;
+        public uint DevicesOffset;
+        public uint SessionCount;
+        public uint SessionsOffset;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SnapshotDevice
+    {
+        public uint PipeId;
+        public SnapshotString Id;
+        public SnapshotString Name;
+        public uint SampleRate;
+        public ushort BitsPerSample;
+        public ushort Channels;
+        public uint FirstSession;
+        public uint SessionCount;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct SnapshotSession
+    {
+        public uint PipeId;
+        public SnapshotString DisplayName;
+        public SnapshotString IconPath;
+        public int IsSystemSession;
+        public SnapshotString SessionIdentifier;
+        public SnapshotString SessionInstanceIdentifier;
+    }
+
+    // Layouts of the native DeviceChangeLog.h.
+    [StructLayout(LayoutKind.Sequential)]
+    private struct ChangesHeader
+    {
+        public uint Version;
+        public uint Size;
+        public ulong Generation;
+        public uint ChangeCount;
+        public uint ChangesOffset;
+        public uint SnapshotOffset;
+        public uint SnapshotSize;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct ChangeRecord
+    {
+        public ulong Generation;
+        public uint Kind;
+        public uint State;
+        public SnapshotString DeviceId;
+        public SnapshotString SessionId;
+    }
+
+    // Return the size of the block, which is only copied if it fits into capacity. -1 on error.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    private static extern int GetOutputDeviceSnapshot(string? deviceId, [Out] byte[] buffer, int capacity);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    private static extern int GetInputDeviceSnapshot(string? deviceId, [Out] byte[] buffer, int capacity);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    private static extern int GetOutputDeviceChanges(ulong generation, [Out] byte[] buffer, int capacity);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    private static extern int GetInputDeviceChanges(ulong generation, [Out] byte[] buffer, int capacity);
+}
@@ -0,0 +1,34 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct DiskWriterBenchmarkOptions
+{
+    public uint FileCount;
+    public uint DurationMs;
+    // Per file.
+    public uint BytesPerSecond;
+    // 10 ms packets in real time, as fast as possible otherwise.
+    [MarshalAs(UnmanagedType.Bool)]
+    public bool Paced;
+    // Blocking WriteFile per packet, the baseline.
+    [MarshalAs(UnmanagedType.Bool)]
+    public bool Synchronous;
+    public uint BufferSize;
+    public uint BufferCount;
+    public uint PreallocationMB;
+    public uint FlushIntervalMs;
+    // Temp directory when null.
+    [MarshalAs(UnmanagedType.BStr)]
+    public string? OutputDirectory;
+}
+
+internal static class DiskWriterBenchmarkInterop
+{
+    // Blocks until every file has been written and closed and appends one JSON object to resultPath
+    // (megabytesPerSecond, appendLatencyUs, writeLatencyUs, stalls). Returns an HRESULT.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int RunFileWriterBenchmark(ref DiskWriterBenchmarkOptions options,
+        [MarshalAs(UnmanagedType.LPWStr)] string resultPath);
+}
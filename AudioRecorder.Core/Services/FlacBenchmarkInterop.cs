@@ -0,0 +1,25 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct FlacBenchmarkOptions
+{
+    // WAV files to encode, synthetic material when null.
+    [MarshalAs(UnmanagedType.BStr)]
+    public string? MusicPath;
+    [MarshalAs(UnmanagedType.BStr)]
+    public string? VoicePath;
+    public uint DurationMs;
+    public int MinCompressionLevel;
+    public int MaxCompressionLevel;
+}
+
+internal static class FlacBenchmarkInterop
+{
+    // Blocks until every level has been measured and appends one JSON object per material and level
+    // to resultPath (ratio and realtimePerCore). Returns an HRESULT.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int RunFlacEncoderBenchmark(ref FlacBenchmarkOptions options,
+        [MarshalAs(UnmanagedType.LPWStr)] string resultPath);
+}
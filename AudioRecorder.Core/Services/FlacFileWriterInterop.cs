@@ -0,0 +1,29 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+internal static class FlacFileWriterInterop
+{
+    public const int DefaultCompressionLevel = 5;
+    public const int MaxCompressionLevel = 8;
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    public static extern IntPtr CreateFlacFileWriter(string filePath, uint sampleRate, ushort bitsPerSample,
+        ushort channels, [MarshalAs(UnmanagedType.Bool)] bool isFloat, int compressionLevel, uint journalSegmentMs);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool AppendFlacFileWriter(IntPtr writer, in byte data, int size);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool AppendSilenceFlacFileWriter(IntPtr writer, ulong frames);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool CloseFlacFileWriter(IntPtr writer);
+
+    // Compresses a finished WAV file, returns an HRESULT.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    public static extern int EncodeWavToFlac(string wavPath, string flacPath, int compressionLevel);
+}
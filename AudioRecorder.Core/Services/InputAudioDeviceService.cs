@@ -24,6 +24,10 @@ internal sealed class InputAudioDeviceService
 
     public event Action<string, int>? DeviceStateChanged;
 
+    private readonly object _changesLock = new();
+    // Last generation of the native change log applied, 0 before the first snapshot.
+    private ulong _generation;
+
     private InputAudioDeviceService()
     {
         try
@@ -31,8 +35,8 @@ internal sealed class InputAudioDeviceService
             _deviceStateChangedCallback = OnDeviceStateChanged;
             RegisterInputNotificationCallback(_deviceStateChangedCallback);
 
-            var devices = GetActiveAudioDevices().ToArray();
-            ActiveInputAudioDevices.AddRange(devices);
+            // Generation 0 is answered with a snapshot of every active device.
+            ApplyChanges();
 
             Logger.LogInfo("Listening for audio device changes...");
         }
@@ -47,76 +51,82 @@ internal sealed class InputAudioDeviceService
         UnregisterInputNotificationCallback();
     }
 
-    private void OnDeviceStateChanged(string deviceId, int newState)
+    // The callback only signals that something changed, what did is read from the native change log.
+    private void OnDeviceStateChanged(string deviceId, int newState) => ApplyChanges();
+
+    private void ApplyChanges()
     {
-        if (newState == DeviceStateActive)
+        lock (_changesLock)
         {
-            var audioDeviceInfo = GetAudioDevice(deviceId);
-            if (audioDeviceInfo == null)
+            var changes = DeviceSnapshotInterop.GetInputChanges(_generation);
+            if (changes == null)
+            {
+                Logger.LogWarning("Failed to read audio device changes");
                 return;
+            }
 
-            ActiveInputAudioDevices.Add(audioDeviceInfo);
-        }
-        else
-        {
-            var deviceToRemove = ActiveInputAudioDevices.FirstOrDefault(device => device.Id == deviceId);
-            if (deviceToRemove == null)
-                return;
+            if (changes.Snapshot != null)
+                ApplySnapshot(changes.Snapshot);
 
-            ActiveInputAudioDevices.Remove(deviceToRemove);
-        }
+            foreach (var change in changes.Changes)
+            {
+                if (change.Kind == DeviceChangeKind.DeviceState)
+                    ApplyDeviceState(change.DeviceId, change.State);
+            }
 
-        DeviceStateChanged?.Invoke(deviceId, newState);
+            _generation = changes.Generation;
+        }
     }
 
-    private static IEnumerable<InputAudioDevice> GetActiveAudioDevices()
+    // The snapshot may already show changes that are reported again later, applying them twice has
+    // to be harmless.
+    private void ApplySnapshot(DeviceSnapshotEntry[] snapshot)
     {
-        GetActiveInputAudioDevices(out var devicesPtr, out var count);
-
-        var devices = new InputAudioDevice[count];
-        if (count == 0 || devicesPtr == IntPtr.Zero)
-            return devices;
-
-        var structSize = Marshal.SizeOf<InputAudioDeviceInfo>();
+        var isInitial = _generation == 0;
+        var devices = snapshot.Select(ToInputAudioDevice).ToDictionary(device => device.Id);
 
-        for (var i = 0; i < count; ++i)
+        foreach (var device in ActiveInputAudioDevices.Where(device => !devices.ContainsKey(device.Id)).ToArray())
         {
-            var devicePtr = IntPtr.Add(devicesPtr, i * structSize);
-            devices[i] = new InputAudioDevice(new InputAudioDeviceInfo
-                { DeviceInfo = Marshal.PtrToStructure<InputAudioDeviceInfo>(devicePtr).DeviceInfo });
+            ActiveInputAudioDevices.Remove(device);
+            DeviceStateChanged?.Invoke(device.Id, DeviceStateNotPresent);
         }
 
-        FreeInputAudioDevicesArray(devicesPtr, count);
-
-        return devices;
+        var added = devices.Values.Where(device => ActiveInputAudioDevices.All(d => d.Id != device.Id)).ToArray();
+        ActiveInputAudioDevices.AddRange(added);
+        if (!isInitial)
+        {
+            foreach (var device in added)
+                DeviceStateChanged?.Invoke(device.Id, DeviceStateActive);
+        }
     }
 
-    private static InputAudioDevice? GetAudioDevice(string deviceId)
+    private void ApplyDeviceState(string deviceId, int newState)
     {
-        var audioDevicePtr = GetInputAudioDeviceInfo(deviceId);
+        var existing = ActiveInputAudioDevices.FirstOrDefault(device => device.Id == deviceId);
+        if (newState == DeviceStateActive)
+        {
+            if (existing != null)
+                return;
 
-        if (audioDevicePtr == IntPtr.Zero)
-            return null;
+            var devices = DeviceSnapshotInterop.GetInputDevices(deviceId);
+            if (devices.Length == 0)
+                return;
 
-        var device = new InputAudioDevice(new InputAudioDeviceInfo
-            { DeviceInfo = Marshal.PtrToStructure<InputAudioDeviceInfo>(audioDevicePtr).DeviceInfo });
+            ActiveInputAudioDevices.Add(ToInputAudioDevice(devices[0]));
+        }
+        else
+        {
+            if (existing == null)
+                return;
 
-        FreeInputAudioDevice(audioDevicePtr);
+            ActiveInputAudioDevices.Remove(existing);
+        }
 
-        return device;
+        DeviceStateChanged?.Invoke(deviceId, newState);
     }
 
-    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
-    private static extern void GetActiveInputAudioDevices(out IntPtr devices, out int count);
-
-    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
-    private static extern void FreeInputAudioDevicesArray(IntPtr devices, int count);
-
-    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
-    private static extern IntPtr GetInputAudioDeviceInfo([MarshalAs(UnmanagedType.LPWStr)] string deviceId);
-
-    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
-    private static extern void FreeInputAudioDevice(IntPtr device);
+    private static InputAudioDevice ToInputAudioDevice(DeviceSnapshotEntry entry) =>
+        new(new InputAudioDeviceInfo { DeviceInfo = entry.Device });
 
     [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
     private static extern void RegisterInputNotificationCallback(DeviceStateChangedCallback callback);
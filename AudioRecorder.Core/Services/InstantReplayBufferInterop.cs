@@ -0,0 +1,30 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+internal static class InstantReplayBufferInterop
+{
+    // Windows from 256 MiB on are kept in a mapped file in backingDirectory, null keeps them in memory.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    public static extern IntPtr CreateInstantReplayBuffer(uint sampleRate, ushort bitsPerSample, ushort channels,
+        int durationSeconds, string? backingDirectory);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void DestroyInstantReplayBuffer(IntPtr buffer);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void AppendInstantReplayBuffer(IntPtr buffer, in byte data, int size);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void AppendSilenceInstantReplayBuffer(IntPtr buffer, ulong frames);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void ResizeInstantReplayBuffer(IntPtr buffer, int durationSeconds);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void ClearInstantReplayBuffer(IntPtr buffer);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool SaveInstantReplayToWav(IntPtr buffer, int seconds, string filePath);
+}
@@ -0,0 +1,21 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct MixdownBenchmarkOptions
+{
+    // Runs with 1, 2, 3, ... sources up to MaxSources.
+    public uint MaxSources;
+    public uint BlockCount;
+    public uint SampleRate;
+}
+
+internal static class MixdownBenchmarkInterop
+{
+    // Times the mixdown block by block for every source count and appends one JSON object per count to
+    // resultPath (blockNs, nsPerBlockPerSource, blockDurationShare). Returns an HRESULT.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int RunMixerBenchmark(ref MixdownBenchmarkOptions options,
+        [MarshalAs(UnmanagedType.LPWStr)] string resultPath);
+}
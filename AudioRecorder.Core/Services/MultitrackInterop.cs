@@ -0,0 +1,33 @@
+﻿using System.Runtime.InteropServices;
+using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+// Multitrack container (.amt): all sources of a save in one file, time-aligned, with a seek index.
+internal static class MultitrackInterop
+{
+    public const string FileExtension = ".amt";
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool SaveInstantReplaysToMultitrack([In] MultitrackReplaySource[] sources, int count,
+        int seconds, string filePath);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    public static extern IntPtr OpenMultitrackReader(string filePath);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void CloseMultitrackReader(IntPtr reader);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int GetMultitrackTrackCount(IntPtr reader);
+
+    // Returns the number of frames copied, reading from any position costs one index lookup.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern ulong ReadMultitrackTrack(IntPtr reader, int track, ulong startFrame, [Out] byte[] destination,
+        ulong frames);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool ExtractMultitrackTrackToWav(IntPtr reader, int track, string filePath);
+}
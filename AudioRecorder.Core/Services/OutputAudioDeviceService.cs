@@ -35,6 +35,10 @@ internal sealed class OutputAudioDeviceService
 
     public event Action<string, int>? DeviceStateChanged;
 
+    private readonly object _changesLock = new();
+    // Last generation of the native change log applied, 0 before the first snapshot.
+    private ulong _generation;
+
     private OutputAudioDeviceService()
     {
         ActiveOutputAudioDevices // TODO: проверить обновление UI при изменении устройств и сессий у устройств
@@ -50,13 +54,8 @@ internal sealed class OutputAudioDeviceService
             _sessionStateChangedCallback = OnSessionStateChanged;
             RegisterOutputNotificationCallback(_deviceStateChangedCallback);
 
-            var audioDevices = GetOutputAudioDevices().ToArray();
-            ActiveOutputAudioDevices.AddRange(audioDevices);
-
-            foreach (var device in audioDevices)
-            {
-                RegisterSessionNotificationCallback(device.Id, _sessionStateChangedCallback);
-            }
+            // Generation 0 is answered with a snapshot of every active device.
+            ApplyChanges();
 
             Logger.LogInfo("Listening for audio device changes...");
         }
@@ -75,11 +74,96 @@ internal sealed class OutputAudioDeviceService
         }
     }
 
-    private void OnDeviceStateChanged(string deviceId, int newState)
+    // The callbacks only signal that something changed, what did is read from the native change log.
+    private void OnDeviceStateChanged(string deviceId, int newState) => ApplyChanges();
+
+    private void OnSessionStateChanged(string deviceId, string sessionId, int newState) => ApplyChanges();
+
+    private void ApplyChanges()
     {
+        lock (_changesLock)
+        {
+            var changes = DeviceSnapshotInterop.GetOutputChanges(_generation);
+            if (changes == null)
+            {
+                Logger.LogWarning("Failed to read audio device changes");
+                return;
+            }
+
+            if (changes.Snapshot != null)
+                ApplySnapshot(changes.Snapshot);
+
+            // A device is read at most once per batch, however many of its sessions changed.
+            var readDevices = new Dictionary<string, OutputAudioDevice?>();
+            foreach (var change in changes.Changes)
+            {
+                switch (change.Kind)
+                {
+                    case DeviceChangeKind.DeviceState:
+                        ApplyDeviceState(change.DeviceId, change.State, readDevices);
+                        break;
+                    case DeviceChangeKind.SessionState:
+                        ApplySessionState(change.DeviceId, change.SessionId, change.State, readDevices);
+                        break;
+                    case DeviceChangeKind.SessionNames:
+                        ApplySessionNames(change.DeviceId, readDevices);
+                        break;
+                }
+            }
+
+            _generation = changes.Generation;
+        }
+    }
+
+    // The snapshot may already show changes that are reported again later, applying them twice has
+    // to be harmless.
+    private void ApplySnapshot(DeviceSnapshotEntry[] snapshot)
+    {
+        var isInitial = _generation == 0;
+        var devices = snapshot.Select(ToOutputAudioDevice).ToDictionary(device => device.Id);
+
+        foreach (var device in ActiveOutputAudioDevices.Where(device => !devices.ContainsKey(device.Id)).ToArray())
+        {
+            ActiveOutputAudioDevices.Remove(device);
+            UnregisterSessionNotificationCallback(device.Id);
+            DeviceStateChanged?.Invoke(device.Id, DeviceStateNotPresent);
+        }
+
+        var added = new List<OutputAudioDevice>();
+        foreach (var device in devices.Values)
+        {
+            var existing = ActiveOutputAudioDevices.FirstOrDefault(d => d.Id == device.Id);
+            if (existing == null)
+            {
+                added.Add(device);
+                continue;
+            }
+
+            foreach (var session in existing.AudioSessions.Where(s => device.AudioSessions.All(n => n.SessionId != s.SessionId)).ToArray())
+                existing.AudioSessions.Remove(session);
+            foreach (var session in device.AudioSessions.Where(n => existing.AudioSessions.All(s => s.SessionId != n.SessionId)).ToArray())
+                existing.AudioSessions.Add(session);
+        }
+
+        ActiveOutputAudioDevices.AddRange(added);
+        foreach (var device in added)
+        {
+            if (_sessionStateChangedCallback != null)
+                RegisterSessionNotificationCallback(device.Id, _sessionStateChangedCallback);
+            if (!isInitial)
+                DeviceStateChanged?.Invoke(device.Id, DeviceStateActive);
+        }
+    }
+
+    private void ApplyDeviceState(string deviceId, int newState, Dictionary<string, OutputAudioDevice?> readDevices)
+    {
+        var existing = ActiveOutputAudioDevices.FirstOrDefault(device => device.Id == deviceId);
         if (newState == DeviceStateActive)
         {
-            var audioDevice = GetOutputAudioDevice(deviceId);
+            if (existing != null)
+                return;
+
+            var audioDevice = ReadDevice(deviceId, readDevices);
             if (audioDevice == null)
                 return;
 
@@ -89,18 +173,18 @@ internal sealed class OutputAudioDeviceService
         }
         else
         {
-            var deviceToRemove = ActiveOutputAudioDevices.FirstOrDefault(device => device.Id == deviceId);
-            if (deviceToRemove == null)
+            if (existing == null)
                 return;
 
-            ActiveOutputAudioDevices.Remove(deviceToRemove);
+            ActiveOutputAudioDevices.Remove(existing);
             UnregisterSessionNotificationCallback(deviceId);
         }
 
         DeviceStateChanged?.Invoke(deviceId, newState);
     }
 
-    private void OnSessionStateChanged(string deviceId, string sessionId, int newState)
+    private void ApplySessionState(string deviceId, string sessionId, int newState,
+        Dictionary<string, OutputAudioDevice?> readDevices)
     {
         var device = ActiveOutputAudioDevices.FirstOrDefault(d => d.Id == deviceId);
         if (device == null)
@@ -116,7 +200,7 @@ internal sealed class OutputAudioDeviceService
             if (existing != null) return;
             Logger.LogInfo($"New session detected: {sessionId} for device {deviceId}");
 
-            var updatedDevice = GetOutputAudioDevice(deviceId);
+            var updatedDevice = ReadDevice(deviceId, readDevices);
             var updatedSession = updatedDevice?.AudioSessions.FirstOrDefault(s => s.SessionId == sessionId);
             if (updatedSession != null)
             {
@@ -131,55 +215,40 @@ internal sealed class OutputAudioDeviceService
         }
     }
 
-    private static IEnumerable<OutputAudioDevice> GetOutputAudioDevices()
+    // Product names of session processes are resolved in the background, the sessions first show
+    // the file name.
+    private void ApplySessionNames(string deviceId, Dictionary<string, OutputAudioDevice?> readDevices)
     {
-        var audioDevices = new List<OutputAudioDevice>();
-
-        GetActiveOutputAudioDevices(out var devicesPtr, out var count);
+        var device = ActiveOutputAudioDevices.FirstOrDefault(d => d.Id == deviceId);
+        if (device == null)
+            return;
 
-        if (devicesPtr == IntPtr.Zero || count == 0)
-            return audioDevices;
+        var updatedDevice = ReadDevice(deviceId, readDevices);
+        if (updatedDevice == null)
+            return;
 
-        for (var i = 0; i < count; ++i)
+        foreach (var session in device.AudioSessions)
         {
-            var currentPtr = IntPtr.Add(devicesPtr, i * Marshal.SizeOf<OutputAudioDeviceInfo>());
-            var deviceStruct = Marshal.PtrToStructure<OutputAudioDeviceInfo>(currentPtr);
-
-            var audioDevice = new OutputAudioDevice(deviceStruct);
-            audioDevices.Add(audioDevice);
+            var updatedSession = updatedDevice.AudioSessions.FirstOrDefault(s => s.SessionId == session.SessionId);
+            if (updatedSession != null)
+                session.DisplayName = updatedSession.DisplayName;
         }
-
-        FreeOutputAudioDevicesArray(devicesPtr, count);
-
-        return audioDevices;
     }
 
-    private static OutputAudioDevice? GetOutputAudioDevice(string deviceId)
+    private static OutputAudioDevice? ReadDevice(string deviceId, Dictionary<string, OutputAudioDevice?> readDevices)
     {
-        var audioDevicePtr = GetOutputAudioDeviceInfo(deviceId);
-
-        if (audioDevicePtr == IntPtr.Zero)
-            return null;
-
-        var deviceStruct = Marshal.PtrToStructure<OutputAudioDeviceInfo>(audioDevicePtr);
-        var audioDevice = new OutputAudioDevice(deviceStruct);
-
-        FreeOutputAudioDevice(audioDevicePtr);
+        if (!readDevices.TryGetValue(deviceId, out var device))
+        {
+            var devices = DeviceSnapshotInterop.GetOutputDevices(deviceId);
+            device = devices.Length == 0 ? null : ToOutputAudioDevice(devices[0]);
+            readDevices[deviceId] = device;
+        }
 
-        return audioDevice;
+        return device;
     }
 
-    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
-    private static extern void GetActiveOutputAudioDevices(out IntPtr devices, out int count);
-
-    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
-    private static extern void FreeOutputAudioDevicesArray(IntPtr devices, int count);
-
-    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
-    private static extern IntPtr GetOutputAudioDeviceInfo([MarshalAs(UnmanagedType.LPWStr)] string deviceId);
-
-    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
-    private static extern void FreeOutputAudioDevice(IntPtr device);
+    private static OutputAudioDevice ToOutputAudioDevice(DeviceSnapshotEntry entry) =>
+        new(entry.Device, entry.Sessions.Select(session => new AudioSession(entry.Device, session)));
 
     [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
     private static extern void RegisterOutputNotificationCallback(DeviceStateChangedCallback callback);
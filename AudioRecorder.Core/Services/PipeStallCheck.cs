@@ -0,0 +1,142 @@
+﻿using System.Buffers.Binary;
+using System.IO.Pipes;
+using System.Text;
+using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+// Feeds AudioDataProcessor's pipe reader through an in-process pipe that goes quiet in the middle of a
+// record and of a record header for longer than any read timeout, then resumes, and checks that the
+// recording written from it holds exactly the audio and silence that were sent.
+internal static class PipeStallCheck
+{
+    private const int HeaderSize = 8;
+    private const uint AudioType = 0;
+    private const uint SilenceType = 1;
+    private const int FrameSize = 4;
+    private const int SilenceFrames = 441;
+    // Longer than the two seconds after which the pipe reader used to give up on a read.
+    public const int DefaultStallMilliseconds = 2500;
+
+    // Returns true when the recording matches, the temporary files are removed either way.
+    public static bool Run(string workDirectory, int stallMilliseconds = DefaultStallMilliseconds)
+    {
+        var pipeName = $"AudioDataPipeStallCheck_{Environment.ProcessId}_{Environment.TickCount64}";
+        var filePath = Path.Combine(workDirectory, $"{pipeName}.wav");
+
+        var first = CreateAudio(4410, 1);
+        var second = CreateAudio(1764, 7);
+        var stream = new List<byte>();
+        stream.AddRange(CreateHeader(AudioType, (uint)first.Length));
+        stream.AddRange(first);
+        stream.AddRange(CreateHeader(SilenceType, (uint)SilenceFrames));
+        stream.AddRange(CreateHeader(AudioType, (uint)second.Length));
+        stream.AddRange(second);
+        var bytes = stream.ToArray();
+
+        // One stall inside the first record's audio, one inside the second record's header.
+        var firstStall = HeaderSize + first.Length / 2;
+        var secondStall = 3 * HeaderSize + first.Length - HeaderSize / 2;
+
+        try
+        {
+            using (var audioData = new AudioData(0, AudioTargetType.Process) { Name = pipeName })
+            {
+                if (!audioData.StartRecording(filePath))
+                {
+                    Logger.LogError("Pipe stall check: failed to create the recording file.");
+                    return false;
+                }
+
+                using (var client = AudioDataProcessor.CreatePipeClient(pipeName))
+                {
+                    Thread reader;
+                    // Closing the server's end, like a stopped capture, lets the reader finish what is in the pipe.
+                    using (var server = new NamedPipeServerStream(pipeName, PipeDirection.Out, 1, PipeTransmissionMode.Byte,
+                               PipeOptions.Asynchronous))
+                    {
+                        var connection = server.WaitForConnectionAsync();
+                        client.Connect(AudioDataProcessor.PipeTimeout);
+                        connection.GetAwaiter().GetResult();
+
+                        reader = new Thread(() => AudioDataProcessor.ProcessPipe(client, audioData, silenceRecords: true));
+                        reader.Start();
+
+                        server.Write(bytes, 0, firstStall);
+                        Thread.Sleep(stallMilliseconds);
+                        server.Write(bytes, firstStall, secondStall - firstStall);
+                        Thread.Sleep(stallMilliseconds);
+                        server.Write(bytes, secondStall, bytes.Length - secondStall);
+                    }
+
+                    if (!reader.Join(AudioDataProcessor.DrainTimeout))
+                    {
+                        audioData.CancelRequested = true;
+                        client.Close();
+                        reader.Join();
+                        Logger.LogError("Pipe stall check: the reader did not end with the pipe.");
+                        return false;
+                    }
+                }
+
+                audioData.FinishRecording();
+            }
+
+            var expected = new byte[first.Length + SilenceFrames * FrameSize + second.Length];
+            first.CopyTo(expected, 0);
+            second.CopyTo(expected, expected.Length - second.Length);
+
+            var recorded = ReadWavData(filePath);
+            if (recorded == null || !recorded.AsSpan().SequenceEqual(expected))
+            {
+                Logger.LogError($"Pipe stall check: recorded {recorded?.Length ?? 0} bytes, expected {expected.Length} intact bytes.");
+                return false;
+            }
+
+            Logger.LogInfo($"Pipe stall check: {expected.Length} bytes intact across two {stallMilliseconds} ms stalls.");
+            return true;
+        }
+        finally
+        {
+            File.Delete(filePath);
+        }
+    }
+
+    private static byte[] CreateHeader(uint type, uint size)
+    {
+        var header = new byte[HeaderSize];
+        BinaryPrimitives.WriteUInt32LittleEndian(header, type);
+        BinaryPrimitives.WriteUInt32LittleEndian(header.AsSpan(4), size);
+        return header;
+    }
+
+    // Non-zero 16 bit stereo, so that lost or shifted bytes cannot pass for silence.
+    private static byte[] CreateAudio(int frames, int seed)
+    {
+        var audio = new byte[frames * FrameSize];
+        for (var i = 0; i < audio.Length; ++i)
+            audio[i] = (byte)((i * 31 + seed) % 255 + 1);
+        return audio;
+    }
+
+    private static byte[]? ReadWavData(string filePath)
+    {
+        var file = File.ReadAllBytes(filePath);
+        if (file.Length < 12 || Encoding.ASCII.GetString(file, 0, 4) != "RIFF" || Encoding.ASCII.GetString(file, 8, 4) != "WAVE")
+            return null;
+
+        var offset = 12;
+        while (offset + HeaderSize <= file.Length)
+        {
+            var id = Encoding.ASCII.GetString(file, offset, 4);
+            var size = (int)Math.Min(BinaryPrimitives.ReadUInt32LittleEndian(file.AsSpan(offset + 4)),
+                (uint)(file.Length - offset - HeaderSize));
+            if (id == "data")
+                return file.AsSpan(offset + HeaderSize, size).ToArray();
+
+            offset += HeaderSize + size + (size & 1);
+        }
+
+        return null;
+    }
+}
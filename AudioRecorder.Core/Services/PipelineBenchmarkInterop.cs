@@ -0,0 +1,37 @@
+﻿using System.Runtime.InteropServices;
+using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct PipelineBenchmarkOptions
+{
+    // Runs with 1, 2, 4, ... simulated sources up to and including MaxSources.
+    public uint MaxSources;
+    public uint DurationMs;
+    public uint SampleRate;
+    public uint Channels;
+    // 0 for 10 ms packets.
+    public uint PacketFrames;
+    public uint JitterMicroseconds;
+    public AudioTransportType Transport;
+    [MarshalAs(UnmanagedType.Bool)]
+    public bool MixdownEnabled;
+    // Temp directory when null.
+    [MarshalAs(UnmanagedType.BStr)]
+    public string? OutputDirectory;
+    // Same as CaptureOptions, one run per setting gives writes per second against latency.
+    public uint CoalesceMaxBytes;
+    public uint CoalesceMaxLatencyMs;
+    // Slow consumer: sleeps this long after every read, callback p99 and droppedBytes show the effect.
+    public uint ConsumerDelayMs;
+}
+
+internal static class PipelineBenchmarkInterop
+{
+    // Blocks until every run has finished and appends one JSON object per run to resultPath.
+    // Returns an HRESULT.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int RunCaptureBenchmark(ref PipelineBenchmarkOptions options,
+        [MarshalAs(UnmanagedType.LPWStr)] string resultPath);
+}
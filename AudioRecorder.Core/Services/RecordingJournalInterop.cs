@@ -0,0 +1,16 @@
+﻿using System.Runtime.InteropServices;
+using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+internal static class RecordingJournalInterop
+{
+    // Appended to the recording's file name, the journal sits next to the recording.
+    public const string JournalExtension = ".journal";
+    // At most this much of an interrupted recording is lost.
+    public const uint DefaultSegmentMilliseconds = 10000;
+
+    // Returns an HRESULT. The journal is deleted when the recording was rebuilt.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    public static extern int RecoverInterruptedRecording(string filePath, out RecoveredRecording result);
+}
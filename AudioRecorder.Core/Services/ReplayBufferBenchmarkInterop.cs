@@ -0,0 +1,29 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct ReplayBufferBenchmarkOptions
+{
+    public uint WindowSeconds;
+    public uint SampleRate;
+    public ushort Channels;
+    public ushort BitsPerSample;
+    public uint SaveSeconds;
+    public uint SaveCount;
+    // Mapped file instead of memory.
+    [MarshalAs(UnmanagedType.Bool)]
+    public bool FileBacked;
+    // Temp directory when null.
+    [MarshalAs(UnmanagedType.BStr)]
+    public string? Directory;
+}
+
+internal static class ReplayBufferBenchmarkInterop
+{
+    // Blocks until the window has been filled and saved SaveCount times and appends one JSON object
+    // to resultPath (megabytesPerSecond, appendLatencyUs, saveLatencyMs, privateBytes). Returns an HRESULT.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int RunInstantReplayBenchmark(ref ReplayBufferBenchmarkOptions options,
+        [MarshalAs(UnmanagedType.LPWStr)] string resultPath);
+}
@@ -0,0 +1,21 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+[StructLayout(LayoutKind.Sequential)]
+internal struct SampleConverterBenchmarkOptions
+{
+    // Samples per kernel call.
+    public uint BlockSamples;
+    // Time each kernel is run for.
+    public uint DurationMs;
+}
+
+internal static class SampleConverterBenchmarkInterop
+{
+    // Times every sample format conversion kernel per supported instruction set and appends one JSON object
+    // per kernel to resultPath (samplesPerSecond, speedupOverScalar). Returns an HRESULT.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int RunFormatConverterBenchmark(ref SampleConverterBenchmarkOptions options,
+        [MarshalAs(UnmanagedType.LPWStr)] string resultPath);
+}
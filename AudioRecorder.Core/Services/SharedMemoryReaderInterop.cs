@@ -0,0 +1,19 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+internal static class SharedMemoryReaderInterop
+{
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern IntPtr OpenSharedMemoryReader(uint pipeId, long captureId);
+
+    // Returns the number of bytes read, 0 on timeout and -1 once the capture source has stopped.
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern int ReadSharedMemory(IntPtr reader, [Out] byte[] buffer, int bufferSize, uint timeoutMs);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern ulong GetSharedMemoryLostRecords(IntPtr reader);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    public static extern void CloseSharedMemoryReader(IntPtr reader);
+}
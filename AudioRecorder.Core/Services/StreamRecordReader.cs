@@ -0,0 +1,59 @@
+﻿using System.Buffers.Binary;
+using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+// Splits a stream with silence records back into audio and silence runs. Every record is an 8 byte
+// header (type, size) followed, for audio, by size bytes of PCM; a silence record stands for size
+// frames and has no payload. Reads may end anywhere inside a record, the reader carries over.
+internal sealed class StreamRecordReader
+{
+    private const int HeaderSize = 8;
+    private const uint AudioType = 0;
+    private const uint SilenceType = 1;
+
+    private readonly byte[] _header = new byte[HeaderSize];
+    private int _headerBytes;
+    private uint _remainingAudioBytes;
+
+    // Returns false on an unknown record type, the stream cannot be followed after that.
+    public bool Process(byte[] buffer, int count, AudioData target)
+    {
+        var offset = 0;
+        while (offset < count)
+        {
+            if (_remainingAudioBytes > 0)
+            {
+                var size = (int)Math.Min(_remainingAudioBytes, (uint)(count - offset));
+                target.AddData(buffer, offset, size);
+                offset += size;
+                _remainingAudioBytes -= (uint)size;
+                continue;
+            }
+
+            var headerBytes = Math.Min(HeaderSize - _headerBytes, count - offset);
+            Buffer.BlockCopy(buffer, offset, _header, _headerBytes, headerBytes);
+            _headerBytes += headerBytes;
+            offset += headerBytes;
+            if (_headerBytes < HeaderSize)
+                break;
+
+            _headerBytes = 0;
+            var type = BinaryPrimitives.ReadUInt32LittleEndian(_header);
+            var recordSize = BinaryPrimitives.ReadUInt32LittleEndian(_header.AsSpan(4));
+            switch (type)
+            {
+                case AudioType:
+                    _remainingAudioBytes = recordSize;
+                    break;
+                case SilenceType:
+                    target.AddSilence(recordSize);
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,22 @@
+﻿using System.Runtime.InteropServices;
+
+namespace AudioRecorder.Core.Services;
+
+internal static class WavFileWriterInterop
+{
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    public static extern IntPtr CreateWavFileWriter(string filePath, uint sampleRate, ushort bitsPerSample,
+        ushort channels, [MarshalAs(UnmanagedType.Bool)] bool isFloat, uint journalSegmentMs);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool AppendWavFileWriter(IntPtr writer, in byte data, int size);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool AppendSilenceWavFileWriter(IntPtr writer, ulong frames);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.Bool)]
+    public static extern bool CloseWavFileWriter(IntPtr writer);
+}
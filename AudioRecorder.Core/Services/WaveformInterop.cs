@@ -0,0 +1,45 @@
+﻿using System.Runtime.InteropServices;
+using AudioRecorder.Core.Data;
+
+namespace AudioRecorder.Core.Services;
+
+// Min/max/RMS overviews kept at three zoom levels while audio is captured: a sidecar next to every
+// finished recording and a sliding one in every instant replay buffer. Level 2 of an hour at 48 kHz
+// is about 2,600 bins, enough to draw it without reading the audio.
+internal static class WaveformInterop
+{
+    public static readonly int[] FramesPerBin = { 256, 4096, 65536 };
+
+    // Empty when the recording has no sidecar, e.g. one that was recovered after a crash.
+    public static WaveformBin[] ReadRecordingWaveform(string filePath, int level) =>
+        ReadSized((bins, capacity) => ReadRecordingWaveform(filePath, level, bins, capacity));
+
+    public static WaveformBin[] GetInstantReplayWaveform(IntPtr buffer, int seconds, int level) =>
+        ReadSized((bins, capacity) => GetInstantReplayWaveform(buffer, seconds, level, bins, capacity));
+
+    public static WaveformBin[] GetCompressedReplayWaveform(IntPtr buffer, int seconds, int level) =>
+        ReadSized((bins, capacity) => GetCompressedReplayWaveform(buffer, seconds, level, bins, capacity));
+
+    // The window keeps sliding between the two calls, the second one may report a bin more.
+    private static WaveformBin[] ReadSized(Func<WaveformBin[]?, int, int> read)
+    {
+        var count = read(null, 0);
+        if (count <= 0)
+            return Array.Empty<WaveformBin>();
+
+        var bins = new WaveformBin[count];
+        count = read(bins, bins.Length);
+        return count <= 0 ? Array.Empty<WaveformBin>() : bins[..Math.Min(count, bins.Length)];
+    }
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall, CharSet = CharSet.Unicode)]
+    private static extern int ReadRecordingWaveform(string filePath, int level, [Out] WaveformBin[]? bins, int capacity);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    private static extern int GetInstantReplayWaveform(IntPtr buffer, int seconds, int level, [Out] WaveformBin[]? bins,
+        int capacity);
+
+    [DllImport("AudioCaptureLibrary.dll", CallingConvention = CallingConvention.StdCall)]
+    private static extern int GetCompressedReplayWaveform(IntPtr buffer, int seconds, int level, [Out] WaveformBin[]? bins,
+        int capacity);
+}
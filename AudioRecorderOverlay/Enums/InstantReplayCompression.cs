@@ -0,0 +1,10 @@
+﻿namespace AudioRecorderOverlay.Enums;
+
+// How the instant replay window is kept in memory. Pcm is the uncompressed buffer, the others
+// compress it with the matching ReplayCodec.
+internal enum InstantReplayCompression
+{
+    Pcm,
+    Flac,
+    ImaAdpcm,
+}
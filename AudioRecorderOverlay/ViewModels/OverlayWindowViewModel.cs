@@ -93,6 +93,14 @@ internal sealed class OverlayWindowViewModel : ReactiveObject
     private readonly ObservableAsPropertyHelper<ObservableCollection<AudioSession>> _filteredAudioSessions;
     public ObservableCollection<AudioSession> FilteredAudioSessions => _filteredAudioSessions.Value;
     
+    // The defaults with the user's settings applied, read once per capture.
+    private static CaptureOptions GetCaptureOptions()
+    {
+        var options = CaptureOptions.Default;
+        options.MixdownEnabled = SettingsDialogViewModel.Instance.MixdownEnabled;
+        return options;
+    }
+
     private AudioDataProcessor? _activeInstantReplayProcessor;
     private AudioDataProcessor? _activeRecordingProcessor;
 
@@ -207,12 +215,16 @@ internal sealed class OverlayWindowViewModel : ReactiveObject
                 return;
             }
 
-            var captureId = AudioCaptureService.StartCapture(activeRecordingInputDevices, activeRecordingOutputDevices, activeRecordingAudioSessions);
+            var captureOptions = GetCaptureOptions();
+            var captureId = AudioCaptureService.StartCapture(activeRecordingInputDevices, activeRecordingOutputDevices, activeRecordingAudioSessions,
+                captureOptions);
             _activeInstantReplayProcessor =
                 new AudioDataProcessor(captureId, activeRecordingInputDevices, activeRecordingOutputDevices,
                     activeRecordingAudioSessions,
                     isInstantReplayMode: true,
-                    instantReplayDuration: SettingsDialogViewModel.Instance.InstantReplayDurationSeconds);
+                    instantReplayDuration: SettingsDialogViewModel.Instance.InstantReplayDurationSeconds,
+                    captureOptions: captureOptions,
+                    replayCodec: SettingsDialogViewModel.Instance.InstantReplayCodec);
 
             SettingsDialogViewModel.Instance
                 .WhenAnyValue(vm => vm.InstantReplayDurationSeconds)
@@ -235,8 +247,10 @@ internal sealed class OverlayWindowViewModel : ReactiveObject
         {
             await Task.Run(() =>
             {
-                _activeInstantReplayProcessor.Stop();
+                // The native side drains its pipes on stop, the readers have to keep going until then.
                 AudioCaptureService.StopCapture(_activeInstantReplayProcessor.CaptureId);
+                _activeInstantReplayProcessor.Stop();
+                _activeInstantReplayProcessor.Dispose();
                 _activeInstantReplayProcessor = null;
             });
         }
@@ -257,7 +271,8 @@ internal sealed class OverlayWindowViewModel : ReactiveObject
             if (!Directory.Exists(basePath))
                 Directory.CreateDirectory(basePath);
 
-            _activeInstantReplayProcessor?.SaveAllAudioData(basePath);
+            _activeInstantReplayProcessor?.SaveAllAudioData(basePath,
+                SettingsDialogViewModel.Instance.SaveInstantReplayAsMultitrack);
         });
     }
 
@@ -284,9 +299,24 @@ internal sealed class OverlayWindowViewModel : ReactiveObject
                 return;
             }
 
-            var captureId = AudioCaptureService.StartCapture(activeRecordingInputDevices, activeRecordingOutputDevices, activeRecordingAudioSessions);
+            // TODO move to settings
+            const string applicationName = "AudioRecorder";
+            var basePath = Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.MyMusic),
+                applicationName);
+
+            if (!Directory.Exists(basePath))
+                Directory.CreateDirectory(basePath);
+
+            // Only one recording runs at a time, so every journal left here belongs to a dead one.
+            AudioDataProcessor.RecoverInterruptedRecordings(basePath);
+
+            var captureOptions = GetCaptureOptions();
+            var captureId = AudioCaptureService.StartCapture(activeRecordingInputDevices, activeRecordingOutputDevices, activeRecordingAudioSessions,
+                captureOptions);
             _activeRecordingProcessor =
-                new AudioDataProcessor(captureId, activeRecordingInputDevices, activeRecordingOutputDevices, activeRecordingAudioSessions);
+                new AudioDataProcessor(captureId, activeRecordingInputDevices, activeRecordingOutputDevices, activeRecordingAudioSessions,
+                    recordingDirectory: basePath, captureOptions: captureOptions,
+                    recordingFormat: SettingsDialogViewModel.Instance.RecordingFormat);
             var ok = _activeRecordingProcessor.Start();
             if (!ok)
                 Dispatcher.UIThread.Post(() => _ = StopCaptureAsync());
@@ -304,18 +334,11 @@ internal sealed class OverlayWindowViewModel : ReactiveObject
         {
             await Task.Run(() =>
             {
-                _activeRecordingProcessor.Stop();
+                // The native side drains its pipes on stop, the readers have to keep going until then.
                 AudioCaptureService.StopCapture(_activeRecordingProcessor.CaptureId);
-
-                // TODO move to settings
-                const string applicationName = "AudioRecorder";
-                var basePath = Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.MyMusic),
-                    applicationName);
-
-                if (!Directory.Exists(basePath))
-                    Directory.CreateDirectory(basePath);
-
-                _activeRecordingProcessor.SaveAllAudioData(basePath);
+                _activeRecordingProcessor.Stop();
+                _activeRecordingProcessor.FinishRecording();
+                _activeRecordingProcessor.Dispose();
                 _activeRecordingProcessor = null;
             });
         }
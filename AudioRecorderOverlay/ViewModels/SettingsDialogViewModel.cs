@@ -3,7 +3,9 @@ using System.IO;
 using System.Reflection;
 using System.Text.Json;
 using System.Text.Json.Serialization;
+using AudioRecorder.Core.Data;
 using AudioRecorder.Core.Services;
+using AudioRecorderOverlay.Enums;
 using Avalonia;
 using Avalonia.Styling;
 using FluentAvalonia.Styling;
@@ -55,6 +57,53 @@ internal sealed class SettingsDialogViewModel : ReactiveObject
         set => this.RaiseAndSetIfChanged(ref _instantReplayDurationSeconds, value);
     }
 
+    private bool _mixdownEnabled = true;
+    // Adds a stereo mix of all captured sources as one more track.
+    public bool MixdownEnabled
+    {
+        get => _mixdownEnabled;
+        set => this.RaiseAndSetIfChanged(ref _mixdownEnabled, value);
+    }
+
+    [JsonIgnore]
+    public InstantReplayCompression[] InstantReplayCompressions { get; } = Enum.GetValues<InstantReplayCompression>();
+
+    private InstantReplayCompression _instantReplayCompression = InstantReplayCompression.Pcm;
+    // Compressing the window trades CPU on every packet for a smaller buffer, see ReplayCodec.
+    public InstantReplayCompression InstantReplayCompression
+    {
+        get => _instantReplayCompression;
+        set => this.RaiseAndSetIfChanged(ref _instantReplayCompression, value);
+    }
+
+    // Codec of the compressed window, null for the PCM buffer.
+    [JsonIgnore]
+    public ReplayCodec? InstantReplayCodec => InstantReplayCompression switch
+    {
+        InstantReplayCompression.Flac => ReplayCodec.Flac,
+        InstantReplayCompression.ImaAdpcm => ReplayCodec.ImaAdpcm,
+        _ => null
+    };
+
+    private bool _saveInstantReplayAsMultitrack;
+    // Saves every track of the replay into one multitrack file instead of a WAV file per track.
+    public bool SaveInstantReplayAsMultitrack
+    {
+        get => _saveInstantReplayAsMultitrack;
+        set => this.RaiseAndSetIfChanged(ref _saveInstantReplayAsMultitrack, value);
+    }
+
+    [JsonIgnore]
+    public RecordingFileFormat[] RecordingFormats { get; } = Enum.GetValues<RecordingFileFormat>();
+
+    private RecordingFileFormat _recordingFormat = RecordingFileFormat.Wav;
+    // File format of new recordings. FLAC is lossless at about half the size, WAV opens everywhere.
+    public RecordingFileFormat RecordingFormat
+    {
+        get => _recordingFormat;
+        set => this.RaiseAndSetIfChanged(ref _recordingFormat, value);
+    }
+
     [JsonIgnore]
     public string CurrentVersion =>
         Assembly.GetExecutingAssembly().GetName().Version?.ToString() ?? "";
@@ -95,6 +144,10 @@ internal sealed class SettingsDialogViewModel : ReactiveObject
 
             CurrentAppTheme = settings.CurrentAppTheme;
             InstantReplayDurationSeconds = settings.InstantReplayDurationSeconds;
+            MixdownEnabled = settings.MixdownEnabled;
+            RecordingFormat = settings.RecordingFormat;
+            InstantReplayCompression = settings.InstantReplayCompression;
+            SaveInstantReplayAsMultitrack = settings.SaveInstantReplayAsMultitrack;
         }
         catch (Exception ex)
         {